@@ -164,6 +164,22 @@ ATOMIC_INLINE int32_t atomic_fetch_and_and_int32(int32_t *p, int32_t x)
   return InterlockedAnd((long *)p, x);
 }
 
+/******************************************************************************/
+/* 16-bit operations. */
+
+/* Signed */
+#pragma intrinsic(_InterlockedAnd16)
+ATOMIC_INLINE int16_t atomic_fetch_and_and_int16(int16_t *p, int16_t b)
+{
+  return _InterlockedAnd16((short *)p, (short)b);
+}
+
+#pragma intrinsic(_InterlockedOr16)
+ATOMIC_INLINE int16_t atomic_fetch_and_or_int16(int16_t *p, int16_t b)
+{
+  return _InterlockedOr16((short *)p, (short)b);
+}
+
 /******************************************************************************/
 /* 8-bit operations. */
 
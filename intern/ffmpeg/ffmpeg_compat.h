@@ -110,6 +110,17 @@
 #  define FFMPEG_HAVE_ENCODE_AUDIO2
 #endif
 
+/* Codec capability flags were renamed with the `AV_` prefix in libavcodec 56.56. */
+#ifndef AV_CODEC_CAP_AUTO_THREADS
+#  define AV_CODEC_CAP_AUTO_THREADS CODEC_CAP_AUTO_THREADS
+#endif
+#ifndef AV_CODEC_CAP_FRAME_THREADS
+#  define AV_CODEC_CAP_FRAME_THREADS CODEC_CAP_FRAME_THREADS
+#endif
+#ifndef AV_CODEC_CAP_SLICE_THREADS
+#  define AV_CODEC_CAP_SLICE_THREADS CODEC_CAP_SLICE_THREADS
+#endif
+
 #if ((LIBAVCODEC_VERSION_MAJOR > 53) || \
      (LIBAVCODEC_VERSION_MAJOR >= 53) && (LIBAVCODEC_VERSION_MINOR >= 42))
 #  define FFMPEG_HAVE_DECODE_AUDIO4
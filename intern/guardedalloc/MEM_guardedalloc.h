@@ -226,6 +226,30 @@ void MEM_use_memleak_detection(bool enabled);
  * tests. */
 void MEM_enable_fail_on_memleak(void);
 
+/**
+ * Enable the sampling heap profiler of the lock-free allocator: the name and call stack of the
+ * allocation containing every \a sample_interval'th allocated byte is recorded. This gives
+ * estimates of the memory in use per allocation name, with little overhead. Zero disables it.
+ * The guarded allocator keeps track of all allocations instead.
+ */
+void MEM_enable_sampling(size_t sample_interval);
+
+/** Print the estimated live and peak memory per allocation name, when sampling is used. */
+void MEM_print_sampling_stats(void);
+
+/** Print the sampled statistics with the next sampled allocation, safe in signal handlers. */
+void MEM_request_print_sampling_stats(void);
+
+/**
+ * Call \a func with the estimated live and peak memory of every sampled allocation name.
+ * The statistics are copied first, so \a func may allocate memory.
+ */
+void MEM_sampling_foreach_name(void (*func)(void *user_data,
+                                            const char *name,
+                                            size_t live,
+                                            size_t peak),
+                               void *user_data);
+
 /* Switch allocator to slower but fully guarded mode. */
 void MEM_use_guarded_allocator(void);
 
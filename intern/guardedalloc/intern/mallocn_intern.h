@@ -112,6 +112,12 @@ void aligned_free(void *ptr);
 extern bool leak_detector_has_run;
 extern char free_after_leak_detection_message[];
 
+/* Sampling heap profiler, used by the lock-free allocator. */
+extern size_t mem_sampling_interval;
+bool mem_sampling_should_sample(size_t len);
+bool mem_sampling_add(const void *ptr, size_t len, const char *str);
+void mem_sampling_remove(const void *ptr);
+
 /* Prototypes for counted allocator functions */
 size_t MEM_lockfree_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
 void MEM_lockfree_freeN(void *vmemh);
@@ -51,12 +51,15 @@ static void (*error_callback)(const char *) = NULL;
 
 enum {
   MEMHEAD_ALIGN_FLAG = 1,
+  /** Set for allocations recorded by the sampling heap profiler, see mallocn_sampling.c. */
+  MEMHEAD_SAMPLED_FLAG = 2,
 };
 
 #define MEMHEAD_FROM_PTR(ptr) (((MemHead *)ptr) - 1)
 #define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
 #define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned *)ptr) - 1)
 #define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & (size_t)MEMHEAD_ALIGN_FLAG)
+#define MEMHEAD_IS_SAMPLED(memhead) ((memhead)->len & (size_t)MEMHEAD_SAMPLED_FLAG)
 
 /* Uncomment this to have proper peak counter. */
 #define USE_ATOMIC_MAX
@@ -70,6 +73,15 @@ MEM_INLINE void update_maximum(size_t *maximum_value, size_t value)
 #endif
 }
 
+MEM_INLINE void update_sampling(void *ptr, size_t len, const char *str)
+{
+  if (UNLIKELY(mem_sampling_interval) && mem_sampling_should_sample(len)) {
+    if (mem_sampling_add(ptr, len, str)) {
+      MEMHEAD_FROM_PTR(ptr)->len |= (size_t)MEMHEAD_SAMPLED_FLAG;
+    }
+  }
+}
+
 #ifdef __GNUC__
 __attribute__((format(printf, 1, 2)))
 #endif
@@ -92,7 +104,8 @@ print_error(const char *str, ...)
 size_t MEM_lockfree_allocN_len(const void *vmemh)
 {
   if (vmemh) {
-    return MEMHEAD_FROM_PTR(vmemh)->len & ~((size_t)(MEMHEAD_ALIGN_FLAG));
+    return MEMHEAD_FROM_PTR(vmemh)->len &
+           ~((size_t)(MEMHEAD_ALIGN_FLAG | MEMHEAD_SAMPLED_FLAG));
   }
 
   return 0;
@@ -118,6 +131,10 @@ void MEM_lockfree_freeN(void *vmemh)
   atomic_sub_and_fetch_u(&totblock, 1);
   atomic_sub_and_fetch_z(&mem_in_use, len);
 
+  if (UNLIKELY(MEMHEAD_IS_SAMPLED(memh))) {
+    mem_sampling_remove(vmemh);
+  }
+
   if (UNLIKELY(malloc_debug_memset && len)) {
     memset(memh + 1, 255, len);
   }
@@ -239,6 +256,7 @@ void *MEM_lockfree_callocN(size_t len, const char *str)
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
+    update_sampling(PTR_FROM_MEMHEAD(memh), len, str);
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -284,6 +302,7 @@ void *MEM_lockfree_mallocN(size_t len, const char *str)
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
+    update_sampling(PTR_FROM_MEMHEAD(memh), len, str);
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -355,6 +374,7 @@ void *MEM_lockfree_mallocN_aligned(size_t len, size_t alignment, const char *str
     atomic_add_and_fetch_u(&totblock, 1);
     atomic_add_and_fetch_z(&mem_in_use, len);
     update_maximum(&peak_mem, mem_in_use);
+    update_sampling(PTR_FROM_MEMHEAD(memh), len, str);
 
     return PTR_FROM_MEMHEAD(memh);
   }
@@ -391,6 +411,8 @@ void MEM_lockfree_printmemlist_stats(void)
   printf("System Statistics:\n");
   malloc_stats();
 #endif
+
+  MEM_print_sampling_stats();
 }
 
 void MEM_lockfree_set_error_callback(void (*func)(const char *))
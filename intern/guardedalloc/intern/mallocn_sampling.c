@@ -0,0 +1,393 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup MEM
+ *
+ * Sampling heap profiler for the lock-free allocator.
+ *
+ * Allocations are sampled by the number of allocated bytes: every time the total of allocated
+ * bytes passes a multiple of the sample interval, the allocation containing that byte is recorded
+ * with its name and call stack. Allocations smaller than the interval are sampled with a
+ * probability of about `len / interval`, so every sample stands for `max(len, interval)` bytes.
+ * This gives estimates of the memory used per allocation name, at a cost that only depends on
+ * the number of samples.
+ *
+ * Sampled allocations are tagged in their header, so freeing them can update the statistics.
+ * All other allocations only pay for an atomic add while sampling is enabled.
+ */
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#if defined(__linux__) || defined(__APPLE__)
+#  include <execinfo.h>
+#  include <unistd.h>
+#  define HAVE_EXECINFO
+#elif defined(WIN32)
+#  include <windows.h>
+#endif
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "atomic_ops.h"
+#include "mallocn_intern.h"
+
+/** Number of call stack frames stored per sample. */
+#define SAMPLE_STACK_LEN 8
+/** Number of frames of the profiler and allocator itself, skipped in the call stack. */
+#define SAMPLE_STACK_SKIP 2
+
+#define SAMPLE_HASH_SIZE 4096
+#define NAME_HASH_SIZE 1024
+
+/** Number of allocation names to print the call stacks for. */
+#define PRINT_STACKS_NUM 10
+
+typedef struct MemSampleName {
+  struct MemSampleName *next;
+  /** Copy of the allocation name, names are not always string literals. */
+  char *name;
+  /** Estimated number of bytes in use, and the maximum of that. */
+  size_t live, peak;
+  /** Number of sampled allocations that are still in use. */
+  unsigned int samples_num;
+} MemSampleName;
+
+typedef struct MemSample {
+  struct MemSample *next;
+  const void *ptr;
+  MemSampleName *name;
+  /** Estimated number of bytes this sample stands for. */
+  size_t weight;
+  int stack_len;
+  void *stack[SAMPLE_STACK_LEN];
+} MemSample;
+
+size_t mem_sampling_interval = 0;
+
+static struct {
+  pthread_mutex_t lock;
+  /** Total number of bytes allocated since sampling was enabled, only used to pick samples. */
+  size_t allocated;
+  MemSample *samples[SAMPLE_HASH_SIZE];
+  /** Unused samples, to avoid calling malloc and free for every sample. */
+  MemSample *samples_unused;
+  MemSampleName *names[NAME_HASH_SIZE];
+  unsigned int names_num;
+  volatile sig_atomic_t print_requested;
+  bool free_at_exit;
+} sampling = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+MEM_INLINE unsigned int sample_hash(const void *ptr)
+{
+  return (unsigned int)((((uintptr_t)ptr >> 4) * 2654435761u) & (SAMPLE_HASH_SIZE - 1));
+}
+
+MEM_INLINE unsigned int name_hash(const char *name)
+{
+  unsigned int hash = 5381;
+  for (const char *c = name; *c; c++) {
+    hash = hash * 33 + (unsigned int)*c;
+  }
+  return hash & (NAME_HASH_SIZE - 1);
+}
+
+static int sample_stack_capture(void **stack)
+{
+  void *frames[SAMPLE_STACK_LEN + SAMPLE_STACK_SKIP];
+  int frames_len = 0;
+#if defined(HAVE_EXECINFO)
+  frames_len = backtrace(frames, SAMPLE_STACK_LEN + SAMPLE_STACK_SKIP);
+#elif defined(WIN32)
+  frames_len = (int)CaptureStackBackTrace(0, SAMPLE_STACK_LEN + SAMPLE_STACK_SKIP, frames, NULL);
+#endif
+  if (frames_len <= SAMPLE_STACK_SKIP) {
+    return 0;
+  }
+  const int stack_len = frames_len - SAMPLE_STACK_SKIP;
+  memcpy(stack, frames + SAMPLE_STACK_SKIP, sizeof(void *) * (size_t)stack_len);
+  return stack_len;
+}
+
+static MemSampleName *sample_name_ensure(const char *str)
+{
+  const unsigned int hash = name_hash(str);
+  for (MemSampleName *name = sampling.names[hash]; name; name = name->next) {
+    if (strcmp(name->name, str) == 0) {
+      return name;
+    }
+  }
+
+  MemSampleName *name = calloc(1, sizeof(MemSampleName));
+  if (name) {
+    name->name = strdup(str);
+    if (name->name == NULL) {
+      free(name);
+      return NULL;
+    }
+    name->next = sampling.names[hash];
+    sampling.names[hash] = name;
+    sampling.names_num++;
+  }
+  return name;
+}
+
+static int sample_name_cmp_live(const void *a_p, const void *b_p)
+{
+  const MemSampleName *a = *(const MemSampleName **)a_p;
+  const MemSampleName *b = *(const MemSampleName **)b_p;
+  if (a->live != b->live) {
+    return (a->live < b->live) ? 1 : -1;
+  }
+  if (a->peak != b->peak) {
+    return (a->peak < b->peak) ? 1 : -1;
+  }
+  return strcmp(a->name, b->name);
+}
+
+static void sample_stack_print(const MemSample *sample)
+{
+#ifdef HAVE_EXECINFO
+  fflush(stdout);
+  /* Doesn't allocate memory, unlike #backtrace_symbols. */
+  backtrace_symbols_fd((void *const *)sample->stack, sample->stack_len, STDOUT_FILENO);
+#else
+  for (int i = 0; i < sample->stack_len; i++) {
+    printf("  %p\n", sample->stack[i]);
+  }
+#endif
+}
+
+static void sampling_print_stats_locked(void)
+{
+  MemSampleName **names = malloc(sizeof(*names) * (sampling.names_num + 1));
+  if (names == NULL) {
+    return;
+  }
+  unsigned int names_num = 0;
+  for (int i = 0; i < NAME_HASH_SIZE; i++) {
+    for (MemSampleName *name = sampling.names[i]; name; name = name->next) {
+      names[names_num++] = name;
+    }
+  }
+  qsort(names, names_num, sizeof(*names), sample_name_cmp_live);
+
+  printf("\nsampled memory statistics (one sample per " SIZET_FORMAT " bytes, estimated):\n",
+         SIZET_ARG(mem_sampling_interval));
+  printf("%12s %12s %8s  name\n", "live (MB)", "peak (MB)", "samples");
+  for (unsigned int i = 0; i < names_num; i++) {
+    printf("%12.3f %12.3f %8u  %s\n",
+           (double)names[i]->live / (double)(1024 * 1024),
+           (double)names[i]->peak / (double)(1024 * 1024),
+           names[i]->samples_num,
+           names[i]->name);
+  }
+
+  /* Print where the largest allocations of the names using the most memory come from. */
+  for (unsigned int i = 0; i < names_num && i < PRINT_STACKS_NUM; i++) {
+    const MemSample *sample_largest = NULL;
+    for (int j = 0; j < SAMPLE_HASH_SIZE; j++) {
+      for (const MemSample *sample = sampling.samples[j]; sample; sample = sample->next) {
+        if (sample->name == names[i] &&
+            (sample_largest == NULL || sample->weight > sample_largest->weight)) {
+          sample_largest = sample;
+        }
+      }
+    }
+    if (sample_largest == NULL || sample_largest->stack_len == 0) {
+      continue;
+    }
+    printf("\nlargest sampled allocation of \"%s\", " SIZET_FORMAT " bytes:\n",
+           names[i]->name,
+           SIZET_ARG(sample_largest->weight));
+    sample_stack_print(sample_largest);
+  }
+  fflush(stdout);
+
+  free(names);
+}
+
+bool mem_sampling_should_sample(size_t len)
+{
+  const size_t interval = mem_sampling_interval;
+  if (interval == 0) {
+    return false;
+  }
+  const size_t allocated_prev = atomic_fetch_and_add_z(&sampling.allocated, len);
+  return (allocated_prev / interval) != ((allocated_prev + len) / interval);
+}
+
+bool mem_sampling_add(const void *ptr, size_t len, const char *str)
+{
+  void *stack[SAMPLE_STACK_LEN];
+  const int stack_len = sample_stack_capture(stack);
+  const size_t interval = mem_sampling_interval;
+  const size_t weight = (len > interval) ? len : interval;
+
+  pthread_mutex_lock(&sampling.lock);
+
+  MemSample *sample = sampling.samples_unused;
+  if (sample) {
+    sampling.samples_unused = sample->next;
+  }
+  else {
+    sample = malloc(sizeof(MemSample));
+  }
+  MemSampleName *name = sample ? sample_name_ensure(str) : NULL;
+
+  if (name) {
+    const unsigned int hash = sample_hash(ptr);
+    sample->ptr = ptr;
+    sample->name = name;
+    sample->weight = weight;
+    sample->stack_len = stack_len;
+    memcpy(sample->stack, stack, sizeof(void *) * (size_t)stack_len);
+    sample->next = sampling.samples[hash];
+    sampling.samples[hash] = sample;
+
+    name->live += weight;
+    name->samples_num++;
+    if (name->live > name->peak) {
+      name->peak = name->live;
+    }
+  }
+  else if (sample) {
+    free(sample);
+  }
+
+  /* Requested from a signal handler, where printing isn't safe. */
+  if (UNLIKELY(sampling.print_requested)) {
+    sampling.print_requested = 0;
+    sampling_print_stats_locked();
+  }
+
+  pthread_mutex_unlock(&sampling.lock);
+
+  return name != NULL;
+}
+
+void mem_sampling_remove(const void *ptr)
+{
+  pthread_mutex_lock(&sampling.lock);
+
+  MemSample **sample_p = &sampling.samples[sample_hash(ptr)];
+  for (MemSample *sample = *sample_p; sample; sample_p = &sample->next, sample = sample->next) {
+    if (sample->ptr == ptr) {
+      *sample_p = sample->next;
+      sample->name->live -= sample->weight;
+      sample->name->samples_num--;
+      sample->next = sampling.samples_unused;
+      sampling.samples_unused = sample;
+      break;
+    }
+  }
+
+  pthread_mutex_unlock(&sampling.lock);
+}
+
+/* Free all samples and names when the process exits, after the statistics were printed. */
+static void sampling_free(void)
+{
+  pthread_mutex_lock(&sampling.lock);
+  mem_sampling_interval = 0;
+
+  for (int i = 0; i < SAMPLE_HASH_SIZE; i++) {
+    for (MemSample *sample = sampling.samples[i], *next; sample; sample = next) {
+      next = sample->next;
+      free(sample);
+    }
+    sampling.samples[i] = NULL;
+  }
+  for (MemSample *sample = sampling.samples_unused, *next; sample; sample = next) {
+    next = sample->next;
+    free(sample);
+  }
+  sampling.samples_unused = NULL;
+
+  for (int i = 0; i < NAME_HASH_SIZE; i++) {
+    for (MemSampleName *name = sampling.names[i], *next; name; name = next) {
+      next = name->next;
+      free(name->name);
+      free(name);
+    }
+    sampling.names[i] = NULL;
+  }
+  sampling.names_num = 0;
+
+  pthread_mutex_unlock(&sampling.lock);
+}
+
+void MEM_enable_sampling(size_t sample_interval)
+{
+  pthread_mutex_lock(&sampling.lock);
+  if (sample_interval != 0 && !sampling.free_at_exit) {
+    sampling.free_at_exit = true;
+    atexit(sampling_free);
+  }
+  mem_sampling_interval = sample_interval;
+  pthread_mutex_unlock(&sampling.lock);
+}
+
+void MEM_print_sampling_stats(void)
+{
+  pthread_mutex_lock(&sampling.lock);
+  if (mem_sampling_interval != 0 || sampling.names_num != 0) {
+    sampling_print_stats_locked();
+  }
+  pthread_mutex_unlock(&sampling.lock);
+}
+
+void MEM_request_print_sampling_stats(void)
+{
+  sampling.print_requested = 1;
+}
+
+void MEM_sampling_foreach_name(void (*func)(void *user_data,
+                                            const char *name,
+                                            size_t live,
+                                            size_t peak),
+                               void *user_data)
+{
+  /* Copy the statistics, so the callback runs without the lock and can allocate. The names
+   * themselves are only freed at exit. */
+  pthread_mutex_lock(&sampling.lock);
+  MemSampleName *names = malloc(sizeof(*names) * (sampling.names_num + 1));
+  unsigned int names_num = 0;
+  if (names) {
+    for (int i = 0; i < NAME_HASH_SIZE; i++) {
+      for (const MemSampleName *name = sampling.names[i]; name; name = name->next) {
+        names[names_num++] = *name;
+      }
+    }
+  }
+  pthread_mutex_unlock(&sampling.lock);
+
+  for (unsigned int i = 0; i < names_num; i++) {
+    func(user_data, names[i].name, names[i].live, names[i].peak);
+  }
+  free(names);
+}
@@ -0,0 +1,95 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cstring>
+
+#include "MEM_guardedalloc.h"
+
+#include "../intern/mallocn_intern.h"
+
+namespace {
+
+struct SampledName {
+  const char *name;
+  size_t live = 0;
+  size_t peak = 0;
+  bool found = false;
+};
+
+void find_sampled_name(void *user_data, const char *name, size_t live, size_t peak)
+{
+  SampledName *sampled = static_cast<SampledName *>(user_data);
+  if (strcmp(name, sampled->name) == 0) {
+    sampled->live = live;
+    sampled->peak = peak;
+    sampled->found = true;
+  }
+}
+
+SampledName lookup_sampled_name(const char *name)
+{
+  SampledName sampled;
+  sampled.name = name;
+  MEM_sampling_foreach_name(find_sampled_name, &sampled);
+  return sampled;
+}
+
+}  // namespace
+
+/* Tests use the guarded allocator, so call the lock-free allocator directly. */
+TEST(guardedalloc, LockfreeSampling)
+{
+  const size_t interval = 4096;
+  const int allocs_num = 1000;
+  const size_t alloc_size = 1024;
+  void *allocs[allocs_num];
+
+  MEM_enable_sampling(interval);
+  for (int i = 0; i < allocs_num; i++) {
+    allocs[i] = (i % 2) ? MEM_lockfree_mallocN(alloc_size, "SamplingTest") :
+                          MEM_lockfree_mallocN_aligned(alloc_size, 64, "SamplingTest");
+  }
+  /* Large allocations are always sampled, with their real size. */
+  void *large = MEM_lockfree_callocN(1024 * 1024, "SamplingTestLarge");
+  MEM_enable_sampling(0);
+
+  /* Allocations are sampled by bytes, so the estimate is exact for a fixed allocation size. */
+  const SampledName sampled = lookup_sampled_name("SamplingTest");
+  EXPECT_TRUE(sampled.found);
+  EXPECT_EQ(sampled.live, allocs_num * alloc_size);
+  EXPECT_EQ(sampled.peak, allocs_num * alloc_size);
+  EXPECT_EQ(lookup_sampled_name("SamplingTestLarge").live, 1024 * 1024);
+
+  /* Tagging sampled allocations must not change their size. */
+  for (int i = 0; i < allocs_num; i++) {
+    EXPECT_EQ(MEM_lockfree_allocN_len(allocs[i]), alloc_size);
+  }
+
+  /* Freeing updates the statistics, even when sampling is disabled. */
+  for (int i = 0; i < allocs_num; i++) {
+    MEM_lockfree_freeN(allocs[i]);
+  }
+  MEM_lockfree_freeN(large);
+
+  const SampledName sampled_freed = lookup_sampled_name("SamplingTest");
+  EXPECT_EQ(sampled_freed.live, 0);
+  EXPECT_EQ(sampled_freed.peak, allocs_num * alloc_size);
+  EXPECT_EQ(lookup_sampled_name("SamplingTestLarge").live, 0);
+}
+
+/* Names are copied, since they are not always string literals. */
+TEST(guardedalloc, LockfreeSamplingNameCopy)
+{
+  char name[] = "SamplingTestCopy";
+
+  MEM_enable_sampling(1);
+  void *alloc = MEM_lockfree_mallocN(1024, name);
+  MEM_enable_sampling(0);
+  strcpy(name, "SamplingTestGone");
+
+  EXPECT_TRUE(lookup_sampled_name("SamplingTestCopy").found);
+  EXPECT_FALSE(lookup_sampled_name("SamplingTestGone").found);
+
+  MEM_lockfree_freeN(alloc);
+}
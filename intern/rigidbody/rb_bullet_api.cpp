@@ -67,6 +67,18 @@
 #include "BulletCollision/Gimpact/btGImpactCollisionAlgorithm.h"
 #include "BulletCollision/Gimpact/btGImpactShape.h"
 
+#ifdef WITH_BULLET_THREADS
+#  include <algorithm>
+#  include <array>
+#  include <mutex>
+
+#  include "BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h"
+#  include "BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h"
+
+#  include "BLI_task.h"
+#  include "BLI_task.hh"
+#endif
+
 struct rbDynamicsWorld {
   btDiscreteDynamicsWorld *dynamicsWorld;
   btDefaultCollisionConfiguration *collisionConfiguration;
@@ -117,6 +129,154 @@ struct rbFilterCallback : public btOverlapFilterCallback {
   }
 };
 
+#ifdef WITH_BULLET_THREADS
+/* Runs the parallel loops of Bullet's multi-threaded classes on Blender's task scheduler. */
+class rbTaskScheduler : public btITaskScheduler {
+ public:
+  rbTaskScheduler() : btITaskScheduler("Blender")
+  {
+  }
+
+  virtual int getMaxNumThreads() const
+  {
+    return BLI_task_scheduler_num_threads();
+  }
+  virtual int getNumThreads() const
+  {
+    return BLI_task_scheduler_num_threads();
+  }
+  virtual void setNumThreads(int /*numThreads*/)
+  {
+    /* The number of threads is controlled by Blender. */
+  }
+
+  virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody &body)
+  {
+    blender::parallel_for(blender::IndexRange(iBegin, iEnd - iBegin),
+                          std::max(grainSize, 1),
+                          [&](const blender::IndexRange range) {
+                            body.forLoop(int(range.first()), int(range.one_after_last()));
+                          });
+  }
+
+  virtual btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody &body)
+  {
+    /* Sum fixed size chunks in order, so the result does not depend on how the range is split
+     * between threads. */
+    const int chunk_size = std::max(grainSize, 1);
+    const int chunks_num = (iEnd - iBegin + chunk_size - 1) / chunk_size;
+    if (chunks_num <= 0) {
+      return btScalar(0);
+    }
+
+    btAlignedObjectArray<btScalar> sums;
+    sums.resize(chunks_num);
+    blender::parallel_for(
+        blender::IndexRange(chunks_num), 1, [&](const blender::IndexRange range) {
+          for (const int64_t chunk : range) {
+            const int begin = iBegin + int(chunk) * chunk_size;
+            sums[int(chunk)] = body.sumLoop(begin, std::min(begin + chunk_size, iEnd));
+          }
+        });
+
+    btScalar sum = 0;
+    for (int i = 0; i < chunks_num; i++) {
+      sum += sums[i];
+    }
+    return sum;
+  }
+};
+
+/* Bullet's scheduler is global and can only be set from the thread it considers the main
+ * thread, returns false when the multi-threaded classes can't be used. */
+static bool rb_task_scheduler_init()
+{
+  static rbTaskScheduler scheduler;
+  static std::once_flag once;
+  std::call_once(once, []() { btSetTaskScheduler(&scheduler); });
+  return btGetTaskScheduler() == &scheduler;
+}
+
+/* Collision dispatcher that keeps the order of contact manifolds deterministic.
+ *
+ * Bullet's version collects manifolds created while dispatching in arrays per thread index,
+ * which are then merged in thread order. Manifolds released while dispatching, like those of
+ * compound shape children that stop overlapping, are not removed from the manifold array at all.
+ * Here manifolds are added and removed directly under a lock instead, which leaves them in an
+ * order that depends on the timing of the threads.
+ *
+ * The manifold order determines the order of contacts in the solver, so afterwards all manifolds
+ * are sorted by the bodies they belong to. Compound shapes create one manifold per child for the
+ * same bodies, those are sorted by the child shapes of their contacts. */
+class rbCollisionDispatcherMt : public btCollisionDispatcherMt {
+ public:
+  rbCollisionDispatcherMt(btCollisionConfiguration *config) : btCollisionDispatcherMt(config)
+  {
+  }
+
+  virtual btPersistentManifold *getNewManifold(const btCollisionObject *body0,
+                                               const btCollisionObject *body1)
+  {
+    if (!m_batchUpdating) {
+      return btCollisionDispatcherMt::getNewManifold(body0, body1);
+    }
+    std::lock_guard<std::mutex> lock(m_manifoldsMutex);
+    return btCollisionDispatcher::getNewManifold(body0, body1);
+  }
+
+  virtual void releaseManifold(btPersistentManifold *manifold)
+  {
+    if (!m_batchUpdating) {
+      btCollisionDispatcherMt::releaseManifold(manifold);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(m_manifoldsMutex);
+    btCollisionDispatcher::releaseManifold(manifold);
+  }
+
+  virtual void dispatchAllCollisionPairs(btOverlappingPairCache *pairCache,
+                                         const btDispatcherInfo &info,
+                                         btDispatcher *dispatcher)
+  {
+    btCollisionDispatcherMt::dispatchAllCollisionPairs(pairCache, info, dispatcher);
+
+    const int manifolds_num = m_manifoldsPtr.size();
+    if (manifolds_num < 2) {
+      return;
+    }
+    btPersistentManifold **manifolds = &m_manifoldsPtr[0];
+    std::sort(manifolds, manifolds + manifolds_num, manifold_less);
+    for (int i = 0; i < manifolds_num; i++) {
+      manifolds[i]->m_index1a = i;
+    }
+  }
+
+ private:
+  std::mutex m_manifoldsMutex;
+
+  /* Manifolds of the same bodies only differ by the child shapes or triangles their contacts
+   * belong to. Manifolds without contacts compare equal, their order doesn't affect the
+   * solver. */
+  static std::array<int, 7> manifold_key(const btPersistentManifold *manifold)
+  {
+    const bool has_contacts = manifold->getNumContacts() > 0;
+    const btManifoldPoint *point = has_contacts ? &manifold->getContactPoint(0) : nullptr;
+    return {manifold->getBody0()->getBroadphaseHandle()->m_uniqueId,
+            manifold->getBody1()->getBroadphaseHandle()->m_uniqueId,
+            has_contacts,
+            point ? point->m_index0 : 0,
+            point ? point->m_index1 : 0,
+            point ? point->m_partId0 : 0,
+            point ? point->m_partId1 : 0};
+  }
+
+  static bool manifold_less(const btPersistentManifold *a, const btPersistentManifold *b)
+  {
+    return manifold_key(a) < manifold_key(b);
+  }
+};
+#endif
+
 static inline void copy_v3_btvec3(float vec[3], const btVector3 &btvec)
 {
   vec[0] = (float)btvec[0];
@@ -136,14 +296,28 @@ static inline void copy_quat_btquat(float quat[4], const btQuaternion &btquat)
 
 /* Setup ---------------------------- */
 
-rbDynamicsWorld *RB_dworld_new(const float gravity[3])
+rbDynamicsWorld *RB_dworld_new(const float gravity[3], bool use_threads)
 {
   rbDynamicsWorld *world = new rbDynamicsWorld;
 
+#ifdef WITH_BULLET_THREADS
+  use_threads = use_threads && rb_task_scheduler_init();
+#else
+  use_threads = false;
+#endif
+
   /* collision detection/handling */
   world->collisionConfiguration = new btDefaultCollisionConfiguration();
 
-  world->dispatcher = new btCollisionDispatcher(world->collisionConfiguration);
+#ifdef WITH_BULLET_THREADS
+  if (use_threads) {
+    world->dispatcher = new rbCollisionDispatcherMt(world->collisionConfiguration);
+  }
+  else
+#endif
+  {
+    world->dispatcher = new btCollisionDispatcher(world->collisionConfiguration);
+  }
   btGImpactCollisionAlgorithm::registerAlgorithm((btCollisionDispatcher *)world->dispatcher);
 
   world->pairCache = new btDbvtBroadphase();
@@ -151,12 +325,31 @@ rbDynamicsWorld *RB_dworld_new(const float gravity[3])
   world->filterCallback = new rbFilterCallback();
   world->pairCache->getOverlappingPairCache()->setOverlapFilterCallback(world->filterCallback);
 
-  /* constraint solving */
-  world->constraintSolver = new btSequentialImpulseConstraintSolver();
-
-  /* world */
-  world->dynamicsWorld = new btDiscreteDynamicsWorld(
-      world->dispatcher, world->pairCache, world->constraintSolver, world->collisionConfiguration);
+#ifdef WITH_BULLET_THREADS
+  if (use_threads) {
+    /* Islands are solved in parallel, each by one solver of the pool. */
+    btConstraintSolverPoolMt *solverPool = new btConstraintSolverPoolMt(
+        BLI_task_scheduler_num_threads());
+    world->constraintSolver = solverPool;
+
+    world->dynamicsWorld = new btDiscreteDynamicsWorldMt(world->dispatcher,
+                                                         world->pairCache,
+                                                         solverPool,
+                                                         NULL,
+                                                         world->collisionConfiguration);
+  }
+  else
+#endif
+  {
+    /* constraint solving */
+    world->constraintSolver = new btSequentialImpulseConstraintSolver();
+
+    /* world */
+    world->dynamicsWorld = new btDiscreteDynamicsWorld(world->dispatcher,
+                                                       world->pairCache,
+                                                       world->constraintSolver,
+                                                       world->collisionConfiguration);
+  }
 
   RB_dworld_set_gravity(world, gravity);
 
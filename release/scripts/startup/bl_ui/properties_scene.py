@@ -384,6 +384,7 @@ class SCENE_PT_rigid_body_world_settings(RigidBodySubPanel, Panel):
             col = flow.column()
             col.active = rbw.enabled
             col.prop(rbw, "use_split_impulse")
+            col.prop(rbw, "use_multithreading")
 
             col = col.column()
             col.prop(rbw, "substeps_per_frame")
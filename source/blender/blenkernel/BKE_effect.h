@@ -131,6 +131,22 @@ void BKE_effectors_apply(struct ListBase *effectors,
                          float *force,
                          float *wind_force,
                          float *impulse);
+/**
+ * Same as #BKE_effectors_apply for an array of points, \a force, \a wind_force and \a impulse
+ * are arrays of the same length (the latter two may be NULL).
+ *
+ * This only interchanges the loops over points and effectors: each effector is evaluated for a
+ * block of points before moving on to the next one, using the same per point falloff and force
+ * functions. The forces of each point are added up in the same order as for a single point.
+ */
+void BKE_effectors_apply_array(struct ListBase *effectors,
+                               struct ListBase *colliders,
+                               struct EffectorWeights *weights,
+                               struct EffectedPoint *points,
+                               int points_num,
+                               float (*force)[3],
+                               float (*wind_force)[3],
+                               float (*impulse)[3]);
 void BKE_effectors_free(struct ListBase *lb);
 
 void pd_point_from_particle(struct ParticleSimulationData *sim,
@@ -319,6 +319,9 @@ bool BKE_image_fill_tile(struct Image *ima,
                          bool is_float);
 
 struct ImageTile *BKE_image_get_tile(struct Image *ima, int tile_number);
+bool BKE_image_is_tile_loaded(struct Image *ima, struct ImageTile *tile);
+bool BKE_image_get_tile_size(struct Image *ima, struct ImageTile *tile, int r_size[2]);
+void BKE_image_free_tile_ibuf_if_reloadable(struct Image *ima, struct ImageTile *tile);
 struct ImageTile *BKE_image_get_tile_from_iuser(struct Image *ima, const struct ImageUser *iuser);
 
 int BKE_image_get_tile_from_pos(struct Image *ima,
@@ -382,6 +385,8 @@ struct GPUTexture *BKE_image_get_gpu_tilemap(struct Image *image,
 bool BKE_image_has_gpu_texture_premultiplied_alpha(struct Image *image, struct ImBuf *ibuf);
 void BKE_image_update_gputexture(
     struct Image *ima, struct ImageUser *iuser, int x, int y, int w, int h);
+void BKE_image_update_gputexture_delayed(
+    struct Image *ima, struct ImBuf *ibuf, int x, int y, int w, int h);
 void BKE_image_paint_set_mipmap(struct Main *bmain, bool mipmap);
 
 /* Delayed free of OpenGL buffers by main thread */
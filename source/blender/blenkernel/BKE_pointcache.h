@@ -49,6 +49,8 @@ extern "C" {
 
 /* Add the blendfile name after blendcache_ */
 #define PTCACHE_EXT ".bphys"
+/* Single file containing all frames, see #PTCACHE_DISK_CONTAINER. */
+#define PTCACHE_CONTAINER_EXT ".bphyc"
 #define PTCACHE_PATH "blendcache_"
 
 /* File open options, for BKE_ptcache_file_open */
@@ -115,6 +117,13 @@ typedef struct PTCacheFile {
 
   struct PTCacheData data;
   void *cur[BPHYS_TOT_DATA];
+
+  /* Frames of single file containers are read and written in memory, when fp is NULL. */
+  unsigned char *mem;
+  size_t mem_len, mem_alloc, mem_pos;
+  /* Container the frame is written to when closing the file. */
+  struct PTCacheContainer *container;
+  int compression;
 } PTCacheFile;
 
 #define PTCACHE_VEL_PER_SEC 1
@@ -300,6 +309,8 @@ bool BKE_ptcache_object_has(struct Scene *scene, struct Object *ob, int duplis);
 
 /***************** Global funcs ****************************/
 void BKE_ptcache_remove(void);
+/* Finish writing single file caches, on exit. */
+void BKE_ptcache_containers_exit(void);
 
 /************ ID specific functions ************************/
 void BKE_ptcache_id_clear(PTCacheID *id, int mode, unsigned int cfra);
@@ -362,6 +373,9 @@ void BKE_ptcache_mem_to_disk(struct PTCacheID *pid);
 /* Convert disk cache to memory cache and vice versa. Clears the cache that was converted. */
 void BKE_ptcache_toggle_disk_cache(struct PTCacheID *pid);
 
+/* Rewrite a disk cache after PTCACHE_DISK_CONTAINER was toggled. */
+void BKE_ptcache_toggle_disk_container(struct PTCacheID *pid);
+
 /* Rename all disk cache files with a new name. Doesn't touch the actual content of the files. */
 void BKE_ptcache_disk_cache_rename(struct PTCacheID *pid,
                                    const char *name_src,
@@ -40,6 +40,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_linklist.h"
 #include "BLI_math.h"
+#include "BLI_profile.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
 
@@ -1785,6 +1786,7 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
 #endif
 
   Mesh *mesh_eval = NULL, *mesh_deform_eval = NULL;
+  BLI_PROFILE_ZONE_BEGIN(zone, "Mesh Modifiers");
   mesh_calc_modifiers(depsgraph,
                       scene,
                       ob,
@@ -1796,6 +1798,7 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
                       true,
                       &mesh_deform_eval,
                       &mesh_eval);
+  BLI_PROFILE_ZONE_END(zone);
 
   /* The modifier stack evaluation is storing result in mesh->runtime.mesh_eval, but this result
    * is not guaranteed to be owned by object.
@@ -1847,7 +1850,9 @@ static void editbmesh_build_data(struct Depsgraph *depsgraph,
   Mesh *me_cage;
   Mesh *me_final;
 
+  BLI_PROFILE_ZONE_BEGIN(zone, "Edit Mesh Modifiers");
   editbmesh_calc_modifiers(depsgraph, scene, obedit, em, dataMask, &me_cage, &me_final);
+  BLI_PROFILE_ZONE_END(zone);
 
   em->mesh_eval_final = me_final;
   em->mesh_eval_cage = me_cage;
@@ -32,6 +32,7 @@
 
 #include "BLI_listbase.h"
 #include "BLI_path_util.h"
+#include "BLI_profile.h"
 #include "BLI_string.h"
 #include "BLI_system.h"
 #include "BLI_utildefines.h"
@@ -442,6 +443,8 @@ bool BKE_blendfile_read_ex(bContext *C,
     printf("Read blend: %s\n", filepath);
   }
 
+  BLI_PROFILE_ZONE_BEGIN(zone, "Read Blend File");
+
   BlendFileData *bfd = BLO_read_from_file(filepath, params->skip_flags, reports);
   if (bfd) {
     handle_subversion_warning(bfd->main, reports);
@@ -456,6 +459,8 @@ bool BKE_blendfile_read_ex(bContext *C,
   else {
     BKE_reports_prependf(reports, "Loading '%s' failed: ", filepath);
   }
+
+  BLI_PROFILE_ZONE_END(zone);
   return (bfd != NULL);
 }
 
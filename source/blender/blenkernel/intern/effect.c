@@ -807,44 +807,42 @@ static void get_effector_tot(
     *tot = 1;
   }
 }
-static void do_texture_effector(EffectorCache *eff,
+static void texture_effector_co(EffectorCache *eff,
                                 EffectorData *efd,
-                                EffectedPoint *point,
-                                float *total_force)
+                                const float loc[3],
+                                float r_tex_co[3])
 {
-  TexResult result[4];
-  float tex_co[3], strength, force[3];
-  float nabla = eff->pd->tex_nabla;
-  int hasrgb;
-  short mode = eff->pd->tex_mode;
-  bool scene_color_manage;
-
-  if (!eff->pd->tex) {
-    return;
-  }
-
-  result[0].nor = result[1].nor = result[2].nor = result[3].nor = NULL;
-
-  strength = eff->pd->f_strength * efd->falloff;
-
-  copy_v3_v3(tex_co, point->loc);
+  copy_v3_v3(r_tex_co, loc);
 
   if (eff->pd->flag & PFIELD_TEX_OBJECT) {
-    mul_m4_v3(eff->ob->imat, tex_co);
+    mul_m4_v3(eff->ob->imat, r_tex_co);
 
     if (eff->pd->flag & PFIELD_TEX_2D) {
-      tex_co[2] = 0.0f;
+      r_tex_co[2] = 0.0f;
     }
   }
   else if (eff->pd->flag & PFIELD_TEX_2D) {
-    float fac = -dot_v3v3(tex_co, efd->nor);
-    madd_v3_v3fl(tex_co, efd->nor, fac);
+    float fac = -dot_v3v3(r_tex_co, efd->nor);
+    madd_v3_v3fl(r_tex_co, efd->nor, fac);
   }
+}
 
-  scene_color_manage = BKE_scene_check_color_management_enabled(eff->scene);
+/* The gradient and curl modes need the samples offset by nabla along each axis,
+ * which are not taken when the RGB mode has color. */
+static bool texture_effector_use_nabla(PartDeflect *pd, int hasrgb)
+{
+  return !(hasrgb && pd->tex_mode == PFIELD_TEX_RGB) && pd->tex_nabla != 0;
+}
 
-  hasrgb = multitex_ext(
-      eff->pd->tex, tex_co, NULL, NULL, 0, result, 0, NULL, scene_color_manage, false);
+static void texture_effector_force(EffectorCache *eff,
+                                   EffectorData *efd,
+                                   TexResult result[4],
+                                   int hasrgb,
+                                   float *total_force)
+{
+  float strength = eff->pd->f_strength * efd->falloff, force[3];
+  float nabla = eff->pd->tex_nabla;
+  short mode = eff->pd->tex_mode;
 
   if (hasrgb && mode == PFIELD_TEX_RGB) {
     force[0] = (0.5f - result->tr) * strength;
@@ -854,20 +852,6 @@ static void do_texture_effector(EffectorCache *eff,
   else if (nabla != 0) {
     strength /= nabla;
 
-    tex_co[0] += nabla;
-    multitex_ext(
-        eff->pd->tex, tex_co, NULL, NULL, 0, result + 1, 0, NULL, scene_color_manage, false);
-
-    tex_co[0] -= nabla;
-    tex_co[1] += nabla;
-    multitex_ext(
-        eff->pd->tex, tex_co, NULL, NULL, 0, result + 2, 0, NULL, scene_color_manage, false);
-
-    tex_co[1] -= nabla;
-    tex_co[2] += nabla;
-    multitex_ext(
-        eff->pd->tex, tex_co, NULL, NULL, 0, result + 3, 0, NULL, scene_color_manage, false);
-
     if (mode == PFIELD_TEX_GRAD || !hasrgb) { /* if we don't have rgb fall back to grad */
       /* generate intensity if texture only has rgb value */
       if (hasrgb & TEX_RGB) {
@@ -905,6 +889,49 @@ static void do_texture_effector(EffectorCache *eff,
 
   add_v3_v3(total_force, force);
 }
+
+static void do_texture_effector(EffectorCache *eff,
+                                EffectorData *efd,
+                                EffectedPoint *point,
+                                float *total_force)
+{
+  TexResult result[4];
+  float tex_co[3];
+  float nabla = eff->pd->tex_nabla;
+  int hasrgb;
+  bool scene_color_manage;
+
+  if (!eff->pd->tex) {
+    return;
+  }
+
+  result[0].nor = result[1].nor = result[2].nor = result[3].nor = NULL;
+
+  texture_effector_co(eff, efd, point->loc, tex_co);
+
+  scene_color_manage = BKE_scene_check_color_management_enabled(eff->scene);
+
+  hasrgb = multitex_ext(
+      eff->pd->tex, tex_co, NULL, NULL, 0, result, 0, NULL, scene_color_manage, false);
+
+  if (texture_effector_use_nabla(eff->pd, hasrgb)) {
+    tex_co[0] += nabla;
+    multitex_ext(
+        eff->pd->tex, tex_co, NULL, NULL, 0, result + 1, 0, NULL, scene_color_manage, false);
+
+    tex_co[0] -= nabla;
+    tex_co[1] += nabla;
+    multitex_ext(
+        eff->pd->tex, tex_co, NULL, NULL, 0, result + 2, 0, NULL, scene_color_manage, false);
+
+    tex_co[1] -= nabla;
+    tex_co[2] += nabla;
+    multitex_ext(
+        eff->pd->tex, tex_co, NULL, NULL, 0, result + 3, 0, NULL, scene_color_manage, false);
+  }
+
+  texture_effector_force(eff, efd, result, hasrgb, total_force);
+}
 static void do_physical_effector(EffectorCache *eff,
                                  EffectorData *efd,
                                  EffectedPoint *point,
@@ -1079,6 +1106,70 @@ static void do_physical_effector(EffectorCache *eff,
  * flags        = only used for softbody wind now
  * guide        = old speed of particle
  */
+
+static void effector_add_force(EffectorCache *eff,
+                               EffectedPoint *point,
+                               const float out_force[3],
+                               float *force,
+                               float *wind_force,
+                               float *impulse)
+{
+  /* for softbody backward compatibility */
+  if (eff->pd->forcefield != PFIELD_TEXTURE && point->flag & PE_WIND_AS_SPEED && impulse) {
+    sub_v3_v3v3(impulse, impulse, out_force);
+  }
+
+  if (wind_force) {
+    madd_v3_v3fl(force, out_force, 1.0f - eff->pd->f_wind_factor);
+    madd_v3_v3fl(wind_force, out_force, eff->pd->f_wind_factor);
+  }
+  else {
+    add_v3_v3(force, out_force);
+  }
+}
+
+static void effector_apply_point(EffectorCache *eff,
+                                 ListBase *colliders,
+                                 EffectorWeights *weights,
+                                 EffectedPoint *point,
+                                 float *force,
+                                 float *wind_force,
+                                 float *impulse)
+{
+  EffectorData efd;
+  /* The step is only set for particle systems with an effector amount, it must not carry over
+   * to the next effector. */
+  int p = 0, tot = 1, step = 1;
+
+  get_effector_tot(eff, &efd, point, &tot, &p, &step);
+
+  for (; p < tot; p += step) {
+    if (get_effector_data(eff, &efd, point, 0)) {
+      efd.falloff = effector_falloff(eff, &efd, point, weights);
+
+      if (efd.falloff > 0.0f) {
+        efd.falloff *= eff_calc_visibility(colliders, eff, &efd, point);
+      }
+      if (efd.falloff > 0.0f) {
+        float out_force[3] = {0, 0, 0};
+
+        if (eff->pd->forcefield == PFIELD_TEXTURE) {
+          do_texture_effector(eff, &efd, point, out_force);
+        }
+        else {
+          do_physical_effector(eff, &efd, point, out_force);
+        }
+
+        effector_add_force(eff, point, out_force, force, wind_force, impulse);
+      }
+    }
+    else if (eff->flag & PE_VELOCITY_TO_IMPULSE && impulse) {
+      /* special case for harmonic effector */
+      add_v3_v3v3(impulse, impulse, efd.vel);
+    }
+  }
+}
+
 void BKE_effectors_apply(ListBase *effectors,
                          ListBase *colliders,
                          EffectorWeights *weights,
@@ -1101,8 +1192,6 @@ void BKE_effectors_apply(ListBase *effectors,
    *     (is independent of other effectors)
    */
   EffectorCache *eff;
-  EffectorData efd;
-  int p = 0, tot = 1, step = 1;
 
   /* Cycle through collected objects, get total of (1/(gravity_strength * dist^gravity_power)) */
   /* Check for min distance here? (yes would be cool to add that, ton) */
@@ -1110,49 +1199,226 @@ void BKE_effectors_apply(ListBase *effectors,
   if (effectors) {
     for (eff = effectors->first; eff; eff = eff->next) {
       /* object effectors were fully checked to be OK to evaluate! */
+      effector_apply_point(eff, colliders, weights, point, force, wind_force, impulse);
+    }
+  }
+}
 
-      get_effector_tot(eff, &efd, point, &tot, &p, &step);
+/*  -------- BKE_effectors_apply_array() -------- */
+
+/* Number of points an effector is evaluated for at once, small enough for the
+ * per point data to stay in cache. */
+#define EFFECTOR_BLOCK_SIZE 128
+
+typedef struct EffectorBlock {
+  EffectorData efd[EFFECTOR_BLOCK_SIZE];
+  float force[EFFECTOR_BLOCK_SIZE][3];
+  /* Effector data was found for the point. */
+  bool has_data[EFFECTOR_BLOCK_SIZE];
+  /* The point is affected, the falloff is above zero. */
+  bool active[EFFECTOR_BLOCK_SIZE];
+
+  /* Texture effectors. */
+  float tex_co[EFFECTOR_BLOCK_SIZE][3];
+  TexResult result[EFFECTOR_BLOCK_SIZE][4];
+  int hasrgb[EFFECTOR_BLOCK_SIZE];
+} EffectorBlock;
+
+/* Same as #do_texture_effector, with the texture sampled in one pass per offset. */
+static void do_texture_effector_block(EffectorCache *eff,
+                                      EffectorBlock *block,
+                                      EffectedPoint *points,
+                                      int points_num)
+{
+  PartDeflect *pd = eff->pd;
+  float nabla = pd->tex_nabla;
+  bool scene_color_manage;
+  int i;
 
-      for (; p < tot; p += step) {
-        if (get_effector_data(eff, &efd, point, 0)) {
-          efd.falloff = effector_falloff(eff, &efd, point, weights);
+  if (!pd->tex) {
+    return;
+  }
 
-          if (efd.falloff > 0.0f) {
-            efd.falloff *= eff_calc_visibility(colliders, eff, &efd, point);
-          }
-          if (efd.falloff > 0.0f) {
-            float out_force[3] = {0, 0, 0};
-
-            if (eff->pd->forcefield == PFIELD_TEXTURE) {
-              do_texture_effector(eff, &efd, point, out_force);
-            }
-            else {
-              do_physical_effector(eff, &efd, point, out_force);
-
-              /* for softbody backward compatibility */
-              if (point->flag & PE_WIND_AS_SPEED && impulse) {
-                sub_v3_v3v3(impulse, impulse, out_force);
-              }
-            }
-
-            if (wind_force) {
-              madd_v3_v3fl(force, out_force, 1.0f - eff->pd->f_wind_factor);
-              madd_v3_v3fl(wind_force, out_force, eff->pd->f_wind_factor);
-            }
-            else {
-              add_v3_v3(force, out_force);
-            }
-          }
+  scene_color_manage = BKE_scene_check_color_management_enabled(eff->scene);
+
+  for (i = 0; i < points_num; i++) {
+    if (block->active[i]) {
+      texture_effector_co(eff, &block->efd[i], points[i].loc, block->tex_co[i]);
+    }
+  }
+
+  for (i = 0; i < points_num; i++) {
+    if (block->active[i]) {
+      TexResult *result = block->result[i];
+      result[0].nor = result[1].nor = result[2].nor = result[3].nor = NULL;
+      block->hasrgb[i] = multitex_ext(
+          pd->tex, block->tex_co[i], NULL, NULL, 0, result, 0, NULL, scene_color_manage, false);
+    }
+  }
+
+  /* Offset the coordinates the same way as for a single point, so the samples match. */
+  for (int axis = 0; axis < 3; axis++) {
+    for (i = 0; i < points_num; i++) {
+      if (block->active[i] && texture_effector_use_nabla(pd, block->hasrgb[i])) {
+        float *tex_co = block->tex_co[i];
+        if (axis > 0) {
+          tex_co[axis - 1] -= nabla;
         }
-        else if (eff->flag & PE_VELOCITY_TO_IMPULSE && impulse) {
-          /* special case for harmonic effector */
-          add_v3_v3v3(impulse, impulse, efd.vel);
+        tex_co[axis] += nabla;
+        multitex_ext(pd->tex,
+                     tex_co,
+                     NULL,
+                     NULL,
+                     0,
+                     block->result[i] + axis + 1,
+                     0,
+                     NULL,
+                     scene_color_manage,
+                     false);
+      }
+    }
+  }
+
+  for (i = 0; i < points_num; i++) {
+    if (block->active[i]) {
+      texture_effector_force(
+          eff, &block->efd[i], block->result[i], block->hasrgb[i], block->force[i]);
+    }
+  }
+}
+
+/* Evaluate an effector with a single effector point for a block of points. */
+static void effector_apply_block(EffectorCache *eff,
+                                 ListBase *colliders,
+                                 EffectorWeights *weights,
+                                 EffectorBlock *block,
+                                 EffectedPoint *points,
+                                 int points_num,
+                                 float (*force)[3],
+                                 float (*wind_force)[3],
+                                 float (*impulse)[3])
+{
+  int p = 0, i;
+
+  for (i = 0; i < points_num; i++) {
+    EffectorData *efd = &block->efd[i];
+
+    efd->index = &p;
+    block->has_data[i] = get_effector_data(eff, efd, &points[i], 0);
+    block->active[i] = false;
+
+    if (block->has_data[i]) {
+      efd->falloff = effector_falloff(eff, efd, &points[i], weights);
+
+      if (efd->falloff > 0.0f) {
+        efd->falloff *= eff_calc_visibility(colliders, eff, efd, &points[i]);
+      }
+      block->active[i] = (efd->falloff > 0.0f);
+    }
+  }
+
+  memset(block->force, 0, sizeof(float[3]) * points_num);
+
+  if (eff->pd->forcefield == PFIELD_TEXTURE) {
+    do_texture_effector_block(eff, block, points, points_num);
+  }
+  else {
+    for (i = 0; i < points_num; i++) {
+      if (block->active[i]) {
+        do_physical_effector(eff, &block->efd[i], &points[i], block->force[i]);
+      }
+    }
+  }
+
+  for (i = 0; i < points_num; i++) {
+    if (block->active[i]) {
+      effector_add_force(eff,
+                         &points[i],
+                         block->force[i],
+                         force[i],
+                         wind_force ? wind_force[i] : NULL,
+                         impulse ? impulse[i] : NULL);
+    }
+    else if (!block->has_data[i] && eff->flag & PE_VELOCITY_TO_IMPULSE && impulse) {
+      /* special case for harmonic effector */
+      add_v3_v3v3(impulse[i], impulse[i], block->efd[i].vel);
+    }
+  }
+}
+
+void BKE_effectors_apply_array(ListBase *effectors,
+                               ListBase *colliders,
+                               EffectorWeights *weights,
+                               EffectedPoint *points,
+                               int points_num,
+                               float (*force)[3],
+                               float (*wind_force)[3],
+                               float (*impulse)[3])
+{
+  EffectorCache *eff;
+  EffectorBlock *block;
+  ListBase **eff_colliders;
+  int eff_index;
+
+  if (!effectors || points_num == 0) {
+    return;
+  }
+
+  block = MEM_mallocN(sizeof(*block), __func__);
+
+  /* Gather the colliders for visibility once, instead of for every point. */
+  eff_colliders = MEM_callocN(sizeof(ListBase *) * BLI_listbase_count(effectors), __func__);
+  if (!colliders) {
+    for (eff = effectors->first, eff_index = 0; eff; eff = eff->next, eff_index++) {
+      if (eff->pd->flag & PFIELD_VISIBILITY) {
+        eff_colliders[eff_index] = BKE_collider_cache_create(eff->depsgraph, eff->ob, NULL);
+      }
+    }
+  }
+
+  for (int start = 0; start < points_num; start += EFFECTOR_BLOCK_SIZE) {
+    const int block_num = min_ii(points_num - start, EFFECTOR_BLOCK_SIZE);
+
+    for (eff = effectors->first, eff_index = 0; eff; eff = eff->next, eff_index++) {
+      ListBase *eff_colls = colliders ? colliders : eff_colliders[eff_index];
+
+      if (eff->psys || eff->pd->shape == PFIELD_SHAPE_POINTS) {
+        /* Effectors made of many points are evaluated point by point. */
+        for (int i = start; i < start + block_num; i++) {
+          effector_apply_point(eff,
+                               eff_colls,
+                               weights,
+                               &points[i],
+                               force[i],
+                               wind_force ? wind_force[i] : NULL,
+                               impulse ? impulse[i] : NULL);
         }
       }
+      else {
+        effector_apply_block(eff,
+                             eff_colls,
+                             weights,
+                             block,
+                             points + start,
+                             block_num,
+                             force + start,
+                             wind_force ? wind_force + start : NULL,
+                             impulse ? impulse + start : NULL);
+      }
     }
   }
+
+  for (eff = effectors->first, eff_index = 0; eff; eff = eff->next, eff_index++) {
+    if (eff_colliders[eff_index]) {
+      BKE_collider_cache_free(&eff_colliders[eff_index]);
+    }
+  }
+  MEM_freeN(eff_colliders);
+  MEM_freeN(block);
 }
 
+#undef EFFECTOR_BLOCK_SIZE
+
 /* ======== Simulation Debugging ======== */
 
 SimDebugData *_sim_debug_data = NULL;
@@ -0,0 +1,322 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_modifier_types.h"
+#include "DNA_object_force_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_texture_types.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_string.h"
+
+#include "BKE_collision.h"
+#include "BKE_effect.h"
+#include "BKE_texture.h"
+
+namespace blender::bke::tests {
+
+/* More than one block of points, with a partial last block. */
+static const int POINTS_NUM = 300;
+
+class EffectorsApplyArrayTest : public testing::Test {
+ protected:
+  Scene *scene;
+  ListBase effectors;
+  ListBase objects;
+
+  float (*loc)[3];
+  float (*vel)[3];
+  EffectedPoint *points;
+
+  void SetUp() override
+  {
+    scene = (Scene *)MEM_callocN(sizeof(Scene), __func__);
+    scene->r.frs_sec = 24;
+    STRNCPY(scene->display_settings.display_device, "None");
+
+    BLI_listbase_clear(&effectors);
+    BLI_listbase_clear(&objects);
+
+    loc = (float(*)[3])MEM_malloc_arrayN(POINTS_NUM, sizeof(float[3]), __func__);
+    vel = (float(*)[3])MEM_malloc_arrayN(POINTS_NUM, sizeof(float[3]), __func__);
+    points = (EffectedPoint *)MEM_malloc_arrayN(POINTS_NUM, sizeof(EffectedPoint), __func__);
+
+    RNG *rng = BLI_rng_new(0);
+    for (int i = 0; i < POINTS_NUM; i++) {
+      for (int axis = 0; axis < 3; axis++) {
+        loc[i][axis] = (BLI_rng_get_float(rng) - 0.5f) * 10.0f;
+        vel[i][axis] = BLI_rng_get_float(rng) - 0.5f;
+      }
+      pd_point_from_loc(scene, loc[i], vel[i], i, &points[i]);
+      points[i].charge = 1.0f;
+    }
+    BLI_rng_free(rng);
+  }
+
+  void TearDown() override
+  {
+    LISTBASE_FOREACH (EffectorCache *, eff, &effectors) {
+      BKE_partdeflect_free(eff->pd);
+    }
+    BLI_freelistN(&effectors);
+    LISTBASE_FOREACH (LinkData *, link, &objects) {
+      MEM_freeN(link->data);
+    }
+    BLI_freelistN(&objects);
+
+    MEM_freeN(loc);
+    MEM_freeN(vel);
+    MEM_freeN(points);
+    MEM_freeN(scene);
+  }
+
+  Object *object_add(const float co[3], const float rot[3])
+  {
+    const float size[3] = {1.0f, 1.0f, 1.0f};
+    Object *ob = (Object *)MEM_callocN(sizeof(Object), __func__);
+    loc_eul_size_to_mat4(ob->obmat, co, rot, size);
+    invert_m4_m4(ob->imat, ob->obmat);
+    BLI_addtail(&objects, BLI_genericNodeN(ob));
+    return ob;
+  }
+
+  PartDeflect *effector_add(int type, const float co[3], const float rot[3])
+  {
+    EffectorCache *eff = (EffectorCache *)MEM_callocN(sizeof(EffectorCache), __func__);
+    eff->scene = scene;
+    eff->ob = object_add(co, rot);
+    eff->pd = BKE_partdeflect_new(type);
+    BLI_addtail(&effectors, eff);
+    return eff->pd;
+  }
+
+  /* Noise is drawn from the effector random generators, start both evaluations with the same
+   * state. */
+  void effectors_reset_noise()
+  {
+    LISTBASE_FOREACH (EffectorCache *, eff, &effectors) {
+      if (eff->pd->rng) {
+        BLI_rng_free(eff->pd->rng);
+      }
+      eff->pd->rng = BLI_rng_new(eff->pd->seed);
+    }
+  }
+
+  void expect_array_matches_points(ListBase *colliders, bool use_wind, bool use_impulse)
+  {
+    const size_t size = sizeof(float[3]) * POINTS_NUM;
+    float(*force)[3] = (float(*)[3])MEM_callocN(size, __func__);
+    float(*wind)[3] = (float(*)[3])MEM_callocN(size, __func__);
+    float(*impulse)[3] = (float(*)[3])MEM_callocN(size, __func__);
+    float(*array_force)[3] = (float(*)[3])MEM_callocN(size, __func__);
+    float(*array_wind)[3] = (float(*)[3])MEM_callocN(size, __func__);
+    float(*array_impulse)[3] = (float(*)[3])MEM_callocN(size, __func__);
+
+    effectors_reset_noise();
+    for (int i = 0; i < POINTS_NUM; i++) {
+      BKE_effectors_apply(&effectors,
+                          colliders,
+                          nullptr,
+                          &points[i],
+                          force[i],
+                          use_wind ? wind[i] : nullptr,
+                          use_impulse ? impulse[i] : nullptr);
+    }
+
+    effectors_reset_noise();
+    BKE_effectors_apply_array(&effectors,
+                              colliders,
+                              nullptr,
+                              points,
+                              POINTS_NUM,
+                              array_force,
+                              use_wind ? array_wind : nullptr,
+                              use_impulse ? array_impulse : nullptr);
+
+    bool has_force = false;
+    for (int i = 0; i < POINTS_NUM; i++) {
+      EXPECT_V3_NEAR(force[i], array_force[i], 1e-6f);
+      EXPECT_V3_NEAR(wind[i], array_wind[i], 1e-6f);
+      EXPECT_V3_NEAR(impulse[i], array_impulse[i], 1e-6f);
+      has_force |= !is_zero_v3(force[i]) || !is_zero_v3(wind[i]);
+    }
+    /* Make sure the effectors did something at all. */
+    EXPECT_TRUE(has_force);
+
+    MEM_freeN(force);
+    MEM_freeN(wind);
+    MEM_freeN(impulse);
+    MEM_freeN(array_force);
+    MEM_freeN(array_wind);
+    MEM_freeN(array_impulse);
+  }
+};
+
+TEST_F(EffectorsApplyArrayTest, PhysicalEffectors)
+{
+  const float origin[3] = {0.0f, 0.0f, 0.0f};
+  const float offset[3] = {1.0f, -2.0f, 0.5f};
+  const float rot[3] = {0.3f, -0.2f, 0.7f};
+  PartDeflect *pd;
+
+  pd = effector_add(PFIELD_FORCE, origin, rot);
+  pd->f_power = 2.0f;
+  pd->flag |= PFIELD_USEMAX;
+  pd->maxdist = 4.0f;
+
+  pd = effector_add(PFIELD_FORCE, offset, rot);
+  pd->falloff = PFIELD_FALL_TUBE;
+  pd->zdir = PFIELD_Z_POS;
+  pd->f_noise = 0.5f;
+
+  pd = effector_add(PFIELD_FORCE, origin, origin);
+  pd->falloff = PFIELD_FALL_CONE;
+  pd->flag |= PFIELD_GRAVITATION;
+
+  pd = effector_add(PFIELD_WIND, offset, rot);
+  pd->f_wind_factor = 0.3f;
+
+  effector_add(PFIELD_VORTEX, origin, rot);
+
+  pd = effector_add(PFIELD_VORTEX, offset, origin);
+  pd->shape = PFIELD_SHAPE_POINT;
+
+  pd = effector_add(PFIELD_MAGNET, origin, rot);
+  pd->shape = PFIELD_SHAPE_LINE;
+
+  pd = effector_add(PFIELD_HARMONIC, offset, origin);
+  pd->f_size = 0.5f;
+  pd->f_noise = 0.2f;
+
+  effector_add(PFIELD_CHARGE, offset, rot);
+  effector_add(PFIELD_LENNARDJ, origin, origin);
+
+  pd = effector_add(PFIELD_TURBULENCE, origin, rot);
+  pd->f_size = 2.0f;
+
+  effector_add(PFIELD_DRAG, offset, origin);
+
+  expect_array_matches_points(nullptr, true, true);
+  expect_array_matches_points(nullptr, false, false);
+}
+
+TEST_F(EffectorsApplyArrayTest, HarmonicVelocityToImpulse)
+{
+  const float offset[3] = {1.0f, -2.0f, 0.5f};
+  const float rot[3] = {0.3f, -0.2f, 0.7f};
+
+  PartDeflect *pd = effector_add(PFIELD_HARMONIC, offset, rot);
+  pd->f_size = 1.0f;
+  ((EffectorCache *)effectors.last)->flag |= PE_VELOCITY_TO_IMPULSE;
+
+  expect_array_matches_points(nullptr, false, true);
+}
+
+TEST_F(EffectorsApplyArrayTest, WindAsSpeed)
+{
+  const float origin[3] = {0.0f, 0.0f, 0.0f};
+  const float rot[3] = {0.3f, -0.2f, 0.7f};
+
+  for (int i = 0; i < POINTS_NUM; i += 2) {
+    points[i].flag |= PE_WIND_AS_SPEED;
+  }
+
+  effector_add(PFIELD_WIND, origin, rot);
+  effector_add(PFIELD_FORCE, origin, origin);
+
+  expect_array_matches_points(nullptr, true, true);
+  expect_array_matches_points(nullptr, false, true);
+}
+
+TEST_F(EffectorsApplyArrayTest, TextureEffectors)
+{
+  const float origin[3] = {0.0f, 0.0f, 0.0f};
+  const float rot[3] = {0.3f, -0.2f, 0.7f};
+
+  Tex *tex = (Tex *)MEM_callocN(sizeof(Tex), __func__);
+  BKE_texture_default(tex);
+  tex->type = TEX_CLOUDS;
+  tex->noisesize = 2.0f;
+
+  /* Colored clouds take the RGB mode, gray clouds fall back to the gradient. */
+  for (const short stype : {(short)TEX_COLOR, (short)TEX_DEFAULT}) {
+    tex->stype = stype;
+
+    for (const short mode : {PFIELD_TEX_RGB, PFIELD_TEX_GRAD, PFIELD_TEX_CURL}) {
+      PartDeflect *pd = effector_add(PFIELD_TEXTURE, origin, rot);
+      pd->tex = tex;
+      pd->tex_mode = mode;
+      pd->tex_nabla = 0.025f;
+
+      pd = effector_add(PFIELD_TEXTURE, origin, rot);
+      pd->tex = tex;
+      pd->tex_mode = mode;
+      pd->tex_nabla = 0.1f;
+      pd->flag |= PFIELD_TEX_OBJECT | PFIELD_TEX_2D;
+
+      expect_array_matches_points(nullptr, true, true);
+
+      LISTBASE_FOREACH (EffectorCache *, eff, &effectors) {
+        BKE_partdeflect_free(eff->pd);
+      }
+      BLI_freelistN(&effectors);
+    }
+  }
+
+  MEM_freeN(tex);
+}
+
+TEST_F(EffectorsApplyArrayTest, Visibility)
+{
+  const float origin[3] = {0.0f, 0.0f, 0.0f};
+  const float rot[3] = {0.3f, -0.2f, 0.7f};
+
+  /* A box covering part of the points, absorbing half of the force. */
+  const float box[2][3] = {{-5.0f, -5.0f, 1.0f}, {5.0f, 0.0f, 2.0f}};
+  CollisionModifierData collmd = {{nullptr}};
+  collmd.bvhtree = BLI_bvhtree_new(1, 0.0f, 4, 26);
+  BLI_bvhtree_insert(collmd.bvhtree, 0, &box[0][0], 2);
+  BLI_bvhtree_balance(collmd.bvhtree);
+
+  Object *ob_collider = object_add(origin, origin);
+  ob_collider->pd = BKE_partdeflect_new(PFIELD_NULL);
+  ob_collider->pd->absorption = 0.5f;
+
+  ColliderCache collider = {nullptr};
+  collider.ob = ob_collider;
+  collider.collmd = &collmd;
+
+  ListBase colliders = {&collider, &collider};
+
+  PartDeflect *pd = effector_add(PFIELD_FORCE, origin, rot);
+  pd->flag |= PFIELD_VISIBILITY;
+  pd = effector_add(PFIELD_WIND, origin, rot);
+  pd->flag |= PFIELD_VISIBILITY;
+
+  expect_array_matches_points(&colliders, true, false);
+
+  BKE_partdeflect_free(ob_collider->pd);
+  BLI_bvhtree_free(collmd.bvhtree);
+}
+
+}  // namespace blender::bke::tests
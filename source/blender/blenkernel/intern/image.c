@@ -37,6 +37,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "IMB_colormanagement.h"
 #include "IMB_imbuf.h"
 #include "IMB_imbuf_types.h"
@@ -4900,6 +4902,16 @@ static ImBuf *image_get_cached_ibuf(Image *ima, ImageUser *iuser, int *r_entry,
   return ibuf;
 }
 
+/* UDIM images can have many large tiles, of which only a few are typically needed at once.
+ * Tiles loaded from a file can be read again on demand, so unlike generated tiles they are
+ * left to the memory cache limiter which frees the least recently used ones under memory
+ * pressure. Tiles with unsaved changes are never freed by the limiter. */
+static bool image_tile_ibuf_is_reloadable(Image *ima, const ImBuf *ibuf)
+{
+  return (ima->source == IMA_SRC_TILED) && (ima->type == IMA_TYPE_IMAGE) &&
+         (ibuf->ftype != 0) && !BKE_image_has_packedfile(ima);
+}
+
 BLI_INLINE bool image_quick_test(Image *ima, const ImageUser *iuser)
 {
   if (ima == NULL) {
@@ -5033,8 +5045,9 @@ static ImBuf *image_acquire_ibuf(Image *ima, ImageUser *iuser, void **r_lock)
       }
     }
 
-    /* We only want movies and sequences to be memory limited. */
-    if (ibuf != NULL && !ELEM(ima->source, IMA_SRC_MOVIE, IMA_SRC_SEQUENCE)) {
+    /* We only want movies, sequences and UDIM tiles read from disk to be memory limited. */
+    if (ibuf != NULL && !ELEM(ima->source, IMA_SRC_MOVIE, IMA_SRC_SEQUENCE) &&
+        !image_tile_ibuf_is_reloadable(ima, ibuf)) {
       ibuf->userflags |= IB_PERSISTENT;
     }
   }
@@ -5109,6 +5122,92 @@ bool BKE_image_has_ibuf(Image *ima, ImageUser *iuser)
   return ibuf != NULL;
 }
 
+/* Checks whether the image buffer of a tile is currently loaded, without loading it. */
+bool BKE_image_is_tile_loaded(Image *ima, ImageTile *tile)
+{
+  ImageUser iuser;
+  BKE_imageuser_default(&iuser);
+  iuser.tile = tile->tile_number;
+
+  BLI_mutex_lock(image_mutex);
+  ImBuf *ibuf = image_get_cached_ibuf(ima, &iuser, NULL, NULL);
+  BLI_mutex_unlock(image_mutex);
+
+  IMB_freeImBuf(ibuf);
+
+  return ibuf != NULL;
+}
+
+/**
+ * Get the resolution of a tile. When the tile is not loaded yet only the header of its file
+ * is read, so that the full image does not have to be decoded.
+ *
+ * \return false when the tile has no image buffer.
+ */
+bool BKE_image_get_tile_size(Image *ima, ImageTile *tile, int r_size[2])
+{
+  ImageUser iuser;
+  BKE_imageuser_default(&iuser);
+  iuser.tile = tile->tile_number;
+
+  BLI_mutex_lock(image_mutex);
+  ImBuf *ibuf = image_get_cached_ibuf(ima, &iuser, NULL, NULL);
+  BLI_mutex_unlock(image_mutex);
+
+  if (ibuf == NULL && ima->source == IMA_SRC_TILED && ima->type == IMA_TYPE_IMAGE &&
+      tile->ok != 0 && !BKE_image_has_packedfile(ima)) {
+    char filepath[FILE_MAX];
+    BKE_image_user_file_path(&iuser, ima, filepath);
+    ibuf = IMB_testiffname(filepath, IB_rect | IB_multilayer);
+  }
+
+  if (ibuf != NULL) {
+    r_size[0] = ibuf->x;
+    r_size[1] = ibuf->y;
+    IMB_freeImBuf(ibuf);
+    return true;
+  }
+
+  /* Fall back to loading the tile, e.g. for generated tiles. */
+  ibuf = BKE_image_acquire_ibuf(ima, &iuser, NULL);
+  if (ibuf != NULL) {
+    r_size[0] = ibuf->x;
+    r_size[1] = ibuf->y;
+  }
+  BKE_image_release_ibuf(ima, ibuf, NULL);
+
+  return ibuf != NULL;
+}
+
+/**
+ * Free the image buffer of a tile if it can be loaded again from its file on demand.
+ * Used to avoid keeping every tile of a UDIM image in memory when only some of them are
+ * needed on the CPU.
+ */
+void BKE_image_free_tile_ibuf_if_reloadable(Image *ima, ImageTile *tile)
+{
+  ImageUser iuser;
+  BKE_imageuser_default(&iuser);
+  iuser.tile = tile->tile_number;
+
+  BLI_mutex_lock(image_mutex);
+
+  ImBuf *ibuf = image_get_cached_ibuf(ima, &iuser, NULL, NULL);
+  if (ibuf != NULL) {
+    /* Only drop the cache reference if it is the last one, the buffer may still be in use. */
+    const bool can_free = image_tile_ibuf_is_reloadable(ima, ibuf) &&
+                          (ibuf->userflags & (IB_BITMAPDIRTY | IB_PERSISTENT)) == 0 &&
+                          ibuf->refcounter <= 1 && !BKE_image_is_multiview(ima);
+    IMB_freeImBuf(ibuf);
+
+    if (can_free) {
+      image_remove_ibuf(ima, 0, tile->tile_number);
+    }
+  }
+
+  BLI_mutex_unlock(image_mutex);
+}
+
 /* ******** Pool for image buffers ********  */
 
 typedef struct ImagePoolItem {
@@ -5313,7 +5412,7 @@ void BKE_image_user_frame_calc(Image *ima, ImageUser *iuser, int cfra)
       /* Note: a single texture and refresh doesn't really work when
        * multiple image users may use different frames, this is to
        * be improved with perhaps a GPU texture cache. */
-      ima->gpuflag |= IMA_GPU_REFRESH;
+      atomic_fetch_and_or_int16(&ima->gpuflag, IMA_GPU_REFRESH);
       ima->gpuframenr = iuser->framenr;
     }
 
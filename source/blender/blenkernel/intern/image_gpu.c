@@ -23,9 +23,13 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_boxpack_2d.h"
 #include "BLI_linklist.h"
 #include "BLI_listbase.h"
+#include "BLI_rect.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "DNA_image_types.h"
@@ -48,6 +52,7 @@
 /* Prototypes. */
 static void gpu_free_unused_buffers(void);
 static void image_free_gpu(Image *ima, const bool immediate);
+static void image_update_gputexture_delayed_flush(Image *ima, ImageUser *iuser, ImBuf *ibuf);
 
 /* Is the alpha of the `GPUTexture` for a given image/ibuf premultiplied. */
 bool BKE_image_has_gpu_texture_premultiplied_alpha(Image *image, ImBuf *ibuf)
@@ -138,16 +143,13 @@ static GPUTexture *gpu_texture_create_tile_array(Image *ima, ImBuf *main_ibuf)
   ListBase boxes = {NULL};
 
   LISTBASE_FOREACH (ImageTile *, tile, &ima->tiles) {
-    ImageUser iuser;
-    BKE_imageuser_default(&iuser);
-    iuser.tile = tile->tile_number;
-    ImBuf *ibuf = BKE_image_acquire_ibuf(ima, &iuser, NULL);
-
-    if (ibuf) {
+    /* Only the tile resolution is needed here, avoid decoding tiles which are not loaded. */
+    int tile_size[2];
+    if (BKE_image_get_tile_size(ima, tile, tile_size)) {
       PackTile *packtile = (PackTile *)MEM_callocN(sizeof(PackTile), __func__);
       packtile->tile = tile;
-      packtile->boxpack.w = ibuf->x;
-      packtile->boxpack.h = ibuf->y;
+      packtile->boxpack.w = tile_size[0];
+      packtile->boxpack.h = tile_size[1];
 
       if (is_over_resolution_limit(packtile->boxpack.w, packtile->boxpack.h)) {
         packtile->boxpack.w = smaller_power_of_2_limit(packtile->boxpack.w);
@@ -161,7 +163,6 @@ static GPUTexture *gpu_texture_create_tile_array(Image *ima, ImBuf *main_ibuf)
       float w = packtile->boxpack.w, h = packtile->boxpack.h;
       packtile->pack_score = max_ff(w, h) / min_ff(w, h) * w * h;
 
-      BKE_image_release_ibuf(ima, ibuf, NULL);
       BLI_addtail(&boxes, packtile);
     }
   }
@@ -207,6 +208,10 @@ static GPUTexture *gpu_texture_create_tile_array(Image *ima, ImBuf *main_ibuf)
       continue;
     }
 
+    /* Tiles which were not in memory before are only loaded for the upload, free them again
+     * afterwards so that only the tiles used on the CPU (painting, baking) stay in memory. */
+    const bool was_loaded = BKE_image_is_tile_loaded(ima, tile);
+
     ImageUser iuser;
     BKE_imageuser_default(&iuser);
     iuser.tile = tile->tile_number;
@@ -224,13 +229,17 @@ static GPUTexture *gpu_texture_create_tile_array(Image *ima, ImBuf *main_ibuf)
     }
 
     BKE_image_release_ibuf(ima, ibuf, NULL);
+
+    if (!was_loaded && ibuf != main_ibuf) {
+      BKE_image_free_tile_ibuf_if_reloadable(ima, tile);
+    }
   }
 
   if (GPU_mipmap_enabled()) {
     GPU_texture_generate_mipmap(tex);
     GPU_texture_mipmap_mode(tex, true, true);
     if (ima) {
-      ima->gpuflag |= IMA_GPU_MIPMAP_COMPLETE;
+      atomic_fetch_and_or_int16(&ima->gpuflag, IMA_GPU_MIPMAP_COMPLETE);
     }
   }
   else {
@@ -297,13 +306,19 @@ static GPUTexture *image_get_gpu_texture(Image *ima,
     ima->gpu_pass = requested_pass;
     ima->gpu_layer = requested_layer;
     ima->gpu_slot = requested_slot;
-    ima->gpuflag |= IMA_GPU_REFRESH;
+    atomic_fetch_and_or_int16(&ima->gpuflag, IMA_GPU_REFRESH);
   }
 
-  /* currently, gpu refresh tagging is used by ima sequences */
-  if (ima->gpuflag & IMA_GPU_REFRESH) {
+  /* Currently, gpu refresh tagging is used by ima sequences and render results. The flags are
+   * set from other threads, so every change to them is atomic. */
+  if (atomic_fetch_and_and_int16(&ima->gpuflag, ~IMA_GPU_REFRESH) & IMA_GPU_REFRESH) {
     image_free_gpu(ima, true);
-    ima->gpuflag &= ~IMA_GPU_REFRESH;
+  }
+
+  /* Upload regions modified by painting or rendering. */
+  if (atomic_fetch_and_and_int16(&ima->gpuflag, ~IMA_GPU_PARTIAL_REFRESH) &
+      IMA_GPU_PARTIAL_REFRESH) {
+    image_update_gputexture_delayed_flush(ima, iuser, ibuf);
   }
 
   /* Tag as in active use for garbage collector. */
@@ -355,7 +370,7 @@ static GPUTexture *image_get_gpu_texture(Image *ima,
     if (GPU_mipmap_enabled()) {
       GPU_texture_generate_mipmap(*tex);
       if (ima) {
-        ima->gpuflag |= IMA_GPU_MIPMAP_COMPLETE;
+        atomic_fetch_and_or_int16(&ima->gpuflag, IMA_GPU_MIPMAP_COMPLETE);
       }
       GPU_texture_mipmap_mode(*tex, true, true);
     }
@@ -449,7 +464,7 @@ static void image_free_gpu(Image *ima, const bool immediate)
     }
   }
 
-  ima->gpuflag &= ~IMA_GPU_MIPMAP_COMPLETE;
+  atomic_fetch_and_and_int16(&ima->gpuflag, ~IMA_GPU_MIPMAP_COMPLETE);
 }
 
 void BKE_image_free_gputextures(Image *ima)
@@ -626,12 +641,30 @@ static void gpu_texture_update_unscaled(GPUTexture *tex,
   GPU_unpack_row_length_set(0);
 }
 
-static void gpu_texture_update_from_ibuf(
-    GPUTexture *tex, Image *ima, ImBuf *ibuf, ImageTile *tile, int x, int y, int w, int h)
+/* Pixels of a region to upload to a GPU texture, converted on the CPU when needed. */
+typedef struct ImageGPUUpdateRegion {
+  GPUTexture *tex;
+  /** Tile of the array texture to update, NULL for the 2D texture. */
+  ImageTile *tile;
+  int x, y, w, h;
+  bool scaled;
+  /** Pixels to upload, either pointing into the image buffer or converted copies. */
+  uchar *rect;
+  float *rect_float;
+  int tex_stride, tex_offset;
+} ImageGPUUpdateRegion;
+
+/* Convert the pixels of a region for uploading. This does not use the GPU, so regions can be
+ * prepared in parallel. */
+static void gpu_texture_update_region_prepare(Image *ima,
+                                              ImBuf *ibuf,
+                                              ImageGPUUpdateRegion *region)
 {
+  int x = region->x, y = region->y, w = region->w, h = region->h;
+
   bool scaled;
-  if (tile != NULL) {
-    int *tilesize = tile->runtime.tilearray_size;
+  if (region->tile != NULL) {
+    int *tilesize = region->tile->runtime.tilearray_size;
     scaled = (ibuf->x != tilesize[0]) || (ibuf->y != tilesize[1]);
   }
   else {
@@ -664,6 +697,7 @@ static void gpu_texture_update_from_ibuf(
 
       rect = (uchar *)MEM_mallocN(sizeof(uchar[4]) * w * h, __func__);
       if (rect == NULL) {
+        region->w = region->h = 0;
         return;
       }
 
@@ -681,6 +715,7 @@ static void gpu_texture_update_from_ibuf(
     if (ibuf->channels != 4 || scaled || !store_premultiplied) {
       rect_float = (float *)MEM_mallocN(sizeof(float[4]) * w * h, __func__);
       if (rect_float == NULL) {
+        region->w = region->h = 0;
         return;
       }
 
@@ -692,18 +727,61 @@ static void gpu_texture_update_from_ibuf(
     }
   }
 
-  if (scaled) {
+  region->x = x;
+  region->y = y;
+  region->w = w;
+  region->h = h;
+  region->scaled = scaled;
+  region->rect = rect;
+  region->rect_float = rect_float;
+  region->tex_stride = tex_stride;
+  region->tex_offset = tex_offset;
+}
+
+/* Upload prepared pixels, from the thread with the GPU context. */
+static void gpu_texture_update_region_upload(ImBuf *ibuf, ImageGPUUpdateRegion *region)
+{
+  if (region->w == 0 || region->h == 0) {
+    return;
+  }
+
+  GPUTexture *tex = region->tex;
+  ImageTile *tile = region->tile;
+  uchar *rect = region->rect;
+  float *rect_float = region->rect_float;
+
+  if (region->scaled) {
     /* Slower update where we first have to scale the input pixels. */
     if (tile != NULL) {
       int *tileoffset = tile->runtime.tilearray_offset;
       int *tilesize = tile->runtime.tilearray_size;
       int tilelayer = tile->runtime.tilearray_layer;
-      gpu_texture_update_scaled(
-          tex, rect, rect_float, ibuf->x, ibuf->y, x, y, tilelayer, tileoffset, tilesize, w, h);
+      gpu_texture_update_scaled(tex,
+                                rect,
+                                rect_float,
+                                ibuf->x,
+                                ibuf->y,
+                                region->x,
+                                region->y,
+                                tilelayer,
+                                tileoffset,
+                                tilesize,
+                                region->w,
+                                region->h);
     }
     else {
-      gpu_texture_update_scaled(
-          tex, rect, rect_float, ibuf->x, ibuf->y, x, y, -1, NULL, NULL, w, h);
+      gpu_texture_update_scaled(tex,
+                                rect,
+                                rect_float,
+                                ibuf->x,
+                                ibuf->y,
+                                region->x,
+                                region->y,
+                                -1,
+                                NULL,
+                                NULL,
+                                region->w,
+                                region->h);
     }
   }
   else {
@@ -711,12 +789,30 @@ static void gpu_texture_update_from_ibuf(
     if (tile != NULL) {
       int *tileoffset = tile->runtime.tilearray_offset;
       int tilelayer = tile->runtime.tilearray_layer;
-      gpu_texture_update_unscaled(
-          tex, rect, rect_float, x, y, tilelayer, tileoffset, w, h, tex_stride, tex_offset);
+      gpu_texture_update_unscaled(tex,
+                                  rect,
+                                  rect_float,
+                                  region->x,
+                                  region->y,
+                                  tilelayer,
+                                  tileoffset,
+                                  region->w,
+                                  region->h,
+                                  region->tex_stride,
+                                  region->tex_offset);
     }
     else {
-      gpu_texture_update_unscaled(
-          tex, rect, rect_float, x, y, -1, NULL, w, h, tex_stride, tex_offset);
+      gpu_texture_update_unscaled(tex,
+                                  rect,
+                                  rect_float,
+                                  region->x,
+                                  region->y,
+                                  -1,
+                                  NULL,
+                                  region->w,
+                                  region->h,
+                                  region->tex_stride,
+                                  region->tex_offset);
     }
   }
 
@@ -727,15 +823,137 @@ static void gpu_texture_update_from_ibuf(
   if (rect_float && rect_float != ibuf->rect_float) {
     MEM_freeN(rect_float);
   }
+}
 
-  if (GPU_mipmap_enabled()) {
-    GPU_texture_generate_mipmap(tex);
+typedef struct ImageGPUUpdateData {
+  Image *ima;
+  ImBuf *ibuf;
+  ImageGPUUpdateRegion *regions;
+} ImageGPUUpdateData;
+
+static void gpu_texture_update_prepare_task(void *__restrict userdata,
+                                            const int i,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  ImageGPUUpdateData *data = userdata;
+  gpu_texture_update_region_prepare(data->ima, data->ibuf, &data->regions[i]);
+}
+
+/* Upload the dirty tiles of an image buffer to the GPU textures of the image. Color space
+ * conversion of the tiles runs in parallel, the upload itself is done one region at a time. */
+static void image_update_gputexture_dirty_tiles(Image *ima, ImBuf *ibuf, ImageTile *tile)
+{
+  int dirty_len;
+  rcti *dirty = IMB_dirty_tiles_pop_regions(ibuf, &dirty_len);
+  if (dirty == NULL) {
+    return;
   }
-  else {
-    ima->gpuflag &= ~IMA_GPU_MIPMAP_COMPLETE;
+
+  GPUTexture *textures[2];
+  ImageTile *texture_tiles[2];
+  int textures_len = 0;
+
+  /* Check if we need to update the main gputexture. */
+  if (ima->gputexture[TEXTARGET_2D][0] != NULL && tile == ima->tiles.first) {
+    textures[textures_len] = ima->gputexture[TEXTARGET_2D][0];
+    texture_tiles[textures_len] = NULL;
+    textures_len++;
+  }
+  /* Check if we need to update the array gputexture. */
+  if (ima->gputexture[TEXTARGET_2D_ARRAY][0] != NULL && tile != NULL) {
+    textures[textures_len] = ima->gputexture[TEXTARGET_2D_ARRAY][0];
+    texture_tiles[textures_len] = tile;
+    textures_len++;
+  }
+
+  if (textures_len == 0) {
+    MEM_freeN(dirty);
+    return;
   }
 
-  GPU_texture_unbind(tex);
+  const int regions_len = dirty_len * textures_len;
+  ImageGPUUpdateRegion *regions = MEM_calloc_arrayN(
+      regions_len, sizeof(ImageGPUUpdateRegion), __func__);
+  for (int t = 0; t < textures_len; t++) {
+    for (int i = 0; i < dirty_len; i++) {
+      ImageGPUUpdateRegion *region = &regions[t * dirty_len + i];
+      region->tex = textures[t];
+      region->tile = texture_tiles[t];
+      region->x = dirty[i].xmin;
+      region->y = dirty[i].ymin;
+      region->w = BLI_rcti_size_x(&dirty[i]);
+      region->h = BLI_rcti_size_y(&dirty[i]);
+    }
+  }
+
+  ImageGPUUpdateData data = {
+      .ima = ima,
+      .ibuf = ibuf,
+      .regions = regions,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (regions_len > 1);
+  BLI_task_parallel_range(0, regions_len, &data, gpu_texture_update_prepare_task, &settings);
+
+  for (int i = 0; i < regions_len; i++) {
+    gpu_texture_update_region_upload(ibuf, &regions[i]);
+  }
+
+  for (int t = 0; t < textures_len; t++) {
+    if (GPU_mipmap_enabled()) {
+      GPU_texture_generate_mipmap(textures[t]);
+    }
+    else {
+      atomic_fetch_and_and_int16(&ima->gpuflag, ~IMA_GPU_MIPMAP_COMPLETE);
+    }
+
+    GPU_texture_unbind(textures[t]);
+  }
+
+  MEM_freeN(regions);
+  MEM_freeN(dirty);
+}
+
+/* Upload regions tagged with #BKE_image_update_gputexture_delayed. */
+static void image_update_gputexture_delayed_flush(Image *ima, ImageUser *iuser, ImBuf *ibuf)
+{
+  if (ima->source == IMA_SRC_TILED) {
+    /* Only tiles which are in memory can have been modified. */
+    LISTBASE_FOREACH (ImageTile *, tile, &ima->tiles) {
+      if (!BKE_image_is_tile_loaded(ima, tile)) {
+        continue;
+      }
+
+      ImageUser tile_iuser;
+      if (iuser != NULL) {
+        tile_iuser = *iuser;
+      }
+      else {
+        BKE_imageuser_default(&tile_iuser);
+      }
+      tile_iuser.tile = tile->tile_number;
+
+      ImBuf *tile_ibuf = BKE_image_acquire_ibuf(ima, &tile_iuser, NULL);
+      if (tile_ibuf != NULL) {
+        image_update_gputexture_dirty_tiles(ima, tile_ibuf, tile);
+      }
+      BKE_image_release_ibuf(ima, tile_ibuf, NULL);
+    }
+    return;
+  }
+
+  ImageTile *tile = BKE_image_get_tile_from_iuser(ima, iuser);
+  if (ibuf != NULL) {
+    image_update_gputexture_dirty_tiles(ima, ibuf, tile);
+    return;
+  }
+
+  ImBuf *ibuf_intern = BKE_image_acquire_ibuf(ima, iuser, NULL);
+  if (ibuf_intern != NULL) {
+    image_update_gputexture_dirty_tiles(ima, ibuf_intern, tile);
+  }
+  BKE_image_release_ibuf(ima, ibuf_intern, NULL);
 }
 
 /* Partial update of texture for texture painting. This is often much
@@ -749,22 +967,25 @@ void BKE_image_update_gputexture(Image *ima, ImageUser *iuser, int x, int y, int
     /* Full reload of texture. */
     BKE_image_free_gputextures(ima);
   }
-
-  GPUTexture *tex = ima->gputexture[TEXTARGET_2D][0];
-  /* Check if we need to update the main gputexture. */
-  if (tex != NULL && tile == ima->tiles.first) {
-    gpu_texture_update_from_ibuf(tex, ima, ibuf, NULL, x, y, w, h);
-  }
-
-  /* Check if we need to update the array gputexture. */
-  tex = ima->gputexture[TEXTARGET_2D_ARRAY][0];
-  if (tex != NULL) {
-    gpu_texture_update_from_ibuf(tex, ima, ibuf, tile, x, y, w, h);
+  else {
+    IMB_dirty_tiles_tag(ibuf, x, y, w, h);
+    image_update_gputexture_dirty_tiles(ima, ibuf, tile);
   }
 
   BKE_image_release_ibuf(ima, ibuf, NULL);
 }
 
+/**
+ * Tag a region of an image buffer to be uploaded to the GPU textures of the image, the next
+ * time they are requested for drawing. Successive updates are accumulated in tiles, so that
+ * each tile is only converted and uploaded once. Can be called from any thread.
+ */
+void BKE_image_update_gputexture_delayed(Image *ima, ImBuf *ibuf, int x, int y, int w, int h)
+{
+  IMB_dirty_tiles_tag(ibuf, x, y, w, h);
+  atomic_fetch_and_or_int16(&ima->gpuflag, IMA_GPU_PARTIAL_REFRESH);
+}
+
 /* these two functions are called on entering and exiting texture paint mode,
  * temporary disabling/enabling mipmapping on all images for quick texture
  * updates with glTexSubImage2D. images that didn't change don't have to be
@@ -790,7 +1011,7 @@ void BKE_image_paint_set_mipmap(Main *bmain, bool mipmap)
       }
     }
     else {
-      ima->gpuflag &= ~IMA_GPU_MIPMAP_COMPLETE;
+      atomic_fetch_and_and_int16(&ima->gpuflag, ~IMA_GPU_MIPMAP_COMPLETE);
     }
   }
 }
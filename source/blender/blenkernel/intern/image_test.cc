@@ -0,0 +1,250 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include "CLG_log.h"
+
+#include "DNA_image_types.h"
+
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "BKE_appdir.h"
+#include "BKE_global.h"
+#include "BKE_idtype.h"
+#include "BKE_image.h"
+#include "BKE_main.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+#include "IMB_moviecache.h"
+
+namespace blender::bke::tests {
+
+/* Tiles of different sizes, so the size query can't fall back to the first tile. */
+static const int TILE_SIZES[2][2] = {{16, 8}, {12, 20}};
+
+static unsigned char tile_pixel_value(int tile_number, int x, int y, int channel)
+{
+  return (unsigned char)((tile_number * 3 + x * 13 + y * 7 + channel * 50) % 256);
+}
+
+class ImageTileTest : public testing::Test {
+ protected:
+  Main *bmain;
+  Image *ima;
+
+  static void SetUpTestCase()
+  {
+    testing::Test::SetUpTestCase();
+    CLG_init();
+    BLI_threadapi_init();
+    BKE_idtype_init();
+    IMB_init();
+    BKE_images_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    BKE_images_exit();
+    IMB_moviecache_destruct();
+    IMB_exit();
+    BLI_threadapi_exit();
+    CLG_exit();
+    testing::Test::TearDownTestCase();
+  }
+
+  void SetUp() override
+  {
+    BKE_tempdir_init(nullptr);
+    bmain = BKE_main_new();
+    /* Image paths are made absolute relative to the global main. */
+    G_MAIN = bmain;
+
+    char filepath[FILE_MAX];
+    for (int i = 0; i < 2; i++) {
+      tile_file_path(1001 + i, filepath);
+      tile_file_write(1001 + i, TILE_SIZES[i][0], TILE_SIZES[i][1], filepath);
+    }
+
+    tile_file_path(1001, filepath);
+    ima = BKE_image_load(bmain, filepath);
+    ASSERT_NE(ima, nullptr);
+    ima->source = IMA_SRC_TILED;
+    ASSERT_NE(BKE_image_add_tile(ima, 1002, nullptr), nullptr);
+  }
+
+  void TearDown() override
+  {
+    BKE_main_free(bmain);
+    G_MAIN = nullptr;
+    BKE_tempdir_session_purge();
+  }
+
+  static void tile_file_path(int tile_number, char *r_filepath)
+  {
+    char filename[FILE_MAX];
+    BLI_snprintf(filename, sizeof(filename), "image_tile_test.%d.png", tile_number);
+    BLI_join_dirfile(r_filepath, FILE_MAX, BKE_tempdir_session(), filename);
+  }
+
+  static void tile_file_write(int tile_number, int width, int height, const char *filepath)
+  {
+    ImBuf *ibuf = IMB_allocImBuf(width, height, 32, IB_rect);
+    for (int y = 0; y < height; y++) {
+      for (int x = 0; x < width; x++) {
+        unsigned char *pixel = (unsigned char *)(ibuf->rect + y * width + x);
+        for (int c = 0; c < 3; c++) {
+          pixel[c] = tile_pixel_value(tile_number, x, y, c);
+        }
+        pixel[3] = 255;
+      }
+    }
+    ibuf->ftype = IMB_FTYPE_PNG;
+    EXPECT_TRUE(IMB_saveiff(ibuf, filepath, IB_rect));
+    IMB_freeImBuf(ibuf);
+  }
+
+  ImBuf *tile_acquire(int tile_number)
+  {
+    ImageUser iuser;
+    BKE_imageuser_default(&iuser);
+    iuser.tile = tile_number;
+    return BKE_image_acquire_ibuf(ima, &iuser, nullptr);
+  }
+
+  void expect_tile_pixels(const ImBuf *ibuf, int tile_number)
+  {
+    const int *size = TILE_SIZES[tile_number - 1001];
+    ASSERT_NE(ibuf, nullptr);
+    ASSERT_NE(ibuf->rect, nullptr);
+    EXPECT_EQ(ibuf->x, size[0]);
+    EXPECT_EQ(ibuf->y, size[1]);
+
+    for (int y = 0; y < ibuf->y; y++) {
+      for (int x = 0; x < ibuf->x; x++) {
+        const unsigned char *pixel = (unsigned char *)(ibuf->rect + y * ibuf->x + x);
+        for (int c = 0; c < 3; c++) {
+          EXPECT_EQ(pixel[c], tile_pixel_value(tile_number, x, y, c)) << x << ", " << y;
+        }
+      }
+    }
+  }
+};
+
+TEST_F(ImageTileTest, FreeAndReload)
+{
+  ImageTile *tile = BKE_image_get_tile(ima, 1002);
+  ASSERT_NE(tile, nullptr);
+  EXPECT_FALSE(BKE_image_is_tile_loaded(ima, tile));
+
+  /* The size comes from the file header, without loading the tile. */
+  int size[2];
+  EXPECT_TRUE(BKE_image_get_tile_size(ima, tile, size));
+  EXPECT_EQ(size[0], TILE_SIZES[1][0]);
+  EXPECT_EQ(size[1], TILE_SIZES[1][1]);
+  EXPECT_FALSE(BKE_image_is_tile_loaded(ima, tile));
+
+  ImBuf *ibuf = tile_acquire(1002);
+  expect_tile_pixels(ibuf, 1002);
+  /* Tiles read from a file are left to the memory cache limiter. */
+  EXPECT_EQ(ibuf->userflags & IB_PERSISTENT, 0);
+  EXPECT_EQ(tile->ok, IMA_OK_LOADED);
+  BKE_image_release_ibuf(ima, ibuf, nullptr);
+  EXPECT_TRUE(BKE_image_is_tile_loaded(ima, tile));
+
+  BKE_image_free_tile_ibuf_if_reloadable(ima, tile);
+  EXPECT_FALSE(BKE_image_is_tile_loaded(ima, tile));
+  /* Freeing is not a load failure, the tile can be loaded again. */
+  EXPECT_EQ(tile->ok, IMA_OK_LOADED);
+
+  ibuf = tile_acquire(1002);
+  expect_tile_pixels(ibuf, 1002);
+  EXPECT_EQ(tile->ok, IMA_OK_LOADED);
+  BKE_image_release_ibuf(ima, ibuf, nullptr);
+  EXPECT_TRUE(BKE_image_is_tile_loaded(ima, tile));
+
+  /* Other tiles are not affected. */
+  ImageTile *first_tile = BKE_image_get_tile(ima, 1001);
+  ibuf = tile_acquire(1001);
+  BKE_image_release_ibuf(ima, ibuf, nullptr);
+  BKE_image_free_tile_ibuf_if_reloadable(ima, tile);
+  EXPECT_TRUE(BKE_image_is_tile_loaded(ima, first_tile));
+  EXPECT_FALSE(BKE_image_is_tile_loaded(ima, tile));
+}
+
+TEST_F(ImageTileTest, KeepUsedTile)
+{
+  ImageTile *tile = BKE_image_get_tile(ima, 1002);
+  ImBuf *ibuf = tile_acquire(1002);
+  ASSERT_NE(ibuf, nullptr);
+
+  /* A tile still acquired elsewhere stays in the cache. */
+  BKE_image_free_tile_ibuf_if_reloadable(ima, tile);
+  EXPECT_TRUE(BKE_image_is_tile_loaded(ima, tile));
+  expect_tile_pixels(ibuf, 1002);
+  BKE_image_release_ibuf(ima, ibuf, nullptr);
+}
+
+TEST_F(ImageTileTest, KeepModifiedTile)
+{
+  ImageTile *tile = BKE_image_get_tile(ima, 1002);
+  ImBuf *ibuf = tile_acquire(1002);
+  ASSERT_NE(ibuf, nullptr);
+  /* Painted pixels are lost when reloading. */
+  ibuf->rect[0] = 0;
+  ibuf->userflags |= IB_BITMAPDIRTY;
+  BKE_image_release_ibuf(ima, ibuf, nullptr);
+
+  BKE_image_free_tile_ibuf_if_reloadable(ima, tile);
+  EXPECT_TRUE(BKE_image_is_tile_loaded(ima, tile));
+
+  ibuf = tile_acquire(1002);
+  ASSERT_NE(ibuf, nullptr);
+  EXPECT_EQ(ibuf->rect[0], 0);
+  BKE_image_release_ibuf(ima, ibuf, nullptr);
+}
+
+TEST_F(ImageTileTest, KeepGeneratedTile)
+{
+  ImageTile *tile = BKE_image_add_tile(ima, 1003, nullptr);
+  ASSERT_NE(tile, nullptr);
+  const float color[4] = {0.0f, 1.0f, 0.0f, 1.0f};
+  EXPECT_TRUE(BKE_image_fill_tile(ima, tile, 8, 4, color, IMA_GENTYPE_BLANK, 32, false));
+  EXPECT_EQ(tile->ok, IMA_OK);
+
+  /* There is no file to reload a generated tile from. */
+  BKE_image_free_tile_ibuf_if_reloadable(ima, tile);
+  EXPECT_TRUE(BKE_image_is_tile_loaded(ima, tile));
+  EXPECT_EQ(tile->ok, IMA_OK);
+
+  int size[2];
+  EXPECT_TRUE(BKE_image_get_tile_size(ima, tile, size));
+  EXPECT_EQ(size[0], 8);
+  EXPECT_EQ(size[1], 4);
+
+  ImBuf *ibuf = tile_acquire(1003);
+  ASSERT_NE(ibuf, nullptr);
+  ASSERT_NE(ibuf->rect, nullptr);
+  const unsigned char *pixel = (unsigned char *)ibuf->rect;
+  EXPECT_EQ(pixel[0], 0);
+  EXPECT_EQ(pixel[1], 255);
+  EXPECT_EQ(pixel[2], 0);
+  BKE_image_release_ibuf(ima, ibuf, nullptr);
+}
+
+}  // namespace blender::bke::tests
@@ -50,6 +50,7 @@
 #include "BLI_linklist.h"
 #include "BLI_listbase.h"
 #include "BLI_path_util.h"
+#include "BLI_profile.h"
 #include "BLI_session_uuid.h"
 #include "BLI_string.h"
 #include "BLI_string_utils.h"
@@ -1019,7 +1020,11 @@ struct Mesh *BKE_modifier_modify_mesh(ModifierData *md,
   if (mti->dependsOnNormals && mti->dependsOnNormals(md)) {
     modwrap_dependsOnNormals(me);
   }
-  return mti->modifyMesh(md, ctx, me);
+
+  BLI_PROFILE_ZONE_BEGIN(zone, mti->name);
+  Mesh *result = mti->modifyMesh(md, ctx, me);
+  BLI_PROFILE_ZONE_END(zone);
+  return result;
 }
 
 void BKE_modifier_deform_verts(ModifierData *md,
@@ -1034,7 +1039,10 @@ void BKE_modifier_deform_verts(ModifierData *md,
   if (me && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
     modwrap_dependsOnNormals(me);
   }
+
+  BLI_PROFILE_ZONE_BEGIN(zone, mti->name);
   mti->deformVerts(md, ctx, me, vertexCos, numVerts);
+  BLI_PROFILE_ZONE_END(zone);
 }
 
 void BKE_modifier_deform_vertsEM(ModifierData *md,
@@ -1050,7 +1058,10 @@ void BKE_modifier_deform_vertsEM(ModifierData *md,
   if (me && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
     BKE_mesh_calc_normals(me);
   }
+
+  BLI_PROFILE_ZONE_BEGIN(zone, mti->name);
   mti->deformVertsEM(md, ctx, em, me, vertexCos, numVerts);
+  BLI_PROFILE_ZONE_END(zone);
 }
 
 /* end modifier callback wrappers */
@@ -2679,10 +2679,35 @@ void psys_find_parents(ParticleSimulationData *sim, const bool use_render_params
 
   BLI_kdtree_3d_balance(tree);
 
-  for (; p < totchild; p++, cpa++) {
-    psys_particle_on_emitter(
-        sim->psmd, from, cpa->num, DMCACHE_ISCHILD, cpa->fuv, cpa->foffset, co, 0, 0, 0, orco);
-    cpa->parent = BLI_kdtree_3d_find_nearest(tree, orco, NULL);
+  const int totfind = totchild - p;
+  if (totfind > 0) {
+    float(*find_orcos)[3] = MEM_malloc_arrayN(totfind, sizeof(*find_orcos), __func__);
+    int *find_parents = MEM_malloc_arrayN(totfind, sizeof(*find_parents), __func__);
+    ChildParticle *cpa_find = cpa;
+
+    for (int i = 0; i < totfind; i++, cpa++) {
+      psys_particle_on_emitter(sim->psmd,
+                               from,
+                               cpa->num,
+                               DMCACHE_ISCHILD,
+                               cpa->fuv,
+                               cpa->foffset,
+                               co,
+                               0,
+                               0,
+                               0,
+                               find_orcos[i]);
+    }
+
+    BLI_kdtree_3d_find_nearest_batch(
+        tree, (const float(*)[3])find_orcos, (uint)totfind, find_parents, NULL);
+
+    for (int i = 0; i < totfind; i++) {
+      cpa_find[i].parent = find_parents[i];
+    }
+
+    MEM_freeN(find_orcos);
+    MEM_freeN(find_parents);
   }
 
   BLI_kdtree_3d_free(tree);
@@ -2229,6 +2229,8 @@ typedef struct EfData {
   ParticleTexture ptex;
   ParticleSimulationData *sim;
   ParticleData *pa;
+  /* Effector force and impulse of the first integration step, when already evaluated. */
+  const float *effector_force, *effector_impulse;
 } EfData;
 static void basic_force_cb(void *efdata_v, ParticleKey *state, float *force, float *impulse)
 {
@@ -2241,7 +2243,12 @@ static void basic_force_cb(void *efdata_v, ParticleKey *state, float *force, flo
 
   /* add effectors */
   pd_point_from_particle(efdata->sim, efdata->pa, state, &epoint);
-  if (part->type != PART_HAIR || part->effector_weights->flag & EFF_WEIGHT_DO_HAIR) {
+  if (efdata->effector_force) {
+    copy_v3_v3(force, efdata->effector_force);
+    copy_v3_v3(impulse, efdata->effector_impulse);
+    efdata->effector_force = efdata->effector_impulse = NULL;
+  }
+  else if (part->type != PART_HAIR || part->effector_weights->flag & EFF_WEIGHT_DO_HAIR) {
     BKE_effectors_apply(sim->psys->effectors,
                         sim->colliders,
                         part->effector_weights,
@@ -2270,8 +2277,90 @@ static void basic_force_cb(void *efdata_v, ParticleKey *state, float *force, flo
     copy_v3_v3(pa->state.ave, epoint.ave);
   }
 }
+/* The first integration step evaluates the effectors at the current particle states, which can
+ * be done for all particles at once unless the result depends on the particles integrated
+ * before. */
+static bool basic_effectors_can_precalc(ParticleSimulationData *sim)
+{
+  ParticleSettings *part = sim->psys->part;
+  EffectorCache *eff;
+
+  if (!sim->psys->effectors || (part->flag & PART_ROT_DYN)) {
+    return false;
+  }
+  if (part->type == PART_HAIR && !(part->effector_weights->flag & EFF_WEIGHT_DO_HAIR)) {
+    return false;
+  }
+
+  for (eff = sim->psys->effectors->first; eff; eff = eff->next) {
+    /* Self effecting particles see the already integrated ones, and the noise would be drawn
+     * in a different order. */
+    if (eff->psys == sim->psys || eff->pd->f_noise > 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Effector forces of the first integration step of all dynamic particles, followed by their
+ * impulses. Returns NULL when the effectors have to be evaluated per particle. */
+static float (*basic_effectors_precalc(ParticleSimulationData *sim))[3]
+{
+  ParticleSystem *psys = sim->psys;
+  ParticleData *pa;
+  EffectedPoint *epoints;
+  float(*effector_force)[3], (*force)[3];
+  int *indices;
+  int p, totdynamic = 0;
+
+  if (!basic_effectors_can_precalc(sim)) {
+    return NULL;
+  }
+
+  epoints = MEM_mallocN(sizeof(EffectedPoint) * psys->totpart, __func__);
+  indices = MEM_mallocN(sizeof(int) * psys->totpart, __func__);
+
+  LOOP_DYNAMIC_PARTICLES
+  {
+    pd_point_from_particle(sim, pa, &pa->state, &epoints[totdynamic]);
+    indices[totdynamic++] = p;
+  }
+
+  if (totdynamic == 0) {
+    MEM_freeN(indices);
+    MEM_freeN(epoints);
+    return NULL;
+  }
+
+  force = MEM_calloc_arrayN(totdynamic * 2, sizeof(float[3]), __func__);
+  BKE_effectors_apply_array(psys->effectors,
+                            sim->colliders,
+                            psys->part->effector_weights,
+                            epoints,
+                            totdynamic,
+                            force,
+                            NULL,
+                            force + totdynamic);
+
+  effector_force = MEM_malloc_arrayN(psys->totpart * 2, sizeof(float[3]), __func__);
+  for (int i = 0; i < totdynamic; i++) {
+    copy_v3_v3(effector_force[indices[i]], force[i]);
+    copy_v3_v3(effector_force[psys->totpart + indices[i]], force[totdynamic + i]);
+  }
+
+  MEM_freeN(force);
+  MEM_freeN(indices);
+  MEM_freeN(epoints);
+
+  return effector_force;
+}
+
 /* gathers all forces that effect particles and calculates a new state for the particle */
-static void basic_integrate(ParticleSimulationData *sim, int p, float dfra, float cfra)
+static void basic_integrate(ParticleSimulationData *sim,
+                            int p,
+                            float dfra,
+                            float cfra,
+                            float (*effector_force)[3])
 {
   ParticleSettings *part = sim->psys->part;
   ParticleData *pa = sim->psys->particles + p;
@@ -2284,6 +2373,8 @@ static void basic_integrate(ParticleSimulationData *sim, int p, float dfra, floa
 
   efdata.pa = pa;
   efdata.sim = sim;
+  efdata.effector_force = effector_force ? effector_force[p] : NULL;
+  efdata.effector_impulse = effector_force ? effector_force[sim->psys->totpart + p] : NULL;
 
   /* add global acceleration (gravitation) */
   if (psys_uses_gravity(sim) &&
@@ -3720,7 +3811,7 @@ static void dynamics_step_sph_ddr_task_cb_ex(void *__restrict userdata,
   }
 
   /* do global forces & effectors */
-  basic_integrate(sim, p, pa->state.time, data->cfra);
+  basic_integrate(sim, p, pa->state.time, data->cfra, NULL);
 
   /* actual fluids calculations */
   sph_integrate(sim, pa, pa->state.time, sphdata);
@@ -3751,7 +3842,7 @@ static void dynamics_step_sph_classical_basic_integrate_task_cb_ex(
     return;
   }
 
-  basic_integrate(sim, p, pa->state.time, data->cfra);
+  basic_integrate(sim, p, pa->state.time, data->cfra, NULL);
 }
 
 static void dynamics_step_sph_classical_calc_density_task_cb_ex(
@@ -3933,10 +4024,12 @@ static void dynamics_step(ParticleSimulationData *sim, float cfra)
 
   switch (part->phystype) {
     case PART_PHYS_NEWTON: {
+      float(*effector_force)[3] = basic_effectors_precalc(sim);
+
       LOOP_DYNAMIC_PARTICLES
       {
         /* do global forces & effectors */
-        basic_integrate(sim, p, pa->state.time, cfra);
+        basic_integrate(sim, p, pa->state.time, cfra, effector_force);
 
         /* deflection */
         if (sim->colliders) {
@@ -3946,6 +4039,7 @@ static void dynamics_step(ParticleSimulationData *sim, float cfra)
         /* rotations */
         basic_rotate(part, pa, pa->state.time, timestep);
       }
+      MEM_SAFE_FREE(effector_force);
       break;
     }
     case PART_PHYS_BOIDS: {
@@ -72,6 +72,8 @@
 
 #include "BIK_api.h"
 
+#include "pointcache_container.h"
+
 #ifdef WITH_BULLET
 #  include "RBI_api.h"
 #endif
@@ -148,11 +150,11 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
   int error = 0;
 
   /* Custom functions should read these basic elements too! */
-  if (!error && !fread(&pf->totpoint, sizeof(unsigned int), 1, pf->fp)) {
+  if (!error && !ptcache_file_read(pf, &pf->totpoint, 1, sizeof(unsigned int))) {
     error = 1;
   }
 
-  if (!error && !fread(&pf->data_types, sizeof(unsigned int), 1, pf->fp)) {
+  if (!error && !ptcache_file_read(pf, &pf->data_types, 1, sizeof(unsigned int))) {
     error = 1;
   }
 
@@ -161,11 +163,11 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
 static int ptcache_basic_header_write(PTCacheFile *pf)
 {
   /* Custom functions should write these basic elements too! */
-  if (!fwrite(&pf->totpoint, sizeof(unsigned int), 1, pf->fp)) {
+  if (!ptcache_file_write(pf, &pf->totpoint, 1, sizeof(unsigned int))) {
     return 0;
   }
 
-  if (!fwrite(&pf->data_types, sizeof(unsigned int), 1, pf->fp)) {
+  if (!ptcache_file_write(pf, &pf->data_types, 1, sizeof(unsigned int))) {
     return 0;
   }
 
@@ -1294,6 +1296,13 @@ static const char *ptcache_file_extension(const PTCacheID *pid)
   }
 }
 
+static bool ptcache_use_container(const PTCacheID *pid)
+{
+  /* External caches are always read from the files of other applications. */
+  return (pid->cache->flag & (PTCACHE_DISK_CONTAINER | PTCACHE_EXTERNAL)) ==
+         PTCACHE_DISK_CONTAINER;
+}
+
 /**
  * Similar to #BLI_path_frame_get, but takes into account the stack-index which is after the frame.
  */
@@ -1427,6 +1436,70 @@ static int ptcache_filename(PTCacheID *pid, char *filename, int cfra, short do_p
   return len; /* make sure the above string is always 16 chars */
 }
 
+/**
+ * File of the single file container that holds all frames of the cache.
+ */
+static int ptcache_container_filename(PTCacheID *pid, char *filename)
+{
+  int len = ptcache_filename(pid, filename, 0, 1, 0);
+
+  if (len == 0) {
+    return 0;
+  }
+
+  if (pid->cache->index < 0) {
+    BLI_assert(GS(pid->owner_id->name) == ID_OB);
+    pid->cache->index = pid->stack_index = BKE_object_insert_ptcache((Object *)pid->owner_id);
+  }
+
+  return len + BLI_snprintf(filename + len,
+                            MAX_PTCACHE_FILE - len,
+                            "_%02u" PTCACHE_CONTAINER_EXT,
+                            pid->stack_index);
+}
+
+static PTCacheContainer *ptcache_container_from_pid(PTCacheID *pid)
+{
+  char filename[MAX_PTCACHE_FILE];
+
+  if (ptcache_container_filename(pid, filename) == 0) {
+    return NULL;
+  }
+  return ptcache_container_get(filename);
+}
+
+/**
+ * Frames in a container are read and written in memory, written frames are added to the
+ * container when the file is closed.
+ */
+static PTCacheFile *ptcache_container_file_open(PTCacheID *pid, int mode, int cfra)
+{
+  PTCacheContainer *container = ptcache_container_from_pid(pid);
+  PTCacheFile *pf;
+  void *mem = NULL;
+  size_t mem_len = 0;
+
+  if (container == NULL) {
+    return NULL;
+  }
+
+  if (mode != PTCACHE_FILE_WRITE) {
+    mem = ptcache_container_read(container, cfra, &mem_len);
+    if (mem == NULL) {
+      return NULL;
+    }
+  }
+
+  pf = MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
+  pf->frame = cfra;
+  pf->mem = mem;
+  pf->mem_len = pf->mem_alloc = mem_len;
+  pf->container = (mode != PTCACHE_FILE_READ) ? container : NULL;
+  pf->compression = pid->cache->compression;
+
+  return pf;
+}
+
 /**
  * Caller must close after!
  */
@@ -1446,6 +1519,10 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
     return NULL; /* save blend file before using disk pointcache */
   }
 
+  if (ptcache_use_container(pid)) {
+    return ptcache_container_file_open(pid, mode, cfra);
+  }
+
   ptcache_filename(pid, filename, cfra, 1, 1);
 
   if (mode == PTCACHE_FILE_READ) {
@@ -1466,7 +1543,7 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
     return NULL;
   }
 
-  pf = MEM_mallocN(sizeof(PTCacheFile), "PTCacheFile");
+  pf = MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
   pf->fp = fp;
   pf->old_format = 0;
   pf->frame = cfra;
@@ -1476,7 +1553,15 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 static void ptcache_file_close(PTCacheFile *pf)
 {
   if (pf) {
-    fclose(pf->fp);
+    if (pf->fp) {
+      fclose(pf->fp);
+    }
+    else if (pf->container) {
+      /* The container takes ownership of the data. */
+      ptcache_container_write(pf->container, pf->frame, pf->mem, pf->mem_len, pf->compression);
+      pf->mem = NULL;
+    }
+    MEM_SAFE_FREE(pf->mem);
     MEM_freeN(pf);
   }
 }
@@ -1603,11 +1688,42 @@ static int ptcache_file_compressed_write(
 }
 static int ptcache_file_read(PTCacheFile *pf, void *f, unsigned int tot, unsigned int size)
 {
-  return (fread(f, size, tot, pf->fp) == tot);
+  if (pf->fp) {
+    return (fread(f, size, tot, pf->fp) == tot);
+  }
+
+  const size_t len = (size_t)tot * size;
+  if (pf->mem_len - pf->mem_pos < len) {
+    return 0;
+  }
+  memcpy(f, pf->mem + pf->mem_pos, len);
+  pf->mem_pos += len;
+  return 1;
 }
 static int ptcache_file_write(PTCacheFile *pf, const void *f, unsigned int tot, unsigned int size)
 {
-  return (fwrite(f, size, tot, pf->fp) == tot);
+  if (pf->fp) {
+    return (fwrite(f, size, tot, pf->fp) == tot);
+  }
+
+  const size_t len = (size_t)tot * size;
+  if (pf->mem_pos + len > pf->mem_alloc) {
+    pf->mem_alloc = MAX2(pf->mem_pos + len, pf->mem_alloc * 2);
+    pf->mem = MEM_reallocN(pf->mem, MAX2(pf->mem_alloc, 1));
+  }
+  memcpy(pf->mem + pf->mem_pos, f, len);
+  pf->mem_pos += len;
+  pf->mem_len = MAX2(pf->mem_len, pf->mem_pos);
+  return 1;
+}
+static void ptcache_file_rewind(PTCacheFile *pf)
+{
+  if (pf->fp) {
+    BLI_fseek(pf->fp, 0, SEEK_SET);
+  }
+  else {
+    pf->mem_pos = 0;
+  }
 }
 static int ptcache_file_data_read(PTCacheFile *pf)
 {
@@ -1643,7 +1759,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 
   pf->data_types = 0;
 
-  if (fread(bphysics, sizeof(char), 8, pf->fp) != 8) {
+  if (!ptcache_file_read(pf, bphysics, 8, sizeof(char))) {
     error = 1;
   }
 
@@ -1651,7 +1767,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
     error = 1;
   }
 
-  if (!error && !fread(&typeflag, sizeof(unsigned int), 1, pf->fp)) {
+  if (!error && !ptcache_file_read(pf, &typeflag, 1, sizeof(unsigned int))) {
     error = 1;
   }
 
@@ -1660,7 +1776,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 
   /* if there was an error set file as it was */
   if (error) {
-    BLI_fseek(pf->fp, 0, SEEK_SET);
+    ptcache_file_rewind(pf);
   }
 
   return !error;
@@ -1670,11 +1786,11 @@ static int ptcache_file_header_begin_write(PTCacheFile *pf)
   const char *bphysics = "BPHYSICS";
   unsigned int typeflag = pf->type + pf->flag;
 
-  if (fwrite(bphysics, sizeof(char), 8, pf->fp) != 8) {
+  if (!ptcache_file_write(pf, bphysics, 8, sizeof(char))) {
     return 0;
   }
 
-  if (!fwrite(&typeflag, sizeof(unsigned int), 1, pf->fp)) {
+  if (!ptcache_file_write(pf, &typeflag, 1, sizeof(unsigned int))) {
     return 0;
   }
 
@@ -2001,8 +2117,14 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
 {
   PTCacheFile *pf = NULL;
   unsigned int i, error = 0;
+  /* Containers compress whole frames. */
+  const int compression = ptcache_use_container(pid) ? PTCACHE_COMPRESS_NO :
+                                                        pid->cache->compression;
 
-  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
+  /* Frames in containers are replaced when written. */
+  if (!ptcache_use_container(pid)) {
+    BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
+  }
 
   pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, pm->frame);
 
@@ -2022,7 +2144,7 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
     pf->flag |= PTCACHE_TYPEFLAG_EXTRADATA;
   }
 
-  if (pid->cache->compression) {
+  if (compression) {
     pf->flag |= PTCACHE_TYPEFLAG_COMPRESS;
   }
 
@@ -2031,14 +2153,14 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
   }
 
   if (!error) {
-    if (pid->cache->compression) {
+    if (compression) {
       for (i = 0; i < BPHYS_TOT_DATA; i++) {
         if (pm->data[i]) {
           unsigned int in_len = pm->totpoint * ptcache_data_size[i];
           unsigned char *out = (unsigned char *)MEM_callocN(LZO_OUT_LEN(in_len) * 4,
                                                             "pointcache_lzo_buffer");
           ptcache_file_compressed_write(
-              pf, (unsigned char *)(pm->data[i]), in_len, out, pid->cache->compression);
+              pf, (unsigned char *)(pm->data[i]), in_len, out, compression);
           MEM_freeN(out);
         }
       }
@@ -2069,12 +2191,12 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
       ptcache_file_write(pf, &extra->type, 1, sizeof(unsigned int));
       ptcache_file_write(pf, &extra->totdata, 1, sizeof(unsigned int));
 
-      if (pid->cache->compression) {
+      if (compression) {
         unsigned int in_len = extra->totdata * ptcache_extra_datasize[extra->type];
         unsigned char *out = (unsigned char *)MEM_callocN(LZO_OUT_LEN(in_len) * 4,
                                                           "pointcache_lzo_buffer");
         ptcache_file_compressed_write(
-            pf, (unsigned char *)(extra->data), in_len, out, pid->cache->compression);
+            pf, (unsigned char *)(extra->data), in_len, out, compression);
         MEM_freeN(out);
       }
       else {
@@ -2354,7 +2476,10 @@ static int ptcache_write_stream(PTCacheID *pid, int cfra, int totpoint)
   PTCacheFile *pf = NULL;
   int error = 0;
 
-  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, cfra);
+  /* Frames in containers are replaced when written. */
+  if (!ptcache_use_container(pid)) {
+    BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, cfra);
+  }
 
   pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, cfra);
 
@@ -2558,6 +2683,58 @@ int BKE_ptcache_write(PTCacheID *pid, unsigned int cfra)
  */
 
 /* Clears & resets */
+
+static void ptcache_container_id_clear(PTCacheID *pid, int mode, int cfra)
+{
+  PointCache *cache = pid->cache;
+  char filename[MAX_PTCACHE_FILE];
+  int frame_first = cfra, frame_last = cfra;
+
+  if (ptcache_container_filename(pid, filename) == 0) {
+    return;
+  }
+
+  if (mode == PTCACHE_CLEAR_ALL) {
+    cache->last_exact = MIN2(cache->startframe, 0);
+    ptcache_container_delete(filename);
+
+    if (cache->cached_frames) {
+      memset(cache->cached_frames, 0, MEM_allocN_len(cache->cached_frames));
+    }
+    return;
+  }
+
+  if (mode == PTCACHE_CLEAR_BEFORE) {
+    frame_first = INT_MIN;
+    frame_last = cfra - 1;
+  }
+  else if (mode == PTCACHE_CLEAR_AFTER) {
+    frame_first = cfra + 1;
+    frame_last = INT_MAX;
+  }
+
+  ptcache_container_remove(ptcache_container_get(filename), frame_first, frame_last);
+
+  if (cache->cached_frames) {
+    const int sta = MAX2(frame_first, cache->startframe);
+    const int end = MIN2(frame_last, cache->endframe);
+
+    for (int frame = sta; frame <= end; frame++) {
+      cache->cached_frames[frame - cache->startframe] = 0;
+    }
+  }
+}
+
+static void ptcache_container_id_flush(PTCacheID *pid)
+{
+  if (ptcache_use_container(pid)) {
+    PTCacheContainer *container = ptcache_container_from_pid(pid);
+    if (container) {
+      ptcache_container_flush(container);
+    }
+  }
+}
+
 void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
 {
   unsigned int len; /* store the length of the string */
@@ -2591,6 +2768,12 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
 
   /*if (!G.relbase_valid) return; */ /* save blend file before using pointcache */
 
+  if ((pid->cache->flag & PTCACHE_DISK_CACHE) && ptcache_use_container(pid)) {
+    ptcache_container_id_clear(pid, mode, (int)cfra);
+    pid->cache->flag |= PTCACHE_FLAG_INFO_DIRTY;
+    return;
+  }
+
   const char *fext = ptcache_file_extension(pid);
 
   /* clear all files in the temp dir with the prefix of the ID and the ".bphys" suffix */
@@ -2729,6 +2912,11 @@ int BKE_ptcache_id_exist(PTCacheID *pid, int cfra)
   if (pid->cache->flag & PTCACHE_DISK_CACHE) {
     char filename[MAX_PTCACHE_FILE];
 
+    if (ptcache_use_container(pid)) {
+      PTCacheContainer *container = ptcache_container_from_pid(pid);
+      return container && ptcache_container_has_frame(container, cfra);
+    }
+
     ptcache_filename(pid, filename, cfra, 1, 1);
 
     return BLI_exists(filename);
@@ -2794,7 +2982,23 @@ void BKE_ptcache_id_time(
     cache->cached_frames = MEM_callocN(sizeof(char) * cache->cached_frames_len,
                                        "cached frames array");
 
-    if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+    if ((pid->cache->flag & PTCACHE_DISK_CACHE) && ptcache_use_container(pid)) {
+      PTCacheContainer *container = ptcache_container_from_pid(pid);
+      int *frames, frames_num;
+
+      if (container == NULL) {
+        return;
+      }
+
+      frames = ptcache_container_frames(container, &frames_num);
+      for (int i = 0; i < frames_num; i++) {
+        if (frames[i] >= (int)sta && frames[i] <= (int)end) {
+          cache->cached_frames[frames[i] - sta] = 1;
+        }
+      }
+      MEM_freeN(frames);
+    }
+    else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
       /* mode is same as fopen's modes */
       DIR *dir;
       struct dirent *de;
@@ -2982,6 +3186,9 @@ void BKE_ptcache_remove(void)
   char path_full[MAX_PTCACHE_PATH];
   int rmdir = 1;
 
+  /* Finish writing before the files are removed. */
+  ptcache_containers_free_all();
+
   ptcache_path(NULL, path);
 
   if (BLI_exists(path)) {
@@ -2999,7 +3206,7 @@ void BKE_ptcache_remove(void)
       if (FILENAME_IS_CURRPAR(de->d_name)) {
         /* do nothing */
       }
-      else if (strstr(de->d_name, PTCACHE_EXT)) { /* do we have the right extension?*/
+      else if (strstr(de->d_name, PTCACHE_EXT) || strstr(de->d_name, PTCACHE_CONTAINER_EXT)) {
         BLI_join_dirfile(path_full, sizeof(path_full), path, de->d_name);
         BLI_delete(path_full, false, false);
       }
@@ -3081,7 +3288,8 @@ static PointCache *ptcache_copy(PointCache *cache, const bool copy_data)
     ncache->cached_frames_len = 0;
 
     /* flag is a mix of user settings and simulator/baking state */
-    ncache->flag = ncache->flag & (PTCACHE_DISK_CACHE | PTCACHE_EXTERNAL | PTCACHE_IGNORE_LIBPATH);
+    ncache->flag = ncache->flag & (PTCACHE_DISK_CACHE | PTCACHE_DISK_CONTAINER | PTCACHE_EXTERNAL |
+                                   PTCACHE_IGNORE_LIBPATH);
     ncache->simframe = 0;
   }
   else {
@@ -3357,6 +3565,7 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
       /* write info file */
       if (cache->flag & PTCACHE_DISK_CACHE) {
         BKE_ptcache_write(pid, 0);
+        ptcache_container_id_flush(pid);
       }
     }
   }
@@ -3386,6 +3595,7 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
           cache->flag |= PTCACHE_BAKED;
           if (cache->flag & PTCACHE_DISK_CACHE) {
             BKE_ptcache_write(pid, 0);
+            ptcache_container_id_flush(pid);
           }
         }
       }
@@ -3498,6 +3708,75 @@ void BKE_ptcache_toggle_disk_cache(PTCacheID *pid)
   }
 }
 
+void BKE_ptcache_toggle_disk_container(PTCacheID *pid)
+{
+  PointCache *cache = pid->cache;
+  int last_exact = cache->last_exact;
+  int baked = cache->flag & PTCACHE_BAKED;
+
+  /* Memory caches only change the layout of future disk caches. External caches are files
+   * supplied by the user, which are never rewritten. */
+  if ((cache->flag & PTCACHE_DISK_CACHE) == 0 || (cache->flag & PTCACHE_EXTERNAL) ||
+      !G.relbase_valid) {
+    return;
+  }
+
+  if (cache->cached_frames) {
+    MEM_freeN(cache->cached_frames);
+    cache->cached_frames = NULL;
+    cache->cached_frames_len = 0;
+  }
+
+  /* Read the frames stored with the previous layout, PTCACHE_DISK_CONTAINER was toggled
+   * already. */
+  cache->flag ^= PTCACHE_DISK_CONTAINER;
+  cache->flag &= ~PTCACHE_DISK_CACHE;
+  BKE_ptcache_disk_to_mem(pid);
+
+  cache->flag |= PTCACHE_DISK_CACHE;
+  cache->flag &= ~PTCACHE_BAKED;
+  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_ALL, 0);
+  cache->flag |= baked;
+
+  /* Write them with the new layout. */
+  cache->flag ^= PTCACHE_DISK_CONTAINER;
+  BKE_ptcache_mem_to_disk(pid);
+
+  /* Keep the frames in memory when they couldn't be written. */
+  if (cache->flag & PTCACHE_DISK_CACHE) {
+    BKE_ptcache_free_mem(&cache->mem_cache);
+  }
+
+  cache->last_exact = last_exact;
+
+  BKE_ptcache_id_time(pid, NULL, 0.0f, NULL, NULL, NULL);
+
+  cache->flag |= PTCACHE_FLAG_INFO_DIRTY;
+}
+
+static void ptcache_container_id_rename(PTCacheID *pid,
+                                        const char *name_src,
+                                        const char *name_dst)
+{
+  char old_name[80];
+  char filename_src[MAX_PTCACHE_FILE];
+  char filename_dst[MAX_PTCACHE_FILE];
+  int len_src, len_dst;
+
+  BLI_strncpy(old_name, pid->cache->name, sizeof(old_name));
+
+  BLI_strncpy(pid->cache->name, name_src, sizeof(pid->cache->name));
+  len_src = ptcache_container_filename(pid, filename_src);
+  BLI_strncpy(pid->cache->name, name_dst, sizeof(pid->cache->name));
+  len_dst = ptcache_container_filename(pid, filename_dst);
+
+  BLI_strncpy(pid->cache->name, old_name, sizeof(pid->cache->name));
+
+  if (len_src && len_dst) {
+    ptcache_container_rename(filename_src, filename_dst);
+  }
+}
+
 void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const char *name_dst)
 {
   char old_name[80];
@@ -3511,6 +3790,11 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
   char old_path_full[MAX_PTCACHE_FILE];
   char ext[MAX_PTCACHE_PATH];
 
+  if (ptcache_use_container(pid)) {
+    ptcache_container_id_rename(pid, name_src, name_dst);
+    return;
+  }
+
   /* save old name */
   BLI_strncpy(old_name, pid->cache->name, sizeof(old_name));
 
@@ -0,0 +1,821 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bke
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#  include <sys/mman.h>
+#  include <unistd.h>
+#else
+#  include "mmap_win.h"
+#  include <io.h>
+#endif
+
+#include "CLG_log.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_pointcache_types.h"
+
+#include "BLI_fileops.h"
+#include "BLI_ghash.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_pointcache.h"
+
+#include "pointcache_container.h"
+
+#ifdef WITH_LZO
+#  ifdef WITH_SYSTEM_LZO
+#    include <lzo/lzo1x.h>
+#  else
+#    include "minilzo.h"
+#  endif
+#endif
+
+#define LZO_OUT_LEN(size) ((size) + (size) / 16 + 64 + 3)
+
+#ifdef WITH_LZMA
+#  include "LzmaLib.h"
+#endif
+
+static CLG_LogRef LOG = {"bke.pointcache"};
+
+#define PTCACHE_CONTAINER_CODE "BPHYSCON"
+#define PTCACHE_CONTAINER_VERSION 1
+
+/* Memory of frames that are waiting to be written, before new writes wait for them. */
+#define PTCACHE_CONTAINER_PENDING_MAX (256 * 1024 * 1024)
+/* Rewrite the file when the unused part is larger than this and larger than the used part. */
+#define PTCACHE_CONTAINER_COMPACT_MIN (4 * 1024 * 1024)
+
+/* -------------------------------------------------------------------- */
+/** \name File Format
+ * \{ */
+
+typedef struct PTCacheContainerHeader {
+  char code[8];
+  unsigned int version;
+  unsigned int _pad;
+} PTCacheContainerHeader;
+
+enum {
+  PTCACHE_CHUNK_FRAME = 0,
+  /* Removes older chunks of a range of frames, has no data. */
+  PTCACHE_CHUNK_REMOVE = 1,
+};
+
+typedef struct PTCacheChunkHeader {
+  unsigned int type;
+  /* Frame of the data, or range of removed frames. */
+  int frame, frame_last;
+  /* Write order, a chunk only replaces older chunks of the same frame. */
+  unsigned int seq;
+  /* PTCACHE_COMPRESS_ value. */
+  unsigned int compression;
+  /* Size of the frame data, and of the (compressed) data following this header. */
+  unsigned int raw_len, data_len;
+  /* LZMA properties. */
+  unsigned char props[8];
+} PTCacheChunkHeader;
+
+BLI_STATIC_ASSERT(sizeof(PTCacheContainerHeader) == 16, "Container header size changed")
+BLI_STATIC_ASSERT(sizeof(PTCacheChunkHeader) == 36, "Chunk header size changed")
+
+BLI_INLINE int64_t chunk_size(const PTCacheChunkHeader *header)
+{
+  return (int64_t)sizeof(*header) + header->data_len;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Container
+ * \{ */
+
+typedef struct PTCacheChunk {
+  /* Header of the chunk in the file, when offset is not -1. */
+  PTCacheChunkHeader header;
+  int64_t offset;
+  /* Newer data of the frame that is not written yet, or failed to be written. */
+  void *pending;
+  size_t pending_len;
+  /* A write task is queued for the pending data, which then frees or keeps it. */
+  bool pending_queued;
+} PTCacheChunk;
+
+struct PTCacheContainer {
+  char filepath[FILE_MAX];
+
+  ThreadMutex mutex;
+  /* Frame to #PTCacheChunk. */
+  GHash *chunks;
+  unsigned int seq;
+
+  /* File for writing, opened on the first write. */
+  FILE *fp;
+  /* End of the last complete chunk, and the file size as last seen. */
+  int64_t file_len, disk_len;
+  /* Size of chunks that were replaced or removed. */
+  int64_t unused_len;
+
+  /* Read only mapping of the file. */
+  int map_fd;
+  void *map;
+  size_t map_len;
+
+  /* Compresses and writes frames. */
+  TaskPool *pool;
+  size_t pending_len;
+};
+
+typedef struct PTCacheContainerWrite {
+  PTCacheContainer *container;
+  int frame;
+  unsigned int seq;
+  int compression;
+  void *data;
+  size_t len;
+} PTCacheContainerWrite;
+
+static GHash *containers = NULL;
+static ThreadMutex containers_mutex = BLI_MUTEX_INITIALIZER;
+/* The mmap emulation on Windows is not thread safe. */
+static ThreadMutex containers_mmap_mutex = BLI_MUTEX_INITIALIZER;
+
+static void container_chunk_free(void *chunk_v)
+{
+  PTCacheChunk *chunk = chunk_v;
+  MEM_SAFE_FREE(chunk->pending);
+  MEM_freeN(chunk);
+}
+
+static PTCacheChunk *container_chunk_ensure(PTCacheContainer *container, int frame)
+{
+  void **chunk_p;
+  if (!BLI_ghash_ensure_p(container->chunks, POINTER_FROM_INT(frame), &chunk_p)) {
+    PTCacheChunk *chunk = MEM_callocN(sizeof(PTCacheChunk), __func__);
+    chunk->offset = -1;
+    *chunk_p = chunk;
+  }
+  return *chunk_p;
+}
+
+static void container_unmap(PTCacheContainer *container)
+{
+  BLI_mutex_lock(&containers_mmap_mutex);
+  if (container->map) {
+    munmap(container->map, container->map_len);
+    container->map = NULL;
+    container->map_len = 0;
+  }
+  BLI_mutex_unlock(&containers_mmap_mutex);
+  if (container->map_fd != -1) {
+    close(container->map_fd);
+    container->map_fd = -1;
+  }
+}
+
+/* Make sure the file is mapped up to end. */
+static bool container_map(PTCacheContainer *container, int64_t end)
+{
+  if (container->map && end <= (int64_t)container->map_len) {
+    return true;
+  }
+  container_unmap(container);
+
+  container->map_fd = BLI_open(container->filepath, O_BINARY | O_RDONLY, 0);
+  if (container->map_fd == -1) {
+    return false;
+  }
+  const size_t len = BLI_file_descriptor_size(container->map_fd);
+  if (len == (size_t)-1 || (int64_t)len < end) {
+    container_unmap(container);
+    return false;
+  }
+
+  BLI_mutex_lock(&containers_mmap_mutex);
+  void *map = mmap(NULL, len, PROT_READ, MAP_SHARED, container->map_fd, 0);
+  BLI_mutex_unlock(&containers_mmap_mutex);
+  if (map == MAP_FAILED) {
+    CLOG_ERROR(&LOG, "Couldn't map point cache file %s", container->filepath);
+    container_unmap(container);
+    return false;
+  }
+  container->map = map;
+  container->map_len = len;
+  return true;
+}
+
+static void container_close_files(PTCacheContainer *container)
+{
+  if (container->fp) {
+    fclose(container->fp);
+    container->fp = NULL;
+  }
+  container_unmap(container);
+}
+
+/* Remove the chunks of a range of frames from the index, returns the number of frames. */
+static int container_index_remove(PTCacheContainer *container, int frame_first, int frame_last)
+{
+  GHashIterator gh_iter;
+  int *frames = MEM_mallocN(sizeof(int) * BLI_ghash_len(container->chunks), __func__);
+  int frames_num = 0;
+
+  GHASH_ITER (gh_iter, container->chunks) {
+    const int frame = POINTER_AS_INT(BLI_ghashIterator_getKey(&gh_iter));
+    if (frame >= frame_first && frame <= frame_last) {
+      frames[frames_num++] = frame;
+    }
+  }
+  for (int i = 0; i < frames_num; i++) {
+    PTCacheChunk *chunk = BLI_ghash_lookup(container->chunks, POINTER_FROM_INT(frames[i]));
+    if (chunk->offset != -1) {
+      container->unused_len += chunk_size(&chunk->header);
+    }
+    BLI_ghash_remove(container->chunks, POINTER_FROM_INT(frames[i]), NULL, container_chunk_free);
+  }
+
+  MEM_freeN(frames);
+  return frames_num;
+}
+
+/* Add a chunk that is in the file at offset to the index. */
+static void container_index_add(PTCacheContainer *container,
+                                const PTCacheChunkHeader *header,
+                                int64_t offset)
+{
+  if (header->type == PTCACHE_CHUNK_REMOVE) {
+    container_index_remove(container, header->frame, header->frame_last);
+    container->unused_len += chunk_size(header);
+    return;
+  }
+
+  PTCacheChunk *chunk = container_chunk_ensure(container, header->frame);
+  if (chunk->offset != -1) {
+    if (chunk->header.seq > header->seq) {
+      /* Written after a newer chunk of the same frame. */
+      container->unused_len += chunk_size(header);
+      return;
+    }
+    container->unused_len += chunk_size(&chunk->header);
+  }
+  chunk->header = *header;
+  chunk->offset = offset;
+}
+
+/* Build the index from the chunk headers in the file. */
+static void container_index_load(PTCacheContainer *container)
+{
+  PTCacheContainerHeader header;
+  PTCacheChunkHeader chunk_header;
+
+  BLI_ghash_clear(container->chunks, NULL, container_chunk_free);
+  container->seq = 0;
+  container->file_len = 0;
+  container->unused_len = 0;
+
+  const size_t disk_len = BLI_file_size(container->filepath);
+  container->disk_len = (disk_len == (size_t)-1) ? 0 : (int64_t)disk_len;
+
+  FILE *fp = BLI_fopen(container->filepath, "rb");
+  if (fp == NULL) {
+    return;
+  }
+
+  /* Files that aren't containers are overwritten by the first write. */
+  if (fread(&header, sizeof(header), 1, fp) != 1 ||
+      !STREQLEN(header.code, PTCACHE_CONTAINER_CODE, sizeof(header.code)) ||
+      header.version != PTCACHE_CONTAINER_VERSION) {
+    fclose(fp);
+    return;
+  }
+
+  int64_t offset = sizeof(header);
+  while (fread(&chunk_header, sizeof(chunk_header), 1, fp) == 1) {
+    const int64_t end = offset + chunk_size(&chunk_header);
+    if (end > container->disk_len) {
+      /* Incomplete chunk of an interrupted write, it is overwritten by the next write. */
+      break;
+    }
+    container_index_add(container, &chunk_header, offset);
+    container->seq = MAX2(container->seq, chunk_header.seq + 1);
+    offset = end;
+    BLI_fseek(fp, offset, SEEK_SET);
+  }
+  container->file_len = offset;
+
+  fclose(fp);
+}
+
+/* Append a chunk to the file, returns its offset or -1 on failure. */
+static int64_t container_append(PTCacheContainer *container,
+                                const PTCacheChunkHeader *header,
+                                const void *data)
+{
+  if (container->fp == NULL) {
+    if (container->file_len == 0) {
+      PTCacheContainerHeader file_header = {PTCACHE_CONTAINER_CODE, PTCACHE_CONTAINER_VERSION};
+
+      BLI_make_existing_file(container->filepath);
+      container->fp = BLI_fopen(container->filepath, "wb+");
+      if (container->fp == NULL ||
+          fwrite(&file_header, sizeof(file_header), 1, container->fp) != 1) {
+        container_close_files(container);
+        return -1;
+      }
+      container->file_len = sizeof(file_header);
+    }
+    else {
+      container->fp = BLI_fopen(container->filepath, "rb+");
+      if (container->fp == NULL) {
+        return -1;
+      }
+    }
+  }
+
+  const int64_t offset = container->file_len;
+  if (BLI_fseek(container->fp, offset, SEEK_SET) != 0 ||
+      fwrite(header, sizeof(*header), 1, container->fp) != 1 ||
+      (header->data_len && fwrite(data, header->data_len, 1, container->fp) != 1) ||
+      fflush(container->fp) != 0) {
+    return -1;
+  }
+
+  container->file_len += chunk_size(header);
+  container->disk_len = MAX2(container->disk_len, container->file_len);
+  return offset;
+}
+
+static int container_frame_cmp(const void *a, const void *b)
+{
+  const int frame_a = *(const int *)a, frame_b = *(const int *)b;
+  return (frame_a > frame_b) - (frame_a < frame_b);
+}
+
+static int *container_frames_sorted(PTCacheContainer *container, int *r_frames_num)
+{
+  GHashIterator gh_iter;
+  int *frames = MEM_mallocN(sizeof(int) * MAX2(BLI_ghash_len(container->chunks), 1), __func__);
+  int frames_num = 0;
+
+  GHASH_ITER (gh_iter, container->chunks) {
+    frames[frames_num++] = POINTER_AS_INT(BLI_ghashIterator_getKey(&gh_iter));
+  }
+  qsort(frames, frames_num, sizeof(int), container_frame_cmp);
+
+  *r_frames_num = frames_num;
+  return frames;
+}
+
+/* Append a chunk that removes a range of frames, returns false on failure. */
+static bool container_append_remove(PTCacheContainer *container, int frame_first, int frame_last)
+{
+  PTCacheChunkHeader header = {PTCACHE_CHUNK_REMOVE};
+  header.frame = frame_first;
+  header.frame_last = frame_last;
+  header.seq = container->seq++;
+
+  if (container_append(container, &header, NULL) == -1) {
+    return false;
+  }
+  container->unused_len += chunk_size(&header);
+  return true;
+}
+
+/* Rewrite the file with only the chunks in the index, returns false on failure. */
+static bool container_compact(PTCacheContainer *container)
+{
+  PTCacheContainerHeader file_header = {PTCACHE_CONTAINER_CODE, PTCACHE_CONTAINER_VERSION};
+  char filepath_tmp[FILE_MAX + 1];
+  int frames_num;
+  bool ok = true;
+
+  if (!container_map(container, container->file_len)) {
+    return false;
+  }
+
+  BLI_snprintf(filepath_tmp, sizeof(filepath_tmp), "%s@", container->filepath);
+  FILE *fp = BLI_fopen(filepath_tmp, "wb");
+  if (fp == NULL) {
+    return false;
+  }
+
+  int *frames = container_frames_sorted(container, &frames_num);
+  int64_t *offsets = MEM_mallocN(sizeof(int64_t) * MAX2(frames_num, 1), __func__);
+  int64_t offset = sizeof(file_header);
+
+  ok = fwrite(&file_header, sizeof(file_header), 1, fp) == 1;
+  for (int i = 0; ok && i < frames_num; i++) {
+    PTCacheChunk *chunk = BLI_ghash_lookup(container->chunks, POINTER_FROM_INT(frames[i]));
+    offsets[i] = -1;
+    if (chunk->offset != -1) {
+      const int64_t size = chunk_size(&chunk->header);
+      ok = fwrite((const char *)container->map + chunk->offset, size, 1, fp) == 1;
+      offsets[i] = offset;
+      offset += size;
+    }
+  }
+  ok = (fclose(fp) == 0) && ok;
+
+  container_close_files(container);
+
+  ok = ok && BLI_rename(filepath_tmp, container->filepath) == 0;
+  if (ok) {
+    for (int i = 0; i < frames_num; i++) {
+      PTCacheChunk *chunk = BLI_ghash_lookup(container->chunks, POINTER_FROM_INT(frames[i]));
+      chunk->offset = offsets[i];
+    }
+    container->file_len = offset;
+    container->disk_len = offset;
+    container->unused_len = 0;
+  }
+  else {
+    CLOG_ERROR(&LOG, "Couldn't rewrite point cache file %s", container->filepath);
+    BLI_delete(filepath_tmp, false, false);
+  }
+
+  MEM_freeN(frames);
+  MEM_freeN(offsets);
+  return ok;
+}
+
+/* Returns the compressed data, or NULL when it is not smaller. */
+static unsigned char *container_compress(
+    int compression, const void *data, size_t len, size_t *r_len, unsigned char props[8])
+{
+  unsigned char *out = NULL;
+
+  (void)data;
+  (void)len;
+  (void)r_len;
+  (void)props;
+
+#ifdef WITH_LZO
+  if (compression == PTCACHE_COMPRESS_LZO) {
+    void *wrkmem = MEM_mallocN(LZO1X_MEM_COMPRESS, __func__);
+    lzo_uint out_len = LZO_OUT_LEN(len);
+
+    out = MEM_mallocN(out_len, "pointcache_lzo_buffer");
+    if (lzo1x_1_compress(data, (lzo_uint)len, out, &out_len, wrkmem) != LZO_E_OK ||
+        out_len >= len) {
+      MEM_SAFE_FREE(out);
+    }
+    *r_len = out_len;
+    MEM_freeN(wrkmem);
+  }
+#endif
+#ifdef WITH_LZMA
+  if (compression == PTCACHE_COMPRESS_LZMA) {
+    size_t out_len = LZO_OUT_LEN(len);
+    size_t props_len = 5;
+
+    out = MEM_mallocN(out_len, "pointcache_lzma_buffer");
+    /* Single threaded, frames are already compressed in parallel. */
+    if (LzmaCompress(out, &out_len, data, len, props, &props_len, 5, 1 << 24, 3, 0, 2, 32, 1) !=
+            SZ_OK ||
+        out_len >= len) {
+      MEM_SAFE_FREE(out);
+    }
+    *r_len = out_len;
+  }
+#endif
+
+  return out;
+}
+
+static bool container_decompress(const PTCacheChunkHeader *header,
+                                 const unsigned char *in,
+                                 unsigned char *out)
+{
+  switch (header->compression) {
+    case PTCACHE_COMPRESS_NO:
+      memcpy(out, in, header->raw_len);
+      return true;
+#ifdef WITH_LZO
+    case PTCACHE_COMPRESS_LZO: {
+      lzo_uint out_len = header->raw_len;
+      return lzo1x_decompress_safe(in, header->data_len, out, &out_len, NULL) == LZO_E_OK &&
+             out_len == header->raw_len;
+    }
+#endif
+#ifdef WITH_LZMA
+    case PTCACHE_COMPRESS_LZMA: {
+      size_t out_len = header->raw_len, in_len = header->data_len;
+      return LzmaUncompress(out, &out_len, in, &in_len, header->props, 5) == SZ_OK &&
+             out_len == header->raw_len;
+    }
+#endif
+  }
+  return false;
+}
+
+static void container_write_task(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  PTCacheContainerWrite *write = taskdata;
+  PTCacheContainer *container = write->container;
+  PTCacheChunkHeader header = {PTCACHE_CHUNK_FRAME};
+  size_t out_len;
+
+  unsigned char *out = container_compress(
+      write->compression, write->data, write->len, &out_len, header.props);
+
+  header.frame = header.frame_last = write->frame;
+  header.seq = write->seq;
+  header.compression = out ? write->compression : PTCACHE_COMPRESS_NO;
+  header.raw_len = write->len;
+  header.data_len = out ? out_len : write->len;
+
+  BLI_mutex_lock(&container->mutex);
+
+  PTCacheChunk *chunk = BLI_ghash_lookup(container->chunks, POINTER_FROM_INT(write->frame));
+  const int64_t offset = container_append(container, &header, out ? out : write->data);
+
+  if (chunk && chunk->pending == write->data) {
+    chunk->pending_queued = false;
+  }
+  if (offset != -1) {
+    container_index_add(container, &header, offset);
+    if (chunk && chunk->pending == write->data) {
+      chunk->pending = NULL;
+    }
+  }
+  else {
+    CLOG_ERROR(&LOG, "Couldn't write frame %d to %s", write->frame, container->filepath);
+  }
+  /* Failed writes stay in memory, so the frame can still be read. */
+  if (chunk == NULL || chunk->pending != write->data) {
+    MEM_freeN(write->data);
+  }
+  container->pending_len -= write->len;
+
+  BLI_mutex_unlock(&container->mutex);
+
+  MEM_SAFE_FREE(out);
+}
+
+static PTCacheContainer *container_new(const char *filepath)
+{
+  PTCacheContainer *container = MEM_callocN(sizeof(PTCacheContainer), __func__);
+
+  BLI_strncpy(container->filepath, filepath, sizeof(container->filepath));
+  BLI_mutex_init(&container->mutex);
+  container->chunks = BLI_ghash_int_new(__func__);
+  container->map_fd = -1;
+  container->pool = BLI_task_pool_create_background(container, TASK_PRIORITY_LOW);
+
+  container_index_load(container);
+
+  return container;
+}
+
+static void container_free(PTCacheContainer *container)
+{
+  BLI_task_pool_work_and_wait(container->pool);
+  BLI_task_pool_free(container->pool);
+
+  container_close_files(container);
+  BLI_ghash_free(container->chunks, NULL, container_chunk_free);
+  BLI_mutex_end(&container->mutex);
+  MEM_freeN(container);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Public API
+ * \{ */
+
+PTCacheContainer *ptcache_container_get(const char *filepath)
+{
+  BLI_mutex_lock(&containers_mutex);
+
+  if (containers == NULL) {
+    containers = BLI_ghash_str_new(__func__);
+  }
+
+  PTCacheContainer *container = BLI_ghash_lookup(containers, filepath);
+  if (container == NULL) {
+    container = container_new(filepath);
+    BLI_ghash_insert(containers, container->filepath, container);
+  }
+
+  BLI_mutex_unlock(&containers_mutex);
+
+  /* Reload when the file was changed by something else, unless writes are in progress. */
+  BLI_mutex_lock(&container->mutex);
+  if (container->pending_len == 0) {
+    const size_t disk_len = BLI_file_size(filepath);
+    if (((disk_len == (size_t)-1) ? 0 : (int64_t)disk_len) != container->disk_len) {
+      container_close_files(container);
+      container_index_load(container);
+    }
+  }
+  BLI_mutex_unlock(&container->mutex);
+
+  return container;
+}
+
+bool ptcache_container_has_frame(PTCacheContainer *container, int frame)
+{
+  BLI_mutex_lock(&container->mutex);
+  const bool exists = BLI_ghash_haskey(container->chunks, POINTER_FROM_INT(frame));
+  BLI_mutex_unlock(&container->mutex);
+  return exists;
+}
+
+int *ptcache_container_frames(PTCacheContainer *container, int *r_frames_num)
+{
+  BLI_mutex_lock(&container->mutex);
+  int *frames = container_frames_sorted(container, r_frames_num);
+  BLI_mutex_unlock(&container->mutex);
+  return frames;
+}
+
+void *ptcache_container_read(PTCacheContainer *container, int frame, size_t *r_len)
+{
+  void *data = NULL;
+
+  BLI_mutex_lock(&container->mutex);
+
+  PTCacheChunk *chunk = BLI_ghash_lookup(container->chunks, POINTER_FROM_INT(frame));
+  if (chunk == NULL) {
+    /* pass */
+  }
+  else if (chunk->pending) {
+    data = MEM_mallocN(MAX2(chunk->pending_len, 1), "pointcache frame");
+    memcpy(data, chunk->pending, chunk->pending_len);
+    *r_len = chunk->pending_len;
+  }
+  else if (chunk->offset != -1) {
+    const PTCacheChunkHeader *header = &chunk->header;
+    const int64_t data_offset = chunk->offset + sizeof(*header);
+
+    if (container_map(container, data_offset + header->data_len)) {
+      data = MEM_mallocN(MAX2(header->raw_len, 1), "pointcache frame");
+      const unsigned char *in = (const unsigned char *)container->map + data_offset;
+      if (container_decompress(header, in, data)) {
+        *r_len = header->raw_len;
+      }
+      else {
+        CLOG_ERROR(&LOG, "Couldn't read frame %d from %s", frame, container->filepath);
+        MEM_SAFE_FREE(data);
+      }
+    }
+  }
+
+  BLI_mutex_unlock(&container->mutex);
+
+  return data;
+}
+
+void ptcache_container_write(
+    PTCacheContainer *container, int frame, void *data, size_t len, int compression)
+{
+  PTCacheContainerWrite *write = MEM_mallocN(sizeof(PTCacheContainerWrite), __func__);
+
+  BLI_mutex_lock(&container->mutex);
+
+  /* Data that is replaced here is freed by its own write task, unless that task already ran
+   * and failed to write it. */
+  PTCacheChunk *chunk = container_chunk_ensure(container, frame);
+  if (chunk->pending && !chunk->pending_queued) {
+    MEM_freeN(chunk->pending);
+  }
+  chunk->pending = data;
+  chunk->pending_len = len;
+  chunk->pending_queued = true;
+
+  write->container = container;
+  write->frame = frame;
+  write->seq = container->seq++;
+  write->compression = compression;
+  write->data = data;
+  write->len = len;
+
+  container->pending_len += len;
+  const bool wait = container->pending_len > PTCACHE_CONTAINER_PENDING_MAX;
+
+  BLI_mutex_unlock(&container->mutex);
+
+  BLI_task_pool_push(container->pool, container_write_task, write, true, NULL);
+
+  if (wait) {
+    BLI_task_pool_work_and_wait(container->pool);
+  }
+}
+
+void ptcache_container_remove(PTCacheContainer *container, int frame_first, int frame_last)
+{
+  BLI_task_pool_work_and_wait(container->pool);
+
+  BLI_mutex_lock(&container->mutex);
+
+  if (container_index_remove(container, frame_first, frame_last)) {
+    const int64_t used_len = container->file_len - container->unused_len;
+
+    const bool compact = container->unused_len > PTCACHE_CONTAINER_COMPACT_MIN &&
+                         container->unused_len > used_len;
+
+    /* The frames are already removed from the index, when the file couldn't be rewritten
+     * without them, record the removal in the file so they don't come back when it's loaded. */
+    if (!(compact && container_compact(container)) &&
+        !container_append_remove(container, frame_first, frame_last)) {
+      CLOG_ERROR(&LOG, "Couldn't remove frames from %s", container->filepath);
+    }
+  }
+
+  BLI_mutex_unlock(&container->mutex);
+}
+
+void ptcache_container_flush(PTCacheContainer *container)
+{
+  BLI_task_pool_work_and_wait(container->pool);
+}
+
+void ptcache_container_delete(const char *filepath)
+{
+  PTCacheContainer *container = ptcache_container_get(filepath);
+
+  BLI_task_pool_work_and_wait(container->pool);
+
+  BLI_mutex_lock(&container->mutex);
+  container_close_files(container);
+  if (BLI_exists(filepath)) {
+    BLI_delete(filepath, false, false);
+  }
+  container_index_load(container);
+  BLI_mutex_unlock(&container->mutex);
+}
+
+void ptcache_container_rename(const char *filepath_src, const char *filepath_dst)
+{
+  if (BLI_path_cmp(filepath_src, filepath_dst) == 0) {
+    return;
+  }
+
+  PTCacheContainer *container_src = ptcache_container_get(filepath_src);
+  PTCacheContainer *container_dst = ptcache_container_get(filepath_dst);
+
+  BLI_task_pool_work_and_wait(container_src->pool);
+  BLI_task_pool_work_and_wait(container_dst->pool);
+
+  /* Lock in a fixed order, so renames in opposite directions can't deadlock. */
+  PTCacheContainer *container_first = MIN2(container_src, container_dst);
+  PTCacheContainer *container_second = MAX2(container_src, container_dst);
+  BLI_mutex_lock(&container_first->mutex);
+  BLI_mutex_lock(&container_second->mutex);
+
+  container_close_files(container_src);
+  container_close_files(container_dst);
+  BLI_rename(filepath_src, filepath_dst);
+  container_index_load(container_src);
+  container_index_load(container_dst);
+
+  BLI_mutex_unlock(&container_second->mutex);
+  BLI_mutex_unlock(&container_first->mutex);
+}
+
+void ptcache_containers_free_all(void)
+{
+  BLI_mutex_lock(&containers_mutex);
+
+  if (containers) {
+    BLI_ghash_free(containers, NULL, (GHashValFreeFP)container_free);
+    containers = NULL;
+  }
+
+  BLI_mutex_unlock(&containers_mutex);
+}
+
+void BKE_ptcache_containers_exit(void)
+{
+  ptcache_containers_free_all();
+}
+
+/** \} */
@@ -0,0 +1,73 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bke
+ *
+ * Single file container for disk point caches.
+ *
+ * All frames of a cache are appended to one file as chunks, each with its own header. Chunks
+ * are compressed on background threads, frames that are still being written are read from
+ * memory. The frame index is built by scanning the chunk headers when a container is first
+ * used, and kept in memory afterwards. Reads map the file into memory.
+ *
+ * Removing frames appends a removal chunk, or rewrites the file when most of it is unused.
+ */
+
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct PTCacheContainer PTCacheContainer;
+
+/**
+ * Get the container for a file, which is created on the first write. Containers are shared by
+ * file path and stay open until #ptcache_containers_free_all.
+ */
+PTCacheContainer *ptcache_container_get(const char *filepath);
+
+bool ptcache_container_has_frame(PTCacheContainer *container, int frame);
+/** Sorted array of the stored frames, free with #MEM_freeN. */
+int *ptcache_container_frames(PTCacheContainer *container, int *r_frames_num);
+
+/** Uncompressed data of a frame or NULL, free with #MEM_freeN. */
+void *ptcache_container_read(PTCacheContainer *container, int frame, size_t *r_len);
+/**
+ * Store a frame, replacing previous data of the same frame. Takes ownership of \a data, which
+ * is compressed with \a compression (a `PTCACHE_COMPRESS_` value) and written in the background.
+ */
+void ptcache_container_write(
+    PTCacheContainer *container, int frame, void *data, size_t len, int compression);
+/** Remove all frames from \a frame_first to \a frame_last. */
+void ptcache_container_remove(PTCacheContainer *container, int frame_first, int frame_last);
+/** Wait until all frames are written. */
+void ptcache_container_flush(PTCacheContainer *container);
+
+/** Delete the file of a container, including frames that are still being written. */
+void ptcache_container_delete(const char *filepath);
+/** Move a container to another file. */
+void ptcache_container_rename(const char *filepath_src, const char *filepath_dst);
+
+/** Finish writing and close all containers. */
+void ptcache_containers_free_all(void);
+
+#ifdef __cplusplus
+}
+#endif
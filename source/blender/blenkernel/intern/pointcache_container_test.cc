@@ -0,0 +1,244 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include <climits>
+#include <cstring>
+#include <string>
+
+#include "CLG_log.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_pointcache_types.h"
+
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+#include "BLI_rand.hh"
+#include "BLI_threads.h"
+
+#include "BKE_appdir.h"
+
+#include "pointcache_container.h"
+
+namespace blender::bke::tests {
+
+class PointCacheContainerTest : public testing::Test {
+ protected:
+  char filepath[FILE_MAX];
+
+  /* Failed writes are logged. */
+  static void SetUpTestCase()
+  {
+    testing::Test::SetUpTestCase();
+    CLG_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    CLG_exit();
+    testing::Test::TearDownTestCase();
+  }
+
+  void SetUp() override
+  {
+    BLI_threadapi_init();
+    BKE_tempdir_init(nullptr);
+    BLI_join_dirfile(
+        filepath, sizeof(filepath), BKE_tempdir_session(), "pointcache_container_test.bphyc");
+  }
+
+  void TearDown() override
+  {
+    ptcache_containers_free_all();
+    BKE_tempdir_session_purge();
+    BLI_threadapi_exit();
+  }
+
+  /* Frame data that depends on the frame and a version, half of it compressible. */
+  static void *frame_data(int frame, int version, size_t len)
+  {
+    RandomNumberGenerator rng(frame * 31 + version);
+    uint32_t *data = (uint32_t *)MEM_callocN(len, __func__);
+    for (size_t i = 0; i < len / sizeof(uint32_t) / 2; i++) {
+      data[i] = rng.get_uint32();
+    }
+    return data;
+  }
+
+  static void expect_frame(PTCacheContainer *container, int frame, int version, size_t len)
+  {
+    size_t read_len = 0;
+    void *read = ptcache_container_read(container, frame, &read_len);
+    void *expected = frame_data(frame, version, len);
+
+    ASSERT_NE(read, nullptr);
+    EXPECT_EQ(read_len, len);
+    EXPECT_EQ(memcmp(read, expected, len), 0);
+
+    MEM_freeN(read);
+    MEM_freeN(expected);
+  }
+};
+
+TEST_F(PointCacheContainerTest, WriteRead)
+{
+  const size_t len = 64 * 1024;
+
+  for (int compression : {PTCACHE_COMPRESS_NO, PTCACHE_COMPRESS_LZO, PTCACHE_COMPRESS_LZMA}) {
+    ptcache_container_delete(filepath);
+    PTCacheContainer *container = ptcache_container_get(filepath);
+
+    for (int frame = 1; frame <= 10; frame++) {
+      ptcache_container_write(container, frame, frame_data(frame, 0, len), len, compression);
+    }
+    /* Frames that are still being written are read from memory. */
+    expect_frame(container, 5, 0, len);
+
+    ptcache_container_flush(container);
+    for (int frame = 1; frame <= 10; frame++) {
+      expect_frame(container, frame, 0, len);
+    }
+    EXPECT_FALSE(ptcache_container_has_frame(container, 11));
+
+    int frames_num;
+    int *frames = ptcache_container_frames(container, &frames_num);
+    EXPECT_EQ(frames_num, 10);
+    EXPECT_EQ(frames[0], 1);
+    EXPECT_EQ(frames[9], 10);
+    MEM_freeN(frames);
+  }
+}
+
+TEST_F(PointCacheContainerTest, Reopen)
+{
+  const size_t len = 4096;
+  PTCacheContainer *container = ptcache_container_get(filepath);
+
+  for (int frame = 1; frame <= 10; frame++) {
+    ptcache_container_write(container, frame, frame_data(frame, 0, len), len, 0);
+  }
+  ptcache_container_write(container, 3, frame_data(3, 1, len), len, 0);
+  ptcache_container_remove(container, 8, INT_MAX);
+
+  ptcache_containers_free_all();
+  container = ptcache_container_get(filepath);
+
+  expect_frame(container, 1, 0, len);
+  expect_frame(container, 3, 1, len);
+  expect_frame(container, 7, 0, len);
+  EXPECT_FALSE(ptcache_container_has_frame(container, 8));
+  EXPECT_FALSE(ptcache_container_has_frame(container, 10));
+}
+
+TEST_F(PointCacheContainerTest, Compact)
+{
+  const size_t len = 1024 * 1024;
+  PTCacheContainer *container = ptcache_container_get(filepath);
+
+  for (int frame = 1; frame <= 8; frame++) {
+    ptcache_container_write(container, frame, frame_data(frame, 0, len), len, 0);
+  }
+  ptcache_container_flush(container);
+  EXPECT_GT(BLI_file_size(filepath), 8 * len);
+
+  /* Most of the file is unused after this, so it is rewritten. */
+  ptcache_container_remove(container, INT_MIN, 6);
+  EXPECT_LT(BLI_file_size(filepath), 3 * len);
+
+  expect_frame(container, 7, 0, len);
+  expect_frame(container, 8, 0, len);
+  EXPECT_FALSE(ptcache_container_has_frame(container, 6));
+
+  ptcache_container_rename(filepath, (std::string(filepath) + ".moved").c_str());
+  EXPECT_FALSE(ptcache_container_has_frame(container, 7));
+}
+
+TEST_F(PointCacheContainerTest, CompactFailed)
+{
+  const size_t len = 1024 * 1024;
+  PTCacheContainer *container = ptcache_container_get(filepath);
+
+  for (int frame = 1; frame <= 8; frame++) {
+    ptcache_container_write(container, frame, frame_data(frame, 0, len), len, 0);
+  }
+  ptcache_container_flush(container);
+
+  /* A directory in place of the temporary file, so the file can't be rewritten. The removal
+   * must still be stored in the file. */
+  const std::string filepath_tmp = std::string(filepath) + "@";
+  ASSERT_TRUE(BLI_dir_create_recursive(filepath_tmp.c_str()));
+  ptcache_container_remove(container, INT_MIN, 6);
+  EXPECT_GT(BLI_file_size(filepath), 8 * len);
+  BLI_delete(filepath_tmp.c_str(), true, false);
+
+  ptcache_containers_free_all();
+  container = ptcache_container_get(filepath);
+
+  EXPECT_FALSE(ptcache_container_has_frame(container, 1));
+  EXPECT_FALSE(ptcache_container_has_frame(container, 6));
+  expect_frame(container, 7, 0, len);
+  expect_frame(container, 8, 0, len);
+}
+
+TEST_F(PointCacheContainerTest, Rename)
+{
+  const size_t len = 4096;
+  const std::string filepath_other = std::string(filepath) + ".other";
+  PTCacheContainer *container = ptcache_container_get(filepath);
+
+  ptcache_container_write(container, 1, frame_data(1, 0, len), len, 0);
+  ptcache_container_flush(container);
+
+  /* Renaming to the same path keeps the frames. */
+  ptcache_container_rename(filepath, filepath);
+  expect_frame(container, 1, 0, len);
+
+  /* Renaming back and forth locks the containers in both orders. */
+  ptcache_container_rename(filepath, filepath_other.c_str());
+  EXPECT_FALSE(ptcache_container_has_frame(container, 1));
+  PTCacheContainer *container_other = ptcache_container_get(filepath_other.c_str());
+  expect_frame(container_other, 1, 0, len);
+
+  ptcache_container_rename(filepath_other.c_str(), filepath);
+  EXPECT_FALSE(ptcache_container_has_frame(container_other, 1));
+  expect_frame(container, 1, 0, len);
+}
+
+TEST_F(PointCacheContainerTest, FailedWrite)
+{
+  const size_t len = 4096;
+  /* A file in place of the directory, so the container can't be created. */
+  char filepath_missing[FILE_MAX];
+  BLI_join_dirfile(filepath_missing, sizeof(filepath_missing), filepath, "container.bphyc");
+  ASSERT_TRUE(BLI_file_touch(filepath));
+
+  PTCacheContainer *container = ptcache_container_get(filepath_missing);
+
+  /* Frames that can't be written stay readable from memory, replacing them must free them. */
+  ptcache_container_write(container, 1, frame_data(1, 0, len), len, 0);
+  ptcache_container_flush(container);
+  expect_frame(container, 1, 0, len);
+
+  /* Counted after the first failure, since logging it allocates the log type. */
+  const unsigned int blocks_num = MEM_get_memory_blocks_in_use();
+  ptcache_container_write(container, 1, frame_data(1, 1, len), len, 0);
+  ptcache_container_flush(container);
+  expect_frame(container, 1, 1, len);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_num);
+}
+
+}  // namespace blender::bke::tests
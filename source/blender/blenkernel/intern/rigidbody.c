@@ -1149,7 +1149,8 @@ void BKE_rigidbody_validate_sim_world(Scene *scene, RigidBodyWorld *rbw, bool re
     if (rbw->shared->physics_world) {
       RB_dworld_delete(rbw->shared->physics_world);
     }
-    rbw->shared->physics_world = RB_dworld_new(scene->physics_settings.gravity);
+    rbw->shared->physics_world = RB_dworld_new(scene->physics_settings.gravity,
+                                               rbw->flag & RBW_FLAG_USE_MULTITHREADING);
   }
 
   RB_dworld_set_solver_iterations(rbw->shared->physics_world, rbw->num_solver_iterations);
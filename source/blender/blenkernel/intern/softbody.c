@@ -55,10 +55,12 @@
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
 
+#include "BLI_buffer.h"
 #include "BLI_ghash.h"
+#include "BLI_kdopbvh.h"
 #include "BLI_listbase.h"
 #include "BLI_math.h"
-#include "BLI_threads.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_collection.h"
@@ -128,16 +130,21 @@ typedef struct SB_thread_context {
   Object *ob;
   float forcetime;
   float timenow;
-  int ifirst;
-  int ilast;
   ListBase *effectors;
   int do_deflector;
+  int do_selfcollision;
+  int do_springcollision;
+  int do_aero;
   float fieldfactor;
   float windfactor;
-  int nr;
-  int tot;
+  /* Broadphase for self collision, its leaves are the collision balls of the body points. */
+  BVHTree *bpoint_tree;
 } SB_thread_context;
 
+typedef struct SB_thread_chunk {
+  bool do_fuzzy;
+} SB_thread_chunk;
+
 #define MID_PRESERVE 1
 
 #define SOFTGOALSNAP 0.999f
@@ -275,11 +282,99 @@ typedef struct ccd_Mesh {
   const MVertTri *tri;
   int safety;
   ccdf_minmax *mima;
+  /* Broadphase for the faces, its leaves are the #ccdf_minmax boxes. */
+  BVHTree *bvhtree;
   /* Axis Aligned Bounding Box AABB */
   float bbmin[3];
   float bbmax[3];
 } ccd_Mesh;
 
+static void ccd_mesh_update_bvhtree(ccd_Mesh *pccd_M)
+{
+  const bool rebuild = (pccd_M->bvhtree == NULL);
+  const ccdf_minmax *mima = pccd_M->mima;
+
+  if (rebuild) {
+    pccd_M->bvhtree = BLI_bvhtree_new(pccd_M->tri_num, 0.0f, 4, 6);
+  }
+  for (int i = 0; i < pccd_M->tri_num; i++, mima++) {
+    const float co[2][3] = {{mima->minx, mima->miny, mima->minz},
+                            {mima->maxx, mima->maxy, mima->maxz}};
+    if (rebuild) {
+      BLI_bvhtree_insert(pccd_M->bvhtree, i, co[0], 2);
+    }
+    else {
+      BLI_bvhtree_update_node(pccd_M->bvhtree, i, co[0], NULL, 2);
+    }
+  }
+  if (rebuild) {
+    BLI_bvhtree_balance(pccd_M->bvhtree);
+  }
+  else {
+    BLI_bvhtree_update_tree(pccd_M->bvhtree);
+  }
+}
+
+typedef struct BoxQueryData {
+  float min[3], max[3];
+  BLI_Buffer *indices;
+} BoxQueryData;
+
+static bool box_query_overlap(const BVHTreeAxisRange *bounds, const BoxQueryData *data)
+{
+  for (int axis = 0; axis < 3; axis++) {
+    if ((data->max[axis] < bounds[axis].min) || (data->min[axis] > bounds[axis].max)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool box_query_parent_cb(const BVHTreeAxisRange *bounds, void *userdata)
+{
+  return box_query_overlap(bounds, userdata);
+}
+
+static bool box_query_leaf_cb(const BVHTreeAxisRange *bounds, int index, void *userdata)
+{
+  BoxQueryData *data = userdata;
+  if (box_query_overlap(bounds, data)) {
+    BLI_buffer_append(data->indices, int, index);
+  }
+  return true;
+}
+
+static bool box_query_order_cb(const BVHTreeAxisRange *UNUSED(bounds),
+                               char UNUSED(axis),
+                               void *UNUSED(userdata))
+{
+  return true;
+}
+
+static int box_query_index_cmp(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+/**
+ * Find the leaves of \a tree whose boxes overlap the box from \a min to \a max. The indices
+ * are sorted, so callers visit them in the same order as a loop over all elements would.
+ */
+static void box_query(
+    BVHTree *tree, const float min[3], const float max[3], BLI_Buffer *r_indices)
+{
+  BoxQueryData data;
+  copy_v3_v3(data.min, min);
+  copy_v3_v3(data.max, max);
+  data.indices = r_indices;
+
+  BLI_buffer_clear(r_indices);
+  BLI_bvhtree_walk_dfs(tree, box_query_parent_cb, box_query_leaf_cb, box_query_order_cb, &data);
+  if (r_indices->count > 1) {
+    qsort(r_indices->data, r_indices->count, sizeof(int), box_query_index_cmp);
+  }
+}
+
 static ccd_Mesh *ccd_mesh_make(Object *ob)
 {
   CollisionModifierData *cmd;
@@ -306,6 +401,7 @@ static ccd_Mesh *ccd_mesh_make(Object *ob)
   pccd_M->bbmin[0] = pccd_M->bbmin[1] = pccd_M->bbmin[2] = 1e30f;
   pccd_M->bbmax[0] = pccd_M->bbmax[1] = pccd_M->bbmax[2] = -1e30f;
   pccd_M->mprevvert = NULL;
+  pccd_M->bvhtree = NULL;
 
   /* blow it up with forcefield ranges */
   hull = max_ff(ob->pd->pdef_sbift, ob->pd->pdef_sboft);
@@ -365,6 +461,8 @@ static ccd_Mesh *ccd_mesh_make(Object *ob)
     mima->maxz = max_ff(mima->maxz, v[2] + hull);
   }
 
+  ccd_mesh_update_bvhtree(pccd_M);
+
   return pccd_M;
 }
 static void ccd_mesh_update(Object *ob, ccd_Mesh *pccd_M)
@@ -485,6 +583,8 @@ static void ccd_mesh_update(Object *ob, ccd_Mesh *pccd_M)
     mima->maxy = max_ff(mima->maxy, v[1] + hull);
     mima->maxz = max_ff(mima->maxz, v[2] + hull);
   }
+
+  ccd_mesh_update_bvhtree(pccd_M);
 }
 
 static void ccd_mesh_free(ccd_Mesh *ccdm)
@@ -497,6 +597,7 @@ static void ccd_mesh_free(ccd_Mesh *ccdm)
       MEM_freeN((void *)ccdm->mprevvert);
     }
     MEM_freeN(ccdm->mima);
+    BLI_bvhtree_free(ccdm->bvhtree);
     MEM_freeN(ccdm);
     ccdm = NULL;
   }
@@ -1162,7 +1263,7 @@ static int sb_detect_face_collisionCached(const float face_v1[3],
   GHashIterator *ihash;
   float nv1[3], nv2[3], nv3[3], edge1[3], edge2[3], d_nvect[3], aabbmin[3], aabbmax[3];
   float t, tune = 10.0f;
-  int a, deflected = 0;
+  int deflected = 0;
 
   aabbmin[0] = min_fff(face_v1[0], face_v2[0], face_v3[0]);
   aabbmin[1] = min_fff(face_v1[1], face_v2[1], face_v3[1]);
@@ -1171,6 +1272,7 @@ static int sb_detect_face_collisionCached(const float face_v1[3],
   aabbmax[1] = max_fff(face_v1[1], face_v2[1], face_v3[1]);
   aabbmax[2] = max_fff(face_v1[2], face_v2[2], face_v3[2]);
 
+  BLI_buffer_declare_static(int, tri_indices, BLI_BUFFER_NOP, 64);
   hash = vertexowner->soft->scratch->colliderhash;
   ihash = BLI_ghashIterator_new(hash);
   while (!BLI_ghashIterator_done(ihash)) {
@@ -1187,10 +1289,7 @@ static int sb_detect_face_collisionCached(const float face_v1[3],
 
         if (ccdm) {
           mvert = ccdm->mvert;
-          vt = ccdm->tri;
           mprevvert = ccdm->mprevvert;
-          mima = ccdm->mima;
-          a = ccdm->tri_num;
 
           if ((aabbmax[0] < ccdm->bbmin[0]) || (aabbmax[1] < ccdm->bbmin[1]) ||
               (aabbmax[2] < ccdm->bbmin[2]) || (aabbmin[0] > ccdm->bbmax[0]) ||
@@ -1208,12 +1307,15 @@ static int sb_detect_face_collisionCached(const float face_v1[3],
         }
 
         /* use mesh*/
-        while (a--) {
+        box_query(ccdm->bvhtree, aabbmin, aabbmax, &tri_indices);
+        for (int i = 0; i < (int)tri_indices.count; i++) {
+          const int tri_index = ((const int *)tri_indices.data)[i];
+          vt = &ccdm->tri[tri_index];
+          mima = &ccdm->mima[tri_index];
+
           if ((aabbmax[0] < mima->minx) || (aabbmin[0] > mima->maxx) ||
               (aabbmax[1] < mima->miny) || (aabbmin[1] > mima->maxy) ||
               (aabbmax[2] < mima->minz) || (aabbmin[2] > mima->maxz)) {
-            mima++;
-            vt++;
             continue;
           }
 
@@ -1247,14 +1349,13 @@ static int sb_detect_face_collisionCached(const float face_v1[3],
             *damp = tune * ob->pd->pdef_sbdamp;
             deflected = 2;
           }
-          mima++;
-          vt++;
-        } /* while a */
+        } /* for tri_indices */
       }   /* if (ob->pd && ob->pd->deflect) */
       BLI_ghashIterator_step(ihash);
     }
   } /* while () */
   BLI_ghashIterator_free(ihash);
+  BLI_buffer_free(&tri_indices);
   return deflected;
 }
 
@@ -1340,13 +1441,14 @@ static int sb_detect_edge_collisionCached(const float edge_v1[3],
   GHashIterator *ihash;
   float nv1[3], nv2[3], nv3[3], edge1[3], edge2[3], d_nvect[3], aabbmin[3], aabbmax[3];
   float t, el;
-  int a, deflected = 0;
+  int deflected = 0;
 
   minmax_v3v3_v3(aabbmin, aabbmax, edge_v1);
   minmax_v3v3_v3(aabbmin, aabbmax, edge_v2);
 
   el = len_v3v3(edge_v1, edge_v2);
 
+  BLI_buffer_declare_static(int, tri_indices, BLI_BUFFER_NOP, 64);
   hash = vertexowner->soft->scratch->colliderhash;
   ihash = BLI_ghashIterator_new(hash);
   while (!BLI_ghashIterator_done(ihash)) {
@@ -1364,9 +1466,6 @@ static int sb_detect_edge_collisionCached(const float edge_v1[3],
         if (ccdm) {
           mvert = ccdm->mvert;
           mprevvert = ccdm->mprevvert;
-          vt = ccdm->tri;
-          mima = ccdm->mima;
-          a = ccdm->tri_num;
 
           if ((aabbmax[0] < ccdm->bbmin[0]) || (aabbmax[1] < ccdm->bbmin[1]) ||
               (aabbmax[2] < ccdm->bbmin[2]) || (aabbmin[0] > ccdm->bbmax[0]) ||
@@ -1384,12 +1483,15 @@ static int sb_detect_edge_collisionCached(const float edge_v1[3],
         }
 
         /* use mesh*/
-        while (a--) {
+        box_query(ccdm->bvhtree, aabbmin, aabbmax, &tri_indices);
+        for (int i = 0; i < (int)tri_indices.count; i++) {
+          const int tri_index = ((const int *)tri_indices.data)[i];
+          vt = &ccdm->tri[tri_index];
+          mima = &ccdm->mima[tri_index];
+
           if ((aabbmax[0] < mima->minx) || (aabbmin[0] > mima->maxx) ||
               (aabbmax[1] < mima->miny) || (aabbmin[1] > mima->maxy) ||
               (aabbmax[2] < mima->minz) || (aabbmin[2] > mima->maxz)) {
-            mima++;
-            vt++;
             continue;
           }
 
@@ -1429,15 +1531,13 @@ static int sb_detect_edge_collisionCached(const float edge_v1[3],
             *damp = ob->pd->pdef_sbdamp;
             deflected = 2;
           }
-
-          mima++;
-          vt++;
-        } /* while a */
+        } /* for tri_indices */
       }   /* if (ob->pd && ob->pd->deflect) */
       BLI_ghashIterator_step(ihash);
     }
   } /* while () */
   BLI_ghashIterator_free(ihash);
+  BLI_buffer_free(&tri_indices);
   return deflected;
 }
 
@@ -1515,12 +1615,12 @@ static void _scan_for_ext_spring_forces(
   }
 }
 
-static void *exec_scan_for_ext_spring_forces(void *data)
+static void scan_for_ext_spring_forces_cb(void *__restrict userdata,
+                                          const int a,
+                                          const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  SB_thread_context *pctx = (SB_thread_context *)data;
-  _scan_for_ext_spring_forces(
-      pctx->scene, pctx->ob, pctx->timenow, pctx->ifirst, pctx->ilast, pctx->effectors);
-  return NULL;
+  SB_thread_context *pctx = (SB_thread_context *)userdata;
+  _scan_for_ext_spring_forces(pctx->scene, pctx->ob, pctx->timenow, a, a + 1, pctx->effectors);
 }
 
 static void sb_sfesf_threads_run(struct Depsgraph *depsgraph,
@@ -1530,61 +1630,21 @@ static void sb_sfesf_threads_run(struct Depsgraph *depsgraph,
                                  int totsprings,
                                  int *UNUSED(ptr_to_break_func(void)))
 {
-  ListBase threads;
-  SB_thread_context *sb_threads;
-  int i, totthread, left, dec;
-
-  /* wild guess .. may increase with better thread management 'above'
-   * or even be UI option sb->spawn_cf_threads_nopts */
-  int lowsprings = 100;
-
   ListBase *effectors = BKE_effectors_create(depsgraph, ob, NULL, ob->soft->effector_weights);
 
-  /* figure the number of threads while preventing pretty pointless threading overhead */
-  totthread = BKE_scene_num_threads(scene);
-  /* what if we got zillions of CPUs running but less to spread*/
-  while ((totsprings / totthread < lowsprings) && (totthread > 1)) {
-    totthread--;
-  }
-
-  sb_threads = MEM_callocN(sizeof(SB_thread_context) * totthread, "SBSpringsThread");
-  memset(sb_threads, 0, sizeof(SB_thread_context) * totthread);
-  left = totsprings;
-  dec = totsprings / totthread + 1;
-  for (i = 0; i < totthread; i++) {
-    sb_threads[i].scene = scene;
-    sb_threads[i].ob = ob;
-    sb_threads[i].forcetime = 0.0; /* not used here */
-    sb_threads[i].timenow = timenow;
-    sb_threads[i].ilast = left;
-    left = left - dec;
-    if (left > 0) {
-      sb_threads[i].ifirst = left;
-    }
-    else {
-      sb_threads[i].ifirst = 0;
-    }
-    sb_threads[i].effectors = effectors;
-    sb_threads[i].do_deflector = false; /* not used here */
-    sb_threads[i].fieldfactor = 0.0f;   /* not used here */
-    sb_threads[i].windfactor = 0.0f;    /* not used here */
-    sb_threads[i].nr = i;
-    sb_threads[i].tot = totthread;
-  }
-  if (totthread > 1) {
-    BLI_threadpool_init(&threads, exec_scan_for_ext_spring_forces, totthread);
+  SB_thread_context sb_thread = {
+      .scene = scene,
+      .ob = ob,
+      .timenow = timenow,
+      .effectors = effectors,
+  };
 
-    for (i = 0; i < totthread; i++) {
-      BLI_threadpool_insert(&threads, &sb_threads[i]);
-    }
-
-    BLI_threadpool_end(&threads);
-  }
-  else {
-    exec_scan_for_ext_spring_forces(&sb_threads[0]);
-  }
-  /* clean up */
-  MEM_freeN(sb_threads);
+  /* Springs near colliders are much more expensive than others,
+   * so leave balancing the load to the task scheduler. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(0, totsprings, &sb_thread, scan_for_ext_spring_forces_cb, &settings);
 
   BKE_effectors_free(effectors);
 }
@@ -1639,9 +1699,10 @@ static int sb_detect_vertex_collisionCached(float opco[3],
       mindistedge = 1000.0f, outerforceaccu[3], innerforceaccu[3], facedist,
       /* n_mag, */ /* UNUSED */ force_mag_norm, minx, miny, minz, maxx, maxy, maxz,
       innerfacethickness = -0.5f, outerfacethickness = 0.2f, ee = 5.0f, ff = 0.1f, fa = 1;
-  int a, deflected = 0, cavel = 0, ci = 0;
+  int deflected = 0, cavel = 0, ci = 0;
   /* init */
   *intrusion = 0.0f;
+  BLI_buffer_declare_static(int, tri_indices, BLI_BUFFER_NOP, 64);
   hash = vertexowner->soft->scratch->colliderhash;
   ihash = BLI_ghashIterator_new(hash);
   outerforceaccu[0] = outerforceaccu[1] = outerforceaccu[2] = 0.0f;
@@ -1662,9 +1723,6 @@ static int sb_detect_vertex_collisionCached(float opco[3],
         if (ccdm) {
           mvert = ccdm->mvert;
           mprevvert = ccdm->mprevvert;
-          vt = ccdm->tri;
-          mima = ccdm->mima;
-          a = ccdm->tri_num;
 
           minx = ccdm->bbmin[0];
           miny = ccdm->bbmin[1];
@@ -1697,11 +1755,14 @@ static int sb_detect_vertex_collisionCached(float opco[3],
         fa = 1.0f / fa;
         avel[0] = avel[1] = avel[2] = 0.0f;
         /* use mesh*/
-        while (a--) {
+        box_query(ccdm->bvhtree, opco, opco, &tri_indices);
+        for (int i = 0; i < (int)tri_indices.count; i++) {
+          const int tri_index = ((const int *)tri_indices.data)[i];
+          vt = &ccdm->tri[tri_index];
+          mima = &ccdm->mima[tri_index];
+
           if ((opco[0] < mima->minx) || (opco[0] > mima->maxx) || (opco[1] < mima->miny) ||
               (opco[1] > mima->maxy) || (opco[2] < mima->minz) || (opco[2] > mima->maxz)) {
-            mima++;
-            vt++;
             continue;
           }
 
@@ -1771,10 +1832,7 @@ static int sb_detect_vertex_collisionCached(float opco[3],
               ci++;
             }
           }
-
-          mima++;
-          vt++;
-        } /* while a */
+        } /* for tri_indices */
       }   /* if (ob->pd && ob->pd->deflect) */
       BLI_ghashIterator_step(ihash);
     }
@@ -1800,6 +1858,7 @@ static int sb_detect_vertex_collisionCached(float opco[3],
   }
 
   BLI_ghashIterator_free(ihash);
+  BLI_buffer_free(&tri_indices);
   if (cavel) {
     mul_v3_fl(avel, 1.0f / (float)cavel);
   }
@@ -1957,245 +2016,246 @@ static void sb_spring_force(
 }
 
 /* since this is definitely the most CPU consuming task here .. try to spread it */
-/* core function _softbody_calc_forces_slice_in_a_thread */
-/* result is int to be able to flag user break */
-static int _softbody_calc_forces_slice_in_a_thread(Scene *scene,
-                                                   Object *ob,
-                                                   float forcetime,
-                                                   float timenow,
-                                                   int ifirst,
-                                                   int ilast,
-                                                   int *UNUSED(ptr_to_break_func(void)),
-                                                   ListBase *effectors,
-                                                   int do_deflector,
-                                                   float fieldfactor,
-                                                   float windfactor)
+static void softbody_calc_forces_point_cb(void *__restrict userdata,
+                                          const int index,
+                                          const TaskParallelTLS *__restrict tls)
 {
-  float iks;
-  int bb, do_selfcollision, do_springcollision, do_aero;
-  int number_of_points_here = ilast - ifirst;
+  const SB_thread_context *pctx = (const SB_thread_context *)userdata;
+  SB_thread_chunk *chunk = (SB_thread_chunk *)tls->userdata_chunk;
+  Object *ob = pctx->ob;
   SoftBody *sb = ob->soft; /* is supposed to be there */
-  BodyPoint *bp;
+  BodyPoint *bp = &sb->bpoint[index];
+  float iks;
 
-  /* initialize */
-  if (sb) {
-    /* check conditions for various options */
-    /* +++ could be done on object level to squeeze out the last bits of it */
-    do_selfcollision = ((ob->softflag & OB_SB_EDGES) && (sb->bspring) &&
-                        (ob->softflag & OB_SB_SELF));
-    do_springcollision = do_deflector && (ob->softflag & OB_SB_EDGES) &&
-                         (ob->softflag & OB_SB_EDGECOLL);
-    do_aero = ((sb->aeroedge) && (ob->softflag & OB_SB_EDGES));
-    /* --- could be done on object level to squeeze out the last bits of it */
-  }
-  else {
-    CLOG_ERROR(&LOG, "expected a SB here");
-    return 999;
-  }
-
-  /* debugerin */
-  if (sb->totpoint < ifirst) {
-    printf("Aye 998");
-    return 998;
-  }
-  /* debugerin */
-
-  bp = &sb->bpoint[ifirst];
-  for (bb = number_of_points_here; bb > 0; bb--, bp++) {
-    /* clear forces  accumulator */
-    bp->force[0] = bp->force[1] = bp->force[2] = 0.0;
-    /* naive ball self collision */
-    /* needs to be done if goal snaps or not */
-    if (do_selfcollision) {
-      int attached;
-      BodyPoint *obp;
-      BodySpring *bs;
-      int c, b;
-      float velcenter[3], dvel[3], def[3];
-      float distance;
-      float compare;
-      float bstune = sb->ballstiff;
-
-      /* Running in a slice we must not assume anything done with obp
-       * neither alter the data of obp. */
-      for (c = sb->totpoint, obp = sb->bpoint; c > 0; c--, obp++) {
-        compare = (obp->colball + bp->colball);
-        sub_v3_v3v3(def, bp->pos, obp->pos);
-        /* rather check the AABBoxes before ever calculating the real distance */
-        /* mathematically it is completely nuts, but performance is pretty much (3) times faster */
-        if ((fabsf(def[0]) > compare) || (fabsf(def[1]) > compare) || (fabsf(def[2]) > compare)) {
-          continue;
-        }
-        distance = normalize_v3(def);
-        if (distance < compare) {
-          /* exclude body points attached with a spring */
-          attached = 0;
-          for (b = obp->nofsprings; b > 0; b--) {
-            bs = sb->bspring + obp->springs[b - 1];
-            if (ELEM(ilast - bb, bs->v2, bs->v1)) {
-              attached = 1;
-              continue;
-            }
+  /* clear forces  accumulator */
+  bp->force[0] = bp->force[1] = bp->force[2] = 0.0;
+  /* naive ball self collision */
+  /* needs to be done if goal snaps or not */
+  if (pctx->do_selfcollision) {
+    int attached;
+    BodyPoint *obp;
+    BodySpring *bs;
+    int b;
+    float velcenter[3], dvel[3], def[3];
+    float distance;
+    float compare;
+    float bstune = sb->ballstiff;
+
+    float min[3], max[3];
+    BLI_buffer_declare_static(int, bp_indices, BLI_BUFFER_NOP, 64);
+
+    /* Running in a task we must not assume anything done with obp
+     * neither alter the data of obp. The candidates are visited in index order,
+     * so the forces add up the same way as when testing all points. */
+    copy_v3_fl3(min, -bp->colball, -bp->colball, -bp->colball);
+    add_v3_v3(min, bp->pos);
+    copy_v3_fl3(max, bp->colball, bp->colball, bp->colball);
+    add_v3_v3(max, bp->pos);
+    box_query(pctx->bpoint_tree, min, max, &bp_indices);
+    for (int i = 0; i < (int)bp_indices.count; i++) {
+      obp = &sb->bpoint[((const int *)bp_indices.data)[i]];
+      compare = (obp->colball + bp->colball);
+      sub_v3_v3v3(def, bp->pos, obp->pos);
+      /* rather check the AABBoxes before ever calculating the real distance */
+      /* mathematically it is completely nuts, but performance is pretty much (3) times faster */
+      if ((fabsf(def[0]) > compare) || (fabsf(def[1]) > compare) || (fabsf(def[2]) > compare)) {
+        continue;
+      }
+      distance = normalize_v3(def);
+      if (distance < compare) {
+        /* exclude body points attached with a spring */
+        attached = 0;
+        for (b = obp->nofsprings; b > 0; b--) {
+          bs = sb->bspring + obp->springs[b - 1];
+          if (ELEM(index, bs->v2, bs->v1)) {
+            attached = 1;
+            continue;
           }
-          if (!attached) {
-            float f = bstune / (distance) + bstune / (compare * compare) * distance -
-                      2.0f * bstune / compare;
+        }
+        if (!attached) {
+          float f = bstune / (distance) + bstune / (compare * compare) * distance -
+                    2.0f * bstune / compare;
 
-            mid_v3_v3v3(velcenter, bp->vec, obp->vec);
-            sub_v3_v3v3(dvel, velcenter, bp->vec);
-            mul_v3_fl(dvel, _final_mass(ob, bp));
+          mid_v3_v3v3(velcenter, bp->vec, obp->vec);
+          sub_v3_v3v3(dvel, velcenter, bp->vec);
+          mul_v3_fl(dvel, _final_mass(ob, bp));
 
-            madd_v3_v3fl(bp->force, def, f * (1.0f - sb->balldamp));
-            madd_v3_v3fl(bp->force, dvel, sb->balldamp);
-          }
+          madd_v3_v3fl(bp->force, def, f * (1.0f - sb->balldamp));
+          madd_v3_v3fl(bp->force, dvel, sb->balldamp);
         }
       }
     }
-    /* naive ball self collision done */
-
-    if (_final_goal(ob, bp) < SOFTGOALSNAP) { /* omit this bp when it snaps */
-      float auxvect[3];
-      float velgoal[3];
-
-      /* do goal stuff */
-      if (ob->softflag & OB_SB_GOAL) {
-        /* true elastic goal */
-        float ks, kd;
-        sub_v3_v3v3(auxvect, bp->pos, bp->origT);
-        ks = 1.0f / (1.0f - _final_goal(ob, bp) * sb->goalspring) - 1.0f;
-        bp->force[0] += -ks * (auxvect[0]);
-        bp->force[1] += -ks * (auxvect[1]);
-        bp->force[2] += -ks * (auxvect[2]);
-
-        /* calculate damping forces generated by goals*/
-        sub_v3_v3v3(velgoal, bp->origS, bp->origE);
-        kd = sb->goalfrict * sb_fric_force_scale(ob);
-        add_v3_v3v3(auxvect, velgoal, bp->vec);
-
-        if (forcetime >
-            0.0f) { /* make sure friction does not become rocket motor on time reversal */
-          bp->force[0] -= kd * (auxvect[0]);
-          bp->force[1] -= kd * (auxvect[1]);
-          bp->force[2] -= kd * (auxvect[2]);
-        }
-        else {
-          bp->force[0] -= kd * (velgoal[0] - bp->vec[0]);
-          bp->force[1] -= kd * (velgoal[1] - bp->vec[1]);
-          bp->force[2] -= kd * (velgoal[2] - bp->vec[2]);
-        }
-      }
-      /* done goal stuff */
-
-      /* gravitation */
-      if (scene->physics_settings.flag & PHYS_GLOBAL_GRAVITY) {
-        float gravity[3];
-        copy_v3_v3(gravity, scene->physics_settings.gravity);
-
-        /* Individual mass of node here. */
-        mul_v3_fl(gravity,
-                  sb_grav_force_scale(ob) * _final_mass(ob, bp) *
-                      sb->effector_weights->global_gravity);
+    BLI_buffer_free(&bp_indices);
+  }
+  /* naive ball self collision done */
 
-        add_v3_v3(bp->force, gravity);
-      }
+  if (_final_goal(ob, bp) < SOFTGOALSNAP) { /* omit this bp when it snaps */
+    float auxvect[3];
+    float velgoal[3];
 
-      /* particle field & vortex */
-      if (effectors) {
-        EffectedPoint epoint;
-        float kd;
-        float force[3] = {0.0f, 0.0f, 0.0f};
-        float speed[3] = {0.0f, 0.0f, 0.0f};
-
-        /* just for calling function once */
-        float eval_sb_fric_force_scale = sb_fric_force_scale(ob);
-
-        pd_point_from_soft(scene, bp->pos, bp->vec, sb->bpoint - bp, &epoint);
-        BKE_effectors_apply(effectors, NULL, sb->effector_weights, &epoint, force, NULL, speed);
-
-        /* apply forcefield*/
-        mul_v3_fl(force, fieldfactor * eval_sb_fric_force_scale);
-        add_v3_v3(bp->force, force);
-
-        /* BP friction in moving media */
-        kd = sb->mediafrict * eval_sb_fric_force_scale;
-        bp->force[0] -= kd * (bp->vec[0] + windfactor * speed[0] / eval_sb_fric_force_scale);
-        bp->force[1] -= kd * (bp->vec[1] + windfactor * speed[1] / eval_sb_fric_force_scale);
-        bp->force[2] -= kd * (bp->vec[2] + windfactor * speed[2] / eval_sb_fric_force_scale);
-        /* now we'll have nice centrifugal effect for vortex */
+    /* do goal stuff */
+    if (ob->softflag & OB_SB_GOAL) {
+      /* true elastic goal */
+      float ks, kd;
+      sub_v3_v3v3(auxvect, bp->pos, bp->origT);
+      ks = 1.0f / (1.0f - _final_goal(ob, bp) * sb->goalspring) - 1.0f;
+      bp->force[0] += -ks * (auxvect[0]);
+      bp->force[1] += -ks * (auxvect[1]);
+      bp->force[2] += -ks * (auxvect[2]);
+
+      /* calculate damping forces generated by goals*/
+      sub_v3_v3v3(velgoal, bp->origS, bp->origE);
+      kd = sb->goalfrict * sb_fric_force_scale(ob);
+      add_v3_v3v3(auxvect, velgoal, bp->vec);
+
+      if (pctx->forcetime >
+          0.0f) { /* make sure friction does not become rocket motor on time reversal */
+        bp->force[0] -= kd * (auxvect[0]);
+        bp->force[1] -= kd * (auxvect[1]);
+        bp->force[2] -= kd * (auxvect[2]);
       }
       else {
-        /* BP friction in media (not) moving*/
-        float kd = sb->mediafrict * sb_fric_force_scale(ob);
-        /* assume it to be proportional to actual velocity */
-        bp->force[0] -= bp->vec[0] * kd;
-        bp->force[1] -= bp->vec[1] * kd;
-        bp->force[2] -= bp->vec[2] * kd;
-        /* friction in media done */
+        bp->force[0] -= kd * (velgoal[0] - bp->vec[0]);
+        bp->force[1] -= kd * (velgoal[1] - bp->vec[1]);
+        bp->force[2] -= kd * (velgoal[2] - bp->vec[2]);
       }
-      /* +++cached collision targets */
-      bp->choke = 0.0f;
-      bp->choke2 = 0.0f;
-      bp->loc_flag &= ~SBF_DOFUZZY;
-      if (do_deflector && !(bp->loc_flag & SBF_OUTOFCOLLISION)) {
-        float cfforce[3], defforce[3] = {0.0f, 0.0f, 0.0f}, vel[3] = {0.0f, 0.0f, 0.0f},
-                          facenormal[3], cf = 1.0f, intrusion;
-        float kd = 1.0f;
-
-        if (sb_deflect_face(ob, bp->pos, facenormal, defforce, &cf, timenow, vel, &intrusion)) {
-          if (intrusion < 0.0f) {
-            sb->scratch->flag |= SBF_DOFUZZY;
-            bp->loc_flag |= SBF_DOFUZZY;
-            bp->choke = sb->choke * 0.01f;
-          }
+    }
+    /* done goal stuff */
+
+    /* gravitation */
+    if (pctx->scene->physics_settings.flag & PHYS_GLOBAL_GRAVITY) {
+      float gravity[3];
+      copy_v3_v3(gravity, pctx->scene->physics_settings.gravity);
+
+      /* Individual mass of node here. */
+      mul_v3_fl(gravity,
+                sb_grav_force_scale(ob) * _final_mass(ob, bp) *
+                    sb->effector_weights->global_gravity);
+
+      add_v3_v3(bp->force, gravity);
+    }
+
+    /* particle field & vortex */
+    if (pctx->effectors) {
+      EffectedPoint epoint;
+      float kd;
+      float force[3] = {0.0f, 0.0f, 0.0f};
+      float speed[3] = {0.0f, 0.0f, 0.0f};
+
+      /* just for calling function once */
+      float eval_sb_fric_force_scale = sb_fric_force_scale(ob);
+
+      pd_point_from_soft(pctx->scene, bp->pos, bp->vec, sb->bpoint - bp, &epoint);
+      BKE_effectors_apply(
+          pctx->effectors, NULL, sb->effector_weights, &epoint, force, NULL, speed);
 
-          sub_v3_v3v3(cfforce, bp->vec, vel);
-          madd_v3_v3fl(bp->force, cfforce, -cf * 50.0f);
+      /* apply forcefield*/
+      mul_v3_fl(force, pctx->fieldfactor * eval_sb_fric_force_scale);
+      add_v3_v3(bp->force, force);
 
-          madd_v3_v3fl(bp->force, defforce, kd);
+      /* BP friction in moving media */
+      kd = sb->mediafrict * eval_sb_fric_force_scale;
+      bp->force[0] -= kd * (bp->vec[0] + pctx->windfactor * speed[0] / eval_sb_fric_force_scale);
+      bp->force[1] -= kd * (bp->vec[1] + pctx->windfactor * speed[1] / eval_sb_fric_force_scale);
+      bp->force[2] -= kd * (bp->vec[2] + pctx->windfactor * speed[2] / eval_sb_fric_force_scale);
+      /* now we'll have nice centrifugal effect for vortex */
+    }
+    else {
+      /* BP friction in media (not) moving*/
+      float kd = sb->mediafrict * sb_fric_force_scale(ob);
+      /* assume it to be proportional to actual velocity */
+      bp->force[0] -= bp->vec[0] * kd;
+      bp->force[1] -= bp->vec[1] * kd;
+      bp->force[2] -= bp->vec[2] * kd;
+      /* friction in media done */
+    }
+    /* +++cached collision targets */
+    bp->choke = 0.0f;
+    bp->choke2 = 0.0f;
+    bp->loc_flag &= ~SBF_DOFUZZY;
+    if (pctx->do_deflector && !(bp->loc_flag & SBF_OUTOFCOLLISION)) {
+      float cfforce[3], defforce[3] = {0.0f, 0.0f, 0.0f}, vel[3] = {0.0f, 0.0f, 0.0f},
+                        facenormal[3], cf = 1.0f, intrusion;
+      float kd = 1.0f;
+
+      if (sb_deflect_face(
+              ob, bp->pos, facenormal, defforce, &cf, pctx->timenow, vel, &intrusion)) {
+        if (intrusion < 0.0f) {
+          chunk->do_fuzzy = true;
+          bp->loc_flag |= SBF_DOFUZZY;
+          bp->choke = sb->choke * 0.01f;
         }
+
+        sub_v3_v3v3(cfforce, bp->vec, vel);
+        madd_v3_v3fl(bp->force, cfforce, -cf * 50.0f);
+
+        madd_v3_v3fl(bp->force, defforce, kd);
       }
-      /* ---cached collision targets */
-
-      /* +++springs */
-      iks = 1.0f / (1.0f - sb->inspring) - 1.0f; /* inner spring constants function */
-      if (ob->softflag & OB_SB_EDGES) {
-        if (sb->bspring) { /* spring list exists at all ? */
-          int b;
-          BodySpring *bs;
-          for (b = bp->nofsprings; b > 0; b--) {
-            bs = sb->bspring + bp->springs[b - 1];
-            if (do_springcollision || do_aero) {
-              add_v3_v3(bp->force, bs->ext_force);
-              if (bs->flag & BSF_INTERSECT) {
-                bp->choke = bs->cf;
-              }
+    }
+    /* ---cached collision targets */
+
+    /* +++springs */
+    iks = 1.0f / (1.0f - sb->inspring) - 1.0f; /* inner spring constants function */
+    if (ob->softflag & OB_SB_EDGES) {
+      if (sb->bspring) { /* spring list exists at all ? */
+        int b;
+        BodySpring *bs;
+        for (b = bp->nofsprings; b > 0; b--) {
+          bs = sb->bspring + bp->springs[b - 1];
+          if (pctx->do_springcollision || pctx->do_aero) {
+            add_v3_v3(bp->force, bs->ext_force);
+            if (bs->flag & BSF_INTERSECT) {
+              bp->choke = bs->cf;
             }
-            // sb_spring_force(Object *ob, int bpi, BodySpring *bs, float iks, float forcetime)
-            sb_spring_force(ob, ilast - bb, bs, iks, forcetime);
-          } /* loop springs */
-        }   /* existing spring list */
-      }     /*any edges*/
-      /* ---springs */
-    }       /*omit on snap */
-  }         /*loop all bp's*/
-  return 0; /*done fine*/
-}
-
-static void *exec_softbody_calc_forces(void *data)
-{
-  SB_thread_context *pctx = (SB_thread_context *)data;
-  _softbody_calc_forces_slice_in_a_thread(pctx->scene,
-                                          pctx->ob,
-                                          pctx->forcetime,
-                                          pctx->timenow,
-                                          pctx->ifirst,
-                                          pctx->ilast,
-                                          NULL,
-                                          pctx->effectors,
-                                          pctx->do_deflector,
-                                          pctx->fieldfactor,
-                                          pctx->windfactor);
-  return NULL;
+          }
+          // sb_spring_force(Object *ob, int bpi, BodySpring *bs, float iks, float forcetime)
+          sb_spring_force(ob, index, bs, iks, pctx->forcetime);
+        } /* loop springs */
+      }   /* existing spring list */
+    }     /*any edges*/
+    /* ---springs */
+  }       /*omit on snap */
+}
+
+static void softbody_calc_forces_reduce(const void *__restrict UNUSED(userdata),
+                                        void *__restrict chunk_join,
+                                        void *__restrict chunk)
+{
+  SB_thread_chunk *join = (SB_thread_chunk *)chunk_join;
+  const SB_thread_chunk *data = (const SB_thread_chunk *)chunk;
+  join->do_fuzzy |= data->do_fuzzy;
+}
+
+/* Tree of the self collision balls, NULL when there are no points. */
+static BVHTree *sb_bpoint_bvhtree_new(SoftBody *sb)
+{
+  BodyPoint *bp;
+  float range = 0.0f;
+  int a;
+
+  if (sb->totpoint == 0) {
+    return NULL;
+  }
+
+  /* Pad the boxes by a few float steps of the largest coordinate, the exact tests are done
+   * on the candidates so the broadphase only has to be conservative. */
+  for (a = 0, bp = sb->bpoint; a < sb->totpoint; a++, bp++) {
+    range = max_ff(range, fabsf(bp->pos[0]) + bp->colball);
+    range = max_ff(range, fabsf(bp->pos[1]) + bp->colball);
+    range = max_ff(range, fabsf(bp->pos[2]) + bp->colball);
+  }
+
+  BVHTree *tree = BLI_bvhtree_new(sb->totpoint, range * FLT_EPSILON * 8.0f, 4, 6);
+  for (a = 0, bp = sb->bpoint; a < sb->totpoint; a++, bp++) {
+    float co[2][3];
+    copy_v3_fl3(co[0], -bp->colball, -bp->colball, -bp->colball);
+    add_v3_v3(co[0], bp->pos);
+    copy_v3_fl3(co[1], bp->colball, bp->colball, bp->colball);
+    add_v3_v3(co[1], bp->pos);
+    BLI_bvhtree_insert(tree, a, co[0], 2);
+  }
+  BLI_bvhtree_balance(tree);
+  return tree;
 }
 
 static void sb_cf_threads_run(Scene *scene,
@@ -2209,62 +2269,44 @@ static void sb_cf_threads_run(Scene *scene,
                               float fieldfactor,
                               float windfactor)
 {
-  ListBase threads;
-  SB_thread_context *sb_threads;
-  int i, totthread, left, dec;
-
-  /* wild guess .. may increase with better thread management 'above'
-   * or even be UI option sb->spawn_cf_threads_nopts. */
-  int lowpoints = 100;
-
-  /* figure the number of threads while preventing pretty pointless threading overhead */
-  totthread = BKE_scene_num_threads(scene);
-  /* what if we got zillions of CPUs running but less to spread*/
-  while ((totpoint / totthread < lowpoints) && (totthread > 1)) {
-    totthread--;
-  }
-
-  /* printf("sb_cf_threads_run spawning %d threads\n", totthread); */
-
-  sb_threads = MEM_callocN(sizeof(SB_thread_context) * totthread, "SBThread");
-  memset(sb_threads, 0, sizeof(SB_thread_context) * totthread);
-  left = totpoint;
-  dec = totpoint / totthread + 1;
-  for (i = 0; i < totthread; i++) {
-    sb_threads[i].scene = scene;
-    sb_threads[i].ob = ob;
-    sb_threads[i].forcetime = forcetime;
-    sb_threads[i].timenow = timenow;
-    sb_threads[i].ilast = left;
-    left = left - dec;
-    if (left > 0) {
-      sb_threads[i].ifirst = left;
-    }
-    else {
-      sb_threads[i].ifirst = 0;
-    }
-    sb_threads[i].effectors = effectors;
-    sb_threads[i].do_deflector = do_deflector;
-    sb_threads[i].fieldfactor = fieldfactor;
-    sb_threads[i].windfactor = windfactor;
-    sb_threads[i].nr = i;
-    sb_threads[i].tot = totthread;
-  }
-
-  if (totthread > 1) {
-    BLI_threadpool_init(&threads, exec_softbody_calc_forces, totthread);
-
-    for (i = 0; i < totthread; i++) {
-      BLI_threadpool_insert(&threads, &sb_threads[i]);
-    }
+  SoftBody *sb = ob->soft;
 
-    BLI_threadpool_end(&threads);
-  }
-  else {
-    exec_softbody_calc_forces(&sb_threads[0]);
-  }
-  /* clean up */
-  MEM_freeN(sb_threads);
+  SB_thread_context sb_thread = {
+      .scene = scene,
+      .ob = ob,
+      .forcetime = forcetime,
+      .timenow = timenow,
+      .effectors = effectors,
+      .do_deflector = do_deflector,
+      /* check conditions for various options */
+      .do_selfcollision = ((ob->softflag & OB_SB_EDGES) && (sb->bspring) &&
+                           (ob->softflag & OB_SB_SELF)),
+      .do_springcollision = do_deflector && (ob->softflag & OB_SB_EDGES) &&
+                            (ob->softflag & OB_SB_EDGECOLL),
+      .do_aero = ((sb->aeroedge) && (ob->softflag & OB_SB_EDGES)),
+      .fieldfactor = fieldfactor,
+      .windfactor = windfactor,
+  };
+
+  if (sb_thread.do_selfcollision) {
+    sb_thread.bpoint_tree = sb_bpoint_bvhtree_new(sb);
+  }
+
+  SB_thread_chunk chunk = {false};
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 16;
+  settings.userdata_chunk = &chunk;
+  settings.userdata_chunk_size = sizeof(chunk);
+  settings.func_reduce = softbody_calc_forces_reduce;
+  BLI_task_parallel_range(0, totpoint, &sb_thread, softbody_calc_forces_point_cb, &settings);
+
+  if (chunk.do_fuzzy) {
+    sb->scratch->flag |= SBF_DOFUZZY;
+  }
+
+  BLI_bvhtree_free(sb_thread.bpoint_tree);
 }
 
 static void softbody_calc_forces(
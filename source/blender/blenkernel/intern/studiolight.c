@@ -340,129 +340,69 @@ static void cube_face_uv_to_direction(float r_dir[3], float x, float y, int face
   normalize_v3(r_dir);
 }
 
-typedef struct MultilayerConvertContext {
-  int num_diffuse_channels;
-  float *diffuse_pass;
-  int num_specular_channels;
-  float *specular_pass;
-} MultilayerConvertContext;
-
-static void *studiolight_multilayer_addview(void *UNUSED(base), const char *UNUSED(view_name))
+/* Read a multilayer pass into a new ImBuf, converting it to 4 channels when needed. */
+static ImBuf *studiolight_multilayer_pass_ibuf(
+    void *exrhandle, const char *pass_name, const int width, const int height)
 {
-  return NULL;
-}
-static void *studiolight_multilayer_addlayer(void *base, const char *UNUSED(layer_name))
-{
-  return base;
-}
+  int channels;
+  float *rect = IMB_exr_read_pass(exrhandle, NULL, pass_name, NULL, 0, height - 1, &channels);
+  if (rect == NULL) {
+    return NULL;
+  }
 
-/* Convert a multilayer pass to ImBuf channel 4 float buffer.
- * NOTE: Parameter rect will become invalid. Do not use rect after calling this
- * function */
-static float *studiolight_multilayer_convert_pass(ImBuf *ibuf,
-                                                  float *rect,
-                                                  const unsigned int channels)
-{
   if (channels == 4) {
-    return rect;
+    return IMB_allocFromBuffer(NULL, rect, width, height, 4);
   }
 
-  float *new_rect = MEM_callocN(sizeof(float[4]) * ibuf->x * ibuf->y, __func__);
-
+  float *new_rect = MEM_callocN(sizeof(float[4]) * width * height, __func__);
   IMB_buffer_float_from_float(new_rect,
                               rect,
                               channels,
                               IB_PROFILE_LINEAR_RGB,
                               IB_PROFILE_LINEAR_RGB,
                               false,
-                              ibuf->x,
-                              ibuf->y,
-                              ibuf->x,
-                              ibuf->x);
-
-  MEM_freeN(rect);
-  return new_rect;
-}
-
-static void studiolight_multilayer_addpass(void *base,
-                                           void *UNUSED(lay),
-                                           const char *pass_name,
-                                           float *rect,
-                                           int num_channels,
-                                           const char *UNUSED(chan_id),
-                                           const char *UNUSED(view_name))
-{
-  MultilayerConvertContext *ctx = base;
-  /* NOTE: This function must free pass pixels data if it is not used, this
-   * is how IMB_exr_multilayer_convert() is working. */
-  /* If we've found a first combined pass, skip all the rest ones. */
-  if (STREQ(pass_name, STUDIOLIGHT_PASSNAME_DIFFUSE)) {
-    ctx->diffuse_pass = rect;
-    ctx->num_diffuse_channels = num_channels;
-  }
-  else if (STREQ(pass_name, STUDIOLIGHT_PASSNAME_SPECULAR)) {
-    ctx->specular_pass = rect;
-    ctx->num_specular_channels = num_channels;
-  }
-  else {
-    MEM_freeN(rect);
-  }
+                              width,
+                              height,
+                              width,
+                              width);
+  ImBuf *ibuf = IMB_allocFromBuffer(NULL, new_rect, width, height, 4);
+  MEM_freeN(new_rect);
+  return ibuf;
 }
 
 static void studiolight_load_equirect_image(StudioLight *sl)
 {
   if (sl->flag & STUDIOLIGHT_EXTERNAL_FILE) {
-    ImBuf *ibuf = IMB_loadiffname(sl->path, IB_multilayer, NULL);
     ImBuf *specular_ibuf = NULL;
     ImBuf *diffuse_ibuf = NULL;
-    const bool failed = (ibuf == NULL);
+    bool failed = false;
+
+    void *exrhandle = IMB_exr_get_handle();
+    int width, height;
+    if (IMB_exr_begin_read_multilayer(exrhandle, sl->path, &width, &height)) {
+      /* the read file is a multilayered openexr file.
+       * This file is currently only supported for MATCAPS where
+       * the first found 'diffuse' pass will be used for diffuse lighting
+       * and the first found 'specular' pass will be used for specular lighting.
+       * Only these two passes are read from the file. */
+      diffuse_ibuf = studiolight_multilayer_pass_ibuf(
+          exrhandle, STUDIOLIGHT_PASSNAME_DIFFUSE, width, height);
+      specular_ibuf = studiolight_multilayer_pass_ibuf(
+          exrhandle, STUDIOLIGHT_PASSNAME_SPECULAR, width, height);
+      IMB_exr_close(exrhandle);
+    }
+    else {
+      IMB_exr_close(exrhandle);
 
-    if (ibuf) {
-      if (ibuf->ftype == IMB_FTYPE_OPENEXR && ibuf->userdata) {
-        /* the read file is a multilayered openexr file (userdata != NULL)
-         * This file is currently only supported for MATCAPS where
-         * the first found 'diffuse' pass will be used for diffuse lighting
-         * and the first found 'specular' pass will be used for specular lighting */
-        MultilayerConvertContext ctx = {0};
-        IMB_exr_multilayer_convert(ibuf->userdata,
-                                   &ctx,
-                                   &studiolight_multilayer_addview,
-                                   &studiolight_multilayer_addlayer,
-                                   &studiolight_multilayer_addpass);
-
-        /* `ctx.diffuse_pass` and `ctx.specular_pass` can be freed inside
-         * `studiolight_multilayer_convert_pass` when conversion happens.
-         * When not converted we move the ownership of the buffer to the
-         * `converted_pass`. We only need to free `converted_pass` as it holds
-         * the unmodified allocation from the `ctx.*_pass` or the converted data.
-         */
-        if (ctx.diffuse_pass != NULL) {
-          float *converted_pass = studiolight_multilayer_convert_pass(
-              ibuf, ctx.diffuse_pass, ctx.num_diffuse_channels);
-          diffuse_ibuf = IMB_allocFromBuffer(
-              NULL, converted_pass, ibuf->x, ibuf->y, ctx.num_diffuse_channels);
-          MEM_freeN(converted_pass);
-        }
-
-        if (ctx.specular_pass != NULL) {
-          float *converted_pass = studiolight_multilayer_convert_pass(
-              ibuf, ctx.specular_pass, ctx.num_specular_channels);
-          specular_ibuf = IMB_allocFromBuffer(
-              NULL, converted_pass, ibuf->x, ibuf->y, ctx.num_specular_channels);
-          MEM_freeN(converted_pass);
-        }
-
-        IMB_exr_close(ibuf->userdata);
-        ibuf->userdata = NULL;
-        IMB_freeImBuf(ibuf);
-        ibuf = NULL;
-      }
-      else {
-        /* read file is an single layer openexr file or the read file isn't
-         * an openexr file */
+      /* read file is an single layer openexr file or the read file isn't
+       * an openexr file */
+      ImBuf *ibuf = IMB_loadiffname(sl->path, 0, NULL);
+      if (ibuf) {
         IMB_float_from_rect(ibuf);
         diffuse_ibuf = ibuf;
-        ibuf = NULL;
+      }
+      else {
+        failed = true;
       }
     }
 
@@ -0,0 +1,281 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * A `blender::ConcurrentMap<Key, Value>` is a hash map that can be accessed from multiple threads
+ * at the same time. It can be used instead of a `blender::Map` that is protected by a single
+ * mutex, or instead of building separate maps per thread and merging them afterwards.
+ *
+ * The map is split into a fixed number of shards. Every shard is a `blender::Map` with its own
+ * lock, so threads only block each other when they access keys that belong to the same shard.
+ * The hash function, equality operator, probing strategy and slot type are passed through to the
+ * shards and can be customized in the same way as for `blender::Map`.
+ *
+ * Some noteworthy information:
+ * - There is no method that returns a reference or pointer to a value, because it could be
+ *   invalidated by another thread at any time. Values are returned by copy instead. To modify a
+ *   value in place, use `add_or_modify`, whose callbacks are called while the shard is locked.
+ * - Callbacks passed to the map must not access the same map again, because that can dead-lock.
+ * - `size` and `foreach_item` lock one shard at a time. When other threads modify the map at the
+ *   same time, the result does not necessarily correspond to a single state of the map.
+ */
+
+#include <mutex>
+
+#include "BLI_array.hh"
+#include "BLI_map.hh"
+
+namespace blender {
+
+template<
+    /**
+     * Type of the keys stored in the map. Keys have to be movable. Furthermore, the hash and
+     * is-equal functions have to support it.
+     */
+    typename Key,
+    /**
+     * Type of the value that is stored per key. It has to be movable and copyable.
+     */
+    typename Value,
+    /**
+     * The strategy used to deal with collisions within a shard. They are defined in
+     * BLI_probing_strategies.hh.
+     */
+    typename ProbingStrategy = DefaultProbingStrategy,
+    /**
+     * The hash function used to hash the keys. It is used to find the shard and the slot within
+     * the shard. See BLI_hash.hh for details.
+     */
+    typename Hash = DefaultHash<Key>,
+    /**
+     * The equality operator used to compare keys.
+     */
+    typename IsEqual = DefaultEquality,
+    /**
+     * This is what will actually be stored in the hash table arrays of the shards. See
+     * BLI_map_slots.hh for details.
+     */
+    typename Slot = typename DefaultMapSlot<Key, Value>::type,
+    /**
+     * The allocator used by this map.
+     */
+    typename Allocator = GuardedAllocator>
+class ConcurrentMap {
+ public:
+  using ShardMapType = Map<Key, Value, 0, ProbingStrategy, Hash, IsEqual, Slot, Allocator>;
+  using MapType = Map<Key,
+                      Value,
+                      default_inline_buffer_capacity(sizeof(Key) + sizeof(Value)),
+                      ProbingStrategy,
+                      Hash,
+                      IsEqual,
+                      Slot,
+                      Allocator>;
+
+ private:
+  /**
+   * The number of shards is a power of two. 64 shards are enough to make contention unlikely
+   * with common thread counts, while keeping the memory overhead for small maps low.
+   */
+  static constexpr int shard_bits_ = 6;
+  static constexpr int64_t shards_num_ = 1 << shard_bits_;
+
+  /* Every shard is on its own cache line, so that locking one does not slow down access to
+   * its neighbors. */
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    ShardMapType map;
+  };
+
+  /* Locking a shard changes its mutex, so the shards are mutable to allow locking in const
+   * methods. */
+  mutable Array<Shard, 0, Allocator> shards_;
+  Hash hash_;
+
+ public:
+  ConcurrentMap() : shards_(shards_num_)
+  {
+  }
+
+  ConcurrentMap(const ConcurrentMap &other) = delete;
+  ConcurrentMap &operator=(const ConcurrentMap &other) = delete;
+
+  /**
+   * Add a key-value-pair to the map. If the map contains the key already, nothing is changed.
+   * Returns true when the key has been newly added.
+   */
+  bool add(const Key &key, const Value &value)
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.add(key, value);
+  }
+  bool add(Key &&key, Value &&value)
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.add(std::move(key), std::move(value));
+  }
+
+  /**
+   * Add a key-value-pair to the map. If the map contains the key already, the corresponding
+   * value will be replaced. Returns true when the key has been newly added.
+   */
+  bool add_overwrite(const Key &key, const Value &value)
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.add_overwrite(key, value);
+  }
+
+  /**
+   * Returns true if there is a key in the map that compares equal to the given key.
+   */
+  bool contains(const Key &key) const
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.contains(key);
+  }
+
+  /**
+   * Deletes the key-value-pair with the given key. Returns true when the key was contained and
+   * is now removed, otherwise false.
+   */
+  bool remove(const Key &key)
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.remove(key);
+  }
+
+  /**
+   * Returns a copy of the value that corresponds to the given key. If the key is not in the map,
+   * the provided default value is returned.
+   */
+  Value lookup_default(const Key &key, const Value &default_value) const
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const Value *value = shard.map.lookup_ptr(key);
+    return (value == nullptr) ? default_value : *value;
+  }
+
+  /**
+   * Returns a copy of the value that corresponds to the given key. If the key is not yet in the
+   * map, the value is created by calling the given function first. Only one thread creates the
+   * value, even when multiple threads try to add the same key at the same time.
+   */
+  template<typename CreateValueF>
+  Value lookup_or_add_cb(const Key &key, const CreateValueF &create_value)
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.lookup_or_add_cb(key, create_value);
+  }
+
+  /**
+   * This method can be used to implement more complex custom behavior without having to do
+   * multiple lookups. It has the same semantics as #Map::add_or_modify. Both callbacks are
+   * called while the shard containing the key is locked.
+   */
+  template<typename CreateValueF, typename ModifyValueF>
+  auto add_or_modify(const Key &key,
+                     const CreateValueF &create_value,
+                     const ModifyValueF &modify_value)
+      -> decltype(create_value(nullptr))
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.map.add_or_modify(key, create_value, modify_value);
+  }
+
+  /**
+   * Calls the given function for every key-value-pair. The shard containing the current item
+   * is locked during the call.
+   */
+  template<typename FuncT> void foreach_item(const FuncT &func) const
+  {
+    for (Shard &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (const auto item : shard.map.items()) {
+        func(item.key, item.value);
+      }
+    }
+  }
+
+  /**
+   * Return the number of key-value-pairs that are stored in the map.
+   */
+  int64_t size() const
+  {
+    int64_t size = 0;
+    for (Shard &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      size += shard.map.size();
+    }
+    return size;
+  }
+
+  /**
+   * Returns true if there are no elements in the map.
+   */
+  bool is_empty() const
+  {
+    return this->size() == 0;
+  }
+
+  /**
+   * Removes all key-value-pairs from the map.
+   */
+  void clear()
+  {
+    for (Shard &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.map.clear();
+    }
+  }
+
+  /**
+   * Moves all key-value-pairs into a regular map, leaving this map empty. This must not be called
+   * while other threads access the concurrent map.
+   */
+  MapType extract()
+  {
+    MapType map;
+    map.reserve(this->size());
+    for (Shard &shard : shards_) {
+      for (auto item : shard.map.items()) {
+        map.add_new(item.key, std::move(item.value));
+      }
+      shard.map.clear();
+    }
+    return map;
+  }
+
+ private:
+  Shard &shard_for_key(const Key &key) const
+  {
+    const uint64_t hash = hash_(key);
+    return shards_[concurrent_hash_table_shard_index(hash, shard_bits_)];
+  }
+};
+
+}  // namespace blender
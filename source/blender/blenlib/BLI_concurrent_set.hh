@@ -0,0 +1,203 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * A `blender::ConcurrentSet<Key>` is a hash set that can be accessed from multiple threads at the
+ * same time. Like #ConcurrentMap, it is split into shards that are separate `blender::Set`
+ * instances with their own lock. See BLI_concurrent_map.hh for more details.
+ */
+
+#include <mutex>
+
+#include "BLI_array.hh"
+#include "BLI_set.hh"
+
+namespace blender {
+
+template<
+    /** Type of the elements that are stored in this set. It has to be movable. Furthermore, the
+     * hash and is-equal functions have to support it.
+     */
+    typename Key,
+    /**
+     * The strategy used to deal with collisions within a shard. They are defined in
+     * BLI_probing_strategies.hh.
+     */
+    typename ProbingStrategy = DefaultProbingStrategy,
+    /**
+     * The hash function used to hash the keys. It is used to find the shard and the slot within
+     * the shard. See BLI_hash.hh for details.
+     */
+    typename Hash = DefaultHash<Key>,
+    /**
+     * The equality operator used to compare keys.
+     */
+    typename IsEqual = DefaultEquality,
+    /**
+     * This is what will actually be stored in the hash table arrays of the shards. See
+     * BLI_set_slots.hh for details.
+     */
+    typename Slot = typename DefaultSetSlot<Key>::type,
+    /**
+     * The allocator used by this set.
+     */
+    typename Allocator = GuardedAllocator>
+class ConcurrentSet {
+ public:
+  using ShardSetType = Set<Key, 0, ProbingStrategy, Hash, IsEqual, Slot, Allocator>;
+  using SetType = Set<Key,
+                      default_inline_buffer_capacity(sizeof(Key)),
+                      ProbingStrategy,
+                      Hash,
+                      IsEqual,
+                      Slot,
+                      Allocator>;
+
+ private:
+  static constexpr int shard_bits_ = 6;
+  static constexpr int64_t shards_num_ = 1 << shard_bits_;
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    ShardSetType set;
+  };
+
+  mutable Array<Shard, 0, Allocator> shards_;
+  Hash hash_;
+
+ public:
+  ConcurrentSet() : shards_(shards_num_)
+  {
+  }
+
+  ConcurrentSet(const ConcurrentSet &other) = delete;
+  ConcurrentSet &operator=(const ConcurrentSet &other) = delete;
+
+  /**
+   * Add a key to the set. If the key exists in the set already, nothing is done. Returns true
+   * when the key has been newly added. When multiple threads add the same key at the same time,
+   * true is returned in exactly one of them.
+   */
+  bool add(const Key &key)
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.set.add(key);
+  }
+  bool add(Key &&key)
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.set.add(std::move(key));
+  }
+
+  /**
+   * Returns true if the key is in the set.
+   */
+  bool contains(const Key &key) const
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.set.contains(key);
+  }
+
+  /**
+   * Deletes the key from the set. Returns true when the key was contained and is now removed,
+   * otherwise false.
+   */
+  bool remove(const Key &key)
+  {
+    Shard &shard = this->shard_for_key(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.set.remove(key);
+  }
+
+  /**
+   * Calls the given function for every key. The shard containing the current key is locked
+   * during the call.
+   */
+  template<typename FuncT> void foreach_key(const FuncT &func) const
+  {
+    for (Shard &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (const Key &key : shard.set) {
+        func(key);
+      }
+    }
+  }
+
+  /**
+   * Returns the number of keys stored in the set.
+   */
+  int64_t size() const
+  {
+    int64_t size = 0;
+    for (Shard &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      size += shard.set.size();
+    }
+    return size;
+  }
+
+  /**
+   * Returns true if no keys are stored.
+   */
+  bool is_empty() const
+  {
+    return this->size() == 0;
+  }
+
+  /**
+   * Removes all keys from the set.
+   */
+  void clear()
+  {
+    for (Shard &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.set.clear();
+    }
+  }
+
+  /**
+   * Moves all keys into a regular set, leaving this set empty. This must not be called while
+   * other threads access the concurrent set.
+   */
+  SetType extract()
+  {
+    SetType set;
+    set.reserve(this->size());
+    for (Shard &shard : shards_) {
+      for (const Key &key : shard.set) {
+        set.add_new(key);
+      }
+      shard.set.clear();
+    }
+    return set;
+  }
+
+ private:
+  Shard &shard_for_key(const Key &key) const
+  {
+    const uint64_t hash = hash_(key);
+    return shards_[concurrent_hash_table_shard_index(hash, shard_bits_)];
+  }
+};
+
+}  // namespace blender
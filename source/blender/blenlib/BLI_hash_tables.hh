@@ -108,6 +108,24 @@ inline constexpr int64_t total_slot_amount_for_usable_slots(
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Concurrent Hash Table Utilities
+ *
+ * Concurrent hash tables are split into shards that are locked separately. The shard of a key is
+ * determined by the high bits of its hash after multiplying it with a large odd constant. That way
+ * the shard index does not correlate with the slot index within the shard, which is computed from
+ * the low bits.
+ *
+ * \{ */
+
+inline int64_t concurrent_hash_table_shard_index(const uint64_t hash, const int shard_bits)
+{
+  BLI_assert(shard_bits > 0 && shard_bits < 64);
+  return static_cast<int64_t>((hash * 0x9E3779B97F4A7C15ull) >> (64 - shard_bits));
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Load Factor
  *
@@ -102,6 +102,12 @@ enum {
   BVH_RAYCAST_WATERTIGHT = (1 << 0),
 };
 #define BVH_RAYCAST_DEFAULT (BVH_RAYCAST_WATERTIGHT)
+enum {
+  /* Split nodes using the surface area heuristic. Slower to build, and for evenly distributed
+   * geometry also slower to query than the default build. Only use it for unevenly distributed
+   * geometry, after measuring it helps. */
+  BVH_BALANCE_SAH = (1 << 0),
+};
 #define BVH_RAYCAST_DIST_MAX (FLT_MAX / 2.0f)
 
 /* callback must update nearest in case it finds a nearest result */
@@ -148,6 +154,8 @@ void BLI_bvhtree_free(BVHTree *tree);
 /* construct: first insert points, then call balance */
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints);
 void BLI_bvhtree_balance(BVHTree *tree);
+/* Same as #BLI_bvhtree_balance, \a flag can be #BVH_BALANCE_SAH. */
+void BLI_bvhtree_balance_ex(BVHTree *tree, const int flag);
 
 /* update: first update points/nodes, then call update_tree to refit the bounding volumes */
 bool BLI_bvhtree_update_node(
@@ -0,0 +1,84 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * Profiling zones: named, possibly nested regions of code whose execution times are recorded
+ * per thread while a capture is running. A capture is written in the Chrome trace event format,
+ * which can be opened in `chrome://tracing` or https://ui.perfetto.dev.
+ *
+ * Zones are only compiled in with `WITH_PROFILE_ZONES`. Outside of a capture, a zone costs a
+ * single check of a global flag. Zone names are not copied, they have to stay valid until the
+ * capture has been written, string literals are best.
+ *
+ * \code{.c}
+ * BLI_PROFILE_ZONE_BEGIN(zone, "Evaluate");
+ * ...
+ * BLI_PROFILE_ZONE_END(zone);
+ * \endcode
+ *
+ * C++ code can use #PROFILE_ZONE from BLI_profile.hh instead.
+ */
+
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ProfileZone {
+  const char *name;
+  /** Start time in nanoseconds, or #UINT64_MAX when the zone isn't recorded. */
+  uint64_t start;
+} ProfileZone;
+
+void BLI_profile_zone_begin(ProfileZone *zone, const char *name);
+void BLI_profile_zone_end(ProfileZone *zone);
+
+/**
+ * Start recording zones, discarding previously recorded ones.
+ * \param filepath: Optional file to write the capture to, when it is ended.
+ */
+void BLI_profile_capture_begin(const char *filepath);
+/**
+ * Stop recording zones, writing them to the file passed to #BLI_profile_capture_begin.
+ * \return False when writing failed.
+ */
+bool BLI_profile_capture_end(void);
+bool BLI_profile_is_capturing(void);
+
+/**
+ * Write the recorded zones in the Chrome trace event format. A running capture is paused while
+ * the zones are written.
+ */
+bool BLI_profile_write_chrome_trace(const char *filepath);
+
+#ifdef WITH_PROFILE_ZONES
+#  define BLI_PROFILE_ZONE_BEGIN(zone, name) \
+    ProfileZone zone; \
+    BLI_profile_zone_begin(&zone, name)
+#  define BLI_PROFILE_ZONE_END(zone) BLI_profile_zone_end(&zone)
+#else
+#  define BLI_PROFILE_ZONE_BEGIN(zone, name) ((void)0)
+#  define BLI_PROFILE_ZONE_END(zone) ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
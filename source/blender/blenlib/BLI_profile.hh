@@ -0,0 +1,61 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bli
+ *
+ * C++ utilities for profiling zones, see BLI_profile.h.
+ */
+
+#include <ostream>
+
+#include "BLI_profile.h"
+
+namespace blender::profile {
+
+/**
+ * Records a profiling zone for the lifetime of the object.
+ */
+class ScopedZone {
+ private:
+  ProfileZone zone_;
+
+ public:
+  ScopedZone(const char *name)
+  {
+    BLI_profile_zone_begin(&zone_, name);
+  }
+
+  ~ScopedZone()
+  {
+    BLI_profile_zone_end(&zone_);
+  }
+
+  ScopedZone(const ScopedZone &other) = delete;
+  ScopedZone &operator=(const ScopedZone &other) = delete;
+};
+
+void write_chrome_trace(std::ostream &stream);
+
+}  // namespace blender::profile
+
+#ifdef WITH_PROFILE_ZONES
+#  define PROFILE_ZONE(name) blender::profile::ScopedZone profile_zone(name)
+#else
+#  define PROFILE_ZONE(name) ((void)0)
+#endif
@@ -36,6 +36,14 @@
  *   #BLI_bvhtree_overlap, #BVHOverlapData_Shared, #BVHOverlapData_Thread
  * - Range Query:
  *   #BLI_bvhtree_range_query
+ *
+ * Trees are built by splitting the leafs at the median of the largest axis
+ * (#BLI_bvhtree_balance), or optionally using the surface area heuristic (#BVH_BALANCE_SAH).
+ * The latter takes longer to build, and for evenly distributed geometry also results in slower
+ * queries, so it is only worth it for unevenly distributed geometry.
+ *
+ * For AABB trees with at most 4 children per node, the bounds of the children of every branch
+ * are additionally stored in a SIMD friendly layout, so that all children can be tested at once.
  */
 
 #include "MEM_guardedalloc.h"
@@ -50,6 +58,12 @@
 
 #include "BLI_strict_flags.h"
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+/* Test all children of a node at once, for AABB trees. */
+#  define USE_SIMD_NODE_TEST
+#endif
+
 /* used for iterative_raycast */
 // #define USE_SKIP_LINKS
 
@@ -61,6 +75,14 @@
 
 #define MAX_TREETYPE 32
 
+/* Number of children that are tested at once by the SIMD node tests. */
+#define SIMD_NODE_WIDTH 4
+/* Number of floats stored per branch for the SIMD node tests: 6 bounds for 4 children. */
+#define SIMD_NODE_BV_LEN (6 * SIMD_NODE_WIDTH)
+
+/* Number of bins used to evaluate split candidates in the SAH build. */
+#define SAH_BINS 16
+
 /* Setting zero so we can catch bugs in BLI_task/KDOPBVH.
  * TODO(sergey): Deduplicate the limits with PBVH from BKE.
  */
@@ -94,6 +116,7 @@ struct BVHTree {
   BVHNode *nodearray;  /* pre-alloc branch nodes */
   BVHNode **nodechild; /* pre-alloc children for nodes */
   float *nodebv;       /* pre-alloc bounding-volumes for nodes */
+  float *nodebv_simd;  /* children bounds of all branches, see #bvhtree_simd_bounds_update */
   float epsilon;       /* epslion is used for inflation of the k-dop      */
   int totleaf;         /* leafs */
   int totbranch;
@@ -103,14 +126,15 @@ struct BVHTree {
 };
 
 /* optimization, ensure we stay small */
-BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
-                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
+BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 56) ||
+                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 36),
                   "over sized")
 
 /* avoid duplicating vars in BVHOverlapData_Thread */
 typedef struct BVHOverlapData_Shared {
   const BVHTree *tree1, *tree2;
   axis_t start_axis, stop_axis;
+  bool use_simd;
 
   /* use for callbacks */
   BVHTree_OverlapCallback callback;
@@ -863,6 +887,342 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Surface Area Heuristic Build
+ *
+ * Top-down build that chooses splits by minimizing the surface area heuristic, which estimates
+ * the cost of traversing the resulting children. Split candidates are evaluated on a fixed number
+ * of bins per axis. Nodes with more than two children are created by repeatedly splitting the
+ * child with the most leafs.
+ *
+ * Unlike the implicit tree build, nodes don't necessarily have #BVHTree.tree_type children,
+ * so more branches may be needed than preallocated in #BLI_bvhtree_new.
+ * \{ */
+
+typedef struct BVHSAHBin {
+  float bv[6];
+  int count;
+} BVHSAHBin;
+
+typedef struct BVHSAHTask {
+  BVHNode *node;
+  int begin, end;
+} BVHSAHTask;
+
+static void sah_bv_init(float bv[6])
+{
+  for (int i = 0; i < 3; i++) {
+    bv[2 * i] = FLT_MAX;
+    bv[2 * i + 1] = -FLT_MAX;
+  }
+}
+
+static void sah_bv_extend(float bv[6], const float other[6])
+{
+  for (int i = 0; i < 3; i++) {
+    bv[2 * i] = min_ff(bv[2 * i], other[2 * i]);
+    bv[2 * i + 1] = max_ff(bv[2 * i + 1], other[2 * i + 1]);
+  }
+}
+
+static float sah_bv_half_area(const float bv[6])
+{
+  const float dx = bv[1] - bv[0];
+  const float dy = bv[3] - bv[2];
+  const float dz = bv[5] - bv[4];
+  return dx * dy + dy * dz + dz * dx;
+}
+
+BLI_INLINE float sah_centroid(const BVHNode *node, const int axis)
+{
+  return (node->bv[2 * axis] + node->bv[2 * axis + 1]) * 0.5f;
+}
+
+BLI_INLINE int sah_bin_index(const float centroid, const float centroid_min, const float scale)
+{
+  return min_ii((int)((centroid - centroid_min) * scale), SAH_BINS - 1);
+}
+
+/**
+ * Reorder the leafs in the given range into two non-empty parts with the lowest SAH cost.
+ *
+ * \param r_axis: The axis the leafs were split on, or -1 if all centroids are at the same place.
+ * \return The index of the first leaf in the second part.
+ */
+static int sah_split_leafs(BVHNode **leafs_array, const int begin, const int end, int *r_axis)
+{
+  float centroid_min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float centroid_max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (int i = begin; i < end; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      const float centroid = sah_centroid(leafs_array[i], axis);
+      centroid_min[axis] = min_ff(centroid_min[axis], centroid);
+      centroid_max[axis] = max_ff(centroid_max[axis], centroid);
+    }
+  }
+
+  float best_cost = FLT_MAX;
+  int best_axis = -1, best_split = 0;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float extent = centroid_max[axis] - centroid_min[axis];
+    if (!(extent > 0.0f)) {
+      continue;
+    }
+    const float scale = (float)SAH_BINS / extent;
+
+    BVHSAHBin bins[SAH_BINS];
+    for (int b = 0; b < SAH_BINS; b++) {
+      sah_bv_init(bins[b].bv);
+      bins[b].count = 0;
+    }
+    for (int i = begin; i < end; i++) {
+      const BVHNode *leaf = leafs_array[i];
+      BVHSAHBin *bin = &bins[sah_bin_index(sah_centroid(leaf, axis), centroid_min[axis], scale)];
+      sah_bv_extend(bin->bv, leaf->bv);
+      bin->count++;
+    }
+
+    /* Cost of the part to the right of every split position. */
+    float right_cost[SAH_BINS];
+    float bv[6];
+    int count = 0;
+    sah_bv_init(bv);
+    for (int b = SAH_BINS - 1; b > 0; b--) {
+      sah_bv_extend(bv, bins[b].bv);
+      count += bins[b].count;
+      right_cost[b] = (count != 0) ? sah_bv_half_area(bv) * (float)count : -1.0f;
+    }
+
+    count = 0;
+    sah_bv_init(bv);
+    for (int b = 0; b < SAH_BINS - 1; b++) {
+      sah_bv_extend(bv, bins[b].bv);
+      count += bins[b].count;
+      if (count == 0 || right_cost[b + 1] < 0.0f) {
+        continue;
+      }
+      const float cost = sah_bv_half_area(bv) * (float)count + right_cost[b + 1];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_split = b + 1;
+      }
+    }
+  }
+
+  *r_axis = best_axis;
+
+  if (best_axis == -1) {
+    /* All centroids are at the same location, any split is as good as another. */
+    return (begin + end) / 2;
+  }
+
+  /* Move all leafs in bins before the split to the front. */
+  const float scale = (float)SAH_BINS / (centroid_max[best_axis] - centroid_min[best_axis]);
+  int i = begin, j = end - 1;
+  while (true) {
+    while (i <= j && sah_bin_index(sah_centroid(leafs_array[i], best_axis),
+                                   centroid_min[best_axis],
+                                   scale) < best_split) {
+      i++;
+    }
+    while (i <= j && sah_bin_index(sah_centroid(leafs_array[j], best_axis),
+                                   centroid_min[best_axis],
+                                   scale) >= best_split) {
+      j--;
+    }
+    if (i >= j) {
+      break;
+    }
+    SWAP(BVHNode *, leafs_array[i], leafs_array[j]);
+  }
+  BLI_assert(i > begin && i < end);
+  return i;
+}
+
+/**
+ * Build the branches of the tree in the preallocated branch nodes. Branches are created in
+ * depth-first order, so that (as for the implicit tree) children always have a greater index
+ * than their parent.
+ *
+ * \return The number of branches.
+ */
+static int sah_bvh_build(const BVHTree *tree, BVHNode *branches_array, BVHNode **leafs_array)
+{
+  const int num_leafs = tree->totleaf;
+  BVHNode *root = &branches_array[0];
+  int num_branches = 1;
+
+  root->parent = NULL;
+
+  /* Every branch on the stack has at least two leafs, and their leafs don't overlap. */
+  BVHSAHTask *stack = MEM_mallocN(sizeof(*stack) * (size_t)(num_leafs / 2 + 1), __func__);
+  int stack_len = 0;
+  stack[stack_len++] = (BVHSAHTask){root, 0, num_leafs};
+
+  while (stack_len > 0) {
+    const BVHSAHTask task = stack[--stack_len];
+    BVHNode *node = task.node;
+
+    refit_kdop_hull(tree, node, task.begin, task.end);
+
+    /* Leafs of child `k` are in the range `[groups[k], groups[k + 1])`. */
+    int groups[MAX_TREETYPE + 1];
+    int groups_len = 1;
+    groups[0] = task.begin;
+    groups[1] = task.end;
+
+    while (groups_len < tree->tree_type) {
+      int largest_group = -1, largest_len = 1;
+      for (int k = 0; k < groups_len; k++) {
+        if (groups[k + 1] - groups[k] > largest_len) {
+          largest_group = k;
+          largest_len = groups[k + 1] - groups[k];
+        }
+      }
+      if (largest_group == -1) {
+        break;
+      }
+
+      int split_axis;
+      const int split = sah_split_leafs(
+          leafs_array, groups[largest_group], groups[largest_group + 1], &split_axis);
+
+      if (groups_len == 1) {
+        /* Children are sorted along this axis, which ray-casts use to choose the order. */
+        node->main_axis = (char)((split_axis != -1) ? split_axis : get_largest_axis(node->bv) / 2);
+      }
+
+      memmove(&groups[largest_group + 2],
+              &groups[largest_group + 1],
+              sizeof(*groups) * (size_t)(groups_len - largest_group));
+      groups[largest_group + 1] = split;
+      groups_len++;
+    }
+
+    for (int k = 0; k < groups_len; k++) {
+      BVHNode *child;
+      if (groups[k + 1] - groups[k] == 1) {
+        child = leafs_array[groups[k]];
+      }
+      else {
+        child = &branches_array[num_branches++];
+        stack[stack_len++] = (BVHSAHTask){child, groups[k], groups[k + 1]};
+      }
+      node->children[k] = child;
+      child->parent = node;
+    }
+    node->totnode = (char)groups_len;
+  }
+
+  MEM_freeN(stack);
+  return num_branches;
+}
+
+/**
+ * Make sure the tree has memory for at least the given number of nodes, keeping the leafs.
+ */
+static void bvhtree_ensure_nodes_len(BVHTree *tree, const int numnodes)
+{
+  const int numnodes_alloc = (int)(MEM_allocN_len(tree->nodes) / sizeof(*tree->nodes));
+  if (numnodes <= numnodes_alloc) {
+    return;
+  }
+
+  const int axis = tree->axis;
+  const int tree_type = tree->tree_type;
+
+  BVHNode **nodes = MEM_callocN(sizeof(BVHNode *) * (size_t)numnodes, "BVHNodes");
+  float *nodebv = MEM_callocN(sizeof(float) * (size_t)(axis * numnodes), "BVHNodeBV");
+  BVHNode **nodechild = MEM_callocN(sizeof(BVHNode *) * (size_t)(tree_type * numnodes),
+                                    "BVHNodeBV");
+  BVHNode *nodearray = MEM_callocN(sizeof(BVHNode) * (size_t)numnodes, "BVHNodeArray");
+
+  memcpy(nodebv, tree->nodebv, sizeof(float) * (size_t)(axis * tree->totleaf));
+  for (int i = 0; i < numnodes; i++) {
+    nodearray[i].bv = &nodebv[i * axis];
+    nodearray[i].children = &nodechild[i * tree_type];
+  }
+  for (int i = 0; i < tree->totleaf; i++) {
+    nodearray[i].index = tree->nodearray[i].index;
+    /* Keep the order of the leafs, it may have been changed by a previous build. */
+    nodes[i] = &nodearray[tree->nodes[i] - tree->nodearray];
+  }
+
+  MEM_freeN(tree->nodes);
+  MEM_freeN(tree->nodebv);
+  MEM_freeN(tree->nodechild);
+  MEM_freeN(tree->nodearray);
+
+  tree->nodes = nodes;
+  tree->nodebv = nodebv;
+  tree->nodechild = nodechild;
+  tree->nodearray = nodearray;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name SIMD Node Bounds
+ *
+ * For every branch, the bounds of its children are stored as 6 rows of #SIMD_NODE_WIDTH floats
+ * (x-min, x-max, y-min, y-max, z-min and z-max), with one column per child.
+ * \{ */
+
+static bool bvhtree_use_simd_node_test(const BVHTree *tree)
+{
+#ifdef USE_SIMD_NODE_TEST
+  return (tree->axis == 6) && (tree->tree_type <= SIMD_NODE_WIDTH);
+#else
+  UNUSED_VARS(tree);
+  return false;
+#endif
+}
+
+BLI_INLINE const float *bvhtree_simd_bounds(const BVHTree *tree, const BVHNode *node)
+{
+  BLI_assert(node->totnode != 0);
+  return tree->nodebv_simd + (node - tree->nodearray - tree->totleaf) * SIMD_NODE_BV_LEN;
+}
+
+/**
+ * Copy the bounds of the children of all branches, has to be called when they changed.
+ */
+static void bvhtree_simd_bounds_update(BVHTree *tree)
+{
+  if (!bvhtree_use_simd_node_test(tree)) {
+    return;
+  }
+
+  if (tree->nodebv_simd == NULL) {
+    tree->nodebv_simd = MEM_mallocN_aligned(
+        sizeof(float) * SIMD_NODE_BV_LEN * (size_t)tree->totbranch, 16, "BVHNodeBVSIMD");
+  }
+
+  for (int i = 0; i < tree->totbranch; i++) {
+    const BVHNode *node = &tree->nodearray[tree->totleaf + i];
+    float *bounds = &tree->nodebv_simd[i * SIMD_NODE_BV_LEN];
+
+    for (int k = 0; k < SIMD_NODE_WIDTH; k++) {
+      if (k < node->totnode) {
+        const float *bv = node->children[k]->bv;
+        for (int j = 0; j < 6; j++) {
+          bounds[j * SIMD_NODE_WIDTH + k] = bv[j];
+        }
+      }
+      else {
+        /* Empty bounds, that are never hit. */
+        for (int j = 0; j < 6; j++) {
+          bounds[j * SIMD_NODE_WIDTH + k] = (j & 1) ? -FLT_MAX : FLT_MAX;
+        }
+      }
+    }
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree API
  * \{ */
@@ -949,11 +1309,22 @@ void BLI_bvhtree_free(BVHTree *tree)
     MEM_SAFE_FREE(tree->nodearray);
     MEM_SAFE_FREE(tree->nodebv);
     MEM_SAFE_FREE(tree->nodechild);
+    MEM_SAFE_FREE(tree->nodebv_simd);
     MEM_freeN(tree);
   }
 }
 
 void BLI_bvhtree_balance(BVHTree *tree)
+{
+  BLI_bvhtree_balance_ex(tree, 0);
+}
+
+/**
+ * \param flag: #BVH_BALANCE_SAH to build the tree using the surface area heuristic.
+ * This takes longer than the default build, and for evenly distributed geometry the queries are
+ * slower too. Only use it for unevenly distributed geometry, after measuring it helps.
+ */
+void BLI_bvhtree_balance_ex(BVHTree *tree, const int flag)
 {
   BVHNode **leafs_array = tree->nodes;
 
@@ -961,17 +1332,31 @@ void BLI_bvhtree_balance(BVHTree *tree)
    * (some big bug goes here if its being called more than once per tree) */
   BLI_assert(tree->totbranch == 0);
 
-  /* Build the implicit tree */
-  non_recursive_bvh_div_nodes(
-      tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
+  /* The SAH build only looks at the x, y and z axis. */
+  const bool use_sah = (flag & BVH_BALANCE_SAH) && (tree->start_axis == 0) &&
+                       (tree->totleaf > 1);
+
+  if (use_sah) {
+    /* Every branch has at least two children. */
+    bvhtree_ensure_nodes_len(tree, tree->totleaf * 2 - 1);
+    leafs_array = tree->nodes;
+    tree->totbranch = sah_bvh_build(tree, tree->nodearray + tree->totleaf, leafs_array);
+  }
+  else {
+    /* Build the implicit tree */
+    non_recursive_bvh_div_nodes(
+        tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
+    tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
+  }
 
   /* current code expects the branches to be linked to the nodes array
    * we perform that linkage here */
-  tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
   for (int i = 0; i < tree->totbranch; i++) {
     tree->nodes[tree->totleaf + i] = &tree->nodearray[tree->totleaf + i];
   }
 
+  bvhtree_simd_bounds_update(tree);
+
 #ifdef USE_SKIP_LINKS
   build_skip_links(tree, tree->nodes[tree->totleaf], NULL, NULL);
 #endif
@@ -1053,6 +1438,8 @@ void BLI_bvhtree_update_tree(BVHTree *tree)
   for (; index >= root; index--) {
     node_join(tree, *index);
   }
+
+  bvhtree_simd_bounds_update(tree);
 }
 /**
  * Number of times #BLI_bvhtree_insert has been called.
@@ -1192,6 +1579,65 @@ static void tree_overlap_traverse_cb(BVHOverlapData_Thread *data_thread,
   }
 }
 
+#ifdef USE_SIMD_NODE_TEST
+/**
+ * Same as #tree_overlap_test for all children of a node against a single node, for AABB trees.
+ *
+ * \return A bit-mask of the children that overlap \a bv.
+ */
+static int simd_tree_overlap_test(const float *bounds, const float bv[6])
+{
+  __m128 separated = _mm_setzero_ps();
+  for (int i = 0; i < 3; i++) {
+    const __m128 child_min = _mm_load_ps(&bounds[(2 * i) * SIMD_NODE_WIDTH]);
+    const __m128 child_max = _mm_load_ps(&bounds[(2 * i + 1) * SIMD_NODE_WIDTH]);
+    separated = _mm_or_ps(separated, _mm_cmpgt_ps(child_min, _mm_set1_ps(bv[2 * i + 1])));
+    separated = _mm_or_ps(separated, _mm_cmpgt_ps(_mm_set1_ps(bv[2 * i]), child_max));
+  }
+  return ~_mm_movemask_ps(separated) & ((1 << SIMD_NODE_WIDTH) - 1);
+}
+
+/**
+ * A version of #tree_overlap_traverse and #tree_overlap_traverse_cb, that tests all children
+ * of a node at once. The given nodes have to overlap already.
+ */
+static void tree_overlap_traverse_simd(BVHOverlapData_Thread *data_thread,
+                                       const BVHNode *node1,
+                                       const BVHNode *node2)
+{
+  BVHOverlapData_Shared *data = data_thread->shared;
+
+  if (node1->totnode) {
+    const int mask = simd_tree_overlap_test(bvhtree_simd_bounds(data->tree1, node1), node2->bv);
+    for (int j = 0; j < node1->totnode; j++) {
+      if (mask & (1 << j)) {
+        tree_overlap_traverse_simd(data_thread, node1->children[j], node2);
+      }
+    }
+  }
+  else if (node2->totnode) {
+    const int mask = simd_tree_overlap_test(bvhtree_simd_bounds(data->tree2, node2), node1->bv);
+    for (int j = 0; j < node2->totnode; j++) {
+      if (mask & (1 << j)) {
+        tree_overlap_traverse_simd(data_thread, node1, node2->children[j]);
+      }
+    }
+  }
+  else {
+    if (UNLIKELY(node1 == node2)) {
+      return;
+    }
+    if (data->callback == NULL ||
+        data->callback(data->userdata, node1->index, node2->index, data_thread->thread)) {
+      /* both leafs, insert overlap! */
+      BVHTreeOverlap *overlap = BLI_stack_push_r(data_thread->overlap);
+      overlap->indexA = node1->index;
+      overlap->indexB = node2->index;
+    }
+  }
+}
+#endif /* USE_SIMD_NODE_TEST */
+
 /**
  * a version of #tree_overlap_traverse_cb that that break on first true return.
  */
@@ -1267,6 +1713,15 @@ static void bvhtree_overlap_task_cb(void *__restrict userdata,
                               data_shared->tree1->nodes[data_shared->tree1->totleaf]->children[j],
                               data_shared->tree2->nodes[data_shared->tree2->totleaf]);
   }
+#ifdef USE_SIMD_NODE_TEST
+  else if (data_shared->use_simd) {
+    const BVHNode *node1 = data_shared->tree1->nodes[data_shared->tree1->totleaf]->children[j];
+    const BVHNode *node2 = data_shared->tree2->nodes[data_shared->tree2->totleaf];
+    if (tree_overlap_test(node1, node2, data_shared->start_axis, data_shared->stop_axis)) {
+      tree_overlap_traverse_simd(data, node1, node2);
+    }
+  }
+#endif
   else if (data_shared->callback) {
     tree_overlap_traverse_cb(data,
                              data_shared->tree1->nodes[data_shared->tree1->totleaf]->children[j],
@@ -1327,6 +1782,7 @@ BVHTreeOverlap *BLI_bvhtree_overlap_ex(
   data_shared.tree2 = tree2;
   data_shared.start_axis = start_axis;
   data_shared.stop_axis = stop_axis;
+  data_shared.use_simd = (tree1->nodebv_simd != NULL) && (tree2->nodebv_simd != NULL);
 
   /* can be NULL */
   data_shared.callback = callback;
@@ -1352,6 +1808,11 @@ BVHTreeOverlap *BLI_bvhtree_overlap_ex(
     if (max_interactions) {
       tree_overlap_traverse_num(data, root1, root2);
     }
+#ifdef USE_SIMD_NODE_TEST
+    else if (data_shared.use_simd) {
+      tree_overlap_traverse_simd(data, root1, root2);
+    }
+#endif
     else if (callback) {
       tree_overlap_traverse_cb(data, root1, root2);
     }
@@ -1528,6 +1989,53 @@ static void dfs_find_nearest_dfs(BVHNearestData *data, BVHNode *node)
   }
 }
 
+#ifdef USE_SIMD_NODE_TEST
+/**
+ * Same as #calc_nearest_point_squared for all children of a node at once.
+ */
+static void simd_calc_nearest_point_squared(const float proj[3],
+                                            const float *bounds,
+                                            float r_dist_sq[SIMD_NODE_WIDTH])
+{
+  __m128 dist_sq = _mm_setzero_ps();
+  for (int i = 0; i < 3; i++) {
+    const __m128 co = _mm_set1_ps(proj[i]);
+    const __m128 nearest = _mm_min_ps(
+        _mm_max_ps(co, _mm_load_ps(&bounds[(2 * i) * SIMD_NODE_WIDTH])),
+        _mm_load_ps(&bounds[(2 * i + 1) * SIMD_NODE_WIDTH]));
+    const __m128 delta = _mm_sub_ps(co, nearest);
+    dist_sq = _mm_add_ps(dist_sq, _mm_mul_ps(delta, delta));
+  }
+  _mm_storeu_ps(r_dist_sq, dist_sq);
+}
+
+/**
+ * Version of #dfs_find_nearest_dfs that tests all children of the given branch at once.
+ */
+static void dfs_find_nearest_simd(BVHNearestData *data, BVHNode *node)
+{
+  float dist_sq[SIMD_NODE_WIDTH];
+  simd_calc_nearest_point_squared(data->proj, bvhtree_simd_bounds(data->tree, node), dist_sq);
+
+  /* Better heuristic to pick the closest node to dive on */
+  const bool forward = data->proj[node->main_axis] <=
+                       node->children[0]->bv[node->main_axis * 2 + 1];
+  for (int j = 0; j != node->totnode; j++) {
+    const int i = forward ? j : node->totnode - 1 - j;
+    if (dist_sq[i] >= data->nearest.dist_sq) {
+      continue;
+    }
+    BVHNode *child = node->children[i];
+    if (child->totnode == 0) {
+      dfs_find_nearest_dfs(data, child);
+    }
+    else {
+      dfs_find_nearest_simd(data, child);
+    }
+  }
+}
+#endif /* USE_SIMD_NODE_TEST */
+
 static void dfs_find_nearest_begin(BVHNearestData *data, BVHNode *node)
 {
   float nearest[3], dist_sq;
@@ -1535,6 +2043,12 @@ static void dfs_find_nearest_begin(BVHNearestData *data, BVHNode *node)
   if (dist_sq >= data->nearest.dist_sq) {
     return;
   }
+#ifdef USE_SIMD_NODE_TEST
+  if (data->tree->nodebv_simd && node->totnode != 0) {
+    dfs_find_nearest_simd(data, node);
+    return;
+  }
+#endif
   dfs_find_nearest_dfs(data, node);
 }
 
@@ -1550,6 +2064,18 @@ static void heap_find_nearest_inner(BVHNearestData *data, HeapSimple *heap, BVHN
       data->nearest.dist_sq = calc_nearest_point_squared(data->proj, node, data->nearest.co);
     }
   }
+#ifdef USE_SIMD_NODE_TEST
+  else if (data->tree->nodebv_simd) {
+    float dist_sq[SIMD_NODE_WIDTH];
+    simd_calc_nearest_point_squared(data->proj, bvhtree_simd_bounds(data->tree, node), dist_sq);
+
+    for (int i = 0; i != node->totnode; i++) {
+      if (dist_sq[i] < data->nearest.dist_sq) {
+        BLI_heapsimple_insert(heap, dist_sq[i], node->children[i]);
+      }
+    }
+  }
+#endif
   else {
     float nearest[3];
 
@@ -1844,6 +2370,89 @@ static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
   }
 }
 
+#ifdef USE_SIMD_NODE_TEST
+/**
+ * Same as #fast_ray_nearest_hit for all children of a node at once.
+ *
+ * \return A bit-mask of the children that are hit, their distances are written to \a r_dist.
+ */
+static int simd_fast_ray_nearest_hit(const BVHRayCastData *data,
+                                     const float *bounds,
+                                     float r_dist[SIMD_NODE_WIDTH])
+{
+  __m128 t1[3], t2[3];
+  for (int i = 0; i < 3; i++) {
+    const __m128 origin = _mm_set1_ps(data->ray.origin[i]);
+    const __m128 idot = _mm_set1_ps(data->idot_axis[i]);
+    t1[i] = _mm_mul_ps(
+        _mm_sub_ps(_mm_load_ps(&bounds[data->index[2 * i] * SIMD_NODE_WIDTH]), origin), idot);
+    t2[i] = _mm_mul_ps(
+        _mm_sub_ps(_mm_load_ps(&bounds[data->index[2 * i + 1] * SIMD_NODE_WIDTH]), origin), idot);
+  }
+
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 dist = _mm_set1_ps(data->hit.dist);
+
+  __m128 miss = _mm_or_ps(_mm_cmpgt_ps(t1[0], t2[1]), _mm_cmplt_ps(t2[0], t1[1]));
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmpgt_ps(t1[0], t2[2]), _mm_cmplt_ps(t2[0], t1[2])));
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmpgt_ps(t1[1], t2[2]), _mm_cmplt_ps(t2[1], t1[2])));
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmplt_ps(t2[0], zero), _mm_cmplt_ps(t2[1], zero)));
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmplt_ps(t2[2], zero), _mm_cmpgt_ps(t1[0], dist)));
+  miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmpgt_ps(t1[1], dist), _mm_cmpgt_ps(t1[2], dist)));
+
+  _mm_storeu_ps(r_dist, _mm_max_ps(_mm_max_ps(t1[0], t1[1]), t1[2]));
+  return ~_mm_movemask_ps(miss) & ((1 << SIMD_NODE_WIDTH) - 1);
+}
+
+/**
+ * Version of #dfs_raycast that tests all children of the given branch at once.
+ * The bounds of the branch itself have to be hit already.
+ */
+static void dfs_raycast_simd(BVHRayCastData *data, const BVHNode *node)
+{
+  float dist[SIMD_NODE_WIDTH];
+  const float *bounds = bvhtree_simd_bounds(data->tree, node);
+  const int hit_mask = simd_fast_ray_nearest_hit(data, bounds, dist);
+
+  /* pick loop direction to dive into the tree (based on ray direction and split axis) */
+  const bool forward = data->ray_dot_axis[node->main_axis] > 0.0f;
+  for (int j = 0; j != node->totnode; j++) {
+    const int i = forward ? j : node->totnode - 1 - j;
+    /* The hit distance may have become smaller while traversing the previous children. */
+    if (!(hit_mask & (1 << i)) || dist[i] >= data->hit.dist) {
+      continue;
+    }
+
+    BVHNode *child = node->children[i];
+    if (child->totnode == 0) {
+      if (data->callback) {
+        data->callback(data->userdata, child->index, &data->ray, &data->hit);
+      }
+      else {
+        data->hit.index = child->index;
+        data->hit.dist = dist[i];
+        madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, dist[i]);
+      }
+    }
+    else {
+      dfs_raycast_simd(data, child);
+    }
+  }
+}
+
+static void dfs_raycast_simd_begin(BVHRayCastData *data, BVHNode *root)
+{
+  if (root->totnode == 0) {
+    dfs_raycast(data, root);
+    return;
+  }
+  if (fast_ray_nearest_hit(data, root) >= data->hit.dist) {
+    return;
+  }
+  dfs_raycast_simd(data, root);
+}
+#endif /* USE_SIMD_NODE_TEST */
+
 /**
  * A version of #dfs_raycast with minor changes to reset the index & dist each ray cast.
  */
@@ -1951,7 +2560,16 @@ int BLI_bvhtree_ray_cast_ex(BVHTree *tree,
   }
 
   if (root) {
-    dfs_raycast(&data, root);
+#ifdef USE_SIMD_NODE_TEST
+    /* The SIMD node test doesn't support a radius, like #fast_ray_nearest_hit. */
+    if (tree->nodebv_simd && radius == 0.0f) {
+      dfs_raycast_simd_begin(&data, root);
+    }
+    else
+#endif
+    {
+      dfs_raycast(&data, root);
+    }
     //      iterative_raycast(&data, root);
   }
 
@@ -104,6 +104,7 @@
 
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BLI_strict_flags.h"
 
@@ -198,6 +199,22 @@
 #  define BCHUNK_SIZE_MAX_MUL 2
 #endif /* USE_MERGE_CHUNKS */
 
+/* Hash and compare large arrays using multiple threads.
+ *
+ * Only the work within a single array is threaded, adding arrays to the same store from multiple
+ * threads isn't supported since they share chunks and memory pools.
+ */
+#define USE_THREADED_DEDUPLICATE
+
+#ifdef USE_THREADED_DEDUPLICATE
+/* Number of elements hashed by each task.
+ */
+#  define BCHUNK_HASH_THREADED_GRAIN (1 << 16)
+/* Compare chunks using multiple threads when at least this many bytes are compared.
+ */
+#  define BCHUNK_COMPARE_THREADED_BYTES_MIN (1 << 20)
+#endif
+
 /* slow (keep disabled), but handy for debugging */
 // #define USE_VALIDATE_LIST_SIZE
 
@@ -361,6 +378,125 @@ static bool bchunk_data_compare(const BChunk *chunk,
   return false;
 }
 
+#ifdef USE_THREADED_DEDUPLICATE
+
+typedef struct BChunkCompareTaskData {
+  const BChunk **chunks;
+  const size_t *offsets;
+  const uchar *data;
+  size_t data_len;
+  bool *is_match;
+} BChunkCompareTaskData;
+
+static void bchunk_data_compare_task(void *__restrict userdata,
+                                     const int index,
+                                     const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BChunkCompareTaskData *task_data = userdata;
+  task_data->is_match[index] = bchunk_data_compare(
+      task_data->chunks[index], task_data->data, task_data->data_len, task_data->offsets[index]);
+}
+
+/**
+ * Compare consecutive chunks starting at \a cref with the data at the same positions,
+ * using multiple threads. Chunks are laid out forwards from \a offset,
+ * or backwards from \a data_len when \a use_reverse is set.
+ * This stops at \a cref_stop, or at the first chunk that doesn't fit between both.
+ * When walking backwards, the first chunk of the list is never compared,
+ * matching the fast-path for end chunks.
+ *
+ * \param use_stop_at_mismatch: Only the flags up to the first mismatch are needed,
+ * comparisons may stop after it.
+ * \param chunks_len_max: The number of chunks in the list.
+ * \param r_is_match: Set to an array with a flag for every compared chunk, to be freed.
+ * \return The number of compared chunks.
+ */
+static uint bchunk_list_compare_threaded(const BChunkRef *cref,
+                                         const BChunkRef *cref_stop,
+                                         const bool use_reverse,
+                                         const bool use_stop_at_mismatch,
+                                         const uint chunks_len_max,
+                                         const uchar *data,
+                                         const size_t data_len,
+                                         const size_t offset,
+                                         bool **r_is_match)
+{
+  const BChunk **chunks = MEM_mallocN(sizeof(*chunks) * chunks_len_max, __func__);
+  size_t *offsets = MEM_mallocN(sizeof(*offsets) * chunks_len_max, __func__);
+
+  uint chunks_len = 0;
+  size_t range_start = offset, range_end = data_len;
+  while ((cref != NULL) && (cref != cref_stop) &&
+         (cref->link->data_len <= range_end - range_start)) {
+    BLI_assert(chunks_len < chunks_len_max);
+    chunks[chunks_len] = cref->link;
+    if (use_reverse) {
+      if (cref->prev == NULL) {
+        break;
+      }
+      range_end -= cref->link->data_len;
+      offsets[chunks_len] = range_end;
+      cref = cref->prev;
+    }
+    else {
+      offsets[chunks_len] = range_start;
+      range_start += cref->link->data_len;
+      cref = cref->next;
+    }
+    chunks_len++;
+  }
+
+  bool *is_match = MEM_mallocN(sizeof(*is_match) * MAX2(chunks_len, 1u), __func__);
+  BChunkCompareTaskData task_data = {
+      .chunks = chunks,
+      .offsets = offsets,
+      .data = data,
+      .data_len = data_len,
+      .is_match = is_match,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 64;
+
+  uint compared_len = 0;
+  if (use_stop_at_mismatch) {
+    /* Compare in batches of growing size,
+     * to limit the unnecessary comparisons after a mismatch. */
+    bool has_mismatch = false;
+    size_t batch_bytes = BCHUNK_COMPARE_THREADED_BYTES_MIN;
+    while ((compared_len < chunks_len) && !has_mismatch) {
+      const uint batch_start = compared_len;
+      size_t bytes = 0;
+      while ((compared_len < chunks_len) && (bytes < batch_bytes)) {
+        bytes += chunks[compared_len]->data_len;
+        compared_len++;
+      }
+      BLI_task_parallel_range(
+          (int)batch_start, (int)compared_len, &task_data, bchunk_data_compare_task, &settings);
+
+      for (uint i = batch_start; i < compared_len; i++) {
+        if (!is_match[i]) {
+          has_mismatch = true;
+          break;
+        }
+      }
+      batch_bytes *= 2;
+    }
+  }
+  else {
+    BLI_task_parallel_range(0, (int)chunks_len, &task_data, bchunk_data_compare_task, &settings);
+    compared_len = chunks_len;
+  }
+
+  MEM_freeN(chunks);
+  MEM_freeN(offsets);
+
+  *r_is_match = is_match;
+  return compared_len;
+}
+
+#endif /* USE_THREADED_DEDUPLICATE */
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -769,24 +905,77 @@ static uint hash_data(const uchar *key, size_t n)
 #undef HASH_INIT
 
 #ifdef USE_HASH_TABLE_ACCUMULATE
-static void hash_array_from_data(const BArrayInfo *info,
-                                 const uchar *data_slice,
-                                 const size_t data_slice_len,
-                                 hash_key *hash_array)
+static void hash_array_from_data_range(const BArrayInfo *info,
+                                       const uchar *data_slice,
+                                       const size_t i_start,
+                                       const size_t i_end,
+                                       hash_key *hash_array)
 {
   if (info->chunk_stride != 1) {
-    for (size_t i = 0, i_step = 0; i_step < data_slice_len; i++, i_step += info->chunk_stride) {
-      hash_array[i] = hash_data(&data_slice[i_step], info->chunk_stride);
+    const size_t stride = info->chunk_stride;
+    for (size_t i = i_start; i < i_end; i++) {
+      hash_array[i] = hash_data(&data_slice[i * stride], stride);
     }
   }
   else {
     /* fast-path for bytes */
-    for (size_t i = 0; i < data_slice_len; i++) {
+    for (size_t i = i_start; i < i_end; i++) {
       hash_array[i] = hash_data_single(data_slice[i]);
     }
   }
 }
 
+#  ifdef USE_THREADED_DEDUPLICATE
+typedef struct HashArrayTaskData {
+  const BArrayInfo *info;
+  const uchar *data_slice;
+  size_t hash_array_len;
+  hash_key *hash_array;
+} HashArrayTaskData;
+
+static void hash_array_from_data_task(void *__restrict userdata,
+                                      const int index,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const HashArrayTaskData *task_data = userdata;
+  const size_t i_start = (size_t)index * BCHUNK_HASH_THREADED_GRAIN;
+  const size_t i_end = MIN2(i_start + BCHUNK_HASH_THREADED_GRAIN, task_data->hash_array_len);
+  hash_array_from_data_range(
+      task_data->info, task_data->data_slice, i_start, i_end, task_data->hash_array);
+}
+#  endif
+
+static void hash_array_from_data(const BArrayInfo *info,
+                                 const uchar *data_slice,
+                                 const size_t data_slice_len,
+                                 hash_key *hash_array)
+{
+  BLI_assert((data_slice_len % info->chunk_stride) == 0);
+  const size_t hash_array_len = data_slice_len / info->chunk_stride;
+
+#  ifdef USE_THREADED_DEDUPLICATE
+  if (hash_array_len > BCHUNK_HASH_THREADED_GRAIN) {
+    HashArrayTaskData task_data = {
+        .info = info,
+        .data_slice = data_slice,
+        .hash_array_len = hash_array_len,
+        .hash_array = hash_array,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    BLI_task_parallel_range(0,
+                            (int)((hash_array_len + BCHUNK_HASH_THREADED_GRAIN - 1) /
+                                  BCHUNK_HASH_THREADED_GRAIN),
+                            &task_data,
+                            hash_array_from_data_task,
+                            &settings);
+    return;
+  }
+#  endif
+
+  hash_array_from_data_range(info, data_slice, 0, hash_array_len, hash_array);
+}
+
 /*
  * Similar to hash_array_from_data,
  * but able to step into the next chunk if we run-out of data.
@@ -816,6 +1005,54 @@ static void hash_array_from_cref(const BArrayInfo *info,
   BLI_assert(i == hash_array_len);
 }
 
+static void hash_accum_step_range(hash_key *hash_array,
+                                  const size_t i_start,
+                                  const size_t i_end,
+                                  const size_t hash_offset)
+{
+  for (size_t i = i_start; i < i_end; i++) {
+    hash_array[i] += (hash_array[i + hash_offset]) * ((hash_array[i] & 0xff) + 1);
+  }
+}
+
+#  ifdef USE_THREADED_DEDUPLICATE
+typedef struct HashAccumTaskData {
+  hash_key *hash_array;
+  size_t hash_array_search_len;
+  size_t hash_offset;
+  /**
+   * The first hashes of every block before this step,
+   * since the end of the previous block reads them while they may have been changed already.
+   */
+  const hash_key *block_start_hashes;
+} HashAccumTaskData;
+
+static void hash_accum_step_task(void *__restrict userdata,
+                                 const int index,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const HashAccumTaskData *task_data = userdata;
+  hash_key *hash_array = task_data->hash_array;
+  const size_t hash_offset = task_data->hash_offset;
+  const size_t i_start = (size_t)index * BCHUNK_HASH_THREADED_GRAIN;
+  const size_t i_end = MIN2(i_start + BCHUNK_HASH_THREADED_GRAIN,
+                            task_data->hash_array_search_len);
+  if (i_end == task_data->hash_array_search_len) {
+    /* The last block only reads from the hashes after the search range, which don't change. */
+    hash_accum_step_range(hash_array, i_start, i_end, hash_offset);
+    return;
+  }
+
+  const size_t i_end_inner = i_end - hash_offset;
+  hash_accum_step_range(hash_array, i_start, i_end_inner, hash_offset);
+  const hash_key *next_block_start = &task_data->block_start_hashes[(size_t)(index + 1) *
+                                                                    hash_offset];
+  for (size_t i = i_end_inner; i < i_end; i++) {
+    hash_array[i] += (next_block_start[i - i_end_inner]) * ((hash_array[i] & 0xff) + 1);
+  }
+}
+#  endif
+
 static void hash_accum(hash_key *hash_array, const size_t hash_array_len, size_t iter_steps)
 {
   /* _very_ unlikely, can happen if you select a chunk-size of 1 for example. */
@@ -824,11 +1061,44 @@ static void hash_accum(hash_key *hash_array, const size_t hash_array_len, size_t
   }
 
   const size_t hash_array_search_len = hash_array_len - iter_steps;
+
+#  ifdef USE_THREADED_DEDUPLICATE
+  if (hash_array_search_len > BCHUNK_HASH_THREADED_GRAIN) {
+    /* Split the array into blocks that are accumulated in-place, like the single threaded loop.
+     * Only the few hashes at the end of each block read from the next block. */
+    const size_t blocks_len = (hash_array_search_len + BCHUNK_HASH_THREADED_GRAIN - 1) /
+                              BCHUNK_HASH_THREADED_GRAIN;
+    hash_key *block_start_hashes = MEM_mallocN(sizeof(*block_start_hashes) * blocks_len *
+                                                   iter_steps,
+                                               __func__);
+    HashAccumTaskData task_data = {
+        .hash_array = hash_array,
+        .hash_array_search_len = hash_array_search_len,
+        .block_start_hashes = block_start_hashes,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+
+    while (iter_steps != 0) {
+      const size_t hash_offset = iter_steps;
+      for (size_t block = 1; block < blocks_len; block++) {
+        memcpy(&block_start_hashes[block * hash_offset],
+               &hash_array[block * BCHUNK_HASH_THREADED_GRAIN],
+               sizeof(*hash_array) * hash_offset);
+      }
+      task_data.hash_offset = hash_offset;
+      BLI_task_parallel_range(0, (int)blocks_len, &task_data, hash_accum_step_task, &settings);
+      iter_steps -= 1;
+    }
+
+    MEM_freeN(block_start_hashes);
+    return;
+  }
+#  endif
+
   while (iter_steps != 0) {
     const size_t hash_offset = iter_steps;
-    for (uint i = 0; i < hash_array_search_len; i++) {
-      hash_array[i] += (hash_array[i + hash_offset]) * ((hash_array[i] & 0xff) + 1);
-    }
+    hash_accum_step_range(hash_array, 0, hash_array_search_len, hash_offset);
     iter_steps -= 1;
   }
 }
@@ -1045,6 +1315,31 @@ static BChunkList *bchunk_list_from_data_merge(const BArrayInfo *info,
     bool full_match = true;
 
     const BChunkRef *cref = chunk_list_reference->chunk_refs.first;
+
+#  ifdef USE_THREADED_DEDUPLICATE
+    if (data_len_original >= BCHUNK_COMPARE_THREADED_BYTES_MIN) {
+      bool *is_match;
+      const uint compared_len = bchunk_list_compare_threaded(cref,
+                                                             NULL,
+                                                             false,
+                                                             true,
+                                                             chunk_list_reference->chunk_refs_len,
+                                                             data,
+                                                             data_len_original,
+                                                             0,
+                                                             &is_match);
+      for (uint i = 0; (i < compared_len) && is_match[i]; i++) {
+        cref_match_first = cref;
+        chunk_list_reference_skip_len += 1;
+        chunk_list_reference_skip_bytes += cref->link->data_len;
+        i_prev += cref->link->data_len;
+        cref = cref->next;
+      }
+      MEM_freeN(is_match);
+      /* The loop below continues after the last match. */
+    }
+#  endif
+
     while (i_prev < data_len_original) {
       if (cref != NULL && bchunk_data_compare(cref->link, data, data_len_original, i_prev)) {
         cref_match_first = cref;
@@ -1119,6 +1414,30 @@ static BChunkList *bchunk_list_from_data_merge(const BArrayInfo *info,
 #ifdef USE_FASTPATH_CHUNKS_LAST
   if (!BLI_listbase_is_empty(&chunk_list_reference->chunk_refs)) {
     const BChunkRef *cref = chunk_list_reference->chunk_refs.last;
+
+#  ifdef USE_THREADED_DEDUPLICATE
+    if (data_len - i_prev >= BCHUNK_COMPARE_THREADED_BYTES_MIN) {
+      bool *is_match;
+      const uint compared_len = bchunk_list_compare_threaded(cref,
+                                                             cref_match_first,
+                                                             true,
+                                                             true,
+                                                             chunk_list_reference->chunk_refs_len,
+                                                             data,
+                                                             data_len,
+                                                             i_prev,
+                                                             &is_match);
+      for (uint i = 0; (i < compared_len) && is_match[i]; i++) {
+        data_len -= cref->link->data_len;
+        chunk_list_reference_last = cref;
+        chunk_list_reference_skip_len += 1;
+        chunk_list_reference_skip_bytes += cref->link->data_len;
+        cref = cref->prev;
+      }
+      MEM_freeN(is_match);
+    }
+#  endif
+
     while ((cref->prev != NULL) && (cref != cref_match_first) &&
            (cref->link->data_len <= data_len - i_prev)) {
       BChunk *chunk_test = cref->link;
@@ -1168,12 +1487,41 @@ static BChunkList *bchunk_list_from_data_merge(const BArrayInfo *info,
     /* Copy matching chunks, creates using the same 'layout' as the reference */
     const BChunkRef *cref = cref_match_first ? cref_match_first->next :
                                                chunk_list_reference->chunk_refs.first;
+
+#ifdef USE_THREADED_DEDUPLICATE
+    /* The positions of all chunks are known, so they can be compared up-front. */
+    bool *cref_is_match = NULL;
+    uint cref_is_match_len = 0, cref_index = 0;
+    if (data_len - i_prev >= BCHUNK_COMPARE_THREADED_BYTES_MIN) {
+      cref_is_match_len = bchunk_list_compare_threaded(cref,
+                                                       chunk_list_reference_last,
+                                                       false,
+                                                       false,
+                                                       chunk_list_reference->chunk_refs_len,
+                                                       data,
+                                                       data_len,
+                                                       i_prev,
+                                                       &cref_is_match);
+    }
+#endif
+
     while (i_prev != data_len) {
       const size_t i = i_prev + cref->link->data_len;
       BLI_assert(i != i_prev);
 
-      if ((cref != chunk_list_reference_last) &&
-          bchunk_data_compare(cref->link, data, data_len, i_prev)) {
+      bool is_match;
+#ifdef USE_THREADED_DEDUPLICATE
+      if (cref_index < cref_is_match_len) {
+        is_match = cref_is_match[cref_index++];
+      }
+      else
+#endif
+      {
+        is_match = (cref != chunk_list_reference_last) &&
+                   bchunk_data_compare(cref->link, data, data_len, i_prev);
+      }
+
+      if (is_match) {
         bchunk_list_append(info, bs_mem, chunk_list, cref->link);
         ASSERT_CHUNKLIST_SIZE(chunk_list, i);
         ASSERT_CHUNKLIST_DATA(chunk_list, data);
@@ -1188,6 +1536,10 @@ static BChunkList *bchunk_list_from_data_merge(const BArrayInfo *info,
 
       i_prev = i;
     }
+
+#ifdef USE_THREADED_DEDUPLICATE
+    MEM_SAFE_FREE(cref_is_match);
+#endif
   }
   else if ((data_len - i_prev >= info->chunk_byte_size) &&
            (chunk_list_reference->chunk_refs_len >= chunk_list_reference_skip_len) &&
@@ -22,6 +22,7 @@
 
 #include "BLI_kdtree_impl.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_strict_flags.h"
 #include "BLI_utildefines.h"
 
@@ -58,6 +59,16 @@ struct KDTree {
 
 #define KD_NODE_UNSET ((uint)-1)
 
+/** Balance sub-trees with fewer nodes than this on a single thread. */
+#define KD_BALANCE_THREAD_MIN 10000
+/** Split the tree into up to `2 ^ KD_BALANCE_THREAD_DEPTH` sub-trees balanced in parallel. */
+#define KD_BALANCE_THREAD_DEPTH 6
+
+/** Run batched queries with fewer points than this on a single thread, in the given order. */
+#define KD_BATCH_THREAD_MIN 1024
+/** Number of bits per dimension of the Morton codes used to order batched queries. */
+#define KD_BATCH_MORTON_BITS (30 / KD_DIMS)
+
 /**
  * When set we know all values are unbalanced,
  * otherwise clear them when re-balancing: see T62210.
@@ -145,19 +156,24 @@ void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS])
 #endif
 }
 
-static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+/**
+ * The root of a sub-tree only depends on its position and size,
+ * so it's known before the sub-tree is balanced.
+ */
+static uint kdtree_balance_root(const uint nodes_len, const uint ofs)
+{
+  return (nodes_len == 0) ? KD_NODE_UNSET : (nodes_len / 2) + ofs;
+}
+
+/**
+ * Order \a nodes so the median along \a axis is at the middle,
+ * with smaller coordinates before and larger ones after it.
+ */
+static uint kdtree_median_partition(KDTreeNode *nodes, uint nodes_len, uint axis)
 {
-  KDTreeNode *node;
   float co;
   uint left, right, median, i, j;
 
-  if (nodes_len <= 0) {
-    return KD_NODE_UNSET;
-  }
-  else if (nodes_len == 1) {
-    return 0 + ofs;
-  }
-
   /* quicksort style sorting around median */
   left = 0;
   right = nodes_len - 1;
@@ -190,6 +206,23 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
     }
   }
 
+  return median;
+}
+
+static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
+{
+  KDTreeNode *node;
+  uint median;
+
+  if (nodes_len <= 0) {
+    return KD_NODE_UNSET;
+  }
+  else if (nodes_len == 1) {
+    return 0 + ofs;
+  }
+
+  median = kdtree_median_partition(nodes, nodes_len, axis);
+
   /* set node and sort subnodes */
   node = &nodes[median];
   node->d = axis;
@@ -201,6 +234,59 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
   return median + ofs;
 }
 
+typedef struct KDTreeBalanceTask {
+  KDTreeNode *nodes;
+  uint nodes_len;
+  uint axis;
+  uint ofs;
+} KDTreeBalanceTask;
+
+/**
+ * Balance the top levels of the tree, collecting the sub-trees below them in \a tasks,
+ * so they can be balanced independently.
+ */
+static uint kdtree_balance_split(KDTreeNode *nodes,
+                                 uint nodes_len,
+                                 uint axis,
+                                 const uint ofs,
+                                 const uint depth,
+                                 KDTreeBalanceTask *tasks,
+                                 uint *tasks_len)
+{
+  if (depth == 0 || nodes_len < KD_BALANCE_THREAD_MIN) {
+    tasks[(*tasks_len)++] = (KDTreeBalanceTask){nodes, nodes_len, axis, ofs};
+    return kdtree_balance_root(nodes_len, ofs);
+  }
+
+  const uint median = kdtree_median_partition(nodes, nodes_len, axis);
+  BLI_assert(median + ofs == kdtree_balance_root(nodes_len, ofs));
+
+  KDTreeNode *node = &nodes[median];
+  node->d = axis;
+  axis = (axis + 1) % KD_DIMS;
+  node->left = kdtree_balance_split(nodes, median, axis, ofs, depth - 1, tasks, tasks_len);
+  node->right = kdtree_balance_split(nodes + median + 1,
+                                     (nodes_len - (median + 1)),
+                                     axis,
+                                     (median + 1) + ofs,
+                                     depth - 1,
+                                     tasks,
+                                     tasks_len);
+
+  return median + ofs;
+}
+
+static void kdtree_balance_task_cb(void *__restrict userdata,
+                                   const int i,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBalanceTask *task = &((const KDTreeBalanceTask *)userdata)[i];
+  kdtree_balance(task->nodes, task->nodes_len, task->axis, task->ofs);
+}
+
+/**
+ * Balancing sorts the nodes, large trees are split into sub-trees which are balanced in parallel.
+ */
 void BLI_kdtree_nd_(balance)(KDTree *tree)
 {
   if (tree->root != KD_NODE_ROOT_IS_INIT) {
@@ -210,7 +296,20 @@ void BLI_kdtree_nd_(balance)(KDTree *tree)
     }
   }
 
-  tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  if (tree->nodes_len < KD_BALANCE_THREAD_MIN) {
+    tree->root = kdtree_balance(tree->nodes, tree->nodes_len, 0, 0);
+  }
+  else {
+    KDTreeBalanceTask tasks[1 << KD_BALANCE_THREAD_DEPTH];
+    uint tasks_len = 0;
+    tree->root = kdtree_balance_split(
+        tree->nodes, tree->nodes_len, 0, 0, KD_BALANCE_THREAD_DEPTH, tasks, &tasks_len);
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(0, (int)tasks_len, tasks, kdtree_balance_task_cb, &settings);
+  }
 
 #ifdef DEBUG
   tree->is_balanced = true;
@@ -806,6 +905,229 @@ finally:
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Batched Queries
+ *
+ * Answer queries for many points at once, in parallel. Large batches are processed in the order
+ * of the Morton codes of the query points, so that queries running one after another on the same
+ * thread are close to each other and visit mostly the same nodes of the tree.
+ * Results are always written at the position of the query point.
+ * \{ */
+
+typedef struct KDTreeMortonCode {
+  uint code;
+  uint index;
+} KDTreeMortonCode;
+
+static int kdtree_morton_code_cmp(const void *a_p, const void *b_p)
+{
+  const KDTreeMortonCode *a = a_p;
+  const KDTreeMortonCode *b = b_p;
+  if (a->code < b->code) {
+    return -1;
+  }
+  if (a->code > b->code) {
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * \return The order to process the query points in, or NULL to use their own order.
+ */
+static uint *kdtree_batch_order(const float (*co)[KD_DIMS], const uint co_len)
+{
+  if (co_len < KD_BATCH_THREAD_MIN) {
+    return NULL;
+  }
+
+  float min[KD_DIMS], scale[KD_DIMS];
+  {
+    float max[KD_DIMS];
+    copy_vn_vn(min, co[0]);
+    copy_vn_vn(max, co[0]);
+    for (uint i = 1; i < co_len; i++) {
+      for (uint j = 0; j < KD_DIMS; j++) {
+        min[j] = min_ff(min[j], co[i][j]);
+        max[j] = max_ff(max[j], co[i][j]);
+      }
+    }
+    for (uint j = 0; j < KD_DIMS; j++) {
+      const float range = max[j] - min[j];
+      scale[j] = (range > 0.0f) ? (float)((1u << KD_BATCH_MORTON_BITS) - 1) / range : 0.0f;
+    }
+  }
+
+  KDTreeMortonCode *codes = MEM_mallocN(sizeof(*codes) * co_len, __func__);
+  for (uint i = 0; i < co_len; i++) {
+    uint quantized[KD_DIMS];
+    for (uint j = 0; j < KD_DIMS; j++) {
+      quantized[j] = (uint)((co[i][j] - min[j]) * scale[j]);
+    }
+    /* Interleave the bits of all dimensions. */
+    uint code = 0;
+    for (int bit = KD_BATCH_MORTON_BITS - 1; bit >= 0; bit--) {
+      for (uint j = 0; j < KD_DIMS; j++) {
+        code = (code << 1) | ((quantized[j] >> bit) & 1u);
+      }
+    }
+    codes[i].code = code;
+    codes[i].index = i;
+  }
+
+  qsort(codes, (size_t)co_len, sizeof(*codes), kdtree_morton_code_cmp);
+
+  uint *order = MEM_mallocN(sizeof(*order) * co_len, __func__);
+  for (uint i = 0; i < co_len; i++) {
+    order[i] = codes[i].index;
+  }
+  MEM_freeN(codes);
+  return order;
+}
+
+typedef struct KDTreeBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+  const uint *order;
+
+  /* Find nearest. */
+  int *r_index;
+
+  /* Find nearest N and range search. */
+  KDTreeNearest *r_nearest;
+  KDTreeNearest **r_nearest_arrays;
+  int *r_nearest_len;
+  uint nearest_len_capacity;
+  float range;
+} KDTreeBatchData;
+
+static void kdtree_batch_run(KDTreeBatchData *data, const uint co_len, TaskParallelRangeFunc func)
+{
+  data->order = kdtree_batch_order(data->co, co_len);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (co_len >= KD_BATCH_THREAD_MIN);
+  /* Keep ranges of consecutive queries together. */
+  settings.min_iter_per_thread = KD_BATCH_THREAD_MIN / 4;
+  BLI_task_parallel_range(0, (int)co_len, data, func, &settings);
+
+  if (data->order) {
+    MEM_freeN((void *)data->order);
+  }
+}
+
+BLI_INLINE uint kdtree_batch_index(const KDTreeBatchData *data, const int i)
+{
+  return data->order ? data->order[i] : (uint)i;
+}
+
+static void kdtree_find_nearest_batch_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  const uint q = kdtree_batch_index(data, i);
+  const int index = BLI_kdtree_nd_(find_nearest)(
+      data->tree, data->co[q], data->r_nearest ? &data->r_nearest[q] : NULL);
+  if (data->r_index) {
+    data->r_index[q] = index;
+  }
+}
+
+/**
+ * Find the nearest point for every point in \a co.
+ *
+ * \param r_index: Optional array of \a co_len, set to the index of the nearest point
+ * or -1 when the tree is empty.
+ * \param r_nearest: Optional array of \a co_len, left unchanged when the tree is empty.
+ */
+void BLI_kdtree_nd_(find_nearest_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        const uint co_len,
+                                        int *r_index,
+                                        KDTreeNearest *r_nearest)
+{
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .r_index = r_index,
+      .r_nearest = r_nearest,
+  };
+  kdtree_batch_run(&data, co_len, kdtree_find_nearest_batch_cb);
+}
+
+static void kdtree_find_nearest_n_batch_cb(void *__restrict userdata,
+                                           const int i,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  const uint q = kdtree_batch_index(data, i);
+  KDTreeNearest *r_nearest = &data->r_nearest[q * data->nearest_len_capacity];
+  data->r_nearest_len[q] = BLI_kdtree_nd_(find_nearest_n)(
+      data->tree, data->co[q], r_nearest, data->nearest_len_capacity);
+}
+
+/**
+ * Find the \a nearest_len_capacity nearest points for every point in \a co.
+ *
+ * \param r_nearest: An array of `co_len * nearest_len_capacity`, the nearest points of the
+ * query point `i` start at `i * nearest_len_capacity`.
+ * \param r_nearest_len: An array of \a co_len, set to the number of points found.
+ */
+void BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                          const float (*co)[KD_DIMS],
+                                          const uint co_len,
+                                          KDTreeNearest *r_nearest,
+                                          const uint nearest_len_capacity,
+                                          int *r_nearest_len)
+{
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .r_nearest = r_nearest,
+      .r_nearest_len = r_nearest_len,
+      .nearest_len_capacity = nearest_len_capacity,
+  };
+  kdtree_batch_run(&data, co_len, kdtree_find_nearest_n_batch_cb);
+}
+
+static void kdtree_range_search_batch_cb(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  const uint q = kdtree_batch_index(data, i);
+  data->r_nearest_len[q] = BLI_kdtree_nd_(range_search)(
+      data->tree, data->co[q], &data->r_nearest_arrays[q], data->range);
+}
+
+/**
+ * Range search for every point in \a co.
+ *
+ * \param r_nearest: An array of \a co_len, set to the points found for every query point,
+ * sorted by distance. Every array has to be freed by the caller, they may be NULL.
+ * \param r_nearest_len: An array of \a co_len, set to the number of points found.
+ */
+void BLI_kdtree_nd_(range_search_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        const uint co_len,
+                                        const float range,
+                                        KDTreeNearest **r_nearest,
+                                        int *r_nearest_len)
+{
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .r_nearest_arrays = r_nearest,
+      .r_nearest_len = r_nearest_len,
+      .range = range,
+  };
+  kdtree_batch_run(&data, co_len, kdtree_range_search_batch_cb);
+}
+
+/** \} */
+
 /**
  * Use when we want to loop over nodes ordered by index.
  * Requires indices to be aligned with nodes.
@@ -883,6 +1205,8 @@ static void deduplicate_recursive(const struct DeDuplicateParams *p, uint i)
  * \returns The number of merges found (includes any merges already in the \a duplicates array).
  *
  * \note Merging is always a single step (target indices wont be marked for merging).
+ * \note Whether a point is merged depends on the merges found before it, so unlike the batched
+ * searches this runs on a single thread.
  */
 int BLI_kdtree_nd_(calc_duplicates_fast)(const KDTree *tree,
                                          const float range,
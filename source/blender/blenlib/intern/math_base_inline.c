@@ -762,6 +762,72 @@ MALWAYS_INLINE __m128 _bli_math_blend_sse(const __m128 mask, const __m128 a, con
   return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
 }
 
+/* Calculate floorf(x), for values which fit in a 32 bit integer. */
+MALWAYS_INLINE __m128 _bli_math_floor_sse(const __m128 x)
+{
+  const __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+  /* Truncation rounds towards zero, step down for negative values with a fraction. */
+  return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.0f)));
+}
+
+/* Calculate sinf(x), using the range reduction and polynomials of the Cephes library.
+ * Error is within a few ULP of sinf for |x| < 8192. */
+MALWAYS_INLINE __m128 _bli_math_sin_sse(const __m128 arg)
+{
+  const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+  __m128 sign = _mm_and_ps(arg, sign_mask);
+  __m128 x = _mm_andnot_ps(sign_mask, arg);
+
+  /* Octant of the argument, rounded up to an even number. */
+  __m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f /* 4/pi */)));
+  octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+  const __m128 y = _mm_cvtepi32_ps(octant);
+
+  /* Octants 4 to 7 flip the sign, octants 2, 3, 6 and 7 use the cosine polynomial. */
+  sign = _mm_xor_ps(
+      sign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29)));
+  const __m128 use_sin = _mm_castsi128_ps(
+      _mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+  /* Extended precision modular arithmetic: x - y * pi/4. */
+  x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+  const __m128 z = _mm_mul_ps(x, x);
+
+  __m128 cos_poly = _mm_set1_ps(2.443315711809948e-5f);
+  cos_poly = _mm_add_ps(_mm_mul_ps(cos_poly, z), _mm_set1_ps(-1.388731625493765e-3f));
+  cos_poly = _mm_add_ps(_mm_mul_ps(cos_poly, z), _mm_set1_ps(4.166664568298827e-2f));
+  cos_poly = _mm_mul_ps(_mm_mul_ps(cos_poly, z), z);
+  cos_poly = _mm_sub_ps(cos_poly, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+  cos_poly = _mm_add_ps(cos_poly, _mm_set1_ps(1.0f));
+
+  __m128 sin_poly = _mm_set1_ps(-1.9515295891e-4f);
+  sin_poly = _mm_add_ps(_mm_mul_ps(sin_poly, z), _mm_set1_ps(8.3321608736e-3f));
+  sin_poly = _mm_add_ps(_mm_mul_ps(sin_poly, z), _mm_set1_ps(-1.6666654611e-1f));
+  sin_poly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sin_poly, z), x), x);
+
+  return _mm_xor_ps(_bli_math_blend_sse(use_sin, sin_poly, cos_poly), sign);
+}
+
+/* Vectorized #unit_float_to_uchar_clamp, giving the same result in each 32 bit lane. */
+MALWAYS_INLINE __m128i _bli_math_unit_float_to_uchar_clamp_sse(const __m128 val)
+{
+  const __m128 clamped = _mm_min_ps(_mm_max_ps(val, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  const __m128i result = _mm_cvttps_epi32(
+      _mm_add_ps(_mm_mul_ps(_mm_set1_ps(255.0f), clamped), _mm_set1_ps(0.5f)));
+  const __m128i saturate = _mm_castps_si128(
+      _mm_cmpgt_ps(val, _mm_set1_ps(1.0f - 0.5f / 255.0f)));
+  return _mm_or_si128(result, _mm_and_si128(saturate, _mm_set1_epi32(255)));
+}
+
+/* Vectorized #unit_ushort_to_uchar for values in 32 bit lanes. Lanes can hold 256 for the
+ * largest inputs, which is expected to be saturated when packing to bytes. */
+MALWAYS_INLINE __m128i _bli_math_unit_ushort_to_uchar_sse(const __m128i val)
+{
+  return _mm_srli_epi32(_mm_add_epi32(val, _mm_set1_epi32(128)), 8);
+}
+
 #endif /* __SSE2__ */
 
 /* Low level conversion functions */
@@ -0,0 +1,253 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Every thread records its zones in its own ring buffer, so recording doesn't need locks. When
+ * a buffer is full, the oldest zones are overwritten. Buffers are created when a thread records
+ * its first zone and are kept until the program exits, because threads keep a pointer to them.
+ *
+ * A thread marks its buffer while it records a zone. Buffers are only read or reset after the
+ * capture flag was cleared and all marked buffers were released, so zones still being recorded
+ * by other threads finish before the buffers are used.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "BLI_profile.hh"
+#include "BLI_utildefines.h"
+#include "BLI_vector.hh"
+
+namespace blender::profile {
+
+struct RecordedZone {
+  const char *name;
+  uint64_t start;
+  uint64_t end;
+};
+
+/** Number of zones per thread that are kept, must be a power of two. */
+static constexpr uint64_t thread_buffer_size = 1 << 16;
+
+struct ThreadBuffer {
+  int thread_id;
+  /**
+   * Number of zones written since the capture began. Incremented by the owning thread while
+   * recording, reset by #BLI_profile_capture_begin while no zone is being recorded.
+   */
+  std::atomic<uint64_t> written = 0;
+  /** Set by the owning thread while it records a zone into the buffer. */
+  std::atomic<bool> is_recording = false;
+  RecordedZone zones[thread_buffer_size];
+};
+
+struct Profiler {
+  std::atomic<bool> is_capturing = false;
+  uint64_t capture_start = 0;
+  std::string filepath;
+
+  std::mutex mutex;
+  Vector<std::unique_ptr<ThreadBuffer>> thread_buffers;
+};
+
+static Profiler &get_profiler()
+{
+  static Profiler profiler;
+  return profiler;
+}
+
+static uint64_t get_time_ns()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static ThreadBuffer &get_thread_buffer()
+{
+  static thread_local ThreadBuffer *buffer = nullptr;
+  if (buffer == nullptr) {
+    Profiler &profiler = get_profiler();
+    std::lock_guard lock{profiler.mutex};
+    std::unique_ptr<ThreadBuffer> new_buffer = std::make_unique<ThreadBuffer>();
+    new_buffer->thread_id = (int)profiler.thread_buffers.size();
+    buffer = new_buffer.get();
+    profiler.thread_buffers.append(std::move(new_buffer));
+  }
+  return *buffer;
+}
+
+/**
+ * Stop the capture and wait until no thread is recording into its buffer anymore, after which
+ * the buffers can be used without races. Returns whether the capture was running.
+ * The profiler mutex must be held, so no buffers are added meanwhile.
+ */
+static bool capture_stop_and_wait(Profiler &profiler)
+{
+  const bool was_capturing = profiler.is_capturing.exchange(false);
+  for (const std::unique_ptr<ThreadBuffer> &buffer : profiler.thread_buffers) {
+    while (buffer->is_recording.load()) {
+      std::this_thread::yield();
+    }
+  }
+  return was_capturing;
+}
+
+static void write_json_string(std::ostream &stream, const char *str)
+{
+  stream << '"';
+  for (const char *c = str; *c; c++) {
+    if (ELEM(*c, '"', '\\')) {
+      stream << '\\' << *c;
+    }
+    else if ((unsigned char)*c < 0x20) {
+      stream << ' ';
+    }
+    else {
+      stream << *c;
+    }
+  }
+  stream << '"';
+}
+
+void write_chrome_trace(std::ostream &stream)
+{
+  Profiler &profiler = get_profiler();
+  std::lock_guard lock{profiler.mutex};
+
+  /* Pause a running capture while the buffers are read. */
+  const bool was_capturing = capture_stop_and_wait(profiler);
+
+  /* Times are in microseconds. */
+  const uint64_t capture_start = profiler.capture_start;
+  stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool is_first = true;
+  for (const std::unique_ptr<ThreadBuffer> &buffer : profiler.thread_buffers) {
+    const uint64_t written = buffer->written.load(std::memory_order_acquire);
+    const uint64_t first = (written > thread_buffer_size) ? written - thread_buffer_size : 0;
+    for (uint64_t i = first; i < written; i++) {
+      const RecordedZone &zone = buffer->zones[i & (thread_buffer_size - 1)];
+      /* A zone that began during an earlier capture and ended during this one is clamped to the
+       * start of the capture, the times are unsigned. */
+      const uint64_t start = std::max(zone.start, capture_start);
+      const uint64_t end = std::max(zone.end, start);
+      if (!is_first) {
+        stream << ",\n";
+      }
+      is_first = false;
+      stream << "{\"name\":";
+      write_json_string(stream, zone.name);
+      stream << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->thread_id
+             << ",\"ts\":" << (start - capture_start) / 1000.0
+             << ",\"dur\":" << (end - start) / 1000.0 << "}";
+    }
+  }
+  stream << "\n]}\n";
+
+  if (was_capturing) {
+    profiler.is_capturing.store(true);
+  }
+}
+
+}  // namespace blender::profile
+
+using namespace blender::profile;
+
+void BLI_profile_zone_begin(ProfileZone *zone, const char *name)
+{
+  zone->name = name;
+  zone->start = get_profiler().is_capturing.load(std::memory_order_relaxed) ? get_time_ns() :
+                                                                              UINT64_MAX;
+}
+
+void BLI_profile_zone_end(ProfileZone *zone)
+{
+  if (zone->start == UINT64_MAX) {
+    return;
+  }
+  if (!get_profiler().is_capturing.load(std::memory_order_relaxed)) {
+    return;
+  }
+  ThreadBuffer &buffer = get_thread_buffer();
+  /* Mark the buffer before checking the capture again, pairs with #capture_stop_and_wait:
+   * either the buffer is waited for, or zones ending after the capture are dropped. */
+  buffer.is_recording.store(true);
+  if (get_profiler().is_capturing.load()) {
+    const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    buffer.zones[index & (thread_buffer_size - 1)] = {zone->name, zone->start, get_time_ns()};
+    buffer.written.store(index + 1, std::memory_order_relaxed);
+  }
+  buffer.is_recording.store(false, std::memory_order_release);
+}
+
+/**
+ * Zones that are recorded by other threads while the capture begins may be lost or kept.
+ */
+void BLI_profile_capture_begin(const char *filepath)
+{
+  Profiler &profiler = get_profiler();
+  {
+    std::lock_guard lock{profiler.mutex};
+    capture_stop_and_wait(profiler);
+    for (std::unique_ptr<ThreadBuffer> &buffer : profiler.thread_buffers) {
+      buffer->written.store(0, std::memory_order_relaxed);
+    }
+    profiler.capture_start = get_time_ns();
+    profiler.filepath = filepath ? filepath : "";
+  }
+  profiler.is_capturing.store(true);
+}
+
+bool BLI_profile_capture_end(void)
+{
+  Profiler &profiler = get_profiler();
+  std::string filepath;
+  {
+    std::lock_guard lock{profiler.mutex};
+    if (!capture_stop_and_wait(profiler)) {
+      return true;
+    }
+    filepath = std::move(profiler.filepath);
+    profiler.filepath.clear();
+  }
+  if (filepath.empty()) {
+    return true;
+  }
+  return BLI_profile_write_chrome_trace(filepath.c_str());
+}
+
+bool BLI_profile_is_capturing(void)
+{
+  return get_profiler().is_capturing.load(std::memory_order_relaxed);
+}
+
+bool BLI_profile_write_chrome_trace(const char *filepath)
+{
+  std::ofstream stream(filepath);
+  if (!stream) {
+    return false;
+  }
+  write_chrome_trace(stream);
+  return bool(stream);
+}
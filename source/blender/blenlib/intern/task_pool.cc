@@ -322,6 +322,14 @@ static void background_task_pool_run(TaskPool *pool, Task &&task)
   }
 }
 
+/* The queue stays in no-wait mode once the thread is told to stop, in which case a new thread
+ * would stop as soon as it ran out of tasks. Use a new queue, so the pool can be used again. */
+static void background_task_pool_queue_reset(TaskPool *pool)
+{
+  BLI_thread_queue_free(pool->background_queue);
+  pool->background_queue = BLI_thread_queue_init();
+}
+
 static void background_task_pool_work_and_wait(TaskPool *pool)
 {
   /* Signal background thread to stop waiting for new tasks if none are
@@ -329,6 +337,8 @@ static void background_task_pool_work_and_wait(TaskPool *pool)
   BLI_thread_queue_nowait(pool->background_queue);
   BLI_thread_queue_wait_finish(pool->background_queue);
   BLI_threadpool_clear(&pool->background_threads);
+
+  background_task_pool_queue_reset(pool);
 }
 
 static void background_task_pool_cancel(TaskPool *pool)
@@ -345,6 +355,8 @@ static void background_task_pool_cancel(TaskPool *pool)
   /* Let background thread finish or cancel task it is working on. */
   BLI_threadpool_remove(&pool->background_threads, pool);
   pool->background_is_canceling = false;
+
+  background_task_pool_queue_reset(pool);
 }
 
 static bool background_task_pool_canceled(TaskPool *pool)
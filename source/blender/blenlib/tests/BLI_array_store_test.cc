@@ -712,6 +712,59 @@ TEST(array_store, TestData_Stride32_Chunk64_Mutate8)
   random_data_mutate_helper(0, 256, 200, 32, 64, 7117, 8);
 }
 
+/* Large enough to hash and compare chunks using multiple threads. */
+TEST(array_store, TestData_Stride12_Chunk256_Mutate8_Large)
+{
+  random_data_mutate_helper(100000, 120000, 8, 12, 256, 4242, 8);
+}
+
+TEST(array_store, LargeShiftedData)
+{
+  /* Removing items in two places shifts the data between them,
+   * which can only be de-duplicated by looking up the hashes of all items. */
+  const size_t stride = 12;
+  const size_t items_len = 600000;
+  const size_t data_len = items_len * stride;
+  char *data = (char *)MEM_mallocN(data_len, __func__);
+  char *data_shifted = (char *)MEM_mallocN(data_len, __func__);
+  RNG *rng = BLI_rng_new(1);
+  BLI_rng_get_char_n(rng, data, data_len);
+  BLI_rng_free(rng);
+
+  const size_t remove_a = (items_len / 3) * stride, remove_a_len = 101 * stride;
+  const size_t remove_b = (items_len / 3) * 2 * stride, remove_b_len = 37 * stride;
+  size_t data_shifted_len = 0;
+  memcpy(&data_shifted[data_shifted_len], data, remove_a);
+  data_shifted_len += remove_a;
+  memcpy(&data_shifted[data_shifted_len],
+         &data[remove_a + remove_a_len],
+         remove_b - (remove_a + remove_a_len));
+  data_shifted_len += remove_b - (remove_a + remove_a_len);
+  memcpy(&data_shifted[data_shifted_len],
+         &data[remove_b + remove_b_len],
+         data_len - (remove_b + remove_b_len));
+  data_shifted_len += data_len - (remove_b + remove_b_len);
+
+  BArrayStore *bs = BLI_array_store_create(stride, 256);
+  BArrayState *state = BLI_array_store_state_add(bs, data, data_len, nullptr);
+  BArrayState *state_shifted = BLI_array_store_state_add(
+      bs, data_shifted, data_shifted_len, state);
+  EXPECT_TRUE(BLI_array_store_is_valid(bs));
+
+  size_t state_data_len;
+  char *state_data = (char *)BLI_array_store_state_data_get_alloc(state_shifted, &state_data_len);
+  EXPECT_EQ(state_data_len, data_shifted_len);
+  EXPECT_EQ(memcmp(state_data, data_shifted, data_shifted_len), 0);
+  MEM_freeN(state_data);
+
+  /* Only the chunks around the removed items are new. */
+  EXPECT_LT(BLI_array_store_calc_size_compacted_get(bs), data_len + data_len / 50);
+
+  BLI_array_store_destroy(bs);
+  MEM_freeN(data);
+  MEM_freeN(data_shifted);
+}
+
 /* -------------------------------------------------------------------- */
 /* Randomized Chunks Test */
 
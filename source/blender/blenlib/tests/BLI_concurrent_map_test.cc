@@ -0,0 +1,100 @@
+/* Apache License, Version 2.0 */
+
+#include <string>
+#include <thread>
+
+#include "BLI_concurrent_map.hh"
+#include "BLI_strict_flags.h"
+#include "BLI_vector.hh"
+#include "testing/testing.h"
+
+namespace blender::tests {
+
+TEST(concurrent_map, DefaultConstructor)
+{
+  ConcurrentMap<int, float> map;
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_TRUE(map.is_empty());
+}
+
+TEST(concurrent_map, AddLookupRemove)
+{
+  ConcurrentMap<int, float> map;
+  EXPECT_TRUE(map.add(2, 5.0f));
+  EXPECT_TRUE(map.add(4, 1.0f));
+  EXPECT_FALSE(map.add(2, 3.0f));
+  EXPECT_EQ(map.size(), 2);
+  EXPECT_TRUE(map.contains(2));
+  EXPECT_FALSE(map.contains(3));
+  EXPECT_EQ(map.lookup_default(2, 0.0f), 5.0f);
+  EXPECT_EQ(map.lookup_default(3, 0.0f), 0.0f);
+
+  EXPECT_FALSE(map.add_overwrite(2, 3.0f));
+  EXPECT_EQ(map.lookup_default(2, 0.0f), 3.0f);
+
+  EXPECT_TRUE(map.remove(2));
+  EXPECT_FALSE(map.remove(2));
+  EXPECT_EQ(map.size(), 1);
+
+  map.clear();
+  EXPECT_TRUE(map.is_empty());
+}
+
+TEST(concurrent_map, StringKeys)
+{
+  ConcurrentMap<std::string, int> map;
+  map.add("a", 1);
+  map.add("b", 2);
+  EXPECT_EQ(map.lookup_or_add_cb("a", []() { return 10; }), 1);
+  EXPECT_EQ(map.lookup_or_add_cb("c", []() { return 10; }), 10);
+  EXPECT_EQ(map.size(), 3);
+}
+
+TEST(concurrent_map, Extract)
+{
+  ConcurrentMap<int, int> map;
+  for (int i = 0; i < 1000; i++) {
+    map.add(i, i * 2);
+  }
+  int sum = 0;
+  map.foreach_item([&](int key, int value) {
+    EXPECT_EQ(value, key * 2);
+    sum += key;
+  });
+  EXPECT_EQ(sum, 999 * 1000 / 2);
+
+  auto extracted = map.extract();
+  EXPECT_TRUE(map.is_empty());
+  EXPECT_EQ(extracted.size(), 1000);
+  EXPECT_EQ(extracted.lookup(500), 1000);
+}
+
+TEST(concurrent_map, ParallelAddOrModify)
+{
+  ConcurrentMap<int, int> map;
+  const int threads_num = 8;
+  const int keys_num = 500;
+  const int iterations = 20;
+
+  Vector<std::thread> threads;
+  for (int thread_index = 0; thread_index < threads_num; thread_index++) {
+    threads.append(std::thread([&]() {
+      for (int iteration = 0; iteration < iterations; iteration++) {
+        for (int key = 0; key < keys_num; key++) {
+          map.add_or_modify(
+              key, [](int *value) { *value = 1; }, [](int *value) { (*value)++; });
+        }
+      }
+    }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(map.size(), keys_num);
+  for (int key = 0; key < keys_num; key++) {
+    EXPECT_EQ(map.lookup_default(key, 0), threads_num * iterations);
+  }
+}
+
+}  // namespace blender::tests
@@ -0,0 +1,63 @@
+/* Apache License, Version 2.0 */
+
+#include <atomic>
+#include <thread>
+
+#include "BLI_concurrent_set.hh"
+#include "BLI_strict_flags.h"
+#include "BLI_vector.hh"
+#include "testing/testing.h"
+
+namespace blender::tests {
+
+TEST(concurrent_set, AddContainsRemove)
+{
+  ConcurrentSet<int> set;
+  EXPECT_TRUE(set.is_empty());
+  EXPECT_TRUE(set.add(5));
+  EXPECT_TRUE(set.add(7));
+  EXPECT_FALSE(set.add(5));
+  EXPECT_EQ(set.size(), 2);
+  EXPECT_TRUE(set.contains(5));
+  EXPECT_FALSE(set.contains(6));
+  EXPECT_TRUE(set.remove(5));
+  EXPECT_FALSE(set.contains(5));
+  EXPECT_EQ(set.size(), 1);
+  set.clear();
+  EXPECT_TRUE(set.is_empty());
+}
+
+TEST(concurrent_set, ParallelAdd)
+{
+  ConcurrentSet<int> set;
+  std::atomic<int> newly_added = 0;
+  const int threads_num = 8;
+  const int keys_num = 10000;
+
+  Vector<std::thread> threads;
+  for (int thread_index = 0; thread_index < threads_num; thread_index++) {
+    threads.append(std::thread([&, thread_index]() {
+      /* Threads add overlapping ranges of keys. */
+      for (int i = 0; i < keys_num; i++) {
+        if (set.add(i + thread_index * keys_num / 2)) {
+          newly_added++;
+        }
+      }
+    }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  const int expected_size = keys_num + (threads_num - 1) * keys_num / 2;
+  EXPECT_EQ(set.size(), expected_size);
+  EXPECT_EQ(newly_added, expected_size);
+
+  Set<int> extracted = set.extract();
+  EXPECT_EQ(extracted.size(), expected_size);
+  for (int i = 0; i < expected_size; i++) {
+    EXPECT_TRUE(extracted.contains(i));
+  }
+}
+
+}  // namespace blender::tests
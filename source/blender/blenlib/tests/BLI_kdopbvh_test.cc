@@ -8,6 +8,7 @@
 
 #include "BLI_compiler_attrs.h"
 #include "BLI_kdopbvh.h"
+#include "BLI_math_geom.h"
 #include "BLI_math_vector.h"
 #include "BLI_rand.h"
 
@@ -66,11 +67,17 @@ static void optimal_check_callback(void *userdata,
  * Note that a small epsilon is added to the BVH nodes bounds, even if we pass in zero.
  * Use rounding to ensure very close nodes don't cause the wrong node to be found as nearest.
  */
-static void find_nearest_points_test(
-    int points_len, float scale, int round, int random_seed, bool optimal = false)
+static void find_nearest_points_test(int points_len,
+                                     float scale,
+                                     int round,
+                                     int random_seed,
+                                     bool optimal = false,
+                                     int tree_type = 8,
+                                     int axis = 8,
+                                     int balance_flag = 0)
 {
   struct RNG *rng = BLI_rng_new(random_seed);
-  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 8, 8);
+  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, tree_type, axis);
 
   void *mem = MEM_mallocN(sizeof(float[3]) * points_len, __func__);
   float(*points)[3] = (float(*)[3])mem;
@@ -79,7 +86,7 @@ static void find_nearest_points_test(
     rng_v3_round(points[i], 3, rng, round, scale);
     BLI_bvhtree_insert(tree, i, points[i], 1);
   }
-  BLI_bvhtree_balance(tree);
+  BLI_bvhtree_balance_ex(tree, balance_flag);
 
   /* first find each point */
   BVHTree_NearestPointCallback callback = optimal ? optimal_check_callback : nullptr;
@@ -132,3 +139,137 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+/* Axis-aligned trees with up to four children use SIMD node tests where supported. */
+TEST(kdopbvh, FindNearestAABB_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, false, 4, 6);
+  find_nearest_points_test(500, 1.0, 1000, 12, false, 2, 6);
+}
+TEST(kdopbvh, FindNearestSAH_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, false, 4, 6, BVH_BALANCE_SAH);
+  find_nearest_points_test(500, 1.0, 1000, 12, false, 8, 8, BVH_BALANCE_SAH);
+}
+TEST(kdopbvh, OptimalFindNearestSAH_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, true, 4, 6, BVH_BALANCE_SAH);
+}
+
+/* -------------------------------------------------------------------- */
+/* Compare Tree Layouts
+ *
+ * Trees using the SAH build and SIMD node tests must give the same results as the default
+ * build of a tree with scalar node tests. */
+
+static void rng_triangles(float (*tris)[3][3], int tris_len, struct RNG *rng)
+{
+  for (int i = 0; i < tris_len; i++) {
+    float center[3];
+    rng_v3_round(center, 3, rng, 1000, 1.0f);
+    for (int j = 0; j < 3; j++) {
+      rng_v3_round(tris[i][j], 3, rng, 1000, 0.05f);
+      add_v3_v3(tris[i][j], center);
+    }
+  }
+}
+
+static BVHTree *bvhtree_from_triangles(
+    const float (*tris)[3][3], int tris_len, int tree_type, int axis, int balance_flag)
+{
+  BVHTree *tree = BLI_bvhtree_new(tris_len, 0.0f, tree_type, axis);
+  for (int i = 0; i < tris_len; i++) {
+    BLI_bvhtree_insert(tree, i, tris[i][0], 3);
+  }
+  BLI_bvhtree_balance_ex(tree, balance_flag);
+  return tree;
+}
+
+static void raycast_triangle_cb(void *userdata,
+                                int index,
+                                const BVHTreeRay *ray,
+                                BVHTreeRayHit *hit)
+{
+  const float(*tris)[3][3] = (const float(*)[3][3])userdata;
+  float dist;
+  if (isect_ray_tri_v3(ray->origin, ray->direction, UNPACK3(tris[index]), &dist, nullptr) &&
+      dist < hit->dist) {
+    hit->index = index;
+    hit->dist = dist;
+  }
+}
+
+static int overlap_pairs_len(BVHTree *tree1, BVHTree *tree2)
+{
+  uint overlap_len = 0;
+  BVHTreeOverlap *overlap = BLI_bvhtree_overlap(tree1, tree2, &overlap_len, nullptr, nullptr);
+  if (overlap) {
+    MEM_freeN(overlap);
+  }
+  return (int)overlap_len;
+}
+
+static void compare_tree_layouts_test(int tris_len, int tree_type, int balance_flag)
+{
+  struct RNG *rng = BLI_rng_new(tris_len);
+  float(*tris)[3][3] = (float(*)[3][3])MEM_mallocN(sizeof(*tris) * tris_len, __func__);
+  float(*tris_other)[3][3] = (float(*)[3][3])MEM_mallocN(sizeof(*tris) * tris_len, __func__);
+  rng_triangles(tris, tris_len, rng);
+  rng_triangles(tris_other, tris_len, rng);
+
+  /* The reference trees use 8 axes, which are always tested with scalar code. */
+  BVHTree *tree_ref = bvhtree_from_triangles(tris, tris_len, tree_type, 8, 0);
+  BVHTree *tree = bvhtree_from_triangles(tris, tris_len, tree_type, 6, balance_flag);
+  BVHTree *tree_other = bvhtree_from_triangles(tris_other, tris_len, tree_type, 6, balance_flag);
+
+  for (int i = 0; i < 200; i++) {
+    float co[3], dir[3];
+    rng_v3_round(co, 3, rng, 1000, 1.5f);
+    BLI_rng_get_float_unit_v3(rng, dir);
+
+    BVHTreeRayHit hit_ref = {-1};
+    BVHTreeRayHit hit = {-1};
+    hit_ref.dist = hit.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(tree_ref, co, dir, 0.0f, &hit_ref, raycast_triangle_cb, tris);
+    BLI_bvhtree_ray_cast(tree, co, dir, 0.0f, &hit, raycast_triangle_cb, tris);
+    EXPECT_EQ(hit.index, hit_ref.index);
+    EXPECT_FLOAT_EQ(hit.dist, hit_ref.dist);
+
+    BVHTreeNearest nearest_ref = {-1};
+    BVHTreeNearest nearest = {-1};
+    nearest_ref.dist_sq = nearest.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(tree_ref, co, &nearest_ref, nullptr, nullptr);
+    BLI_bvhtree_find_nearest(tree, co, &nearest, nullptr, nullptr);
+    EXPECT_FLOAT_EQ(nearest.dist_sq, nearest_ref.dist_sq);
+  }
+
+  /* Node bounds of the 8 axis tree are tighter, so only compare trees of the same type. */
+  BVHTree *tree_other_ref = bvhtree_from_triangles(tris_other, tris_len, tree_type, 6, 0);
+  BVHTree *tree_self_ref = bvhtree_from_triangles(tris, tris_len, tree_type, 6, 0);
+  EXPECT_EQ(overlap_pairs_len(tree, tree_other), overlap_pairs_len(tree_self_ref, tree_other_ref));
+  EXPECT_EQ(overlap_pairs_len(tree, tree), overlap_pairs_len(tree_self_ref, tree_self_ref));
+
+  BLI_bvhtree_free(tree_ref);
+  BLI_bvhtree_free(tree);
+  BLI_bvhtree_free(tree_other);
+  BLI_bvhtree_free(tree_other_ref);
+  BLI_bvhtree_free(tree_self_ref);
+  MEM_freeN(tris);
+  MEM_freeN(tris_other);
+  BLI_rng_free(rng);
+}
+
+TEST(kdopbvh, CompareLayouts)
+{
+  compare_tree_layouts_test(1, 4, 0);
+  compare_tree_layouts_test(1000, 4, 0);
+  compare_tree_layouts_test(1000, 2, 0);
+}
+TEST(kdopbvh, CompareLayoutsSAH)
+{
+  compare_tree_layouts_test(1, 4, BVH_BALANCE_SAH);
+  compare_tree_layouts_test(2, 4, BVH_BALANCE_SAH);
+  compare_tree_layouts_test(1000, 4, BVH_BALANCE_SAH);
+  compare_tree_layouts_test(1000, 2, BVH_BALANCE_SAH);
+  compare_tree_layouts_test(1000, 8, BVH_BALANCE_SAH);
+}
@@ -0,0 +1,153 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+
+static float (*random_points(int points_len, int random_seed))[3]
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(*points) * points_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, points[i]);
+    mul_v3_fl(points[i], BLI_rng_get_float(rng));
+  }
+  BLI_rng_free(rng);
+  return points;
+}
+
+static KDTree_3d *kdtree_from_points(const float (*points)[3], int points_len)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(points_len);
+  for (int i = 0; i < points_len; i++) {
+    BLI_kdtree_3d_insert(tree, i, points[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+  return tree;
+}
+
+/* Large enough for the tree to be balanced in parallel and the queries to be reordered. */
+static const int tree_points_len = 50000;
+static const int query_points_len = 5000;
+
+TEST(kdtree, BalanceFindNearest)
+{
+  float(*points)[3] = random_points(tree_points_len, 1);
+  KDTree_3d *tree = kdtree_from_points(points, tree_points_len);
+
+  for (int i = 0; i < tree_points_len; i += 7) {
+    KDTreeNearest_3d nearest;
+    EXPECT_EQ(BLI_kdtree_3d_find_nearest(tree, points[i], &nearest), i);
+    EXPECT_EQ(nearest.dist, 0.0f);
+  }
+
+  /* Balancing again must give a valid tree too. */
+  BLI_kdtree_3d_balance(tree);
+  EXPECT_EQ(BLI_kdtree_3d_find_nearest(tree, points[12345], nullptr), 12345);
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(points);
+}
+
+TEST(kdtree, FindNearestBatch)
+{
+  float(*points)[3] = random_points(tree_points_len, 2);
+  float(*query)[3] = random_points(query_points_len, 3);
+  KDTree_3d *tree = kdtree_from_points(points, tree_points_len);
+
+  int *index = (int *)MEM_mallocN(sizeof(int) * query_points_len, __func__);
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_mallocN(
+      sizeof(KDTreeNearest_3d) * query_points_len, __func__);
+  BLI_kdtree_3d_find_nearest_batch(tree, query, query_points_len, index, nearest);
+
+  for (int i = 0; i < query_points_len; i++) {
+    KDTreeNearest_3d nearest_single;
+    EXPECT_EQ(index[i], BLI_kdtree_3d_find_nearest(tree, query[i], &nearest_single));
+    EXPECT_EQ(nearest[i].index, nearest_single.index);
+    EXPECT_EQ(nearest[i].dist, nearest_single.dist);
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(index);
+  MEM_freeN(nearest);
+  MEM_freeN(points);
+  MEM_freeN(query);
+}
+
+TEST(kdtree, FindNearestNBatch)
+{
+  const int n = 5;
+  float(*points)[3] = random_points(tree_points_len, 4);
+  float(*query)[3] = random_points(query_points_len, 5);
+  KDTree_3d *tree = kdtree_from_points(points, tree_points_len);
+
+  int *nearest_len = (int *)MEM_mallocN(sizeof(int) * query_points_len, __func__);
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_mallocN(
+      sizeof(KDTreeNearest_3d) * query_points_len * n, __func__);
+  BLI_kdtree_3d_find_nearest_n_batch(tree, query, query_points_len, nearest, n, nearest_len);
+
+  for (int i = 0; i < query_points_len; i++) {
+    KDTreeNearest_3d nearest_single[n];
+    ASSERT_EQ(nearest_len[i], BLI_kdtree_3d_find_nearest_n(tree, query[i], nearest_single, n));
+    for (int j = 0; j < nearest_len[i]; j++) {
+      EXPECT_EQ(nearest[i * n + j].index, nearest_single[j].index);
+    }
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(nearest_len);
+  MEM_freeN(nearest);
+  MEM_freeN(points);
+  MEM_freeN(query);
+}
+
+TEST(kdtree, RangeSearchBatch)
+{
+  const float range = 0.05f;
+  float(*points)[3] = random_points(tree_points_len, 6);
+  float(*query)[3] = random_points(query_points_len, 7);
+  KDTree_3d *tree = kdtree_from_points(points, tree_points_len);
+
+  int *nearest_len = (int *)MEM_mallocN(sizeof(int) * query_points_len, __func__);
+  KDTreeNearest_3d **nearest = (KDTreeNearest_3d **)MEM_mallocN(
+      sizeof(KDTreeNearest_3d *) * query_points_len, __func__);
+  BLI_kdtree_3d_range_search_batch(tree, query, query_points_len, range, nearest, nearest_len);
+
+  for (int i = 0; i < query_points_len; i++) {
+    KDTreeNearest_3d *nearest_single;
+    ASSERT_EQ(nearest_len[i], BLI_kdtree_3d_range_search(tree, query[i], &nearest_single, range));
+    for (int j = 0; j < nearest_len[i]; j++) {
+      EXPECT_EQ(nearest[i][j].dist, nearest_single[j].dist);
+    }
+    if (nearest_len[i]) {
+      MEM_freeN(nearest[i]);
+      MEM_freeN(nearest_single);
+    }
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(nearest_len);
+  MEM_freeN(nearest);
+  MEM_freeN(points);
+  MEM_freeN(query);
+}
+
+TEST(kdtree, EmptyBatch)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(0);
+  BLI_kdtree_3d_balance(tree);
+
+  const float query[2][3] = {{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}};
+  int index[2];
+  BLI_kdtree_3d_find_nearest_batch(tree, query, 2, index, nullptr);
+  EXPECT_EQ(index[0], -1);
+  EXPECT_EQ(index[1], -1);
+
+  BLI_kdtree_3d_find_nearest_batch(tree, query, 0, index, nullptr);
+
+  BLI_kdtree_3d_free(tree);
+}
@@ -113,3 +113,48 @@ TEST(math_base, Log2CeilU)
   EXPECT_EQ(log2_ceil_u(9), 4);
   EXPECT_EQ(log2_ceil_u(123456), 17);
 }
+
+#ifdef __SSE2__
+TEST(math_base, FloorSSE)
+{
+  const float values[4] = {-2.5f, -1.0f, 0.25f, 3.75f};
+  float result[4];
+  _mm_storeu_ps(result, _bli_math_floor_sse(_mm_loadu_ps(values)));
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(floorf(values[i]), result[i]);
+  }
+}
+
+TEST(math_base, SinSSE)
+{
+  float max_error = 0.0f;
+  for (int i = 0; i < 100000; i += 4) {
+    float values[4], result[4];
+    for (int j = 0; j < 4; j++) {
+      values[j] = -200.0f + (i + j) * (400.0f / 100000.0f);
+    }
+    _mm_storeu_ps(result, _bli_math_sin_sse(_mm_loadu_ps(values)));
+    for (int j = 0; j < 4; j++) {
+      max_error = max_ff(max_error, fabsf(result[j] - sinf(values[j])));
+    }
+  }
+  EXPECT_LT(max_error, 1e-6f);
+}
+
+TEST(math_base, UnitFloatToUcharClampSSE)
+{
+  /* Must be bit exact with the scalar version, including around the rounding boundaries. */
+  for (int i = -1000; i < 256 * 1000 + 1000; i += 4) {
+    float values[4];
+    int result[4];
+    for (int j = 0; j < 4; j++) {
+      values[j] = (i + j) / (255.0f * 1000.0f);
+    }
+    _mm_storeu_si128((__m128i *)result,
+                     _bli_math_unit_float_to_uchar_clamp_sse(_mm_loadu_ps(values)));
+    for (int j = 0; j < 4; j++) {
+      EXPECT_EQ(unit_float_to_uchar_clamp(values[j]), result[j]);
+    }
+  }
+}
+#endif
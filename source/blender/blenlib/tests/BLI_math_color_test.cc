@@ -74,3 +74,28 @@ TEST(math_color, LinearRGBTosRGBRoundtrip)
     EXPECT_NEAR(orig_linear_color, linear_color, 1e-5);
   }
 }
+
+#ifdef __SSE2__
+TEST(math_color, DitherRandomValueSIMD)
+{
+  /* The noise can only differ from the scalar version by wrapping around differently, which
+   * should be rare. */
+  const int width = 1920;
+  int wrapped = 0;
+  for (int x = 0; x < width; x += 4) {
+    const float t = 0.37f;
+    float s[4], result[4];
+    for (int i = 0; i < 4; i++) {
+      s[i] = (float)(x + i) / width;
+    }
+    _mm_storeu_ps(result, dither_random_value_simd(_mm_loadu_ps(s), _mm_set1_ps(t)));
+    for (int i = 0; i < 4; i++) {
+      const float diff = result[i] - dither_random_value(s[i], t);
+      const float wrap = roundf(diff);
+      EXPECT_NEAR(diff, wrap, 2e-2f);
+      wrapped += (wrap != 0.0f);
+    }
+  }
+  EXPECT_LT(wrapped, width / 100);
+}
+#endif
@@ -0,0 +1,153 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include "BLI_profile.hh"
+#include "BLI_vector.hh"
+
+namespace blender::profile::tests {
+
+static int count_occurrences(const std::string &str, const std::string &part)
+{
+  int count = 0;
+  for (size_t pos = str.find(part); pos != std::string::npos; pos = str.find(part, pos + 1)) {
+    count++;
+  }
+  return count;
+}
+
+static std::string capture_to_string()
+{
+  std::stringstream stream;
+  write_chrome_trace(stream);
+  return stream.str();
+}
+
+TEST(profile, NotCapturing)
+{
+  EXPECT_FALSE(BLI_profile_is_capturing());
+  {
+    ScopedZone zone("not captured");
+  }
+  BLI_profile_capture_begin(nullptr);
+  EXPECT_TRUE(BLI_profile_is_capturing());
+  EXPECT_TRUE(BLI_profile_capture_end());
+  EXPECT_FALSE(BLI_profile_is_capturing());
+
+  const std::string trace = capture_to_string();
+  EXPECT_EQ(count_occurrences(trace, "not captured"), 0);
+  EXPECT_EQ(count_occurrences(trace, "\"ph\":\"X\""), 0);
+}
+
+TEST(profile, Nested)
+{
+  BLI_profile_capture_begin(nullptr);
+  {
+    ScopedZone outer("outer");
+    for (int i = 0; i < 3; i++) {
+      ScopedZone inner("inner");
+    }
+  }
+  /* Zones are recorded when they end, one that begins during the capture and ends after it is
+   * dropped. */
+  ProfileZone zone;
+  BLI_profile_zone_begin(&zone, "late");
+  BLI_profile_capture_end();
+  EXPECT_FALSE(BLI_profile_is_capturing());
+  BLI_profile_zone_end(&zone);
+
+  const std::string trace = capture_to_string();
+  EXPECT_EQ(count_occurrences(trace, "\"name\":\"outer\""), 1);
+  EXPECT_EQ(count_occurrences(trace, "\"name\":\"inner\""), 3);
+  EXPECT_EQ(count_occurrences(trace, "late"), 0);
+  /* Inner zones end first. */
+  EXPECT_LT(trace.find("inner"), trace.find("outer"));
+}
+
+TEST(profile, ZoneAcrossCaptures)
+{
+  /* Begins before any capture, so it's dropped. */
+  ProfileZone zone_before;
+  BLI_profile_zone_begin(&zone_before, "before");
+
+  /* Begins during an earlier capture and ends during the next one, so it's recorded from the
+   * start of the capture it ends in. */
+  BLI_profile_capture_begin(nullptr);
+  ProfileZone zone_previous;
+  BLI_profile_zone_begin(&zone_previous, "previous");
+  BLI_profile_capture_end();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  BLI_profile_capture_begin(nullptr);
+  BLI_profile_zone_end(&zone_before);
+  BLI_profile_zone_end(&zone_previous);
+  BLI_profile_capture_end();
+
+  const std::string trace = capture_to_string();
+  EXPECT_EQ(count_occurrences(trace, "before"), 0);
+  EXPECT_EQ(count_occurrences(trace, "\"name\":\"previous\""), 1);
+
+  const size_t ts_pos = trace.find("\"ts\":", trace.find("previous"));
+  const size_t dur_pos = trace.find("\"dur\":", ts_pos);
+  ASSERT_NE(ts_pos, std::string::npos);
+  ASSERT_NE(dur_pos, std::string::npos);
+  EXPECT_EQ(std::stod(trace.substr(ts_pos + 5)), 0.0);
+  /* Not the wrapped around difference of the unsigned times. */
+  EXPECT_LT(std::stod(trace.substr(dur_pos + 6)), 1e6);
+}
+
+TEST(profile, Threads)
+{
+  BLI_profile_capture_begin(nullptr);
+  Vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.append(std::thread([]() {
+      for (int j = 0; j < 100; j++) {
+        ScopedZone zone("thread \"zone\"");
+      }
+    }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  BLI_profile_capture_end();
+
+  const std::string trace = capture_to_string();
+  EXPECT_EQ(count_occurrences(trace, "\"name\":\"thread \\\"zone\\\"\""), 400);
+}
+
+/* Capturing while other threads keep recording, the buffers must not be read or reset while
+ * zones are written into them. */
+TEST(profile, CaptureWhileRecording)
+{
+  std::atomic<bool> stop = false;
+  Vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.append(std::thread([&stop]() {
+      while (!stop.load()) {
+        {
+          ScopedZone zone("recording");
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+      }
+    }));
+  }
+  for (int i = 0; i < 3; i++) {
+    BLI_profile_capture_begin(nullptr);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    capture_to_string();
+    BLI_profile_capture_end();
+    const std::string trace = capture_to_string();
+    EXPECT_EQ(trace.find("\"name\":null"), std::string::npos);
+  }
+  stop.store(true);
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace blender::profile::tests
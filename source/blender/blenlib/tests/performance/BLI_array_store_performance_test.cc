@@ -0,0 +1,119 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cstring>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
+#include "BLI_array_store.h"
+#include "BLI_rand.h"
+#include "BLI_timeit.hh"
+#include "BLI_vector.hh"
+
+namespace blender::tests {
+
+/* Sizes similar to the mesh undo system storing the vertex positions of a dense mesh,
+ * see `editmesh_undo.c`. */
+
+#define ELEM_STRIDE (sizeof(float) * 3)
+#define ELEM_NUM 4000000
+#define CHUNK_COUNT 256
+#define RUNS_NUM 5
+
+static Array<float> random_positions(const int elem_num)
+{
+  RNG *rng = BLI_rng_new(0);
+  Array<float> positions(elem_num * 3);
+  for (float &value : positions) {
+    value = BLI_rng_get_float(rng);
+  }
+  BLI_rng_free(rng);
+  return positions;
+}
+
+template<typename ModifyFn>
+static void array_store_modify_and_add(const char *name, const ModifyFn &modify)
+{
+  const Array<float> positions_orig = random_positions(ELEM_NUM);
+  Vector<float> positions(positions_orig.as_span());
+  modify(positions);
+  const size_t data_len = positions.size() * sizeof(float);
+
+  BArrayStore *bs = BLI_array_store_create(ELEM_STRIDE, CHUNK_COUNT);
+  BArrayState *state_orig = BLI_array_store_state_add(
+      bs, positions_orig.data(), positions_orig.size() * sizeof(float), nullptr);
+
+  BArrayState *state = nullptr;
+  {
+    SCOPED_TIMER(name);
+    for (int i = 0; i < RUNS_NUM; i++) {
+      if (state != nullptr) {
+        BLI_array_store_state_remove(bs, state);
+      }
+      state = BLI_array_store_state_add(bs, positions.data(), data_len, state_orig);
+    }
+  }
+
+  size_t state_data_len;
+  void *state_data = BLI_array_store_state_data_get_alloc(state, &state_data_len);
+  EXPECT_EQ(state_data_len, data_len);
+  EXPECT_EQ(memcmp(state_data, positions.data(), data_len), 0);
+  MEM_freeN(state_data);
+
+  const size_t size_compacted = BLI_array_store_calc_size_compacted_get(bs);
+  printf("  stored %.1f%% of the expanded size\n",
+         (double)size_compacted / (double)(2 * data_len) * 100.0);
+
+  BLI_array_store_destroy(bs);
+}
+
+TEST(array_store, UnchangedPerformance)
+{
+  array_store_modify_and_add("Unchanged", [](Vector<float> &UNUSED(positions)) {});
+}
+
+TEST(array_store, LocalEditPerformance)
+{
+  array_store_modify_and_add("Local Edit", [](Vector<float> &positions) {
+    for (const int i : IndexRange(positions.size() / 2, 3000)) {
+      positions[i] += 1.0f;
+    }
+  });
+}
+
+TEST(array_store, ScatteredEditPerformance)
+{
+  array_store_modify_and_add("Scattered Edit", [](Vector<float> &positions) {
+    for (int64_t i = 0; i < positions.size(); i += 3 * CHUNK_COUNT * 16) {
+      positions[i] += 1.0f;
+    }
+  });
+}
+
+TEST(array_store, FullEditPerformance)
+{
+  array_store_modify_and_add("Full Edit", [](Vector<float> &positions) {
+    for (float &value : positions) {
+      value += 1.0f;
+    }
+  });
+}
+
+TEST(array_store, DeletePerformance)
+{
+  /* Removing elements in two places shifts the data between them,
+   * so its chunks have to be found by their hash. */
+  array_store_modify_and_add("Delete", [](Vector<float> &positions) {
+    for (const int64_t start : {positions.size() / 3, positions.size() / 3 * 2}) {
+      const int64_t removed = 3 * 1001;
+      std::memmove(&positions[start],
+                   &positions[start + removed],
+                   sizeof(float) * (size_t)(positions.size() - start - removed));
+      positions.resize(positions.size() - removed);
+    }
+  });
+}
+
+}  // namespace blender::tests
@@ -0,0 +1,177 @@
+/* Apache License, Version 2.0 */
+
+#include <mutex>
+#include <thread>
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_concurrent_map.hh"
+#include "BLI_concurrent_set.hh"
+#include "BLI_ghash.h"
+#include "BLI_map.hh"
+#include "BLI_rand.h"
+#include "BLI_set.hh"
+#include "BLI_system.h"
+#include "BLI_threads.h"
+#include "BLI_timeit.hh"
+#include "BLI_vector.hh"
+
+namespace blender::tests {
+
+/* Compares concurrent hash tables against the mutex guarded alternatives that are used in
+ * multi-threaded code currently. Every thread inserts and looks up a part of the same set of
+ * random keys, many of which are shared between threads. */
+
+#define KEYS_NUM 4000000
+#define KEYS_RANGE (KEYS_NUM / 2)
+
+static Vector<int> generate_keys()
+{
+  RNG *rng = BLI_rng_new(0);
+  Vector<int> keys(KEYS_NUM);
+  for (int &key : keys) {
+    key = (int)(BLI_rng_get_uint(rng) % KEYS_RANGE);
+  }
+  BLI_rng_free(rng);
+  return keys;
+}
+
+template<typename FuncT> static void run_in_threads(Span<int> keys, const FuncT &func)
+{
+  const int threads_num = BLI_system_thread_count();
+  const int64_t keys_per_thread = keys.size() / threads_num + 1;
+  Vector<std::thread> threads;
+  for (int thread_index = 0; thread_index < threads_num; thread_index++) {
+    const int64_t start = std::min(thread_index * keys_per_thread, keys.size());
+    const int64_t size = std::min(keys_per_thread, keys.size() - start);
+    threads.append(std::thread([&func, keys, start, size]() { func(keys.slice(start, size)); }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(concurrent_map, AddOrModifyPerformance)
+{
+  Vector<int> keys = generate_keys();
+  printf("\nAdding %d keys with %d threads\n", KEYS_NUM, BLI_system_thread_count());
+
+  {
+    SCOPED_TIMER("GHash + ThreadMutex");
+    GHash *ghash = BLI_ghash_int_new(__func__);
+    ThreadMutex mutex = BLI_MUTEX_INITIALIZER;
+    run_in_threads(keys, [&](Span<int> thread_keys) {
+      for (const int key : thread_keys) {
+        BLI_mutex_lock(&mutex);
+        void **value;
+        if (!BLI_ghash_ensure_p(ghash, POINTER_FROM_INT(key), &value)) {
+          *value = POINTER_FROM_INT(0);
+        }
+        *value = POINTER_FROM_INT(POINTER_AS_INT(*value) + 1);
+        BLI_mutex_unlock(&mutex);
+      }
+    });
+    EXPECT_LE(BLI_ghash_len(ghash), KEYS_RANGE);
+    BLI_ghash_free(ghash, nullptr, nullptr);
+  }
+  {
+    SCOPED_TIMER("Map + std::mutex");
+    Map<int, int> map;
+    std::mutex mutex;
+    run_in_threads(keys, [&](Span<int> thread_keys) {
+      for (const int key : thread_keys) {
+        std::lock_guard<std::mutex> lock(mutex);
+        map.add_or_modify(
+            key, [](int *value) { *value = 1; }, [](int *value) { (*value)++; });
+      }
+    });
+    EXPECT_LE(map.size(), KEYS_RANGE);
+  }
+  {
+    SCOPED_TIMER("Map per thread + merge");
+    std::mutex mutex;
+    Map<int, int> map;
+    run_in_threads(keys, [&](Span<int> thread_keys) {
+      Map<int, int> thread_map;
+      for (const int key : thread_keys) {
+        thread_map.add_or_modify(
+            key, [](int *value) { *value = 1; }, [](int *value) { (*value)++; });
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto item : thread_map.items()) {
+        map.add_or_modify(
+            item.key,
+            [&](int *value) { *value = item.value; },
+            [&](int *value) { *value += item.value; });
+      }
+    });
+    EXPECT_LE(map.size(), KEYS_RANGE);
+  }
+  {
+    SCOPED_TIMER("ConcurrentMap");
+    ConcurrentMap<int, int> map;
+    run_in_threads(keys, [&](Span<int> thread_keys) {
+      for (const int key : thread_keys) {
+        map.add_or_modify(
+            key, [](int *value) { *value = 1; }, [](int *value) { (*value)++; });
+      }
+    });
+    EXPECT_LE(map.size(), KEYS_RANGE);
+  }
+}
+
+TEST(concurrent_set, AddContainsPerformance)
+{
+  Vector<int> keys = generate_keys();
+  printf("\nAdding and testing %d keys with %d threads\n", KEYS_NUM, BLI_system_thread_count());
+
+  {
+    SCOPED_TIMER("GSet + ThreadMutex");
+    GSet *gset = BLI_gset_int_new(__func__);
+    ThreadMutex mutex = BLI_MUTEX_INITIALIZER;
+    run_in_threads(keys, [&](Span<int> thread_keys) {
+      for (const int key : thread_keys) {
+        BLI_mutex_lock(&mutex);
+        BLI_gset_add(gset, POINTER_FROM_INT(key));
+        BLI_mutex_unlock(&mutex);
+      }
+      for (const int key : thread_keys) {
+        BLI_mutex_lock(&mutex);
+        EXPECT_TRUE(BLI_gset_haskey(gset, POINTER_FROM_INT(key)));
+        BLI_mutex_unlock(&mutex);
+      }
+    });
+    BLI_gset_free(gset, nullptr);
+  }
+  {
+    SCOPED_TIMER("Set + std::mutex");
+    Set<int> set;
+    std::mutex mutex;
+    run_in_threads(keys, [&](Span<int> thread_keys) {
+      for (const int key : thread_keys) {
+        std::lock_guard<std::mutex> lock(mutex);
+        set.add(key);
+      }
+      for (const int key : thread_keys) {
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_TRUE(set.contains(key));
+      }
+    });
+  }
+  {
+    SCOPED_TIMER("ConcurrentSet");
+    ConcurrentSet<int> set;
+    run_in_threads(keys, [&](Span<int> thread_keys) {
+      for (const int key : thread_keys) {
+        set.add(key);
+      }
+      for (const int key : thread_keys) {
+        EXPECT_TRUE(set.contains(key));
+      }
+    });
+  }
+}
+
+}  // namespace blender::tests
@@ -0,0 +1,824 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stack>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_edgehash.h"
+#include "BLI_ghash.h"
+#include "BLI_linear_allocator.hh"
+#include "BLI_map.hh"
+#include "BLI_mempool.h"
+#include "BLI_multi_value_map.hh"
+#include "BLI_set.hh"
+#include "BLI_stack.h"
+#include "BLI_stack.hh"
+#include "BLI_vector.hh"
+#include "BLI_vector_set.hh"
+
+/* Compare the C++ containers with the C containers they are meant to replace and with the
+ * standard library. Every operation is repeated until about #OPERATIONS_NUM operations have been
+ * done, and the average time per operation is printed. */
+
+/* Run the tests with ten million elements, this takes a while. */
+//#define CONTAINERS_RUN_BIG
+
+#define OPERATIONS_NUM 1000000
+
+namespace blender::tests {
+
+#ifdef CONTAINERS_RUN_BIG
+static const int64_t sizes[] = {10, 1000, 100000, 1000000, 10000000};
+#else
+static const int64_t sizes[] = {10, 1000, 100000, 1000000};
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+static int64_t repeats_for_size(const int64_t size)
+{
+  return std::max<int64_t>(1, OPERATIONS_NUM / size);
+}
+
+static double elapsed_ns(const Clock::time_point start)
+{
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start)
+      .count();
+}
+
+static void print_header(const char *title)
+{
+  printf("\n%s\n", title);
+  printf("  %-44s %-10s %10s %12s\n", "Container", "Operation", "Size", "ns/op");
+}
+
+static void print_result(const char *container,
+                         const char *operation,
+                         const int64_t size,
+                         const double ns,
+                         const int64_t operations_num)
+{
+  printf("  %-44s %-10s %10lld %12.2f\n",
+         container,
+         operation,
+         (long long)size,
+         ns / (double)operations_num);
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Keys
+ *
+ * Keys are distinct but not sequential, to not favor hash tables that store consecutive keys in
+ * consecutive slots.
+ * \{ */
+
+static Vector<int> int_keys(const int64_t size)
+{
+  Vector<int> keys(size);
+  for (const int64_t i : keys.index_range()) {
+    /* Multiplying with an odd number is a bijection. */
+    keys[i] = (int)((uint32_t)i * 2654435761u);
+  }
+  return keys;
+}
+
+static Vector<uint64_t> uint64_keys(const int64_t size)
+{
+  Vector<uint64_t> keys(size);
+  for (const int64_t i : keys.index_range()) {
+    keys[i] = (uint64_t)i * 0x9E3779B97F4A7C15ull;
+  }
+  return keys;
+}
+
+static Vector<std::string> string_keys(const int64_t size)
+{
+  Vector<std::string> keys(size);
+  for (const int64_t i : keys.index_range()) {
+    keys[i] = "key_" + std::to_string((uint32_t)i * 2654435761u);
+  }
+  return keys;
+}
+
+/** Addresses of separately allocated elements, like pointers to #ID or #BMVert. */
+static Vector<void *> pointer_keys(const int64_t size, LinearAllocator<> &allocator)
+{
+  Vector<void *> keys(size);
+  for (const int64_t i : keys.index_range()) {
+    keys[i] = allocator.allocate(48, 8);
+  }
+  return keys;
+}
+
+static Vector<std::pair<int, int>> edge_keys(const int64_t size)
+{
+  Vector<std::pair<int, int>> keys(size);
+  const int verts_per_row = (int)std::sqrt((double)size) + 1;
+  for (const int64_t i : keys.index_range()) {
+    const int v = (int)(i / 2);
+    /* Edges of a grid, with the lower vertex first like in #EdgeHash. */
+    keys[i] = (i % 2) ? std::make_pair(v, v + 1) : std::make_pair(v, v + verts_per_row);
+  }
+  return keys;
+}
+
+static Vector<int64_t> shuffled_indices(const int64_t size)
+{
+  Vector<int64_t> indices(size);
+  for (const int64_t i : indices.index_range()) {
+    indices[i] = i;
+  }
+  std::shuffle(indices.begin(), indices.end(), std::mt19937(0));
+  return indices;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Hash Table Wrappers
+ *
+ * A common interface for maps and sets. Values are the key indices, so lookups can be verified.
+ * \{ */
+
+template<typename Key, typename ProbingStrategy = DefaultProbingStrategy> struct BlenderMap {
+  Map<Key, int64_t, 4, ProbingStrategy> map;
+
+  void insert(const Key &key, const int64_t value)
+  {
+    map.add_new(key, value);
+  }
+  int64_t lookup(const Key &key) const
+  {
+    return map.lookup(key);
+  }
+  void remove(const Key &key)
+  {
+    map.remove_contained(key);
+  }
+  int64_t iterate() const
+  {
+    int64_t sum = 0;
+    for (const int64_t value : map.values()) {
+      sum += value;
+    }
+    return sum;
+  }
+};
+
+template<typename Key> struct StdUnorderedMap {
+  std::unordered_map<Key, int64_t, DefaultHash<Key>> map;
+
+  void insert(const Key &key, const int64_t value)
+  {
+    map.emplace(key, value);
+  }
+  int64_t lookup(const Key &key) const
+  {
+    return map.find(key)->second;
+  }
+  void remove(const Key &key)
+  {
+    map.erase(key);
+  }
+  int64_t iterate() const
+  {
+    int64_t sum = 0;
+    for (const auto &item : map) {
+      sum += item.second;
+    }
+    return sum;
+  }
+};
+
+static void *ghash_key(const int key)
+{
+  return POINTER_FROM_INT(key);
+}
+static void *ghash_key(void *key)
+{
+  return key;
+}
+static void *ghash_key(const std::string &key)
+{
+  return (void *)key.c_str();
+}
+
+static GHash *ghash_new(const int *UNUSED(dummy))
+{
+  return BLI_ghash_int_new(__func__);
+}
+static GHash *ghash_new(void *const *UNUSED(dummy))
+{
+  return BLI_ghash_ptr_new(__func__);
+}
+static GHash *ghash_new(const std::string *UNUSED(dummy))
+{
+  return BLI_ghash_str_new(__func__);
+}
+
+/** String keys are not copied, they are owned by the key array of the test. */
+template<typename Key> struct GHashMap {
+  GHash *ghash = ghash_new((const Key *)nullptr);
+
+  ~GHashMap()
+  {
+    BLI_ghash_free(ghash, nullptr, nullptr);
+  }
+  void insert(const Key &key, const int64_t value)
+  {
+    BLI_ghash_insert(ghash, ghash_key(key), POINTER_FROM_INT(value));
+  }
+  int64_t lookup(const Key &key) const
+  {
+    return POINTER_AS_INT(BLI_ghash_lookup(ghash, ghash_key(key)));
+  }
+  void remove(const Key &key)
+  {
+    BLI_ghash_remove(ghash, ghash_key(key), nullptr, nullptr);
+  }
+  int64_t iterate() const
+  {
+    int64_t sum = 0;
+    GHashIterator gh_iter;
+    GHASH_ITER (gh_iter, ghash) {
+      sum += POINTER_AS_INT(BLI_ghashIterator_getValue(&gh_iter));
+    }
+    return sum;
+  }
+};
+
+struct EdgeHashMap {
+  EdgeHash *edgehash = BLI_edgehash_new("EdgeHashMap");
+
+  ~EdgeHashMap()
+  {
+    BLI_edgehash_free(edgehash, nullptr);
+  }
+  void insert(const std::pair<int, int> &key, const int64_t value)
+  {
+    BLI_edgehash_insert(edgehash, key.first, key.second, POINTER_FROM_INT(value));
+  }
+  int64_t lookup(const std::pair<int, int> &key) const
+  {
+    return POINTER_AS_INT(BLI_edgehash_lookup(edgehash, key.first, key.second));
+  }
+  void remove(const std::pair<int, int> &key)
+  {
+    BLI_edgehash_remove(edgehash, key.first, key.second, nullptr);
+  }
+  int64_t iterate() const
+  {
+    int64_t sum = 0;
+    EdgeHashIterator *ehi = BLI_edgehashIterator_new(edgehash);
+    for (; !BLI_edgehashIterator_isDone(ehi); BLI_edgehashIterator_step(ehi)) {
+      sum += POINTER_AS_INT(BLI_edgehashIterator_getValue(ehi));
+    }
+    BLI_edgehashIterator_free(ehi);
+    return sum;
+  }
+};
+
+/* Sets return the key index from lookups as well, so they can be verified the same way. */
+
+template<typename SetT, typename Key> struct SetWrapper {
+  SetT set;
+  Span<Key> keys;
+
+  SetWrapper(Span<Key> keys) : keys(keys)
+  {
+  }
+
+  void insert(const Key &key, const int64_t UNUSED(value))
+  {
+    set.add_new(key);
+  }
+  int64_t lookup(const Key &key) const
+  {
+    return set.contains(key) ? &key - keys.data() : -1;
+  }
+  void remove(const Key &key)
+  {
+    set.remove_contained(key);
+  }
+  int64_t iterate() const
+  {
+    int64_t sum = 0;
+    for (const Key &key : set) {
+      sum += key;
+    }
+    return sum;
+  }
+};
+
+template<typename Key> struct StdUnorderedSet {
+  std::unordered_set<Key, DefaultHash<Key>> set;
+  Span<Key> keys;
+
+  StdUnorderedSet(Span<Key> keys) : keys(keys)
+  {
+  }
+
+  void insert(const Key &key, const int64_t UNUSED(value))
+  {
+    set.insert(key);
+  }
+  int64_t lookup(const Key &key) const
+  {
+    return set.count(key) ? &key - keys.data() : -1;
+  }
+  void remove(const Key &key)
+  {
+    set.erase(key);
+  }
+  int64_t iterate() const
+  {
+    int64_t sum = 0;
+    for (const Key &key : set) {
+      sum += key;
+    }
+    return sum;
+  }
+};
+
+struct GSetInt {
+  GSet *gset = BLI_gset_int_new("GSetInt");
+  Span<int> keys;
+
+  GSetInt(Span<int> keys) : keys(keys)
+  {
+  }
+  ~GSetInt()
+  {
+    BLI_gset_free(gset, nullptr);
+  }
+  void insert(const int &key, const int64_t UNUSED(value))
+  {
+    BLI_gset_insert(gset, POINTER_FROM_INT(key));
+  }
+  int64_t lookup(const int &key) const
+  {
+    return BLI_gset_haskey(gset, POINTER_FROM_INT(key)) ? &key - keys.data() : -1;
+  }
+  void remove(const int &key)
+  {
+    BLI_gset_remove(gset, POINTER_FROM_INT(key), nullptr);
+  }
+  int64_t iterate() const
+  {
+    int64_t sum = 0;
+    GSetIterator gs_iter;
+    GSET_ITER (gs_iter, gset) {
+      sum += POINTER_AS_INT(BLI_gsetIterator_getKey(&gs_iter));
+    }
+    return sum;
+  }
+};
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Hash Table Benchmarks
+ * \{ */
+
+/**
+ * Insert all keys, look them up in random order, iterate over the table and remove all keys.
+ * \param make_table: Creates an empty table, gets the keys because sets need them to compute the
+ * key indices.
+ */
+template<typename Key, typename MakeTableFn>
+static void benchmark_hash_table(const char *name,
+                                 const Span<Key> all_keys,
+                                 const MakeTableFn &make_table,
+                                 const bool sets_iterate_keys = false)
+{
+  for (const int64_t size : sizes) {
+    if (size > all_keys.size()) {
+      break;
+    }
+    const Span<Key> keys = all_keys.take_front(size);
+    const Vector<int64_t> lookup_order = shuffled_indices(size);
+    const int64_t repeats = repeats_for_size(size);
+    const int64_t expected_sum = size * (size - 1) / 2;
+
+    double insert_ns = 0.0, lookup_ns = 0.0, iterate_ns = 0.0, remove_ns = 0.0;
+    int64_t lookup_sum = 0, iterate_sum = 0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      auto table = make_table(keys);
+
+      Clock::time_point start = Clock::now();
+      for (const int64_t i : keys.index_range()) {
+        table->insert(keys[i], i);
+      }
+      insert_ns += elapsed_ns(start);
+
+      start = Clock::now();
+      for (const int64_t i : lookup_order) {
+        lookup_sum += table->lookup(keys[i]);
+      }
+      lookup_ns += elapsed_ns(start);
+
+      start = Clock::now();
+      iterate_sum += table->iterate();
+      iterate_ns += elapsed_ns(start);
+
+      start = Clock::now();
+      for (const int64_t i : lookup_order) {
+        table->remove(keys[i]);
+      }
+      remove_ns += elapsed_ns(start);
+    }
+    EXPECT_EQ(lookup_sum, expected_sum * repeats);
+    if (!sets_iterate_keys) {
+      EXPECT_EQ(iterate_sum, expected_sum * repeats);
+    }
+
+    const int64_t operations_num = size * repeats;
+    print_result(name, "insert", size, insert_ns, operations_num);
+    print_result(name, "lookup", size, lookup_ns, operations_num);
+    print_result(name, "iterate", size, iterate_ns, operations_num);
+    print_result(name, "remove", size, remove_ns, operations_num);
+  }
+}
+
+static int64_t max_size()
+{
+  return sizes[ARRAY_SIZE(sizes) - 1];
+}
+
+TEST(containers, MapIntPerformance)
+{
+  print_header("Map, int keys");
+  const Vector<int> keys = int_keys(max_size());
+  benchmark_hash_table<int>("Map<int> Python", keys, [](Span<int>) {
+    return std::make_unique<BlenderMap<int>>();
+  });
+  benchmark_hash_table<int>("Map<int> Linear", keys, [](Span<int>) {
+    return std::make_unique<BlenderMap<int, LinearProbingStrategy>>();
+  });
+  benchmark_hash_table<int>("Map<int> Quadratic", keys, [](Span<int>) {
+    return std::make_unique<BlenderMap<int, QuadraticProbingStrategy>>();
+  });
+  benchmark_hash_table<int>("Map<int> Shuffle", keys, [](Span<int>) {
+    return std::make_unique<BlenderMap<int, ShuffleProbingStrategy<>>>();
+  });
+  benchmark_hash_table<int>("Map<int> Python PreShuffle", keys, [](Span<int>) {
+    return std::make_unique<BlenderMap<int, PythonProbingStrategy<1, true>>>();
+  });
+  benchmark_hash_table<int>("GHash int", keys, [](Span<int>) {
+    return std::make_unique<GHashMap<int>>();
+  });
+  benchmark_hash_table<int>("std::unordered_map<int>", keys, [](Span<int>) {
+    return std::make_unique<StdUnorderedMap<int>>();
+  });
+}
+
+TEST(containers, MapUInt64Performance)
+{
+  print_header("Map, uint64_t keys");
+  const Vector<uint64_t> keys = uint64_keys(max_size());
+  benchmark_hash_table<uint64_t>("Map<uint64_t> Python", keys, [](Span<uint64_t>) {
+    return std::make_unique<BlenderMap<uint64_t>>();
+  });
+  benchmark_hash_table<uint64_t>("Map<uint64_t> Linear", keys, [](Span<uint64_t>) {
+    return std::make_unique<BlenderMap<uint64_t, LinearProbingStrategy>>();
+  });
+  benchmark_hash_table<uint64_t>("std::unordered_map<uint64_t>", keys, [](Span<uint64_t>) {
+    return std::make_unique<StdUnorderedMap<uint64_t>>();
+  });
+}
+
+TEST(containers, MapStringPerformance)
+{
+  print_header("Map, string keys");
+  const Vector<std::string> keys = string_keys(max_size());
+  benchmark_hash_table<std::string>("Map<std::string>", keys, [](Span<std::string>) {
+    return std::make_unique<BlenderMap<std::string>>();
+  });
+  benchmark_hash_table<std::string>("GHash str", keys, [](Span<std::string>) {
+    return std::make_unique<GHashMap<std::string>>();
+  });
+  benchmark_hash_table<std::string>(
+      "std::unordered_map<std::string>", keys, [](Span<std::string>) {
+        return std::make_unique<StdUnorderedMap<std::string>>();
+      });
+}
+
+TEST(containers, MapPointerPerformance)
+{
+  print_header("Map, pointer keys");
+  LinearAllocator<> allocator;
+  const Vector<void *> keys = pointer_keys(max_size(), allocator);
+  benchmark_hash_table<void *>("Map<void *>", keys, [](Span<void *>) {
+    return std::make_unique<BlenderMap<void *>>();
+  });
+  benchmark_hash_table<void *>("GHash ptr", keys, [](Span<void *>) {
+    return std::make_unique<GHashMap<void *>>();
+  });
+  benchmark_hash_table<void *>("std::unordered_map<void *>", keys, [](Span<void *>) {
+    return std::make_unique<StdUnorderedMap<void *>>();
+  });
+}
+
+TEST(containers, MapEdgePerformance)
+{
+  print_header("Map, edge keys");
+  const Vector<std::pair<int, int>> keys = edge_keys(max_size());
+  using Edge = std::pair<int, int>;
+  benchmark_hash_table<Edge>("Map<std::pair<int, int>>", keys, [](Span<Edge>) {
+    return std::make_unique<BlenderMap<Edge>>();
+  });
+  benchmark_hash_table<Edge>("EdgeHash", keys, [](Span<Edge>) {
+    return std::make_unique<EdgeHashMap>();
+  });
+  benchmark_hash_table<Edge>("std::unordered_map<std::pair<int, int>>", keys, [](Span<Edge>) {
+    return std::make_unique<StdUnorderedMap<Edge>>();
+  });
+}
+
+TEST(containers, SetIntPerformance)
+{
+  print_header("Set, int keys");
+  const Vector<int> keys = int_keys(max_size());
+  benchmark_hash_table<int>(
+      "Set<int>",
+      keys,
+      [](Span<int> keys) { return std::make_unique<SetWrapper<Set<int>, int>>(keys); },
+      true);
+  benchmark_hash_table<int>(
+      "VectorSet<int>",
+      keys,
+      [](Span<int> keys) { return std::make_unique<SetWrapper<VectorSet<int>, int>>(keys); },
+      true);
+  benchmark_hash_table<int>(
+      "GSet int", keys, [](Span<int> keys) { return std::make_unique<GSetInt>(keys); }, true);
+  benchmark_hash_table<int>(
+      "std::unordered_set<int>",
+      keys,
+      [](Span<int> keys) { return std::make_unique<StdUnorderedSet<int>>(keys); },
+      true);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Multi-Value Map Benchmarks
+ * \{ */
+
+TEST(containers, MultiValueMapPerformance)
+{
+  print_header("Multi-value map, int keys with four values each");
+  for (const int64_t size : sizes) {
+    const int64_t repeats = repeats_for_size(size);
+    const Vector<int> keys = int_keys(std::max<int64_t>(1, size / 4));
+    const int64_t operations_num = size * repeats;
+
+    double insert_ns = 0.0, lookup_ns = 0.0;
+    int64_t lookup_sum = 0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      MultiValueMap<int, int> map;
+      Clock::time_point start = Clock::now();
+      for (const int64_t i : IndexRange(size)) {
+        map.add(keys[i % keys.size()], (int)i);
+      }
+      insert_ns += elapsed_ns(start);
+      start = Clock::now();
+      for (const int64_t i : IndexRange(size)) {
+        lookup_sum += map.lookup(keys[i % keys.size()]).size();
+      }
+      lookup_ns += elapsed_ns(start);
+    }
+    print_result("MultiValueMap<int, int>", "insert", size, insert_ns, operations_num);
+    print_result("MultiValueMap<int, int>", "lookup", size, lookup_ns, operations_num);
+
+    insert_ns = 0.0;
+    lookup_ns = 0.0;
+    int64_t std_lookup_sum = 0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      std::unordered_multimap<int, int> map;
+      Clock::time_point start = Clock::now();
+      for (const int64_t i : IndexRange(size)) {
+        map.emplace(keys[i % keys.size()], (int)i);
+      }
+      insert_ns += elapsed_ns(start);
+      start = Clock::now();
+      for (const int64_t i : IndexRange(size)) {
+        std_lookup_sum += (int64_t)map.count(keys[i % keys.size()]);
+      }
+      lookup_ns += elapsed_ns(start);
+    }
+    print_result("std::unordered_multimap<int, int>", "insert", size, insert_ns, operations_num);
+    print_result("std::unordered_multimap<int, int>", "lookup", size, lookup_ns, operations_num);
+    EXPECT_EQ(lookup_sum, std_lookup_sum);
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Sequence Benchmarks
+ * \{ */
+
+TEST(containers, VectorPerformance)
+{
+  print_header("Vector, append without reserving and iterate");
+  for (const int64_t size : sizes) {
+    const int64_t repeats = repeats_for_size(size);
+    const int64_t operations_num = size * repeats;
+    int64_t sum = 0, std_sum = 0;
+
+    double append_ns = 0.0, iterate_ns = 0.0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      Vector<int> vector;
+      Clock::time_point start = Clock::now();
+      for (const int64_t i : IndexRange(size)) {
+        vector.append((int)i);
+      }
+      append_ns += elapsed_ns(start);
+      start = Clock::now();
+      for (const int value : vector) {
+        sum += value;
+      }
+      iterate_ns += elapsed_ns(start);
+    }
+    print_result("Vector<int>", "append", size, append_ns, operations_num);
+    print_result("Vector<int>", "iterate", size, iterate_ns, operations_num);
+
+    append_ns = 0.0;
+    iterate_ns = 0.0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      std::vector<int> vector;
+      Clock::time_point start = Clock::now();
+      for (const int64_t i : IndexRange(size)) {
+        vector.push_back((int)i);
+      }
+      append_ns += elapsed_ns(start);
+      start = Clock::now();
+      for (const int value : vector) {
+        std_sum += value;
+      }
+      iterate_ns += elapsed_ns(start);
+    }
+    print_result("std::vector<int>", "append", size, append_ns, operations_num);
+    print_result("std::vector<int>", "iterate", size, iterate_ns, operations_num);
+    EXPECT_EQ(sum, std_sum);
+  }
+}
+
+TEST(containers, StackPerformance)
+{
+  print_header("Stack, push all and pop all");
+  for (const int64_t size : sizes) {
+    const int64_t repeats = repeats_for_size(size);
+    const int64_t operations_num = size * repeats;
+    int64_t sum = 0, c_sum = 0, std_sum = 0;
+
+    double push_ns = 0.0, pop_ns = 0.0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      Stack<int> stack;
+      Clock::time_point start = Clock::now();
+      for (const int64_t i : IndexRange(size)) {
+        stack.push((int)i);
+      }
+      push_ns += elapsed_ns(start);
+      start = Clock::now();
+      while (!stack.is_empty()) {
+        sum += stack.pop();
+      }
+      pop_ns += elapsed_ns(start);
+    }
+    print_result("Stack<int>", "push", size, push_ns, operations_num);
+    print_result("Stack<int>", "pop", size, pop_ns, operations_num);
+
+    push_ns = 0.0;
+    pop_ns = 0.0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      BLI_Stack *stack = BLI_stack_new(sizeof(int), __func__);
+      Clock::time_point start = Clock::now();
+      for (const int64_t i : IndexRange(size)) {
+        const int value = (int)i;
+        BLI_stack_push(stack, &value);
+      }
+      push_ns += elapsed_ns(start);
+      start = Clock::now();
+      while (!BLI_stack_is_empty(stack)) {
+        int value;
+        BLI_stack_pop(stack, &value);
+        c_sum += value;
+      }
+      pop_ns += elapsed_ns(start);
+      BLI_stack_free(stack);
+    }
+    print_result("BLI_Stack", "push", size, push_ns, operations_num);
+    print_result("BLI_Stack", "pop", size, pop_ns, operations_num);
+
+    push_ns = 0.0;
+    pop_ns = 0.0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      std::stack<int> stack;
+      Clock::time_point start = Clock::now();
+      for (const int64_t i : IndexRange(size)) {
+        stack.push((int)i);
+      }
+      push_ns += elapsed_ns(start);
+      start = Clock::now();
+      while (!stack.empty()) {
+        std_sum += stack.top();
+        stack.pop();
+      }
+      pop_ns += elapsed_ns(start);
+    }
+    print_result("std::stack<int>", "push", size, push_ns, operations_num);
+    print_result("std::stack<int>", "pop", size, pop_ns, operations_num);
+    EXPECT_EQ(sum, c_sum);
+    EXPECT_EQ(sum, std_sum);
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Allocator Benchmarks
+ *
+ * Allocate many small elements and free all of them at once, like the elements of a #BMesh.
+ * \{ */
+
+struct SmallElement {
+  float co[3];
+  int index;
+  void *data[2];
+};
+
+TEST(containers, SmallAllocationPerformance)
+{
+  print_header("Allocate small elements and free all of them");
+  for (const int64_t size : sizes) {
+    const int64_t repeats = repeats_for_size(size);
+    const int64_t operations_num = size * repeats;
+    Vector<SmallElement *> elements(size);
+
+    double ns = 0.0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      Clock::time_point start = Clock::now();
+      {
+        LinearAllocator<> allocator;
+        for (const int64_t i : IndexRange(size)) {
+          elements[i] = allocator.construct<SmallElement>();
+        }
+      }
+      ns += elapsed_ns(start);
+    }
+    print_result("LinearAllocator", "alloc", size, ns, operations_num);
+
+    ns = 0.0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      Clock::time_point start = Clock::now();
+      BLI_mempool *pool = BLI_mempool_create(sizeof(SmallElement), 0, 512, BLI_MEMPOOL_NOP);
+      for (const int64_t i : IndexRange(size)) {
+        elements[i] = (SmallElement *)BLI_mempool_alloc(pool);
+      }
+      BLI_mempool_destroy(pool);
+      ns += elapsed_ns(start);
+    }
+    print_result("BLI_mempool", "alloc", size, ns, operations_num);
+
+    ns = 0.0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      Clock::time_point start = Clock::now();
+      for (const int64_t i : IndexRange(size)) {
+        elements[i] = (SmallElement *)MEM_mallocN(sizeof(SmallElement), __func__);
+      }
+      for (SmallElement *element : elements) {
+        MEM_freeN(element);
+      }
+      ns += elapsed_ns(start);
+    }
+    print_result("MEM_mallocN", "alloc", size, ns, operations_num);
+
+    ns = 0.0;
+    for (int64_t repeat = 0; repeat < repeats; repeat++) {
+      Clock::time_point start = Clock::now();
+      for (const int64_t i : IndexRange(size)) {
+        elements[i] = new SmallElement();
+      }
+      for (SmallElement *element : elements) {
+        delete element;
+      }
+      ns += elapsed_ns(start);
+    }
+    print_result("new", "alloc", size, ns, operations_num);
+  }
+}
+
+/** \} */
+
+}  // namespace blender::tests
@@ -0,0 +1,101 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_math_geom.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+
+#include "PIL_time.h"
+
+/* Build and ray-cast times of trees with the default and the SAH build.
+ * Trees with 6 axes use the SIMD node tests, trees with 8 axes the scalar ones.
+ *
+ * On uniformly distributed triangles the SAH build doesn't pay off, it's meant for
+ * unevenly distributed geometry. */
+
+#define TRIS_NUM 200000
+#define RAYS_NUM 1000000
+
+static void rng_v3_round(float *coords, int coords_len, struct RNG *rng, int round, float scale)
+{
+  for (int i = 0; i < coords_len; i++) {
+    float f = BLI_rng_get_float(rng) * 2.0f - 1.0f;
+    coords[i] = ((float)((int)(f * round)) / (float)round) * scale;
+  }
+}
+
+static void rng_triangles(float (*tris)[3][3], int tris_len, struct RNG *rng)
+{
+  for (int i = 0; i < tris_len; i++) {
+    float center[3];
+    rng_v3_round(center, 3, rng, 1000, 1.0f);
+    for (int j = 0; j < 3; j++) {
+      rng_v3_round(tris[i][j], 3, rng, 1000, 0.05f);
+      add_v3_v3(tris[i][j], center);
+    }
+  }
+}
+
+static void raycast_triangle_cb(void *userdata,
+                                int index,
+                                const BVHTreeRay *ray,
+                                BVHTreeRayHit *hit)
+{
+  const float(*tris)[3][3] = (const float(*)[3][3])userdata;
+  float dist;
+  if (isect_ray_tri_v3(ray->origin, ray->direction, UNPACK3(tris[index]), &dist, nullptr) &&
+      dist < hit->dist) {
+    hit->index = index;
+    hit->dist = dist;
+  }
+}
+
+static void raycast_benchmark(int axis, int balance_flag, const char *name)
+{
+  struct RNG *rng = BLI_rng_new(0);
+  float(*tris)[3][3] = (float(*)[3][3])MEM_mallocN(sizeof(*tris) * TRIS_NUM, __func__);
+  rng_triangles(tris, TRIS_NUM, rng);
+
+  double time = PIL_check_seconds_timer();
+  BVHTree *tree = BLI_bvhtree_new(TRIS_NUM, 0.0f, 4, axis);
+  for (int i = 0; i < TRIS_NUM; i++) {
+    BLI_bvhtree_insert(tree, i, tris[i][0], 3);
+  }
+  BLI_bvhtree_balance_ex(tree, balance_flag);
+  const double time_build = PIL_check_seconds_timer() - time;
+
+  time = PIL_check_seconds_timer();
+  int hits = 0;
+  for (int i = 0; i < RAYS_NUM; i++) {
+    float co[3], dir[3];
+    rng_v3_round(co, 3, rng, 1000, 1.5f);
+    BLI_rng_get_float_unit_v3(rng, dir);
+    BVHTreeRayHit hit = {-1};
+    hit.dist = BVH_RAYCAST_DIST_MAX;
+    BLI_bvhtree_ray_cast(tree, co, dir, 0.0f, &hit, raycast_triangle_cb, tris);
+    hits += (hit.index != -1);
+  }
+  const double time_query = PIL_check_seconds_timer() - time;
+
+  printf("%s: build %.3fs, ray-cast %.3fs (%d hits)\n", name, time_build, time_query, hits);
+
+  BLI_bvhtree_free(tree);
+  MEM_freeN(tris);
+  BLI_rng_free(rng);
+}
+
+TEST(kdopbvh, RaycastDefault)
+{
+  raycast_benchmark(8, 0, "Default (scalar)");
+  raycast_benchmark(6, 0, "Default (SIMD)");
+}
+
+TEST(kdopbvh, RaycastSAH)
+{
+  raycast_benchmark(8, BVH_BALANCE_SAH, "SAH (scalar)");
+  raycast_benchmark(6, BVH_BALANCE_SAH, "SAH (SIMD)");
+}
@@ -29,6 +29,7 @@
 
 #include "BLI_compiler_attrs.h"
 #include "BLI_gsqueue.h"
+#include "BLI_profile.hh"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
 
@@ -103,6 +104,7 @@ void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_nod
 
   /* Sanity checks. */
   BLI_assert(!operation_node->is_noop() && "NOOP nodes should not actually be scheduled");
+  PROFILE_ZONE(operationCodeAsString(operation_node->opcode));
   /* Perform operation. */
   if (state->do_stats) {
     const double start_time = PIL_check_seconds_timer();
@@ -370,6 +372,7 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
     return;
   }
 
+  PROFILE_ZONE("Depsgraph Evaluation");
   graph->debug.begin_graph_evaluation();
 
   graph->is_evaluating = true;
@@ -27,6 +27,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_listbase.h"
 #include "BLI_math.h"
 #include "BLI_threads.h"
@@ -591,7 +593,7 @@ static void image_rect_update(void *rjv, RenderResult *rr, volatile rcti *renrec
         ED_draw_imbuf_method(ibuf) != IMAGE_DRAW_METHOD_GLSL) {
       image_buffer_rect_update(rj, rr, ibuf, &rj->iuser, renrect, viewname);
     }
-    ima->gpuflag |= IMA_GPU_REFRESH;
+    atomic_fetch_and_or_int16(&ima->gpuflag, IMA_GPU_REFRESH);
 
     /* make jobs timer to send notifier */
     *(rj->do_update) = true;
@@ -27,6 +27,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
 #include "BLI_math.h"
@@ -521,7 +523,7 @@ static void screen_opengl_render_apply(const bContext *C, OGLRender *oglrender)
     ibuf->userflags |= IB_DISPLAY_BUFFER_INVALID;
   }
   BKE_image_release_ibuf(oglrender->ima, ibuf, lock);
-  oglrender->ima->gpuflag |= IMA_GPU_REFRESH;
+  atomic_fetch_and_or_int16(&oglrender->ima->gpuflag, IMA_GPU_REFRESH);
 
   if (oglrender->write_still) {
     screen_opengl_render_write(oglrender);
@@ -180,8 +180,10 @@ void imapaint_image_update(
     int w = imapaintpartial.x2 - imapaintpartial.x1;
     int h = imapaintpartial.y2 - imapaintpartial.y1;
     if (w && h) {
-      /* Testing with partial update in uv editor too */
-      BKE_image_update_gputexture(image, iuser, imapaintpartial.x1, imapaintpartial.y1, w, h);
+      /* Testing with partial update in uv editor too. Uploading is delayed until the next
+       * redraw, so that all regions painted in between are uploaded at once. */
+      BKE_image_update_gputexture_delayed(
+          image, ibuf, imapaintpartial.x1, imapaintpartial.y1, w, h);
     }
   }
 }
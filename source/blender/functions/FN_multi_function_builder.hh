@@ -28,6 +28,53 @@
 
 namespace blender::fn {
 
+namespace detail {
+
+/**
+ * Wraps a single value, so that it can be indexed like the array of a full #VSpan.
+ */
+template<typename T> class SingleValueArray {
+ private:
+  const T &value_;
+
+ public:
+  SingleValueArray(const T &value) : value_(value)
+  {
+  }
+
+  const T &operator[](const int64_t UNUSED(index)) const
+  {
+    return value_;
+  }
+};
+
+/**
+ * Spans that reference a single value or a full array can be devirtualized. Spans of pointers
+ * are rare, they are handled by the generic code path.
+ */
+template<typename... T> inline bool vspans_are_devirtualizable(const VSpan<T> &...spans)
+{
+  return ((spans.is_single_element() || spans.is_full_array()) && ...);
+}
+
+/**
+ * Calls \a fn with the elements of \a span as either a #SingleValueArray or a pointer to the
+ * full array. Both can be indexed without checking the category of the span for every element,
+ * so that element-wise loops in \a fn are compiled into tight loops the compiler can vectorize.
+ */
+template<typename T, typename Fn>
+inline void devirtualize_vspan(const VSpan<T> &span, const Fn &fn)
+{
+  if (span.is_single_element()) {
+    fn(SingleValueArray<T>(span.as_single_element()));
+  }
+  else {
+    fn(span.as_full_array().data());
+  }
+}
+
+}  // namespace detail
+
 /**
  * Generates a multi-function with the following parameters:
  * 1. single input (SI) of type In1
@@ -58,8 +105,17 @@ template<typename In1, typename Out1> class CustomMF_SI_SO : public MultiFunctio
   template<typename ElementFuncT> static FunctionT create_function(ElementFuncT element_fn)
   {
     return [=](IndexMask mask, VSpan<In1> in1, MutableSpan<Out1> out1) {
-      mask.foreach_index(
-          [&](int i) { new (static_cast<void *>(&out1[i])) Out1(element_fn(in1[i])); });
+      Out1 *out1_data = out1.data();
+      if (!detail::vspans_are_devirtualizable(in1)) {
+        mask.foreach_index(
+            [&](int64_t i) { new (static_cast<void *>(out1_data + i)) Out1(element_fn(in1[i])); });
+        return;
+      }
+      detail::devirtualize_vspan(in1, [&](const auto &in1_array) {
+        mask.foreach_index([&](int64_t i) {
+          new (static_cast<void *>(out1_data + i)) Out1(element_fn(in1_array[i]));
+        });
+      });
     };
   }
 
@@ -101,8 +157,20 @@ class CustomMF_SI_SI_SO : public MultiFunction {
   template<typename ElementFuncT> static FunctionT create_function(ElementFuncT element_fn)
   {
     return [=](IndexMask mask, VSpan<In1> in1, VSpan<In2> in2, MutableSpan<Out1> out1) {
-      mask.foreach_index(
-          [&](int i) { new (static_cast<void *>(&out1[i])) Out1(element_fn(in1[i], in2[i])); });
+      Out1 *out1_data = out1.data();
+      if (!detail::vspans_are_devirtualizable(in1, in2)) {
+        mask.foreach_index([&](int64_t i) {
+          new (static_cast<void *>(out1_data + i)) Out1(element_fn(in1[i], in2[i]));
+        });
+        return;
+      }
+      detail::devirtualize_vspan(in1, [&](const auto &in1_array) {
+        detail::devirtualize_vspan(in2, [&](const auto &in2_array) {
+          mask.foreach_index([&](int64_t i) {
+            new (static_cast<void *>(out1_data + i)) Out1(element_fn(in1_array[i], in2_array[i]));
+          });
+        });
+      });
     };
   }
 
@@ -152,8 +220,22 @@ class CustomMF_SI_SI_SI_SO : public MultiFunction {
                VSpan<In2> in2,
                VSpan<In3> in3,
                MutableSpan<Out1> out1) {
-      mask.foreach_index([&](int i) {
-        new (static_cast<void *>(&out1[i])) Out1(element_fn(in1[i], in2[i], in3[i]));
+      Out1 *out1_data = out1.data();
+      if (!detail::vspans_are_devirtualizable(in1, in2, in3)) {
+        mask.foreach_index([&](int64_t i) {
+          new (static_cast<void *>(out1_data + i)) Out1(element_fn(in1[i], in2[i], in3[i]));
+        });
+        return;
+      }
+      detail::devirtualize_vspan(in1, [&](const auto &in1_array) {
+        detail::devirtualize_vspan(in2, [&](const auto &in2_array) {
+          detail::devirtualize_vspan(in3, [&](const auto &in3_array) {
+            mask.foreach_index([&](int64_t i) {
+              new (static_cast<void *>(out1_data + i))
+                  Out1(element_fn(in1_array[i], in2_array[i], in3_array[i]));
+            });
+          });
+        });
       });
     };
   }
@@ -193,7 +275,8 @@ template<typename Mut1> class CustomMF_SM : public MultiFunction {
   template<typename ElementFuncT> static FunctionT create_function(ElementFuncT element_fn)
   {
     return [=](IndexMask mask, MutableSpan<Mut1> mut1) {
-      mask.foreach_index([&](int i) { element_fn(mut1[i]); });
+      Mut1 *mut1_data = mut1.data();
+      mask.foreach_index([&](int64_t i) { element_fn(mut1_data[i]); });
     };
   }
 
@@ -25,6 +25,7 @@
 namespace blender::fn {
 
 class MFNetworkEvaluationStorage;
+class MFNetworkEvaluationBufferCache;
 
 class MFNetworkEvaluator : public MultiFunction {
  private:
@@ -38,6 +39,14 @@ class MFNetworkEvaluator : public MultiFunction {
 
  private:
   using Storage = MFNetworkEvaluationStorage;
+  using BufferCache = MFNetworkEvaluationBufferCache;
+
+  bool supports_chunked_evaluation() const;
+  void evaluate_in_chunks(IndexMask mask, MFParams params, MFContext context) const;
+  void evaluate(IndexMask mask,
+                MFParams params,
+                MFContext context,
+                BufferCache *buffer_cache) const;
 
   void copy_inputs_to_storage(MFParams params, Storage &storage) const;
   void copy_outputs_to_storage(
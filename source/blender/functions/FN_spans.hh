@@ -419,6 +419,29 @@ class GVSpan : public VSpanBase<void> {
     return VSpan<T>(*this);
   }
 
+  /**
+   * Returns a virtual span that references \a size elements beginning at \a start. A single
+   * value remains a single value.
+   */
+  GVSpan slice(int64_t start, int64_t size) const
+  {
+    BLI_assert(start >= 0);
+    BLI_assert(size >= 0);
+    BLI_assert(start + size <= this->virtual_size_);
+    switch (this->category_) {
+      case VSpanCategory::Single:
+        return GVSpan::FromSingle(*type_, this->data_.single.data, size);
+      case VSpanCategory::FullArray:
+        return GSpan(
+            *type_, POINTER_OFFSET(this->data_.full_array.data, start * type_->size()), size);
+      case VSpanCategory::FullPointerArray:
+        return GVSpan::FromFullPointerArray(
+            *type_, this->data_.full_pointer_array.data + start, size);
+    }
+    BLI_assert(false);
+    return GVSpan(*type_);
+  }
+
   const void *as_single_element() const
   {
     BLI_assert(this->is_single_element());
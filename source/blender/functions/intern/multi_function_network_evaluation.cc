@@ -29,20 +29,70 @@
  * - Every node is executed at most once.
  * - Can compute sub-functions on a single element, when the result is the same for all elements.
  *
+ * - Large masks are split into chunks, which are evaluated in parallel. This keeps temporary
+ *   buffers small and buffers are reused by the chunks evaluated on the same thread.
+ *
  * Possible improvements:
- * - Cache and reuse buffers.
  * - Use "deepest depth first" heuristic to decide which order the inputs of a node should be
  *   computed. This reduces the number of required temporary buffers when they are reused.
  */
 
 #include "FN_multi_function_network_evaluation.hh"
 
+#include "BLI_map.hh"
 #include "BLI_stack.hh"
+#include "BLI_task.hh"
 
 namespace blender::fn {
 
 struct Value;
 
+/**
+ * Masks larger than this are evaluated in chunks of this size. It is small enough for the
+ * temporary buffers of a chunk to stay in the CPU cache.
+ */
+static constexpr int64_t evaluation_chunk_size = 4096;
+
+/**
+ * Buffers that are not used anymore by an evaluation are kept here, so that they can be reused
+ * when the network is evaluated for the next chunk. A cache must only be used by one thread.
+ */
+class MFNetworkEvaluationBufferCache {
+ private:
+  static constexpr int64_t alignment_ = 64;
+  Map<int64_t, Vector<void *>> free_buffers_by_size_;
+
+ public:
+  MFNetworkEvaluationBufferCache() = default;
+  MFNetworkEvaluationBufferCache(const MFNetworkEvaluationBufferCache &other) = delete;
+  MFNetworkEvaluationBufferCache &operator=(const MFNetworkEvaluationBufferCache &other) = delete;
+
+  ~MFNetworkEvaluationBufferCache()
+  {
+    for (Vector<void *> &buffers : free_buffers_by_size_.values()) {
+      for (void *buffer : buffers) {
+        MEM_freeN(buffer);
+      }
+    }
+  }
+
+  void *allocate(int64_t size, int64_t alignment)
+  {
+    BLI_assert(alignment <= alignment_);
+    UNUSED_VARS_NDEBUG(alignment);
+    Vector<void *> *buffers = free_buffers_by_size_.lookup_ptr(size);
+    if (buffers != nullptr && !buffers->is_empty()) {
+      return buffers->pop_last();
+    }
+    return MEM_mallocN_aligned(size, alignment_, AT);
+  }
+
+  void deallocate(void *buffer, int64_t size)
+  {
+    free_buffers_by_size_.lookup_or_add_default(size).append(buffer);
+  }
+};
+
 /**
  * This keeps track of all the values that flow through the multi-function network. Therefore it
  * maintains a mapping between output sockets and their corresponding values. Every `value`
@@ -56,9 +106,12 @@ class MFNetworkEvaluationStorage {
   IndexMask mask_;
   Array<Value *> value_per_output_id_;
   int64_t min_array_size_;
+  MFNetworkEvaluationBufferCache *buffer_cache_;
 
  public:
-  MFNetworkEvaluationStorage(IndexMask mask, int socket_id_amount);
+  MFNetworkEvaluationStorage(IndexMask mask,
+                             int socket_id_amount,
+                             MFNetworkEvaluationBufferCache *buffer_cache);
   ~MFNetworkEvaluationStorage();
 
   /* Add the values that have been provided by the caller of the multi-function network. */
@@ -97,6 +150,10 @@ class MFNetworkEvaluationStorage {
   bool socket_is_computed(const MFOutputSocket &socket);
   bool is_same_value_for_every_index(const MFOutputSocket &socket);
   bool socket_has_buffer_for_output(const MFOutputSocket &socket);
+
+ private:
+  GMutableSpan allocate_full_buffer(const CPPType &type);
+  void free_full_buffer(GMutableSpan span);
 };
 
 MFNetworkEvaluator::MFNetworkEvaluator(Vector<const MFOutputSocket *> inputs,
@@ -141,8 +198,124 @@ void MFNetworkEvaluator::call(IndexMask mask, MFParams params, MFContext context
     return;
   }
 
+  if (mask.size() > evaluation_chunk_size && this->supports_chunked_evaluation()) {
+    this->evaluate_in_chunks(mask, params, context);
+  }
+  else {
+    this->evaluate(mask, params, context, nullptr);
+  }
+}
+
+bool MFNetworkEvaluator::supports_chunked_evaluation() const
+{
+  /* Vector outputs can't be split into independent parts. */
+  for (int param_index : this->param_indices()) {
+    const MFParamType param_type = this->param_type(param_index);
+    if (!ELEM(param_type.category(), MFParamType::SingleInput, MFParamType::SingleOutput)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+BLI_NOINLINE void MFNetworkEvaluator::evaluate_in_chunks(IndexMask mask,
+                                                         MFParams params,
+                                                         MFContext context) const
+{
+  Vector<GVSpan> inputs;
+  Vector<GMutableSpan> outputs;
+  for (int param_index : this->param_indices()) {
+    if (this->param_type(param_index).category() == MFParamType::SingleInput) {
+      inputs.append(params.readonly_single_input(param_index));
+    }
+    else {
+      outputs.append(params.uninitialized_single_output(param_index));
+    }
+  }
+
+  const int64_t chunks_len = (mask.size() + evaluation_chunk_size - 1) / evaluation_chunk_size;
+  parallel_for(IndexRange(chunks_len), 1, [&](IndexRange chunk_range) {
+    BufferCache buffer_cache;
+    Vector<GMutableSpan> compact_inputs;
+    Vector<GMutableSpan> compact_outputs;
+
+    for (const int64_t chunk_index : chunk_range) {
+      const int64_t start = chunk_index * evaluation_chunk_size;
+      const Span<int64_t> indices = mask.indices().slice(
+          start, std::min(evaluation_chunk_size, mask.size() - start));
+      const int64_t chunk_size = indices.size();
+      const IndexMask chunk_mask(chunk_size);
+      MFParamsBuilder chunk_params(*this, chunk_size);
+
+      const int64_t offset = indices.first();
+      if (indices.last() - offset + 1 == chunk_size) {
+        /* The indices are contiguous, reference the parameters directly. */
+        for (const GVSpan &input : inputs) {
+          chunk_params.add_readonly_single_input(input.slice(offset, chunk_size));
+        }
+        for (GMutableSpan output : outputs) {
+          const CPPType &type = output.type();
+          chunk_params.add_uninitialized_single_output(GMutableSpan(
+              type, POINTER_OFFSET(output.data(), offset * type.size()), chunk_size));
+        }
+        this->evaluate(chunk_mask, chunk_params, context, &buffer_cache);
+        continue;
+      }
+
+      /* Gather the indices of a sparse chunk into compact buffers, so that all buffers only have
+       * the size of the chunk, independent of the range its indices span. */
+      compact_inputs.clear();
+      compact_outputs.clear();
+      for (const GVSpan &input : inputs) {
+        const CPPType &type = input.type();
+        if (input.is_single_element()) {
+          chunk_params.add_readonly_single_input(
+              GVSpan::FromSingle(type, input.as_single_element(), chunk_size));
+          continue;
+        }
+        GMutableSpan compact(
+            type, buffer_cache.allocate(chunk_size * type.size(), type.alignment()), chunk_size);
+        for (const int64_t i : IndexRange(chunk_size)) {
+          type.copy_to_uninitialized(input[indices[i]], compact[i]);
+        }
+        compact_inputs.append(compact);
+        chunk_params.add_readonly_single_input(compact);
+      }
+      for (GMutableSpan output : outputs) {
+        const CPPType &type = output.type();
+        GMutableSpan compact(
+            type, buffer_cache.allocate(chunk_size * type.size(), type.alignment()), chunk_size);
+        compact_outputs.append(compact);
+        chunk_params.add_uninitialized_single_output(compact);
+      }
+
+      this->evaluate(chunk_mask, chunk_params, context, &buffer_cache);
+
+      for (const int64_t output_index : outputs.index_range()) {
+        GMutableSpan output = outputs[output_index];
+        GMutableSpan compact = compact_outputs[output_index];
+        const CPPType &type = output.type();
+        for (const int64_t i : IndexRange(chunk_size)) {
+          type.relocate_to_uninitialized(compact[i], output[indices[i]]);
+        }
+        buffer_cache.deallocate(compact.data(), chunk_size * type.size());
+      }
+      for (GMutableSpan compact : compact_inputs) {
+        const CPPType &type = compact.type();
+        type.destruct_n(compact.data(), chunk_size);
+        buffer_cache.deallocate(compact.data(), chunk_size * type.size());
+      }
+    }
+  });
+}
+
+BLI_NOINLINE void MFNetworkEvaluator::evaluate(IndexMask mask,
+                                               MFParams params,
+                                               MFContext context,
+                                               BufferCache *buffer_cache) const
+{
   const MFNetwork &network = outputs_[0]->node().network();
-  Storage storage(mask, network.socket_id_amount());
+  Storage storage(mask, network.socket_id_amount(), buffer_cache);
 
   Vector<const MFInputSocket *> outputs_to_initialize_in_the_end;
 
@@ -506,13 +679,35 @@ struct OwnVectorValue : public Value {
 /** \name Storage methods
  * \{ */
 
-MFNetworkEvaluationStorage::MFNetworkEvaluationStorage(IndexMask mask, int socket_id_amount)
+MFNetworkEvaluationStorage::MFNetworkEvaluationStorage(
+    IndexMask mask, int socket_id_amount, MFNetworkEvaluationBufferCache *buffer_cache)
     : mask_(mask),
       value_per_output_id_(socket_id_amount, nullptr),
-      min_array_size_(mask.min_array_size())
+      min_array_size_(mask.min_array_size()),
+      buffer_cache_(buffer_cache)
 {
 }
 
+GMutableSpan MFNetworkEvaluationStorage::allocate_full_buffer(const CPPType &type)
+{
+  const int64_t size = min_array_size_ * type.size();
+  void *buffer = (buffer_cache_ != nullptr) ?
+                     buffer_cache_->allocate(size, type.alignment()) :
+                     MEM_mallocN_aligned(size, type.alignment(), AT);
+  return GMutableSpan(type, buffer, min_array_size_);
+}
+
+/* The elements of the buffer have to be destructed already. */
+void MFNetworkEvaluationStorage::free_full_buffer(GMutableSpan span)
+{
+  if (buffer_cache_ != nullptr) {
+    buffer_cache_->deallocate(span.data(), span.size() * span.type().size());
+  }
+  else {
+    MEM_freeN(span.data());
+  }
+}
+
 MFNetworkEvaluationStorage::~MFNetworkEvaluationStorage()
 {
   for (Value *any_value : value_per_output_id_) {
@@ -528,7 +723,7 @@ MFNetworkEvaluationStorage::~MFNetworkEvaluationStorage()
       }
       else {
         type.destruct_indices(span.data(), mask_);
-        MEM_freeN(span.data());
+        this->free_full_buffer(span);
       }
     }
     else if (any_value->type == ValueType::OwnVector) {
@@ -638,7 +833,7 @@ void MFNetworkEvaluationStorage::finish_input_socket(const MFInputSocket &socket
         }
         else {
           type.destruct_indices(span.data(), mask_);
-          MEM_freeN(span.data());
+          this->free_full_buffer(span);
         }
         value_per_output_id_[origin.id()] = nullptr;
       }
@@ -702,8 +897,7 @@ GMutableSpan MFNetworkEvaluationStorage::get_single_output__full(const MFOutputS
   Value *any_value = value_per_output_id_[socket.id()];
   if (any_value == nullptr) {
     const CPPType &type = socket.data_type().single_type();
-    void *buffer = MEM_mallocN_aligned(min_array_size_ * type.size(), type.alignment(), AT);
-    GMutableSpan span(type, buffer, min_array_size_);
+    GMutableSpan span = this->allocate_full_buffer(type);
 
     auto *value = allocator_.construct<OwnSingleValue>(span, socket.targets().size(), false);
     value_per_output_id_[socket.id()] = value;
@@ -802,8 +996,7 @@ GMutableSpan MFNetworkEvaluationStorage::get_mutable_single__full(const MFInputS
   }
 
   GVSpan virtual_span = this->get_single_input__full(input);
-  void *new_buffer = MEM_mallocN_aligned(min_array_size_ * type.size(), type.alignment(), AT);
-  GMutableSpan new_array_ref(type, new_buffer, min_array_size_);
+  GMutableSpan new_array_ref = this->allocate_full_buffer(type);
   virtual_span.materialize_to_uninitialized(mask_, new_array_ref.data());
 
   OwnSingleValue *new_value = allocator_.construct<OwnSingleValue>(
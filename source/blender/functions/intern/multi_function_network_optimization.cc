@@ -18,9 +18,12 @@
  * \ingroup fn
  */
 
+#include <algorithm>
 /* Used to check if two multi-functions have the exact same type. */
 #include <typeinfo>
 
+#include "MEM_guardedalloc.h"
+
 #include "FN_multi_function_builder.hh"
 #include "FN_multi_function_network_evaluation.hh"
 #include "FN_multi_function_network_optimization.hh"
@@ -31,6 +34,7 @@
 #include "BLI_multi_value_map.hh"
 #include "BLI_rand.h"
 #include "BLI_stack.hh"
+#include "BLI_vector_set.hh"
 
 namespace blender::fn::mf_network_optimization {
 
@@ -505,4 +509,315 @@ void common_subnetwork_elimination(MFNetwork &network)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Element-wise Function Fusion
+ *
+ * Every function node in a network writes its output into a full intermediate array that is read
+ * back by the nodes depending on it. For long chains of cheap element-wise functions, most of the
+ * time is then spent moving memory. Fusing such chains into a single function allows processing
+ * small blocks of elements through all stages while the data is still in the cache.
+ * \{ */
+
+/* Amount of elements that is passed through all stages of a fused function at once. */
+static constexpr int64_t fused_block_size = 256;
+
+/**
+ * Calls multiple element-wise functions, where later stages can use the outputs of earlier ones.
+ * The output of the last stage is the output of the fused function.
+ */
+class MFElementwiseFusedFunction : public MultiFunction {
+ public:
+  struct Stage {
+    const MultiFunction *fn;
+    /* For every input of the function, the index of the value that is passed in. The first
+     * values are the inputs of the fused function, followed by the outputs of all stages. */
+    Vector<int> sources;
+  };
+
+ private:
+  Vector<Stage> stages_;
+  Vector<const CPPType *> input_types_;
+
+ public:
+  MFElementwiseFusedFunction(Vector<Stage> stages, Span<MFOutputSocket *> inputs)
+      : stages_(std::move(stages))
+  {
+    std::string name = "Fused";
+    for (const Stage &stage : stages_) {
+      name += " " + stage.fn->name();
+    }
+
+    MFSignatureBuilder signature = this->get_builder(std::move(name));
+    for (const MFOutputSocket *socket : inputs) {
+      const CPPType &type = socket->data_type().single_type();
+      input_types_.append(&type);
+      signature.single_input(socket->name(), type);
+    }
+    const MultiFunction &last_fn = *stages_.last().fn;
+    for (int param_index : last_fn.param_indices()) {
+      MFParamType param_type = last_fn.param_type(param_index);
+      if (param_type.is_output()) {
+        signature.single_output(last_fn.param_name(param_index),
+                                param_type.data_type().single_type());
+      }
+    }
+  }
+
+  void call(IndexMask mask, MFParams params, MFContext context) const override
+  {
+    if (mask.size() == 0) {
+      return;
+    }
+
+    const int inputs_len = input_types_.size();
+    const int stages_len = stages_.size();
+
+    Array<GVSpan> inputs(inputs_len, GVSpan(CPPType::get<int>()));
+    for (int i : IndexRange(inputs_len)) {
+      inputs[i] = params.readonly_single_input(i);
+    }
+    GMutableSpan output = params.uninitialized_single_output(inputs_len);
+
+    /* Buffers for the outputs of all but the last stage, reused for every block. */
+    Array<const CPPType *> buffer_types(stages_len - 1);
+    Array<void *> buffers(stages_len - 1);
+    for (int stage_index : IndexRange(stages_len - 1)) {
+      const CPPType &type = this->stage_output_type(stage_index);
+      buffer_types[stage_index] = &type;
+      buffers[stage_index] = MEM_mallocN_aligned(
+          fused_block_size * type.size(), std::max<int64_t>(type.alignment(), 64), __func__);
+    }
+
+    Vector<int64_t> offset_indices;
+    const Span<int64_t> indices = mask.indices();
+    int64_t mask_start = 0;
+    while (mask_start < indices.size()) {
+      /* Find all indices that fall into the next block, starting at the first remaining index. */
+      const int64_t offset = indices[mask_start];
+      const Span<int64_t> candidates = indices.slice(
+          mask_start, std::min(fused_block_size, indices.size() - mask_start));
+      const int64_t block_len = std::lower_bound(candidates.begin(),
+                                                 candidates.end(),
+                                                 offset + fused_block_size) -
+                                candidates.begin();
+      const Span<int64_t> block_indices = candidates.take_front(block_len);
+      mask_start += block_len;
+
+      /* Offset the block to start at index zero, so that it fits into the buffers. */
+      const int64_t array_size = block_indices.last() - offset + 1;
+      if (array_size != block_len) {
+        offset_indices.clear();
+        for (const int64_t i : block_indices) {
+          offset_indices.append(i - offset);
+        }
+      }
+      const IndexMask block_mask = (array_size == block_len) ?
+                                       IndexMask(IndexRange(array_size)) :
+                                       IndexMask(offset_indices.as_span());
+
+      for (int stage_index : IndexRange(stages_len)) {
+        const Stage &stage = stages_[stage_index];
+        MFParamsBuilder stage_params(*stage.fn, array_size);
+        int input_index = 0;
+        for (int param_index : stage.fn->param_indices()) {
+          MFParamType param_type = stage.fn->param_type(param_index);
+          if (param_type.is_input_or_mutable()) {
+            const int source = stage.sources[input_index++];
+            if (source < inputs_len) {
+              stage_params.add_readonly_single_input(inputs[source].slice(offset, array_size));
+            }
+            else {
+              const int buffer_index = source - inputs_len;
+              stage_params.add_readonly_single_input(
+                  GSpan(*buffer_types[buffer_index], buffers[buffer_index], array_size));
+            }
+          }
+          else if (stage_index == stages_len - 1) {
+            stage_params.add_uninitialized_single_output(GMutableSpan(
+                output.type(), POINTER_OFFSET(output.data(), offset * output.type().size()),
+                array_size));
+          }
+          else {
+            stage_params.add_uninitialized_single_output(
+                GMutableSpan(*buffer_types[stage_index], buffers[stage_index], array_size));
+          }
+        }
+        stage.fn->call(block_mask, stage_params, context);
+      }
+
+      for (int buffer_index : buffers.index_range()) {
+        buffer_types[buffer_index]->destruct_indices(buffers[buffer_index], block_mask);
+      }
+    }
+
+    for (void *buffer : buffers) {
+      MEM_freeN(buffer);
+    }
+  }
+
+ private:
+  const CPPType &stage_output_type(int stage_index) const
+  {
+    const MultiFunction &fn = *stages_[stage_index].fn;
+    for (int param_index : fn.param_indices()) {
+      MFParamType param_type = fn.param_type(param_index);
+      if (param_type.is_output()) {
+        return param_type.data_type().single_type();
+      }
+    }
+    BLI_assert(false);
+    return CPPType::get<int>();
+  }
+};
+
+static bool function_node_is_fusable(const MFFunctionNode &node)
+{
+  const MultiFunction &fn = node.function();
+  if (fn.depends_on_context()) {
+    return false;
+  }
+  if (node.has_unlinked_inputs()) {
+    return false;
+  }
+  if (node.outputs().size() != 1) {
+    return false;
+  }
+  for (int param_index : fn.param_indices()) {
+    MFParamType param_type = fn.param_type(param_index);
+    if (!ELEM(param_type.category(), MFParamType::SingleInput, MFParamType::SingleOutput)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * A fusable node can be merged into the node that uses its output, when no other node depends on
+ * the output. Returns that node or null.
+ */
+static MFFunctionNode *find_fusion_target(MFFunctionNode &node, Span<bool> is_fusable)
+{
+  if (!is_fusable[node.id()]) {
+    return nullptr;
+  }
+  Span<MFInputSocket *> targets = node.output(0).targets();
+  if (targets.is_empty()) {
+    return nullptr;
+  }
+  MFNode &target_node = targets[0]->node();
+  if (!is_fusable[target_node.id()]) {
+    return nullptr;
+  }
+  for (const MFInputSocket *target : targets) {
+    if (&target->node() != &target_node) {
+      return nullptr;
+    }
+  }
+  return &target_node.as_function();
+}
+
+/**
+ * Collects the nodes that are merged into the given node in an order that respects
+ * dependencies. The given node comes last.
+ */
+static void gather_fused_nodes(MFFunctionNode &node,
+                               Span<MFFunctionNode *> fusion_targets,
+                               VectorSet<MFFunctionNode *> &r_nodes)
+{
+  if (r_nodes.contains(&node)) {
+    return;
+  }
+  for (MFInputSocket *input : node.inputs()) {
+    MFNode &origin_node = input->origin()->node();
+    if (fusion_targets[origin_node.id()] == &node) {
+      gather_fused_nodes(origin_node.as_function(), fusion_targets, r_nodes);
+    }
+  }
+  r_nodes.add_new(&node);
+}
+
+static void fuse_nodes(MFNetwork &network,
+                       Span<MFFunctionNode *> nodes,
+                       ResourceCollector &resources)
+{
+  VectorSet<MFOutputSocket *> external_inputs;
+  Map<const MFNode *, int> stage_by_node;
+  for (int stage_index : nodes.index_range()) {
+    stage_by_node.add_new(nodes[stage_index], stage_index);
+  }
+
+  Vector<MFElementwiseFusedFunction::Stage> stages;
+  for (MFFunctionNode *node : nodes) {
+    MFElementwiseFusedFunction::Stage stage;
+    stage.fn = &node->function();
+    for (MFInputSocket *input : node->inputs()) {
+      MFOutputSocket *origin = input->origin();
+      const int *origin_stage = stage_by_node.lookup_ptr(&origin->node());
+      if (origin_stage == nullptr) {
+        external_inputs.add(origin);
+        stage.sources.append(external_inputs.index_of(origin));
+      }
+      else {
+        stage.sources.append(-1 - *origin_stage);
+      }
+    }
+    stages.append(std::move(stage));
+  }
+
+  /* Stage outputs are stored after the external inputs. */
+  for (MFElementwiseFusedFunction::Stage &stage : stages) {
+    for (int &source : stage.sources) {
+      if (source < 0) {
+        source = external_inputs.size() + (-1 - source);
+      }
+    }
+  }
+
+  const MultiFunction &fused_fn = resources.construct<MFElementwiseFusedFunction>(
+      __func__, std::move(stages), external_inputs.as_span());
+  MFFunctionNode &fused_node = network.add_function(fused_fn);
+  for (int i : external_inputs.as_span().index_range()) {
+    network.add_link(*external_inputs[i], fused_node.input(i));
+  }
+  network.relink(nodes.last()->output(0), fused_node.output(0));
+  network.remove(nodes.cast<MFNode *>());
+}
+
+/**
+ * Replace trees of element-wise function nodes that only have a single output with a single
+ * function node that evaluates all of them block by block. Intermediate values that are used
+ * elsewhere in the network are kept as separate nodes.
+ */
+void elementwise_function_fusion(MFNetwork &network, ResourceCollector &resources)
+{
+  Array<bool> is_fusable(network.node_id_amount(), false);
+  for (MFFunctionNode *node : network.function_nodes()) {
+    is_fusable[node->id()] = function_node_is_fusable(*node);
+  }
+
+  Array<MFFunctionNode *> fusion_targets(network.node_id_amount(), nullptr);
+  for (MFFunctionNode *node : network.function_nodes()) {
+    fusion_targets[node->id()] = find_fusion_target(*node, is_fusable);
+  }
+
+  /* Every tree of fusable nodes has a root whose output is used outside of the tree. */
+  Vector<Vector<MFFunctionNode *>> groups;
+  for (MFFunctionNode *node : network.function_nodes()) {
+    if (!is_fusable[node->id()] || fusion_targets[node->id()] != nullptr) {
+      continue;
+    }
+    VectorSet<MFFunctionNode *> nodes;
+    gather_fused_nodes(*node, fusion_targets, nodes);
+    if (nodes.size() >= 2) {
+      groups.append(Vector<MFFunctionNode *>(nodes.as_span()));
+    }
+  }
+
+  for (Span<MFFunctionNode *> nodes : groups) {
+    fuse_nodes(network, nodes, resources);
+  }
+}
+
+/** \} */
+
 }  // namespace blender::fn::mf_network_optimization
@@ -5,6 +5,7 @@
 #include "FN_multi_function_builder.hh"
 #include "FN_multi_function_network.hh"
 #include "FN_multi_function_network_evaluation.hh"
+#include "FN_multi_function_network_optimization.hh"
 
 namespace blender::fn::tests {
 namespace {
@@ -251,5 +252,135 @@ TEST(multi_function_network, Test2)
   }
 }
 
+TEST(multi_function_network, LargeMask)
+{
+  /* Large masks are evaluated in chunks, make sure all of them are computed. */
+  CustomMF_SI_SO<int, std::string> to_string_fn("to string",
+                                                 [](int value) { return std::to_string(value); });
+  CustomMF_SI_SI_SO<std::string, int, int> length_fn(
+      "length", [](const std::string &str, int value) { return (int)str.size() + value; });
+
+  MFNetwork network;
+
+  MFNode &node1 = network.add_function(to_string_fn);
+  MFNode &node2 = network.add_function(length_fn);
+  MFOutputSocket &input_socket = network.add_input("Input", MFDataType::ForSingle<int>());
+  MFInputSocket &output_socket = network.add_output("Output", MFDataType::ForSingle<int>());
+  network.add_link(input_socket, node1.input(0));
+  network.add_link(node1.output(0), node2.input(0));
+  network.add_link(input_socket, node2.input(1));
+  network.add_link(node2.output(0), output_socket);
+
+  MFNetworkEvaluator network_fn{{&input_socket}, {&output_socket}};
+
+  const int size = 100000;
+  Array<int> values(size);
+  for (const int i : values.index_range()) {
+    values[i] = i;
+  }
+  MFContextBuilder context;
+
+  {
+    Array<int> results(size, -1);
+    MFParamsBuilder params(network_fn, size);
+    params.add_readonly_single_input(values.as_span());
+    params.add_uninitialized_single_output(results.as_mutable_span());
+    network_fn.call(IndexRange(size), params, context);
+
+    for (const int i : results.index_range()) {
+      EXPECT_EQ(results[i], (int)std::to_string(i).size() + i);
+    }
+  }
+  {
+    Vector<int64_t> indices;
+    for (int i = 5; i < size; i += 3) {
+      indices.append(i);
+    }
+    Array<int> results(size, -1);
+    MFParamsBuilder params(network_fn, size);
+    params.add_readonly_single_input(values.as_span());
+    params.add_uninitialized_single_output(results.as_mutable_span());
+    network_fn.call(indices.as_span(), params, context);
+
+    for (const int i : results.index_range()) {
+      if (i >= 5 && (i - 5) % 3 == 0) {
+        EXPECT_EQ(results[i], (int)std::to_string(i).size() + i);
+      }
+      else {
+        EXPECT_EQ(results[i], -1);
+      }
+    }
+  }
+}
+
+TEST(multi_function_network, ElementwiseFusion)
+{
+  CustomMF_SI_SO<int, std::string> to_string_fn("to string",
+                                                 [](int value) { return std::to_string(value); });
+  CustomMF_SI_SI_SO<std::string, int, int> length_fn(
+      "length", [](const std::string &str, int value) { return (int)str.size() + value; });
+  CustomMF_SI_SO<int, int> add_10_fn("add 10", [](int value) { return value + 10; });
+  CustomMF_SI_SI_SO<int, int, int> multiply_fn("multiply", [](int a, int b) { return a * b; });
+
+  MFNetwork network;
+
+  MFNode &node1 = network.add_function(to_string_fn);
+  MFNode &node2 = network.add_function(length_fn);
+  MFNode &node3 = network.add_function(add_10_fn);
+  MFNode &node4 = network.add_function(multiply_fn);
+  MFNode &node5 = network.add_function(add_10_fn);
+  MFOutputSocket &input_socket = network.add_input("Input", MFDataType::ForSingle<int>());
+  MFInputSocket &output_socket1 = network.add_output("Output 1", MFDataType::ForSingle<int>());
+  MFInputSocket &output_socket2 = network.add_output("Output 2", MFDataType::ForSingle<int>());
+  network.add_link(input_socket, node1.input(0));
+  network.add_link(node1.output(0), node2.input(0));
+  network.add_link(input_socket, node2.input(1));
+  network.add_link(input_socket, node3.input(0));
+  network.add_link(node2.output(0), node4.input(0));
+  network.add_link(node3.output(0), node4.input(1));
+  network.add_link(node4.output(0), node5.input(0));
+  network.add_link(node5.output(0), output_socket1);
+  /* The result of the multiplication is used twice, so it has to be computed separately. */
+  network.add_link(node4.output(0), output_socket2);
+
+  ResourceCollector resources;
+  mf_network_optimization::elementwise_function_fusion(network, resources);
+  EXPECT_EQ(network.function_nodes().size(), 2);
+
+  MFNetworkEvaluator network_fn{{&input_socket}, {&output_socket1, &output_socket2}};
+
+  const int size = 1000;
+  Array<int> values(size);
+  for (const int i : values.index_range()) {
+    values[i] = i;
+  }
+  Vector<int64_t> indices;
+  for (int i = 5; i < size; i += 3) {
+    indices.append(i);
+  }
+  indices.append(size - 1);
+
+  Array<int> results1(size, -1);
+  Array<int> results2(size, -1);
+  MFParamsBuilder params(network_fn, size);
+  params.add_readonly_single_input(values.as_span());
+  params.add_uninitialized_single_output(results1.as_mutable_span());
+  params.add_uninitialized_single_output(results2.as_mutable_span());
+  MFContextBuilder context;
+  network_fn.call(indices.as_span(), params, context);
+
+  for (const int i : values.index_range()) {
+    if (indices.contains(i)) {
+      const int expected = ((int)std::to_string(i).size() + i) * (i + 10);
+      EXPECT_EQ(results2[i], expected);
+      EXPECT_EQ(results1[i], expected + 10);
+    }
+    else {
+      EXPECT_EQ(results1[i], -1);
+      EXPECT_EQ(results2[i], -1);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace blender::fn::tests
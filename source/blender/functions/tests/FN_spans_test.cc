@@ -219,4 +219,29 @@ TEST(generic_virtual_span, SingleConstructor)
   EXPECT_EQ(converted[2], 5);
 }
 
+TEST(generic_virtual_span, Slice)
+{
+  std::array<int, 5> values = {3, 4, 5, 6, 7};
+  GVSpan span{Span<int>(values)};
+  GVSpan slice = span.slice(1, 3);
+  EXPECT_EQ(slice.size(), 3);
+  EXPECT_TRUE(slice.is_full_array());
+  EXPECT_EQ(slice[0], &values[1]);
+  EXPECT_EQ(slice[2], &values[3]);
+
+  int value = 5;
+  GVSpan single_span = GVSpan::FromSingle(CPPType::get<int32_t>(), &value, 10);
+  GVSpan single_slice = single_span.slice(4, 2);
+  EXPECT_EQ(single_slice.size(), 2);
+  EXPECT_TRUE(single_slice.is_single_element());
+  EXPECT_EQ(single_slice[1], &value);
+
+  std::array<const int *, 3> pointers = {&values[4], &values[0], &values[2]};
+  GVSpan pointer_span = VSpan<int>(Span<const int *>(pointers));
+  GVSpan pointer_slice = pointer_span.slice(1, 2);
+  EXPECT_EQ(pointer_slice.size(), 2);
+  EXPECT_EQ(pointer_slice[0], &values[0]);
+  EXPECT_EQ(pointer_slice[1], &values[2]);
+}
+
 }  // namespace blender::fn::tests
@@ -122,6 +122,16 @@ struct ImBuf *IMB_testiffname(const char *filepath, int flags);
  */
 struct ImBuf *IMB_loadiffname(const char *filepath, int flags, char colorspace[IM_MAX_SPACE]);
 
+/**
+ *
+ * \attention Defined in readimage.c
+ */
+struct ImBuf *IMB_thumb_load_image(const char *filepath,
+                                   const size_t max_thumb_size,
+                                   char colorspace[IM_MAX_SPACE],
+                                   size_t *r_width,
+                                   size_t *r_height);
+
 /**
  *
  * \attention Defined in allocimbuf.c
@@ -462,6 +472,25 @@ bool IMB_scalefastImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy
  */
 void IMB_scaleImBuf_threaded(struct ImBuf *ibuf, unsigned int newx, unsigned int newy);
 
+typedef enum eIMBScaleFilter {
+  /** Average of the covered pixels when scaling down, nearest when scaling up. */
+  IMB_SCALE_FILTER_BOX = 0,
+  IMB_SCALE_FILTER_BILINEAR = 1,
+  /** Bicubic, Mitchell-Netravali with B = C = 1/3. */
+  IMB_SCALE_FILTER_MITCHELL = 2,
+  /** Sharpest, may ring on hard edges. */
+  IMB_SCALE_FILTER_LANCZOS3 = 3,
+} eIMBScaleFilter;
+
+/**
+ *
+ * \attention Defined in scaling.c
+ */
+bool IMB_scaleImBuf_filtered(struct ImBuf *ibuf,
+                             unsigned int newx,
+                             unsigned int newy,
+                             eIMBScaleFilter filter);
+
 /**
  *
  * \attention Defined in writeimage.c
@@ -674,6 +703,19 @@ void IMB_unpremultiply_alpha(struct ImBuf *ibuf);
 void IMB_freezbufImBuf(struct ImBuf *ibuf);
 void IMB_freezbuffloatImBuf(struct ImBuf *ibuf);
 
+/** Size in pixels of the tiles used to track modified regions of image buffers. */
+#define IMB_DIRTY_TILE_SIZE 256
+
+/**
+ *
+ * \attention Defined in dirty_tiles.c
+ */
+void IMB_dirty_tiles_tag(struct ImBuf *ibuf, int x, int y, int w, int h);
+void IMB_dirty_tiles_tag_all(struct ImBuf *ibuf);
+bool IMB_dirty_tiles_any(const struct ImBuf *ibuf);
+struct rcti *IMB_dirty_tiles_pop_regions(struct ImBuf *ibuf, int *r_regions_len);
+void IMB_dirty_tiles_free(struct ImBuf *ibuf);
+
 /**
  *
  * \attention Defined in rectop.c
@@ -277,6 +277,10 @@ typedef struct ImBuf {
   int colormanage_flag;
   rcti invalid_rect;
 
+  /* partial updates */
+  /** Tiles modified since data derived from the pixels was updated, see #IMB_dirty_tiles_tag. */
+  struct ImBufDirtyTiles *dirty_tiles;
+
   /* information for compressed textures */
   struct DDSData dds_data;
 } ImBuf;
@@ -43,6 +43,16 @@ typedef void *(*MovieCacheGetPriorityDataFP)(void *userkey);
 typedef int (*MovieCacheGetItemPriorityFP)(void *last_userkey, void *priority_data);
 typedef void (*MovieCachePriorityDeleterFP)(void *priority_data);
 
+typedef struct MovieCacheStatistics {
+  /* Memory used by cached buffers in bytes. */
+  size_t memory_in_use;
+  /* Number of buffers currently stored. */
+  int totitem;
+  /* Requests which found a buffer, requests which did not and buffers freed to stay within the
+   * memory limit, counted since startup. */
+  uint64_t hits, misses, evictions;
+} MovieCacheStatistics;
+
 void IMB_moviecache_init(void);
 void IMB_moviecache_destruct(void);
 
@@ -70,6 +80,10 @@ void IMB_moviecache_cleanup(struct MovieCache *cache,
                                                    void *userdata),
                             void *userdata);
 
+size_t IMB_moviecache_get_memory_in_use(void);
+void IMB_moviecache_get_statistics(MovieCacheStatistics *r_stats);
+void IMB_moviecache_get_cache_statistics(struct MovieCache *cache, MovieCacheStatistics *r_stats);
+
 void IMB_moviecache_get_cache_segments(
     struct MovieCache *cache, int proxy, int render_flags, int *r_totseg, int **r_points);
 
@@ -130,6 +130,17 @@ struct anim {
   AVFrame *pFrameRGB;
   AVFrame *pFrameDeinterlaced;
   struct SwsContext *img_convert_ctx;
+  /* Per-slice conversion contexts, so the color conversion can run on multiple threads.
+   * Each context converts `img_convert_slice_height` rows (the last one possibly fewer), plus
+   * `img_convert_slice_margin` rows of the neighboring slices which are discarded afterwards.
+   * The slices are converted into `img_convert_slice_buffer` before they're copied to the
+   * frame. */
+  struct SwsContext **img_convert_slice_ctx;
+  int img_convert_slice_num;
+  int img_convert_slice_height;
+  int img_convert_slice_margin;
+  uint8_t *img_convert_slice_buffer;
+  int img_convert_slice_buffer_stride;
   int videoStream;
 
   struct ImBuf *last_frame;
@@ -226,6 +226,7 @@ void IMB_freeImBuf(ImBuf *ibuf)
       imb_freerectImbuf_all(ibuf);
       IMB_metadata_free(ibuf->metadata);
       colormanage_cache_free(ibuf);
+      IMB_dirty_tiles_free(ibuf);
 
       if (ibuf->dds_data.data != NULL) {
         /* dds_data.data is allocated by DirectDrawSurface::readData(), so don't use MEM_freeN! */
@@ -620,6 +621,7 @@ ImBuf *IMB_dupImBuf(const ImBuf *ibuf1)
 
   tbuf.display_buffer_flags = NULL;
   tbuf.colormanage_cache = NULL;
+  tbuf.dirty_tiles = NULL;
 
   *ibuf2 = tbuf;
 
@@ -55,6 +55,8 @@
 
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_system.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "MEM_guardedalloc.h"
@@ -78,6 +80,7 @@
 
 #  include <libavcodec/avcodec.h>
 #  include <libavformat/avformat.h>
+#  include <libavutil/pixdesc.h>
 #  include <libavutil/rational.h>
 #  include <libswscale/swscale.h>
 
@@ -505,6 +508,186 @@ BLI_INLINE bool need_aligned_ffmpeg_buffer(struct anim *anim)
   return (anim->x & 31) != 0;
 }
 
+/* Minimal number of rows converted by a single slice context, smaller slices are not worth the
+ * threading overhead. */
+#  define FFMPEG_CONVERT_SLICE_MIN_HEIGHT 64
+
+static struct SwsContext *ffmpeg_sws_context_create(struct anim *anim,
+                                                    int height,
+                                                    int extra_flags)
+{
+  struct SwsContext *sws_ctx = sws_getContext(anim->x,
+                                              height,
+                                              anim->pCodecCtx->pix_fmt,
+                                              anim->x,
+                                              height,
+                                              AV_PIX_FMT_RGBA,
+                                              SWS_FAST_BILINEAR | SWS_FULL_CHR_H_INT |
+                                                  extra_flags,
+                                              NULL,
+                                              NULL,
+                                              NULL);
+  if (sws_ctx == NULL) {
+    return NULL;
+  }
+
+#  ifdef FFMPEG_SWSCALE_COLOR_SPACE_SUPPORT
+  {
+    /* The following for color space determination */
+    int srcRange, dstRange, brightness, contrast, saturation;
+    int *table;
+    const int *inv_table;
+
+    /* Try do detect if input has 0-255 YCbCR range (JFIF Jpeg MotionJpeg) */
+    if (!sws_getColorspaceDetails(sws_ctx,
+                                  (int **)&inv_table,
+                                  &srcRange,
+                                  &table,
+                                  &dstRange,
+                                  &brightness,
+                                  &contrast,
+                                  &saturation)) {
+      srcRange = srcRange || anim->pCodecCtx->color_range == AVCOL_RANGE_JPEG;
+      inv_table = sws_getCoefficients(anim->pCodecCtx->colorspace);
+
+      if (sws_setColorspaceDetails(sws_ctx,
+                                   (int *)inv_table,
+                                   srcRange,
+                                   table,
+                                   dstRange,
+                                   brightness,
+                                   contrast,
+                                   saturation)) {
+        fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
+      }
+    }
+    else {
+      fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
+    }
+  }
+#  endif
+
+  return sws_ctx;
+}
+
+/* Rows of the neighboring slices converted with every slice, in units of the vertical chroma
+ * sub-sampling. The vertical chroma filter reads one chroma row beyond the rows it outputs, so
+ * without them every slice would clamp the chroma at its edges and show seams. */
+#  define FFMPEG_CONVERT_SLICE_MARGIN_CHROMA_ROWS 2
+
+/* Range of rows converted by a slice context, including the margins. */
+static void ffmpeg_convert_slice_range(const struct anim *anim,
+                                       const int slice,
+                                       int *r_y_start,
+                                       int *r_height,
+                                       int *r_margin_top,
+                                       int *r_margin_bottom)
+{
+  const int y_start = slice * anim->img_convert_slice_height;
+  const int height = MIN2(anim->img_convert_slice_height, anim->y - y_start);
+
+  *r_y_start = y_start;
+  *r_height = height;
+  *r_margin_top = MIN2(anim->img_convert_slice_margin, y_start);
+  *r_margin_bottom = MIN2(anim->img_convert_slice_margin, anim->y - (y_start + height));
+}
+
+/* Create contexts which convert horizontal bands of the frame independently, so the color space
+ * conversion can be spread over multiple threads. Slice boundaries and margins are aligned to the
+ * vertical chroma sub-sampling, so every slice starts at a full chroma row and interpolates the
+ * chroma the same way as a single context would. Formats for which the planes can not be offset
+ * per row (palettized, bitstream) keep using the single context. */
+static void ffmpeg_sws_slice_contexts_create(struct anim *anim)
+{
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(anim->pCodecCtx->pix_fmt);
+  const int num_threads = BLI_system_thread_count();
+
+  anim->img_convert_slice_ctx = NULL;
+  anim->img_convert_slice_num = 0;
+  anim->img_convert_slice_height = 0;
+  anim->img_convert_slice_margin = 0;
+  anim->img_convert_slice_buffer = NULL;
+  anim->img_convert_slice_buffer_stride = 0;
+
+  if (desc == NULL || (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM)) ||
+      num_threads < 2 || anim->y < 2 * FFMPEG_CONVERT_SLICE_MIN_HEIGHT) {
+    return;
+  }
+
+  const int alignment = 1 << desc->log2_chroma_h;
+  int slice_height = (anim->y + num_threads - 1) / num_threads;
+  slice_height = MAX2(slice_height, FFMPEG_CONVERT_SLICE_MIN_HEIGHT);
+  slice_height = ((slice_height + alignment - 1) / alignment) * alignment;
+
+  const int slice_num = (anim->y + slice_height - 1) / slice_height;
+  if (slice_num < 2) {
+    return;
+  }
+
+  anim->img_convert_slice_num = slice_num;
+  anim->img_convert_slice_height = slice_height;
+  anim->img_convert_slice_margin = FFMPEG_CONVERT_SLICE_MARGIN_CHROMA_ROWS * alignment;
+
+  struct SwsContext **slice_ctx = MEM_callocN(sizeof(*slice_ctx) * slice_num,
+                                              "ffmpeg slice sws contexts");
+  for (int i = 0; i < slice_num; i++) {
+    int y_start, height, margin_top, margin_bottom;
+    ffmpeg_convert_slice_range(anim, i, &y_start, &height, &margin_top, &margin_bottom);
+    slice_ctx[i] = ffmpeg_sws_context_create(anim, margin_top + height + margin_bottom, 0);
+    if (slice_ctx[i] == NULL) {
+      for (int j = 0; j < i; j++) {
+        sws_freeContext(slice_ctx[j]);
+      }
+      MEM_freeN(slice_ctx);
+      anim->img_convert_slice_num = 0;
+      anim->img_convert_slice_height = 0;
+      anim->img_convert_slice_margin = 0;
+      return;
+    }
+  }
+
+  const int stride = (anim->x * 4 + 63) & ~63;
+  const int buffer_height = slice_height + 2 * anim->img_convert_slice_margin;
+  anim->img_convert_slice_ctx = slice_ctx;
+  anim->img_convert_slice_buffer_stride = stride;
+  anim->img_convert_slice_buffer = MEM_mallocN_aligned(
+      (size_t)slice_num * buffer_height * stride, 64, "ffmpeg slice conversion buffer");
+}
+
+static void ffmpeg_sws_slice_contexts_free(struct anim *anim)
+{
+  if (anim->img_convert_slice_ctx == NULL) {
+    return;
+  }
+  for (int i = 0; i < anim->img_convert_slice_num; i++) {
+    sws_freeContext(anim->img_convert_slice_ctx[i]);
+  }
+  MEM_freeN(anim->img_convert_slice_ctx);
+  MEM_freeN(anim->img_convert_slice_buffer);
+  anim->img_convert_slice_ctx = NULL;
+  anim->img_convert_slice_buffer = NULL;
+  anim->img_convert_slice_num = 0;
+}
+
+/* Let the decoder use its own threads: frame threading pipelines decoding of consecutive
+ * frames, slice threading splits a single frame. */
+static void ffmpeg_codec_threads_setup(AVCodecContext *pCodecCtx, const AVCodec *pCodec)
+{
+  if (pCodec->capabilities & AV_CODEC_CAP_AUTO_THREADS) {
+    pCodecCtx->thread_count = 0;
+  }
+  else {
+    pCodecCtx->thread_count = BLI_system_thread_count();
+  }
+
+  if (pCodec->capabilities & AV_CODEC_CAP_FRAME_THREADS) {
+    pCodecCtx->thread_type = FF_THREAD_FRAME;
+  }
+  else if (pCodec->capabilities & AV_CODEC_CAP_SLICE_THREADS) {
+    pCodecCtx->thread_type = FF_THREAD_SLICE;
+  }
+}
+
 static int startffmpeg(struct anim *anim)
 {
   int i, video_stream_index;
@@ -518,13 +701,6 @@ static int startffmpeg(struct anim *anim)
   double frs_den;
   int streamcount;
 
-#  ifdef FFMPEG_SWSCALE_COLOR_SPACE_SUPPORT
-  /* The following for color space determination */
-  int srcRange, dstRange, brightness, contrast, saturation;
-  int *table;
-  const int *inv_table;
-#  endif
-
   if (anim == NULL) {
     return (-1);
   }
@@ -572,6 +748,7 @@ static int startffmpeg(struct anim *anim)
   }
 
   pCodecCtx->workaround_bugs = 1;
+  ffmpeg_codec_threads_setup(pCodecCtx, pCodec);
 
   if (avcodec_open2(pCodecCtx, pCodec, NULL) < 0) {
     avformat_close_input(&pFormatCtx);
@@ -692,16 +869,7 @@ static int startffmpeg(struct anim *anim)
     anim->preseek = 0;
   }
 
-  anim->img_convert_ctx = sws_getContext(anim->x,
-                                         anim->y,
-                                         anim->pCodecCtx->pix_fmt,
-                                         anim->x,
-                                         anim->y,
-                                         AV_PIX_FMT_RGBA,
-                                         SWS_FAST_BILINEAR | SWS_PRINT_INFO | SWS_FULL_CHR_H_INT,
-                                         NULL,
-                                         NULL,
-                                         NULL);
+  anim->img_convert_ctx = ffmpeg_sws_context_create(anim, anim->y, SWS_PRINT_INFO);
 
   if (!anim->img_convert_ctx) {
     fprintf(stderr, "Can't transform color space??? Bailing out...\n");
@@ -714,38 +882,64 @@ static int startffmpeg(struct anim *anim)
     return -1;
   }
 
-#  ifdef FFMPEG_SWSCALE_COLOR_SPACE_SUPPORT
-  /* Try do detect if input has 0-255 YCbCR range (JFIF Jpeg MotionJpeg) */
-  if (!sws_getColorspaceDetails(anim->img_convert_ctx,
-                                (int **)&inv_table,
-                                &srcRange,
-                                &table,
-                                &dstRange,
-                                &brightness,
-                                &contrast,
-                                &saturation)) {
-    srcRange = srcRange || anim->pCodecCtx->color_range == AVCOL_RANGE_JPEG;
-    inv_table = sws_getCoefficients(anim->pCodecCtx->colorspace);
-
-    if (sws_setColorspaceDetails(anim->img_convert_ctx,
-                                 (int *)inv_table,
-                                 srcRange,
-                                 table,
-                                 dstRange,
-                                 brightness,
-                                 contrast,
-                                 saturation)) {
-      fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
-    }
-  }
-  else {
-    fprintf(stderr, "Warning: Could not set libswscale colorspace details.\n");
-  }
-#  endif
+  ffmpeg_sws_slice_contexts_create(anim);
 
   return 0;
 }
 
+typedef struct FFmpegConvertSliceData {
+  struct anim *anim;
+  AVFrame *input;
+  const AVPixFmtDescriptor *desc;
+} FFmpegConvertSliceData;
+
+/* Convert one horizontal band of the frame with its margins, and copy the band without the
+ * margins vertically flipped into the RGBA buffer. */
+static void ffmpeg_convert_slice_fn(void *__restrict userdata,
+                                    const int slice,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  FFmpegConvertSliceData *data = userdata;
+  struct anim *anim = data->anim;
+  AVFrame *input = data->input;
+  int y_start, height, margin_top, margin_bottom;
+  ffmpeg_convert_slice_range(anim, slice, &y_start, &height, &margin_top, &margin_bottom);
+
+  const int src_y_start = y_start - margin_top;
+  const uint8_t *src[4] = {NULL, NULL, NULL, NULL};
+  for (int plane = 0; plane < 4; plane++) {
+    if (input->data[plane] == NULL) {
+      continue;
+    }
+    /* Planes 1 and 2 hold the (sub-sampled) chroma, 0 and 3 luma and alpha. */
+    const int shift = (plane == 1 || plane == 2) ? data->desc->log2_chroma_h : 0;
+    src[plane] = input->data[plane] + (size_t)(src_y_start >> shift) * input->linesize[plane];
+  }
+
+  const int buffer_stride = anim->img_convert_slice_buffer_stride;
+  const int buffer_height = anim->img_convert_slice_height + 2 * anim->img_convert_slice_margin;
+  uint8_t *buffer = anim->img_convert_slice_buffer +
+                    (size_t)slice * buffer_height * buffer_stride;
+  uint8_t *dst_buffer[4] = {buffer, NULL, NULL, NULL};
+  const int dst_buffer_stride[4] = {buffer_stride, 0, 0, 0};
+
+  sws_scale(anim->img_convert_slice_ctx[slice],
+            src,
+            input->linesize,
+            0,
+            margin_top + height + margin_bottom,
+            dst_buffer,
+            dst_buffer_stride);
+
+  const int dst_stride = anim->pFrameRGB->linesize[0];
+  const uint8_t *src_row = buffer + (size_t)margin_top * buffer_stride;
+  for (int y = y_start; y < y_start + height; y++) {
+    uint8_t *dst_row = anim->pFrameRGB->data[0] + (size_t)(anim->y - 1 - y) * dst_stride;
+    memcpy(dst_row, src_row, (size_t)anim->x * 4);
+    src_row += buffer_stride;
+  }
+}
+
 /* postprocess the image in anim->pFrame and do color conversion
  * and deinterlacing stuff.
  *
@@ -846,6 +1040,18 @@ static void ffmpeg_postprocess(struct anim *anim)
       top -= 8 * w;
     }
   }
+  else if (anim->img_convert_slice_num > 1) {
+    FFmpegConvertSliceData data = {
+        .anim = anim,
+        .input = input,
+        .desc = av_pix_fmt_desc_get(anim->pCodecCtx->pix_fmt),
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(
+        0, anim->img_convert_slice_num, &data, ffmpeg_convert_slice_fn, &settings);
+  }
   else {
     int *dstStride = anim->pFrameRGB->linesize;
     uint8_t **dst = anim->pFrameRGB->data;
@@ -1272,6 +1478,7 @@ static void free_anim_ffmpeg(struct anim *anim)
     av_frame_free(&anim->pFrameDeinterlaced);
 
     sws_freeContext(anim->img_convert_ctx);
+    ffmpeg_sws_slice_contexts_free(anim);
     IMB_freeImBuf(anim->last_frame);
     if (anim->next_packet.stream_index != -1) {
       av_free_packet(&anim->next_packet);
@@ -77,6 +77,8 @@ static char global_role_default_float[MAX_COLORSPACE_NAME];
 static char global_role_default_sequencer[MAX_COLORSPACE_NAME];
 
 static ListBase global_colorspaces = {NULL, NULL};
+/* Incremented for every loaded configuration, identifies data derived from the configuration. */
+static int global_config_id = 0;
 static ListBase global_displays = {NULL, NULL};
 static ListBase global_views = {NULL, NULL};
 static ListBase global_looks = {NULL, NULL};
@@ -100,9 +102,13 @@ static float imbuf_linear_srgb_to_xyz[3][3] = {{0.0f}};
  */
 static pthread_mutex_t processor_lock = BLI_MUTEX_INITIALIZER;
 
+struct ColormanageLUT3D;
+
 typedef struct ColormanageProcessor {
   OCIO_ConstProcessorRcPtr *processor;
   CurveMapping *curve_mapping;
+  /* Optional baked approximation of the processor, used for byte display buffers. */
+  struct ColormanageLUT3D *lut3d;
   bool is_data_result;
 } ColormanageProcessor;
 
@@ -702,6 +708,8 @@ void colormanagement_init(void)
     config = OCIO_configCreateFallback();
   }
 
+  global_config_id++;
+
   if (config) {
     OCIO_setCurrentConfig(config);
 
@@ -725,8 +733,12 @@ void colormanagement_init(void)
   BLI_init_srgb_conversion();
 }
 
+static void colormanage_lut3d_cache_free(void);
+
 void colormanagement_exit(void)
 {
+  colormanage_lut3d_cache_free();
+
   if (global_glsl_state.processor_scene_to_ui) {
     OCIO_processorRelease(global_glsl_state.processor_scene_to_ui);
   }
@@ -1481,6 +1493,287 @@ const float *IMB_colormangement_get_xyz_to_rgb()
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Baked Display Transform LUT
+ *
+ * Evaluating the OCIO processor per pixel is expensive for display transforms with looks and
+ * view transforms. For byte display buffers the combined transform is baked into a 3D LUT,
+ * which is indexed through a logarithmic shaper and sampled with tetrahedral interpolation.
+ * Scene linear values outside of the shaper range are transformed by the exact processor.
+ *
+ * LUTs are cached per configuration, scene linear role, look, view, display, exposure and gamma
+ * combination.
+ * \{ */
+
+/* Number of samples along each axis of the LUT. 65 keeps the interpolation error well below
+ * the precision of 8 bit display buffers for the default configuration. */
+#define DISPLAY_LUT3D_SIZE 65
+/* Scene linear range covered by the shaper, as exponents of two. */
+#define DISPLAY_LUT3D_LOG2_MIN -12.0f
+#define DISPLAY_LUT3D_LOG2_MAX 8.0f
+/* Number of LUTs kept around for different view settings. */
+#define DISPLAY_LUT3D_CACHE_SIZE 4
+/* Smallest display buffer for which a LUT is baked. */
+#define DISPLAY_LUT3D_MIN_PIXELS (512 * 512)
+
+typedef struct ColormanageLUT3D {
+  struct ColormanageLUT3D *next, *prev;
+
+  int config_id;
+  char scene_linear_role[MAX_COLORSPACE_NAME];
+  char look[MAX_COLORSPACE_NAME];
+  char view_transform[MAX_COLORSPACE_NAME];
+  char display_device[MAX_COLORSPACE_NAME];
+  float exposure, gamma;
+
+  /* Number of processors using this LUT, it is only freed when unused. */
+  int users;
+
+  /* RGB triplets, red changes fastest. */
+  float *table;
+} ColormanageLUT3D;
+
+/* Most recently used LUT first. */
+static ListBase global_lut3d_cache = {NULL, NULL};
+static ThreadMutex lut3d_cache_lock = BLI_MUTEX_INITIALIZER;
+
+BLI_INLINE float lut3d_shaper(float value)
+{
+  const float range = DISPLAY_LUT3D_LOG2_MAX - DISPLAY_LUT3D_LOG2_MIN;
+  return (log2f(value + exp2f(DISPLAY_LUT3D_LOG2_MIN)) - DISPLAY_LUT3D_LOG2_MIN) / range;
+}
+
+BLI_INLINE float lut3d_shaper_inverse(float value)
+{
+  const float range = DISPLAY_LUT3D_LOG2_MAX - DISPLAY_LUT3D_LOG2_MIN;
+  return exp2f(value * range + DISPLAY_LUT3D_LOG2_MIN) - exp2f(DISPLAY_LUT3D_LOG2_MIN);
+}
+
+static float *colormanage_lut3d_bake(OCIO_ConstProcessorRcPtr *processor)
+{
+  const int size = DISPLAY_LUT3D_SIZE;
+  const size_t num_samples = (size_t)size * size * size;
+  float *table = MEM_mallocN(sizeof(float[3]) * num_samples, "display transform LUT");
+
+  float *fp = table;
+  for (int b = 0; b < size; b++) {
+    for (int g = 0; g < size; g++) {
+      for (int r = 0; r < size; r++, fp += 3) {
+        fp[0] = lut3d_shaper_inverse((float)r / (size - 1));
+        fp[1] = lut3d_shaper_inverse((float)g / (size - 1));
+        fp[2] = lut3d_shaper_inverse((float)b / (size - 1));
+      }
+    }
+  }
+
+  /* Evaluate all samples through the exact processor at once. */
+  OCIO_PackedImageDesc *img = OCIO_createOCIO_PackedImageDesc(table,
+                                                              size * size,
+                                                              size,
+                                                              3,
+                                                              sizeof(float),
+                                                              sizeof(float[3]),
+                                                              sizeof(float[3]) * size * size);
+  OCIO_processorApply(processor, img);
+  OCIO_PackedImageDescRelease(img);
+
+  return table;
+}
+
+static void colormanage_lut3d_cache_free(void)
+{
+  BLI_mutex_lock(&lut3d_cache_lock);
+  LISTBASE_FOREACH_MUTABLE (ColormanageLUT3D *, lut, &global_lut3d_cache) {
+    BLI_assert(lut->users == 0);
+    MEM_freeN(lut->table);
+    MEM_freeN(lut);
+  }
+  BLI_listbase_clear(&global_lut3d_cache);
+  BLI_mutex_unlock(&lut3d_cache_lock);
+}
+
+/* Drop least recently used LUTs which are not in use until the cache fits its size again.
+ * LUTs still used by processors are kept, so the cache can temporarily be bigger. */
+static void colormanage_lut3d_cache_trim(void)
+{
+  int num_luts = BLI_listbase_count(&global_lut3d_cache);
+  ColormanageLUT3D *lut = global_lut3d_cache.last;
+  while (lut && num_luts > DISPLAY_LUT3D_CACHE_SIZE) {
+    ColormanageLUT3D *prev_lut = lut->prev;
+    if (lut->users == 0) {
+      BLI_remlink(&global_lut3d_cache, lut);
+      MEM_freeN(lut->table);
+      MEM_freeN(lut);
+      num_luts--;
+    }
+    lut = prev_lut;
+  }
+}
+
+/* Attach a baked LUT matching the view settings to the processor, baking it when not cached.
+ * Curve mapping is evaluated before the OCIO processor and is not part of the LUT, processors
+ * using it keep the exact path. */
+static void colormanage_processor_lut3d_ensure(ColormanageProcessor *cm_processor,
+                                               const ColorManagedViewSettings *view_settings,
+                                               const ColorManagedDisplaySettings *display_settings)
+{
+  if (cm_processor->processor == NULL || cm_processor->curve_mapping != NULL ||
+      cm_processor->is_data_result || view_settings == NULL) {
+    return;
+  }
+
+  BLI_mutex_lock(&lut3d_cache_lock);
+
+  ColormanageLUT3D *lut;
+  for (lut = global_lut3d_cache.first; lut; lut = lut->next) {
+    if (lut->config_id == global_config_id &&
+        STREQ(lut->scene_linear_role, global_role_scene_linear) &&
+        STREQ(lut->look, view_settings->look) &&
+        STREQ(lut->view_transform, view_settings->view_transform) &&
+        STREQ(lut->display_device, display_settings->display_device) &&
+        lut->exposure == view_settings->exposure && lut->gamma == view_settings->gamma) {
+      break;
+    }
+  }
+
+  if (lut) {
+    BLI_remlink(&global_lut3d_cache, lut);
+  }
+  else {
+    lut = MEM_callocN(sizeof(ColormanageLUT3D), "ColormanageLUT3D");
+    lut->config_id = global_config_id;
+    STRNCPY(lut->scene_linear_role, global_role_scene_linear);
+    STRNCPY(lut->look, view_settings->look);
+    STRNCPY(lut->view_transform, view_settings->view_transform);
+    STRNCPY(lut->display_device, display_settings->display_device);
+    lut->exposure = view_settings->exposure;
+    lut->gamma = view_settings->gamma;
+    lut->table = colormanage_lut3d_bake(cm_processor->processor);
+  }
+
+  BLI_addhead(&global_lut3d_cache, lut);
+  lut->users++;
+  cm_processor->lut3d = lut;
+
+  colormanage_lut3d_cache_trim();
+
+  BLI_mutex_unlock(&lut3d_cache_lock);
+}
+
+static void colormanage_processor_lut3d_release(ColormanageProcessor *cm_processor)
+{
+  if (cm_processor->lut3d == NULL) {
+    return;
+  }
+
+  BLI_mutex_lock(&lut3d_cache_lock);
+  cm_processor->lut3d->users--;
+  colormanage_lut3d_cache_trim();
+  BLI_mutex_unlock(&lut3d_cache_lock);
+  cm_processor->lut3d = NULL;
+}
+
+/* Tetrahedral interpolation of the LUT, the input must be inside of the shaper range. */
+BLI_INLINE void colormanage_lut3d_evaluate(const float *table, const float rgb[3], float r_rgb[3])
+{
+  const int size = DISPLAY_LUT3D_SIZE;
+  const int stride_r = 3, stride_g = 3 * size, stride_b = 3 * size * size;
+  int index[3];
+  float f[3];
+
+  for (int i = 0; i < 3; i++) {
+    const float s = lut3d_shaper(rgb[i]) * (size - 1);
+    index[i] = min_ii((int)s, size - 2);
+    f[i] = s - (float)index[i];
+  }
+
+  const float *c000 = table + index[0] * stride_r + index[1] * stride_g + index[2] * stride_b;
+  const float *c111 = c000 + stride_r + stride_g + stride_b;
+  const float *c1, *c2;
+  float w0, w1, w2, w3;
+  const float fr = f[0], fg = f[1], fb = f[2];
+
+  if (fr >= fg) {
+    if (fg >= fb) {
+      c1 = c000 + stride_r;
+      c2 = c000 + stride_r + stride_g;
+      w0 = 1.0f - fr, w1 = fr - fg, w2 = fg - fb, w3 = fb;
+    }
+    else if (fr >= fb) {
+      c1 = c000 + stride_r;
+      c2 = c000 + stride_r + stride_b;
+      w0 = 1.0f - fr, w1 = fr - fb, w2 = fb - fg, w3 = fg;
+    }
+    else {
+      c1 = c000 + stride_b;
+      c2 = c000 + stride_r + stride_b;
+      w0 = 1.0f - fb, w1 = fb - fr, w2 = fr - fg, w3 = fg;
+    }
+  }
+  else {
+    if (fb >= fg) {
+      c1 = c000 + stride_b;
+      c2 = c000 + stride_g + stride_b;
+      w0 = 1.0f - fb, w1 = fb - fg, w2 = fg - fr, w3 = fr;
+    }
+    else if (fb >= fr) {
+      c1 = c000 + stride_g;
+      c2 = c000 + stride_g + stride_b;
+      w0 = 1.0f - fg, w1 = fg - fb, w2 = fb - fr, w3 = fr;
+    }
+    else {
+      c1 = c000 + stride_g;
+      c2 = c000 + stride_r + stride_g;
+      w0 = 1.0f - fg, w1 = fg - fr, w2 = fr - fb, w3 = fb;
+    }
+  }
+
+  for (int i = 0; i < 3; i++) {
+    r_rgb[i] = w0 * c000[i] + w1 * c1[i] + w2 * c2[i] + w3 * c111[i];
+  }
+}
+
+static void colormanage_lut3d_apply(ColormanageProcessor *cm_processor,
+                                    float *buffer,
+                                    int width,
+                                    int height,
+                                    int channels,
+                                    bool predivide)
+{
+  const float *table = cm_processor->lut3d->table;
+  const float max_value = lut3d_shaper_inverse(1.0f);
+  const size_t num_pixels = (size_t)width * height;
+
+  float *pixel = buffer;
+  for (size_t i = 0; i < num_pixels; i++, pixel += channels) {
+    float rgb[3];
+    float alpha = 1.0f;
+    copy_v3_v3(rgb, pixel);
+
+    /* Same as OCIO's predivide: unpremultiply for the transform and premultiply after. */
+    const bool use_predivide = predivide && channels == 4 && !ELEM(pixel[3], 0.0f, 1.0f);
+    if (use_predivide) {
+      alpha = pixel[3];
+      mul_v3_fl(rgb, 1.0f / alpha);
+    }
+
+    if (rgb[0] >= 0.0f && rgb[1] >= 0.0f && rgb[2] >= 0.0f && rgb[0] <= max_value &&
+        rgb[1] <= max_value && rgb[2] <= max_value) {
+      colormanage_lut3d_evaluate(table, rgb, rgb);
+    }
+    else {
+      OCIO_processorApplyRGB(cm_processor->processor, rgb);
+    }
+
+    if (use_predivide) {
+      mul_v3_fl(rgb, alpha);
+    }
+    copy_v3_v3(pixel, rgb);
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Threaded Display Buffer Transform Routines
  * \{ */
@@ -1702,6 +1995,10 @@ static void *do_display_buffer_apply_thread(void *handle_v)
        * only generate byte buffers
        */
     }
+    else if (cm_processor->lut3d && channels >= 3) {
+      /* apply baked approximation of the processor */
+      colormanage_lut3d_apply(cm_processor, linear_buffer, width, height, channels, predivide);
+    }
     else {
       /* apply processor */
       IMB_colormanagement_processor_apply(
@@ -1828,6 +2125,13 @@ static void colormanage_display_buffer_process_ex(
 
   if (skip_transform == false) {
     cm_processor = IMB_colormanagement_display_processor_new(view_settings, display_settings);
+
+    /* Byte display buffers only need 8 bit precision, which the baked LUT easily provides.
+     * Baking has a fixed cost, so only do it for buffers big enough to benefit from it. */
+    if (display_buffer == NULL && display_buffer_byte != NULL &&
+        (size_t)ibuf->x * ibuf->y >= DISPLAY_LUT3D_MIN_PIXELS) {
+      colormanage_processor_lut3d_ensure(cm_processor, view_settings, display_settings);
+    }
   }
 
   display_buffer_apply_threaded(ibuf,
@@ -3990,6 +4294,7 @@ void IMB_colormanagement_processor_apply_byte(
 
 void IMB_colormanagement_processor_free(ColormanageProcessor *cm_processor)
 {
+  colormanage_processor_lut3d_release(cm_processor);
   if (cm_processor->curve_mapping) {
     BKE_curvemapping_free(cm_processor->curve_mapping);
   }
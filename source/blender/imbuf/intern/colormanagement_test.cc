@@ -0,0 +1,133 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include <math.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math_base.h"
+#include "BLI_rand.h"
+#include "BLI_string.h"
+
+#include "DNA_color_types.h"
+
+#include "IMB_colormanagement.h"
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+namespace blender::imbuf::tests {
+
+/* Big enough for the display buffer to use the baked LUT. */
+static const int SIZE = 512;
+
+class imbuf_colormanagement : public testing::Test {
+ public:
+  static void SetUpTestCase()
+  {
+    testing::Test::SetUpTestCase();
+    IMB_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    IMB_exit();
+    testing::Test::TearDownTestCase();
+  }
+};
+
+/* Scene linear values spread logarithmically over a range wider than the LUT shaper, so both
+ * the LUT and the exact processor fallback are covered. */
+static ImBuf *linear_test_image_new()
+{
+  ImBuf *ibuf = IMB_allocImBuf(SIZE, SIZE, 32, IB_rectfloat);
+  RNG *rng = BLI_rng_new(0);
+
+  float *fp = ibuf->rect_float;
+  for (int i = 0; i < SIZE * SIZE; i++, fp += 4) {
+    for (int c = 0; c < 3; c++) {
+      fp[c] = (i % 97 == 0) ? 0.0f : exp2f(BLI_rng_get_float(rng) * 24.0f - 14.0f);
+    }
+    fp[3] = 1.0f;
+  }
+
+  BLI_rng_free(rng);
+  return ibuf;
+}
+
+static void expect_display_buffer_matches_exact(ImBuf *ibuf,
+                                                const ColorManagedViewSettings *view_settings,
+                                                const ColorManagedDisplaySettings *display_settings)
+{
+  unsigned char *exact = (unsigned char *)MEM_mallocN(sizeof(unsigned char[4]) * SIZE * SIZE,
+                                                      __func__);
+  IMB_display_buffer_transform_apply(
+      exact, ibuf->rect_float, SIZE, SIZE, 4, view_settings, display_settings, false);
+
+  void *cache_handle;
+  unsigned char *display_buffer = IMB_display_buffer_acquire(
+      ibuf, view_settings, display_settings, &cache_handle);
+  ASSERT_NE(display_buffer, nullptr);
+
+  int max_error = 0;
+  for (int i = 0; i < SIZE * SIZE * 4; i++) {
+    max_error = max_ii(max_error, abs((int)display_buffer[i] - (int)exact[i]));
+  }
+  /* The LUT is only used for byte display buffers, it must stay within one 8 bit step. */
+  EXPECT_LE(max_error, 1) << view_settings->view_transform << " exposure "
+                          << view_settings->exposure << " gamma " << view_settings->gamma;
+
+  IMB_display_buffer_release(cache_handle);
+  MEM_freeN(exact);
+}
+
+TEST_F(imbuf_colormanagement, DisplayBufferLUTMatchesProcessor)
+{
+  ColorManagedDisplaySettings display_settings;
+  STRNCPY(display_settings.display_device, IMB_colormanagement_display_get_default_name());
+
+  ColorManagedViewSettings view_settings;
+  IMB_colormanagement_init_default_view_settings(&view_settings, &display_settings);
+
+  char default_view_transform[sizeof(view_settings.view_transform)];
+  STRNCPY(default_view_transform, view_settings.view_transform);
+
+  const char *view_transforms[] = {default_view_transform, "Filmic"};
+  const float exposures[] = {0.0f, 1.5f, -2.0f};
+  const float gammas[] = {1.0f, 0.7f};
+
+  /* More combinations than cached LUTs, so cache eviction is covered as well. */
+  for (const char *view_transform : view_transforms) {
+    if (IMB_colormanagement_view_get_named_index(view_transform) == 0) {
+      continue;
+    }
+    STRNCPY(view_settings.view_transform, view_transform);
+
+    for (const float exposure : exposures) {
+      for (const float gamma : gammas) {
+        view_settings.exposure = exposure;
+        view_settings.gamma = gamma;
+
+        /* Display buffers are cached on the image, use a new one for every combination. */
+        ImBuf *ibuf = linear_test_image_new();
+        expect_display_buffer_matches_exact(ibuf, &view_settings, &display_settings);
+        IMB_freeImBuf(ibuf);
+      }
+    }
+  }
+}
+
+}  // namespace blender::imbuf::tests
@@ -0,0 +1,215 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup imbuf
+ *
+ * Tracking of modified regions of an image buffer, in tiles of #IMB_DIRTY_TILE_SIZE pixels.
+ *
+ * Used to update data derived from the pixels, like GPU textures, only where the image was
+ * changed. Tagging and retrieving regions may happen from different threads, e.g. a render
+ * thread writing pixels while the interface is drawn.
+ */
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_bitmap.h"
+#include "BLI_math_base.h"
+#include "BLI_rect.h"
+#include "BLI_utildefines.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+#include "atomic_ops.h"
+
+typedef struct ImBufDirtyTiles {
+  /** Size of the image buffer the tiles were created for, in tiles. */
+  int tiles_x, tiles_y;
+  /** One bit per tile, set for modified tiles. */
+  BLI_bitmap *bitmap;
+} ImBufDirtyTiles;
+
+static ImBufDirtyTiles *dirty_tiles_ensure(ImBuf *ibuf)
+{
+  ImBufDirtyTiles *dirty_tiles = ibuf->dirty_tiles;
+  if (dirty_tiles != NULL) {
+    return dirty_tiles;
+  }
+
+  dirty_tiles = MEM_callocN(sizeof(ImBufDirtyTiles), __func__);
+  dirty_tiles->tiles_x = (ibuf->x + IMB_DIRTY_TILE_SIZE - 1) / IMB_DIRTY_TILE_SIZE;
+  dirty_tiles->tiles_y = (ibuf->y + IMB_DIRTY_TILE_SIZE - 1) / IMB_DIRTY_TILE_SIZE;
+  dirty_tiles->bitmap = BLI_BITMAP_NEW(dirty_tiles->tiles_x * dirty_tiles->tiles_y, __func__);
+
+  /* Another thread may have created the tiles in the meantime. */
+  if (atomic_cas_ptr((void **)&ibuf->dirty_tiles, NULL, dirty_tiles) != NULL) {
+    MEM_freeN(dirty_tiles->bitmap);
+    MEM_freeN(dirty_tiles);
+  }
+
+  return ibuf->dirty_tiles;
+}
+
+/**
+ * Tag a region of the image buffer as modified.
+ */
+void IMB_dirty_tiles_tag(ImBuf *ibuf, int x, int y, int w, int h)
+{
+  if (ibuf->x <= 0 || ibuf->y <= 0 || w <= 0 || h <= 0 || x + w <= 0 || y + h <= 0) {
+    return;
+  }
+
+  ImBufDirtyTiles *dirty_tiles = dirty_tiles_ensure(ibuf);
+
+  const int xmin = max_ii(x, 0) / IMB_DIRTY_TILE_SIZE;
+  const int ymin = max_ii(y, 0) / IMB_DIRTY_TILE_SIZE;
+  const int xmax = min_ii((x + w - 1) / IMB_DIRTY_TILE_SIZE, dirty_tiles->tiles_x - 1);
+  const int ymax = min_ii((y + h - 1) / IMB_DIRTY_TILE_SIZE, dirty_tiles->tiles_y - 1);
+
+  for (int ty = ymin; ty <= ymax; ty++) {
+    for (int tx = xmin; tx <= xmax; tx++) {
+      const int index = ty * dirty_tiles->tiles_x + tx;
+      atomic_fetch_and_or_uint32(&dirty_tiles->bitmap[index >> _BITMAP_POWER],
+                                 1u << (index & _BITMAP_MASK));
+    }
+  }
+}
+
+void IMB_dirty_tiles_tag_all(ImBuf *ibuf)
+{
+  IMB_dirty_tiles_tag(ibuf, 0, 0, ibuf->x, ibuf->y);
+}
+
+/**
+ * Check whether any tile was tagged since the regions were last retrieved.
+ */
+bool IMB_dirty_tiles_any(const ImBuf *ibuf)
+{
+  const ImBufDirtyTiles *dirty_tiles = ibuf->dirty_tiles;
+  if (dirty_tiles == NULL) {
+    return false;
+  }
+
+  const int words_len = _BITMAP_NUM_BLOCKS(dirty_tiles->tiles_x * dirty_tiles->tiles_y);
+  for (int i = 0; i < words_len; i++) {
+    if (dirty_tiles->bitmap[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Retrieve the modified regions in pixels and clear the tags. Horizontally and vertically
+ * adjacent dirty tiles are merged into rectangles, to reduce the number of updates.
+ * The maximum of the returned rectangles is exclusive.
+ *
+ * \return An array of regions to be freed with #MEM_freeN, or NULL when nothing was tagged.
+ */
+rcti *IMB_dirty_tiles_pop_regions(ImBuf *ibuf, int *r_regions_len)
+{
+  ImBufDirtyTiles *dirty_tiles = ibuf->dirty_tiles;
+  *r_regions_len = 0;
+
+  if (dirty_tiles == NULL) {
+    return NULL;
+  }
+
+  /* Take a snapshot of the tags, tiles tagged concurrently end up either in this or the next
+   * set of regions. */
+  const int tiles_x = dirty_tiles->tiles_x, tiles_y = dirty_tiles->tiles_y;
+  const int words_len = _BITMAP_NUM_BLOCKS(tiles_x * tiles_y);
+  BLI_bitmap *bitmap = BLI_BITMAP_NEW(tiles_x * tiles_y, __func__);
+  bool any_dirty = false;
+  for (int i = 0; i < words_len; i++) {
+    bitmap[i] = atomic_fetch_and_and_uint32(&dirty_tiles->bitmap[i], 0);
+    any_dirty |= (bitmap[i] != 0);
+  }
+
+  if (!any_dirty) {
+    MEM_freeN(bitmap);
+    return NULL;
+  }
+
+  rcti *regions = NULL;
+  int regions_len = 0, regions_alloc = 0;
+
+  for (int ty = 0; ty < tiles_y; ty++) {
+    for (int tx = 0; tx < tiles_x; tx++) {
+      if (!BLI_BITMAP_TEST(bitmap, ty * tiles_x + tx)) {
+        continue;
+      }
+
+      /* Grow a run of dirty tiles to the right, then downwards as long as the rows below are
+       * dirty over the full width of the run. */
+      const int tx_start = tx;
+      int tx_end = tx + 1;
+      while (tx_end < tiles_x && BLI_BITMAP_TEST(bitmap, ty * tiles_x + tx_end)) {
+        tx_end++;
+      }
+
+      int ty_end = ty + 1;
+      for (; ty_end < tiles_y; ty_end++) {
+        bool row_dirty = true;
+        for (int i = tx_start; i < tx_end && row_dirty; i++) {
+          row_dirty = BLI_BITMAP_TEST(bitmap, ty_end * tiles_x + i);
+        }
+        if (!row_dirty) {
+          break;
+        }
+      }
+
+      for (int j = ty; j < ty_end; j++) {
+        for (int i = tx_start; i < tx_end; i++) {
+          BLI_BITMAP_DISABLE(bitmap, j * tiles_x + i);
+        }
+      }
+
+      tx = tx_end - 1;
+
+      /* The image buffer may have been resized since the tiles were created. */
+      if (tx_start * IMB_DIRTY_TILE_SIZE >= ibuf->x || ty * IMB_DIRTY_TILE_SIZE >= ibuf->y) {
+        continue;
+      }
+
+      if (regions_len == regions_alloc) {
+        regions_alloc = max_ii(16, regions_alloc * 2);
+        regions = MEM_reallocN(regions, sizeof(rcti) * regions_alloc);
+      }
+
+      BLI_rcti_init(&regions[regions_len++],
+                    tx_start * IMB_DIRTY_TILE_SIZE,
+                    min_ii(tx_end * IMB_DIRTY_TILE_SIZE, ibuf->x),
+                    ty * IMB_DIRTY_TILE_SIZE,
+                    min_ii(ty_end * IMB_DIRTY_TILE_SIZE, ibuf->y));
+    }
+  }
+
+  MEM_freeN(bitmap);
+
+  *r_regions_len = regions_len;
+  return regions;
+}
+
+void IMB_dirty_tiles_free(ImBuf *ibuf)
+{
+  if (ibuf->dirty_tiles) {
+    MEM_freeN(ibuf->dirty_tiles->bitmap);
+    MEM_freeN(ibuf->dirty_tiles);
+    ibuf->dirty_tiles = NULL;
+  }
+}
@@ -0,0 +1,143 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_rect.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+namespace blender::imbuf::tests {
+
+static const int TILE = IMB_DIRTY_TILE_SIZE;
+
+class imbuf_dirty_tiles : public testing::Test {
+ public:
+  static void SetUpTestCase()
+  {
+    testing::Test::SetUpTestCase();
+    IMB_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    IMB_exit();
+    testing::Test::TearDownTestCase();
+  }
+};
+
+TEST_F(imbuf_dirty_tiles, Empty)
+{
+  ImBuf *ibuf = IMB_allocImBuf(1000, 600, 32, 0);
+  EXPECT_FALSE(IMB_dirty_tiles_any(ibuf));
+
+  int regions_len;
+  EXPECT_EQ(IMB_dirty_tiles_pop_regions(ibuf, &regions_len), nullptr);
+  EXPECT_EQ(regions_len, 0);
+
+  /* Regions outside of the image are ignored. */
+  IMB_dirty_tiles_tag(ibuf, -100, -100, 50, 50);
+  IMB_dirty_tiles_tag(ibuf, 10, 10, 0, 10);
+  EXPECT_FALSE(IMB_dirty_tiles_any(ibuf));
+
+  IMB_freeImBuf(ibuf);
+}
+
+TEST_F(imbuf_dirty_tiles, SingleTile)
+{
+  ImBuf *ibuf = IMB_allocImBuf(1000, 600, 32, 0);
+  IMB_dirty_tiles_tag(ibuf, TILE + 10, 20, 5, 5);
+  EXPECT_TRUE(IMB_dirty_tiles_any(ibuf));
+
+  int regions_len;
+  rcti *regions = IMB_dirty_tiles_pop_regions(ibuf, &regions_len);
+  ASSERT_EQ(regions_len, 1);
+  EXPECT_EQ(regions[0].xmin, TILE);
+  EXPECT_EQ(regions[0].xmax, 2 * TILE);
+  EXPECT_EQ(regions[0].ymin, 0);
+  EXPECT_EQ(regions[0].ymax, TILE);
+  MEM_freeN(regions);
+
+  /* Popping clears the tags. */
+  EXPECT_FALSE(IMB_dirty_tiles_any(ibuf));
+
+  IMB_freeImBuf(ibuf);
+}
+
+TEST_F(imbuf_dirty_tiles, ClipToImage)
+{
+  ImBuf *ibuf = IMB_allocImBuf(1000, 600, 32, 0);
+  IMB_dirty_tiles_tag_all(ibuf);
+
+  int regions_len;
+  rcti *regions = IMB_dirty_tiles_pop_regions(ibuf, &regions_len);
+  ASSERT_EQ(regions_len, 1);
+  EXPECT_EQ(regions[0].xmin, 0);
+  EXPECT_EQ(regions[0].xmax, 1000);
+  EXPECT_EQ(regions[0].ymin, 0);
+  EXPECT_EQ(regions[0].ymax, 600);
+  MEM_freeN(regions);
+
+  IMB_freeImBuf(ibuf);
+}
+
+TEST_F(imbuf_dirty_tiles, MergeRegions)
+{
+  ImBuf *ibuf = IMB_allocImBuf(8 * TILE, 8 * TILE, 32, 0);
+
+  /* A 2x3 block of tiles, built from overlapping strokes. */
+  IMB_dirty_tiles_tag(ibuf, TILE, TILE, 10, 3 * TILE - 1);
+  IMB_dirty_tiles_tag(ibuf, 2 * TILE + 5, TILE + 5, 10, 2 * TILE);
+  /* A separate tile. */
+  IMB_dirty_tiles_tag(ibuf, 6 * TILE, 6 * TILE, 1, 1);
+
+  int regions_len;
+  rcti *regions = IMB_dirty_tiles_pop_regions(ibuf, &regions_len);
+  ASSERT_EQ(regions_len, 2);
+
+  EXPECT_EQ(regions[0].xmin, TILE);
+  EXPECT_EQ(regions[0].xmax, 3 * TILE);
+  EXPECT_EQ(regions[0].ymin, TILE);
+  EXPECT_EQ(regions[0].ymax, 4 * TILE);
+
+  EXPECT_EQ(regions[1].xmin, 6 * TILE);
+  EXPECT_EQ(regions[1].xmax, 7 * TILE);
+  EXPECT_EQ(regions[1].ymin, 6 * TILE);
+  EXPECT_EQ(regions[1].ymax, 7 * TILE);
+
+  /* Every tagged pixel is covered, and regions don't overlap. */
+  EXPECT_FALSE(BLI_rcti_isect(&regions[0], &regions[1], nullptr));
+  MEM_freeN(regions);
+
+  IMB_freeImBuf(ibuf);
+}
+
+TEST_F(imbuf_dirty_tiles, DuplicateDoesNotShareTags)
+{
+  ImBuf *ibuf = IMB_allocImBuf(300, 300, 32, IB_rect);
+  IMB_dirty_tiles_tag(ibuf, 0, 0, 10, 10);
+
+  ImBuf *ibuf_copy = IMB_dupImBuf(ibuf);
+  EXPECT_FALSE(IMB_dirty_tiles_any(ibuf_copy));
+  EXPECT_TRUE(IMB_dirty_tiles_any(ibuf));
+
+  IMB_freeImBuf(ibuf_copy);
+  IMB_freeImBuf(ibuf);
+}
+
+}  // namespace blender::imbuf::tests
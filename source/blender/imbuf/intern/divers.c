@@ -60,6 +60,175 @@ static void clear_dither_context(DitherContext *di)
 
 /** \} */
 
+#ifdef __SSE2__
+
+/* -------------------------------------------------------------------- */
+/** \name Vectorized Row Conversion
+ *
+ * Conversion of RGBA rows four pixels at a time, used for the common cases of
+ * #IMB_buffer_byte_from_float and #IMB_buffer_float_from_byte. The functions return the number
+ * of converted pixels, the remaining ones are left to the scalar code. Results match the scalar
+ * code exactly, except for the dither noise which may differ by one step for some pixels.
+ * \{ */
+
+/* Same as #premul_to_straight_v4_v4. */
+MALWAYS_INLINE __m128 premul_to_straight_simd(const __m128 premul)
+{
+  const __m128 alpha = _mm_shuffle_ps(premul, premul, _MM_SHUFFLE(3, 3, 3, 3));
+  const __m128 keep = _mm_or_ps(
+      _mm_or_ps(_mm_cmpeq_ps(alpha, _mm_setzero_ps()), _mm_cmpeq_ps(alpha, _mm_set1_ps(1.0f))),
+      _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1)));
+  const __m128 straight = _mm_mul_ps(premul, _mm_div_ps(_mm_set1_ps(1.0f), alpha));
+  return _bli_math_blend_sse(keep, premul, straight);
+}
+
+/* Dither noise of four pixels of a row, scaled like #float_to_byte_dither_v4. */
+MALWAYS_INLINE __m128 dither_value_simd(int x, float inv_width, float t, float dither)
+{
+  const __m128 s = _mm_mul_ps(_mm_cvtepi32_ps(_mm_setr_epi32(x, x + 1, x + 2, x + 3)),
+                              _mm_set1_ps(inv_width));
+  const __m128 value = dither_random_value_simd(s, _mm_set1_ps(t));
+  return _mm_mul_ps(_mm_mul_ps(value, _mm_set1_ps(0.0033f)), _mm_set1_ps(dither));
+}
+
+/* Dither value of one pixel for the color channels, alpha is not dithered. */
+#  define DITHER_PIXEL_SIMD(dither_v, i) \
+    _mm_and_ps(_mm_shuffle_ps(dither_v, dither_v, _MM_SHUFFLE(i, i, i, i)), \
+               _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)))
+
+/* Pack four pixels with channels in 32 bit lanes into 16 bytes. */
+MALWAYS_INLINE void store_byte_rgba4_simd(
+    uchar *to, const __m128i p0, const __m128i p1, const __m128i p2, const __m128i p3)
+{
+  const __m128i p01 = _mm_packs_epi32(p0, p1);
+  const __m128i p23 = _mm_packs_epi32(p2, p3);
+  _mm_storeu_si128((__m128i *)to, _mm_packus_epi16(p01, p23));
+}
+
+/* Float RGBA to byte RGBA without color space conversion. */
+static int float_to_byte_rgba_row_simd(uchar *to,
+                                       const float *from,
+                                       int width,
+                                       bool predivide,
+                                       float dither,
+                                       float inv_width,
+                                       float t)
+{
+  int x;
+
+  for (x = 0; x + 4 <= width; x += 4, from += 16, to += 16) {
+    __m128 pixel[4];
+    for (int i = 0; i < 4; i++) {
+      pixel[i] = _mm_loadu_ps(from + i * 4);
+      if (predivide) {
+        pixel[i] = premul_to_straight_simd(pixel[i]);
+      }
+    }
+
+    if (dither != 0.0f) {
+      const __m128 dither_v = dither_value_simd(x, inv_width, t, dither);
+      pixel[0] = _mm_add_ps(DITHER_PIXEL_SIMD(dither_v, 0), pixel[0]);
+      pixel[1] = _mm_add_ps(DITHER_PIXEL_SIMD(dither_v, 1), pixel[1]);
+      pixel[2] = _mm_add_ps(DITHER_PIXEL_SIMD(dither_v, 2), pixel[2]);
+      pixel[3] = _mm_add_ps(DITHER_PIXEL_SIMD(dither_v, 3), pixel[3]);
+    }
+
+    store_byte_rgba4_simd(to,
+                          _bli_math_unit_float_to_uchar_clamp_sse(pixel[0]),
+                          _bli_math_unit_float_to_uchar_clamp_sse(pixel[1]),
+                          _bli_math_unit_float_to_uchar_clamp_sse(pixel[2]),
+                          _bli_math_unit_float_to_uchar_clamp_sse(pixel[3]));
+  }
+
+  return x;
+}
+
+/* Linear float RGBA to sRGB byte RGBA. The transfer function itself uses the same lookup
+ * table as #linearrgb_to_srgb_ushort4, the rest of the conversion is vectorized. */
+static int float_to_byte_srgb_rgba_row_simd(uchar *to,
+                                            const float *from,
+                                            int width,
+                                            bool predivide,
+                                            float dither,
+                                            float inv_width,
+                                            float t)
+{
+  const __m128i alpha_lane = _mm_setr_epi32(0, 0, 0, -1);
+  int x;
+
+  for (x = 0; x + 4 <= width; x += 4, from += 16, to += 16) {
+    __m128i us[4];
+    for (int i = 0; i < 4; i++) {
+      __m128 pixel = _mm_loadu_ps(from + i * 4);
+      if (predivide) {
+        pixel = premul_to_straight_simd(pixel);
+      }
+
+      /* Table index from the upper 16 bits of the float. */
+      int index[4];
+      _mm_storeu_si128((__m128i *)index, _mm_srli_epi32(_mm_castps_si128(pixel), 16));
+      us[i] = _mm_setr_epi32(BLI_color_to_srgb_table[index[0]],
+                             BLI_color_to_srgb_table[index[1]],
+                             BLI_color_to_srgb_table[index[2]],
+                             unit_float_to_ushort_clamp(from[i * 4 + 3]));
+    }
+
+    __m128i result[4];
+    for (int i = 0; i < 4; i++) {
+      result[i] = _bli_math_unit_ushort_to_uchar_sse(us[i]);
+    }
+
+    if (dither != 0.0f) {
+      /* Same as #ushort_to_byte_dither_v4, alpha is converted without dither. */
+      const __m128 dither_v = dither_value_simd(x, inv_width, t, dither);
+      __m128 dither_pixel[4];
+      dither_pixel[0] = DITHER_PIXEL_SIMD(dither_v, 0);
+      dither_pixel[1] = DITHER_PIXEL_SIMD(dither_v, 1);
+      dither_pixel[2] = DITHER_PIXEL_SIMD(dither_v, 2);
+      dither_pixel[3] = DITHER_PIXEL_SIMD(dither_v, 3);
+
+      for (int i = 0; i < 4; i++) {
+        const __m128 value = _mm_div_ps(_mm_cvtepi32_ps(us[i]), _mm_set1_ps(65535.0f));
+        const __m128i dithered = _bli_math_unit_float_to_uchar_clamp_sse(
+            _mm_add_ps(dither_pixel[i], value));
+        result[i] = _mm_or_si128(_mm_and_si128(alpha_lane, result[i]),
+                                 _mm_andnot_si128(alpha_lane, dithered));
+      }
+    }
+
+    store_byte_rgba4_simd(to, result[0], result[1], result[2], result[3]);
+  }
+
+  return x;
+}
+
+#  undef DITHER_PIXEL_SIMD
+
+/* Byte RGBA to float RGBA without color space conversion. */
+static int byte_to_float_rgba_row_simd(float *to, const uchar *from, int width)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+  int x;
+
+  for (x = 0; x + 4 <= width; x += 4, from += 16, to += 16) {
+    const __m128i bytes = _mm_loadu_si128((const __m128i *)from);
+    const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+    const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+
+    _mm_storeu_ps(to, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+    _mm_storeu_ps(to + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+    _mm_storeu_ps(to + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+    _mm_storeu_ps(to + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+  }
+
+  return x;
+}
+
+/** \} */
+
+#endif /* __SSE2__ */
+
 /* -------------------------------------------------------------------- */
 /** \name Generic Buffer Conversion
  * \{ */
@@ -184,26 +353,33 @@ void IMB_buffer_byte_from_float(uchar *rect_to,
       if (profile_to == profile_from) {
         float straight[4];
 
+        x = 0;
+#ifdef __SSE2__
+        x = float_to_byte_rgba_row_simd(to, from, width, predivide, dither, inv_width, t);
+        from += 4 * x;
+        to += 4 * x;
+#endif
+
         /* no color space conversion */
         if (dither && predivide) {
-          for (x = 0; x < width; x++, from += 4, to += 4) {
+          for (; x < width; x++, from += 4, to += 4) {
             premul_to_straight_v4_v4(straight, from);
             float_to_byte_dither_v4(to, straight, di, (float)x * inv_width, t);
           }
         }
         else if (dither) {
-          for (x = 0; x < width; x++, from += 4, to += 4) {
+          for (; x < width; x++, from += 4, to += 4) {
             float_to_byte_dither_v4(to, from, di, (float)x * inv_width, t);
           }
         }
         else if (predivide) {
-          for (x = 0; x < width; x++, from += 4, to += 4) {
+          for (; x < width; x++, from += 4, to += 4) {
             premul_to_straight_v4_v4(straight, from);
             rgba_float_to_uchar(to, straight);
           }
         }
         else {
-          for (x = 0; x < width; x++, from += 4, to += 4) {
+          for (; x < width; x++, from += 4, to += 4) {
             rgba_float_to_uchar(to, from);
           }
         }
@@ -213,28 +389,35 @@ void IMB_buffer_byte_from_float(uchar *rect_to,
         unsigned short us[4];
         float straight[4];
 
+        x = 0;
+#ifdef __SSE2__
+        x = float_to_byte_srgb_rgba_row_simd(to, from, width, predivide, dither, inv_width, t);
+        from += 4 * x;
+        to += 4 * x;
+#endif
+
         if (dither && predivide) {
-          for (x = 0; x < width; x++, from += 4, to += 4) {
+          for (; x < width; x++, from += 4, to += 4) {
             premul_to_straight_v4_v4(straight, from);
-            linearrgb_to_srgb_ushort4(us, from);
+            linearrgb_to_srgb_ushort4(us, straight);
             ushort_to_byte_dither_v4(to, us, di, (float)x * inv_width, t);
           }
         }
         else if (dither) {
-          for (x = 0; x < width; x++, from += 4, to += 4) {
+          for (; x < width; x++, from += 4, to += 4) {
             linearrgb_to_srgb_ushort4(us, from);
             ushort_to_byte_dither_v4(to, us, di, (float)x * inv_width, t);
           }
         }
         else if (predivide) {
-          for (x = 0; x < width; x++, from += 4, to += 4) {
+          for (; x < width; x++, from += 4, to += 4) {
             premul_to_straight_v4_v4(straight, from);
-            linearrgb_to_srgb_ushort4(us, from);
+            linearrgb_to_srgb_ushort4(us, straight);
             ushort_to_byte_v4(to, us);
           }
         }
         else {
-          for (x = 0; x < width; x++, from += 4, to += 4) {
+          for (; x < width; x++, from += 4, to += 4) {
             linearrgb_to_srgb_ushort4(us, from);
             ushort_to_byte_v4(to, us);
           }
@@ -391,7 +574,13 @@ void IMB_buffer_float_from_byte(float *rect_to,
 
     if (profile_to == profile_from) {
       /* no color space conversion */
-      for (x = 0; x < width; x++, from += 4, to += 4) {
+      x = 0;
+#ifdef __SSE2__
+      x = byte_to_float_rgba_row_simd(to, from, width);
+      from += 4 * x;
+      to += 4 * x;
+#endif
+      for (; x < width; x++, from += 4, to += 4) {
         rgba_uchar_to_float(to, from);
       }
     }
@@ -0,0 +1,227 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include "BLI_math.h"
+#include "BLI_rand.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+namespace blender::imbuf::tests {
+
+/* Widths below, at and above the four pixels converted at once, with every possible number of
+ * remaining pixels. */
+static const int WIDTHS[] = {1, 2, 3, 4, 5, 6, 7, 8, 13, 31, 66};
+static const int HEIGHT = 3;
+/* Rows are padded, the padding must be left untouched. */
+static const int STRIDE_PADDING = 3;
+static const uchar BYTE_UNSET = 0xA5;
+
+class imbuf_buffer_conversion : public testing::Test {
+ public:
+  static void SetUpTestCase()
+  {
+    testing::Test::SetUpTestCase();
+    BLI_init_srgb_conversion();
+  }
+};
+
+/* Colors slightly outside of the 0..1 range, with some alpha values exactly 0 or 1 to hit the
+ * special cases of unpremultiplying. The pixels start after one float of padding, so they are
+ * not 16 byte aligned. */
+static std::vector<float> random_float_pixels(int pixels_num, int seed)
+{
+  RNG *rng = BLI_rng_new(seed);
+  std::vector<float> buffer((size_t)pixels_num * 4 + 1, 0.0f);
+  float *pixels = buffer.data() + 1;
+  for (int i = 0; i < pixels_num; i++) {
+    for (int c = 0; c < 3; c++) {
+      pixels[i * 4 + c] = BLI_rng_get_float(rng) * 1.4f - 0.2f;
+    }
+    const int alpha_case = BLI_rng_get_int(rng) % 4;
+    pixels[i * 4 + 3] = (alpha_case == 0) ? 0.0f :
+                        (alpha_case == 1) ? 1.0f :
+                                            BLI_rng_get_float(rng);
+  }
+  BLI_rng_free(rng);
+  return buffer;
+}
+
+/* The scalar conversion of #IMB_buffer_byte_from_float for RGBA, done per pixel. */
+static void byte_from_float_reference(uchar *rect_to,
+                                      const float *rect_from,
+                                      float dither,
+                                      bool to_srgb,
+                                      bool predivide,
+                                      int width,
+                                      int height,
+                                      int stride_to,
+                                      int stride_from)
+{
+  const float inv_width = 1.0f / width;
+  const float inv_height = 1.0f / height;
+
+  for (int y = 0; y < height; y++) {
+    const float t = y * inv_height;
+    for (int x = 0; x < width; x++) {
+      const float *from = rect_from + ((size_t)stride_from * y + x) * 4;
+      uchar *to = rect_to + ((size_t)stride_to * y + x) * 4;
+      const float dither_value = dither_random_value((float)x * inv_width, t) * 0.0033f * dither;
+
+      float straight[4];
+      if (predivide) {
+        premul_to_straight_v4_v4(straight, from);
+      }
+      else {
+        copy_v4_v4(straight, from);
+      }
+
+      if (to_srgb) {
+        unsigned short us[4];
+        linearrgb_to_srgb_ushort4(us, straight);
+        for (int c = 0; c < 3; c++) {
+          to[c] = dither ? unit_float_to_uchar_clamp(dither_value + (float)us[c] / 65535.0f) :
+                           unit_ushort_to_uchar(us[c]);
+        }
+        to[3] = unit_ushort_to_uchar(us[3]);
+      }
+      else if (dither) {
+        for (int c = 0; c < 3; c++) {
+          to[c] = unit_float_to_uchar_clamp(dither_value + straight[c]);
+        }
+        to[3] = unit_float_to_uchar_clamp(straight[3]);
+      }
+      else {
+        rgba_float_to_uchar(to, straight);
+      }
+    }
+  }
+}
+
+static void test_byte_from_float(bool to_srgb, bool predivide, float dither)
+{
+  for (const int width : WIDTHS) {
+    const int stride = width + STRIDE_PADDING;
+    const int pixels_num = stride * HEIGHT;
+    const std::vector<float> pixels = random_float_pixels(pixels_num, width);
+    const float *from = pixels.data() + 1;
+
+    /* Results start one byte into the buffers, so they are not aligned either. */
+    std::vector<uchar> result((size_t)pixels_num * 4 + 1, BYTE_UNSET);
+    std::vector<uchar> expect((size_t)pixels_num * 4 + 1, BYTE_UNSET);
+
+    IMB_buffer_byte_from_float(result.data() + 1,
+                               from,
+                               4,
+                               dither,
+                               to_srgb ? IB_PROFILE_SRGB : IB_PROFILE_LINEAR_RGB,
+                               IB_PROFILE_LINEAR_RGB,
+                               predivide,
+                               width,
+                               HEIGHT,
+                               stride,
+                               stride);
+    byte_from_float_reference(
+        expect.data() + 1, from, dither, to_srgb, predivide, width, HEIGHT, stride, stride);
+
+    /* The vectorized dither noise may differ by one step in some pixels, everything else must
+     * match exactly. */
+    const int max_difference = dither ? 1 : 0;
+    int different_num = 0;
+    for (size_t i = 0; i < result.size(); i++) {
+      const int difference = abs((int)result[i] - (int)expect[i]);
+      EXPECT_LE(difference, max_difference) << "width " << width << ", byte " << i;
+      different_num += difference != 0;
+    }
+    EXPECT_LE(different_num, (int)result.size() / 50) << "width " << width;
+  }
+}
+
+TEST_F(imbuf_buffer_conversion, ByteFromFloat)
+{
+  test_byte_from_float(false, false, 0.0f);
+}
+
+TEST_F(imbuf_buffer_conversion, ByteFromFloatPredivide)
+{
+  test_byte_from_float(false, true, 0.0f);
+}
+
+TEST_F(imbuf_buffer_conversion, ByteFromFloatDither)
+{
+  test_byte_from_float(false, false, 1.0f);
+  test_byte_from_float(false, true, 1.0f);
+}
+
+TEST_F(imbuf_buffer_conversion, ByteFromFloatSRGB)
+{
+  test_byte_from_float(true, false, 0.0f);
+}
+
+TEST_F(imbuf_buffer_conversion, ByteFromFloatSRGBPredivide)
+{
+  test_byte_from_float(true, true, 0.0f);
+}
+
+TEST_F(imbuf_buffer_conversion, ByteFromFloatSRGBDither)
+{
+  test_byte_from_float(true, false, 1.0f);
+  test_byte_from_float(true, true, 1.0f);
+}
+
+TEST_F(imbuf_buffer_conversion, FloatFromByte)
+{
+  for (const int width : WIDTHS) {
+    const int stride = width + STRIDE_PADDING;
+    const int pixels_num = stride * HEIGHT;
+
+    std::vector<uchar> pixels((size_t)pixels_num * 4 + 3);
+    for (size_t i = 0; i < pixels.size(); i++) {
+      pixels[i] = (uchar)((i * 89 + width) % 256);
+    }
+
+    /* Start three bytes and one float into the buffers, so neither is 16 byte aligned. */
+    const uchar *from = pixels.data() + 3;
+    std::vector<float> result((size_t)pixels_num * 4 + 1, -1.0f);
+    std::vector<float> expect((size_t)pixels_num * 4 + 1, -1.0f);
+
+    IMB_buffer_float_from_byte(result.data() + 1,
+                               from,
+                               IB_PROFILE_SRGB,
+                               IB_PROFILE_SRGB,
+                               false,
+                               width,
+                               HEIGHT,
+                               stride,
+                               stride);
+    for (int y = 0; y < HEIGHT; y++) {
+      for (int x = 0; x < width; x++) {
+        const size_t offset = ((size_t)stride * y + x) * 4;
+        rgba_uchar_to_float(expect.data() + 1 + offset, from + offset);
+      }
+    }
+
+    for (size_t i = 0; i < result.size(); i++) {
+      EXPECT_EQ(result[i], expect[i]) << "width " << width << ", float " << i;
+    }
+  }
+}
+
+}  // namespace blender::imbuf::tests
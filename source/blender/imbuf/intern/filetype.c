@@ -57,6 +57,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_ftype_default,
      imb_load_jpeg,
      NULL,
+     imb_thumbnail_jpeg,
      imb_savejpeg,
      NULL,
      0,
@@ -68,6 +69,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_ftype_default,
      imb_loadpng,
      NULL,
+     NULL,
      imb_savepng,
      NULL,
      0,
@@ -79,6 +81,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_ftype_default,
      imb_bmp_decode,
      NULL,
+     NULL,
      imb_savebmp,
      NULL,
      0,
@@ -90,6 +93,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_ftype_default,
      imb_loadtarga,
      NULL,
+     NULL,
      imb_savetarga,
      NULL,
      0,
@@ -101,6 +105,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_ftype_iris,
      imb_loadiris,
      NULL,
+     NULL,
      imb_saveiris,
      NULL,
      0,
@@ -113,6 +118,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_ftype_default,
      imb_load_dpx,
      NULL,
+     NULL,
      imb_save_dpx,
      NULL,
      IM_FTYPE_FLOAT,
@@ -124,6 +130,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_ftype_default,
      imb_load_cineon,
      NULL,
+     NULL,
      imb_save_cineon,
      NULL,
      IM_FTYPE_FLOAT,
@@ -137,6 +144,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_ftype_default,
      imb_loadtiff,
      NULL,
+     NULL,
      imb_savetiff,
      imb_loadtiletiff,
      0,
@@ -150,6 +158,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_ftype_default,
      imb_loadhdr,
      NULL,
+     NULL,
      imb_savehdr,
      NULL,
      IM_FTYPE_FLOAT,
@@ -163,6 +172,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_ftype_default,
      imb_load_openexr,
      NULL,
+     imb_load_filepath_thumbnail_openexr,
      imb_save_openexr,
      NULL,
      IM_FTYPE_FLOAT,
@@ -176,6 +186,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_ftype_default,
      imb_load_jp2,
      NULL,
+     NULL,
      imb_save_jp2,
      NULL,
      IM_FTYPE_FLOAT,
@@ -191,6 +202,7 @@ const ImFileType IMB_FILE_TYPES[] = {
      NULL,
      NULL,
      NULL,
+     NULL,
      0,
      IMB_FTYPE_DDS,
      COLOR_ROLE_DEFAULT_BYTE},
@@ -204,11 +216,12 @@ const ImFileType IMB_FILE_TYPES[] = {
      imb_load_photoshop,
      NULL,
      NULL,
+     NULL,
      IM_FTYPE_FLOAT,
      IMB_FTYPE_PSD,
      COLOR_ROLE_DEFAULT_FLOAT},
 #endif
-    {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, 0},
+    {NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, 0},
 };
 
 const ImFileType *IMB_FILE_TYPES_LAST = &IMB_FILE_TYPES[ARRAY_SIZE(IMB_FILE_TYPES) - 1];
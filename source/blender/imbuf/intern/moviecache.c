@@ -23,6 +23,8 @@
 
 #undef DEBUG_MESSAGES
 
+#include <limits.h>
+#include <math.h>
 #include <memory.h>
 #include <stdlib.h> /* for qsort */
 
@@ -35,6 +37,8 @@
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
+#include "PIL_time.h"
+
 #include "IMB_moviecache.h"
 
 #include "IMB_imbuf.h"
@@ -50,9 +54,21 @@
 #  define PRINT(format, ...)
 #endif
 
+/* Items with a recompute cost of this many seconds are kept twice as long as free ones. */
+#define MOVIECACHE_COST_WEIGHT 10.0
+/* Misses which are not followed by a put within this time are not used as a cost estimate. */
+#define MOVIECACHE_COST_MAX 10.0
+
 static MEM_CacheLimiterC *limitor = NULL;
 static pthread_mutex_t limitor_lock = BLI_MUTEX_INITIALIZER;
 
+/* All fields below are protected by #limitor_lock. */
+
+/* Incremented on every put and successful get, used as a clock for least-recently-used. */
+static uint64_t limitor_access_tick = 0;
+/* Statistics accumulated over all caches. */
+static MovieCacheStatistics limitor_stats = {0};
+
 typedef struct MovieCache {
   char name[64];
 
@@ -74,7 +90,13 @@ typedef struct MovieCache {
   void *last_userkey;
 
   int totseg, *points, proxy, render_flags; /* for visual statistics optimization */
-  int pad;
+
+  /* Time and key hash of the last miss, the following put of the same key gets the time
+   * in-between as its recompute cost. */
+  unsigned int miss_hash;
+  double miss_time;
+
+  MovieCacheStatistics stats;
 } MovieCache;
 
 typedef struct MovieCacheKey {
@@ -87,6 +109,10 @@ typedef struct MovieCacheItem {
   ImBuf *ibuf;
   MEM_CacheLimiterHandleC *c_handle;
   void *priority_data;
+  /* Value of #limitor_access_tick when the item was last put or requested. */
+  uint64_t last_access;
+  /* Time in seconds it took to create the buffer, zero if unknown. */
+  float cost;
 } MovieCacheItem;
 
 static unsigned int moviecache_hashhash(const void *keyv)
@@ -113,6 +139,8 @@ static void moviecache_keyfree(void *val)
   BLI_mempool_free(key->cache_owner->keys_pool, key);
 }
 
+/* Callers hold #limitor_lock when the item can have a buffer, it is not taken here since
+ * #do_moviecache_put may already hold it when replacing an item. */
 static void moviecache_valfree(void *val)
 {
   MovieCacheItem *item = (MovieCacheItem *)val;
@@ -122,6 +150,9 @@ static void moviecache_valfree(void *val)
 
   if (item->ibuf) {
     MEM_CacheLimiter_unmanage(item->c_handle);
+    cache->stats.totitem--;
+    limitor_stats.totitem--;
+
     IMB_freeImBuf(item->ibuf);
   }
 
@@ -178,6 +209,12 @@ static void IMB_moviecache_destructor(void *p)
     item->ibuf = NULL;
     item->c_handle = NULL;
 
+    /* Only called by the limiter, which means the item is evicted. */
+    cache->stats.totitem--;
+    cache->stats.evictions++;
+    limitor_stats.totitem--;
+    limitor_stats.evictions++;
+
     /* force cached segments to be updated */
     if (cache->points) {
       MEM_freeN(cache->points);
@@ -207,20 +244,37 @@ static size_t get_item_size(void *p)
   return size;
 }
 
-static int get_item_priority(void *item_v, int default_priority)
+/* Priority of items from caches without their own priority callback.
+ *
+ * Least recently used items are freed first, large buffers are freed before small ones of
+ * the same age and buffers which took long to create are kept longer. */
+static int get_item_default_priority(MovieCacheItem *item)
+{
+  const double age = (double)(limitor_access_tick - item->last_access);
+  const double size_mb = (double)get_item_size(item) / (1024.0 * 1024.0);
+  const double size_factor = 1.0 + log2(1.0 + size_mb);
+  const double cost_factor = 1.0 + (double)item->cost * MOVIECACHE_COST_WEIGHT;
+  const double priority = -age * size_factor / cost_factor;
+
+  return (priority > (double)(INT_MIN + 1)) ? (int)priority : INT_MIN + 1;
+}
+
+static int get_item_priority(void *item_v, int UNUSED(default_priority))
 {
   MovieCacheItem *item = (MovieCacheItem *)item_v;
   MovieCache *cache = item->cache_owner;
   int priority;
 
   if (!cache->getitempriorityfp) {
+    priority = get_item_default_priority(item);
+
     PRINT("%s: cache '%s' item %p use default priority %d\n",
           __func__,
           cache->name,
           item,
-          default_priority);
+          priority);
 
-    return default_priority;
+    return priority;
   }
 
   priority = cache->getitempriorityfp(cache->last_userkey, item->priority_data);
@@ -327,22 +381,34 @@ static void do_moviecache_put(MovieCache *cache, void *userkey, ImBuf *ibuf, boo
   item->cache_owner = cache;
   item->c_handle = NULL;
   item->priority_data = NULL;
+  item->cost = 0.0f;
 
   if (cache->getprioritydatafp) {
     item->priority_data = cache->getprioritydatafp(userkey);
   }
 
+  if (need_lock) {
+    BLI_mutex_lock(&limitor_lock);
+  }
+
   BLI_ghash_reinsert(cache->hash, key, item, moviecache_keyfree, moviecache_valfree);
 
   if (cache->last_userkey) {
     memcpy(cache->last_userkey, userkey, cache->keysize);
   }
 
-  if (need_lock) {
-    BLI_mutex_lock(&limitor_lock);
+  if (cache->miss_time != 0.0 && cache->miss_hash == cache->hashfp(userkey)) {
+    const double cost = PIL_check_seconds_timer() - cache->miss_time;
+    if (cost < MOVIECACHE_COST_MAX) {
+      item->cost = (float)cost;
+    }
+    cache->miss_time = 0.0;
   }
 
+  item->last_access = ++limitor_access_tick;
   item->c_handle = MEM_CacheLimiter_insert(limitor, item);
+  cache->stats.totitem++;
+  limitor_stats.totitem++;
 
   MEM_CacheLimiter_ref(item->c_handle);
   MEM_CacheLimiter_enforce_limits(limitor);
@@ -392,7 +458,10 @@ void IMB_moviecache_remove(MovieCache *cache, void *userkey)
   MovieCacheKey key;
   key.cache_owner = cache;
   key.userkey = userkey;
+
+  BLI_mutex_lock(&limitor_lock);
   BLI_ghash_remove(cache->hash, &key, moviecache_keyfree, moviecache_valfree);
+  BLI_mutex_unlock(&limitor_lock);
 }
 
 ImBuf *IMB_moviecache_get(MovieCache *cache, void *userkey)
@@ -404,18 +473,26 @@ ImBuf *IMB_moviecache_get(MovieCache *cache, void *userkey)
   key.userkey = userkey;
   item = (MovieCacheItem *)BLI_ghash_lookup(cache->hash, &key);
 
-  if (item) {
-    if (item->ibuf) {
-      BLI_mutex_lock(&limitor_lock);
-      MEM_CacheLimiter_touch(item->c_handle);
-      BLI_mutex_unlock(&limitor_lock);
+  BLI_mutex_lock(&limitor_lock);
 
-      IMB_refImBuf(item->ibuf);
+  if (item && item->ibuf) {
+    MEM_CacheLimiter_touch(item->c_handle);
+    item->last_access = ++limitor_access_tick;
+    cache->stats.hits++;
+    limitor_stats.hits++;
+    BLI_mutex_unlock(&limitor_lock);
 
-      return item->ibuf;
-    }
+    IMB_refImBuf(item->ibuf);
+
+    return item->ibuf;
   }
 
+  cache->miss_hash = cache->hashfp(userkey);
+  cache->miss_time = PIL_check_seconds_timer();
+  cache->stats.misses++;
+  limitor_stats.misses++;
+  BLI_mutex_unlock(&limitor_lock);
+
   return NULL;
 }
 
@@ -435,7 +512,9 @@ void IMB_moviecache_free(MovieCache *cache)
 {
   PRINT("%s: cache '%s' free\n", __func__, cache->name);
 
+  BLI_mutex_lock(&limitor_lock);
   BLI_ghash_free(cache->hash, moviecache_keyfree, moviecache_valfree);
+  BLI_mutex_unlock(&limitor_lock);
 
   BLI_mempool_destroy(cache->keys_pool);
   BLI_mempool_destroy(cache->items_pool);
@@ -471,11 +550,52 @@ void IMB_moviecache_cleanup(MovieCache *cache,
     if (cleanup_check_cb(item->ibuf, key->userkey, userdata)) {
       PRINT("%s: cache '%s' remove item %p\n", __func__, cache->name, item);
 
+      BLI_mutex_lock(&limitor_lock);
       BLI_ghash_remove(cache->hash, key, moviecache_keyfree, moviecache_valfree);
+      BLI_mutex_unlock(&limitor_lock);
     }
   }
 }
 
+size_t IMB_moviecache_get_memory_in_use(void)
+{
+  size_t mem_in_use = 0;
+
+  if (limitor) {
+    BLI_mutex_lock(&limitor_lock);
+    mem_in_use = MEM_CacheLimiter_get_memory_in_use(limitor);
+    BLI_mutex_unlock(&limitor_lock);
+  }
+
+  return mem_in_use;
+}
+
+/* Statistics of all movie caches, memory usage includes every cache sharing the limiter. */
+void IMB_moviecache_get_statistics(MovieCacheStatistics *r_stats)
+{
+  BLI_mutex_lock(&limitor_lock);
+  *r_stats = limitor_stats;
+  r_stats->memory_in_use = limitor ? MEM_CacheLimiter_get_memory_in_use(limitor) : 0;
+  BLI_mutex_unlock(&limitor_lock);
+}
+
+/* Statistics of a single cache, memory usage only counts buffers stored in that cache. */
+void IMB_moviecache_get_cache_statistics(MovieCache *cache, MovieCacheStatistics *r_stats)
+{
+  GHashIterator gh_iter;
+
+  BLI_mutex_lock(&limitor_lock);
+  *r_stats = cache->stats;
+  r_stats->memory_in_use = 0;
+  GHASH_ITER (gh_iter, cache->hash) {
+    MovieCacheItem *item = BLI_ghashIterator_getValue(&gh_iter);
+    if (item->ibuf) {
+      r_stats->memory_in_use += get_item_size(item);
+    }
+  }
+  BLI_mutex_unlock(&limitor_lock);
+}
+
 /* get segments of cached frames. useful for debugging cache policies */
 void IMB_moviecache_get_cache_segments(
     MovieCache *cache, int proxy, int render_flags, int *r_totseg, int **r_points)
@@ -42,8 +42,11 @@
 #include <ImfInputFile.h>
 #include <ImfOutputFile.h>
 #include <ImfPixelType.h>
+#include <ImfPreviewImage.h>
+#include <ImfRgbaFile.h>
 #include <ImfStandardAttributes.h>
 #include <ImfStringAttribute.h>
+#include <ImfTiledRgbaFile.h>
 #include <ImfVersion.h>
 #include <half.h>
 
@@ -78,6 +81,7 @@ _CRTIMP void __cdecl _invalid_parameter_noinfo(void)
 }
 #include "BLI_blenlib.h"
 #include "BLI_math_color.h"
+#include "BLI_math_vector.h"
 #include "BLI_threads.h"
 
 #include "BKE_idprop.h"
@@ -98,6 +102,9 @@ using namespace Imath;
 extern "C" {
 /* prototype */
 static struct ExrPass *imb_exr_get_pass(ListBase *lb, char *passname);
+static bool imb_exr_build_layers(struct ExrHandle *data);
+static bool imb_exr_is_multi(MultiPartInputFile &file);
+static void imb_exr_pass_alloc_rect(struct ExrHandle *data, struct ExrPass *pass);
 static bool exr_has_multiview(MultiPartInputFile &file);
 static bool exr_has_multipart_file(MultiPartInputFile &file);
 static bool exr_has_alpha(MultiPartInputFile &file);
@@ -632,6 +639,8 @@ typedef struct ExrHandle {
   OutputFile *ofile;
 
   int tilex, tiley;
+  /** Size of the tiles in the file, smaller tiles written at once are compressed in parallel. */
+  int file_tilex, file_tiley;
   int width, height;
   int mipmap;
 
@@ -893,6 +902,16 @@ int IMB_exr_begin_write(void *handle,
   return (data->ofile != nullptr);
 }
 
+/* Tiles written by the render pipeline are split into smaller tiles in the file, so that
+ * OpenEXR compresses the parts of every written tile in parallel. */
+static int imb_exr_file_tile_size(int size)
+{
+  while (size > 64 && (size % 2) == 0) {
+    size /= 2;
+  }
+  return size;
+}
+
 /* only used for writing temp. render results (not image files)
  * (FSA and Save Buffers) */
 void IMB_exrtile_begin_write(
@@ -905,13 +924,19 @@ void IMB_exrtile_begin_write(
 
   data->tilex = tilex;
   data->tiley = tiley;
+  data->file_tilex = imb_exr_file_tile_size(tilex);
+  data->file_tiley = imb_exr_file_tile_size(tiley);
   data->width = width;
   data->height = height;
   data->mipmap = mipmap;
 
-  header.setTileDescription(TileDescription(tilex, tiley, (mipmap) ? MIPMAP_LEVELS : ONE_LEVEL));
+  header.setTileDescription(TileDescription(
+      data->file_tilex, data->file_tiley, (mipmap) ? MIPMAP_LEVELS : ONE_LEVEL));
   header.compression() = RLE_COMPRESSION;
   header.setType(TILEDIMAGE);
+  /* Tiles finish in any order, write them to the file immediately instead of keeping them in
+   * memory until all tiles before them are written. */
+  header.lineOrder() = RANDOM_Y;
 
   header.insert("BlenderMultiChannel", StringAttribute("Blender V2.43"));
 
@@ -1102,47 +1127,62 @@ void IMB_exr_clear_channels(void *handle)
 void IMB_exr_write_channels(void *handle)
 {
   ExrHandle *data = (ExrHandle *)handle;
-  FrameBuffer frameBuffer;
   ExrChannel *echan;
 
   if (data->channels.first) {
-    const size_t num_pixels = ((size_t)data->width) * data->height;
-    half *rect_half = nullptr, *current_rect_half = nullptr;
+    /* Half float channels are converted and written a block of scanlines at a time, instead of
+     * allocating a full resolution copy of all of them. The block covers enough scanlines for
+     * OpenEXR to compress multiple line buffers in parallel. */
+    const int block_height = (data->num_half_channels != 0) ?
+                                 std::min(data->height,
+                                          std::max(256, 32 * BLI_system_thread_count())) :
+                                 data->height;
+    const size_t block_pixels = ((size_t)data->width) * block_height;
+    half *rect_half = nullptr;
 
-    /* We allocate teporary storage for half pixels for all the channels at once. */
     if (data->num_half_channels != 0) {
-      rect_half = (half *)MEM_mallocN(sizeof(half) * data->num_half_channels * num_pixels,
+      rect_half = (half *)MEM_mallocN(sizeof(half) * data->num_half_channels * block_pixels,
                                       __func__);
-      current_rect_half = rect_half;
     }
 
-    for (echan = (ExrChannel *)data->channels.first; echan; echan = echan->next) {
-      /* Writing starts from last scanline, stride negative. */
-      if (echan->use_half_float) {
-        float *rect = echan->rect;
-        half *cur = current_rect_half;
-        for (size_t i = 0; i < num_pixels; i++, cur++) {
-          *cur = rect[i * echan->xstride];
+    try {
+      for (int ystart = 0; ystart < data->height; ystart += block_height) {
+        const int yend = std::min(ystart + block_height, data->height);
+        FrameBuffer frameBuffer;
+        half *current_rect_half = rect_half;
+
+        for (echan = (ExrChannel *)data->channels.first; echan; echan = echan->next) {
+          /* Writing starts from last scanline, stride negative. */
+          if (echan->use_half_float) {
+            for (int y = ystart; y < yend; y++) {
+              const float *rect = echan->rect + echan->xstride * (data->height - 1L - y) *
+                                                    data->width;
+              half *cur = current_rect_half + ((size_t)(y - ystart)) * data->width;
+              for (int x = 0; x < data->width; x++) {
+                cur[x] = rect[x * echan->xstride];
+              }
+            }
+            /* The slice is addressed with scanlines of the file, offset it to the block. */
+            char *rect_to_write = (char *)current_rect_half -
+                                  ((size_t)ystart) * data->width * sizeof(half);
+            frameBuffer.insert(
+                echan->name,
+                Slice(Imf::HALF, rect_to_write, sizeof(half), data->width * sizeof(half)));
+            current_rect_half += block_pixels;
+          }
+          else {
+            float *rect = echan->rect + echan->xstride * (data->height - 1L) * data->width;
+            frameBuffer.insert(echan->name,
+                               Slice(Imf::FLOAT,
+                                     (char *)rect,
+                                     echan->xstride * sizeof(float),
+                                     -echan->ystride * sizeof(float)));
+          }
         }
-        half *rect_to_write = current_rect_half + (data->height - 1L) * data->width;
-        frameBuffer.insert(
-            echan->name,
-            Slice(Imf::HALF, (char *)rect_to_write, sizeof(half), -data->width * sizeof(half)));
-        current_rect_half += num_pixels;
-      }
-      else {
-        float *rect = echan->rect + echan->xstride * (data->height - 1L) * data->width;
-        frameBuffer.insert(echan->name,
-                           Slice(Imf::FLOAT,
-                                 (char *)rect,
-                                 echan->xstride * sizeof(float),
-                                 -echan->ystride * sizeof(float)));
-      }
-    }
 
-    data->ofile->setFrameBuffer(frameBuffer);
-    try {
-      data->ofile->writePixels(data->height);
+        data->ofile->setFrameBuffer(frameBuffer);
+        data->ofile->writePixels(yend - ystart);
+      }
     }
     catch (const std::exception &exc) {
       std::cerr << "OpenEXR-writePixels: ERROR: " << exc.what() << std::endl;
@@ -1202,17 +1242,38 @@ void IMB_exrtile_write_channels(
   out.setFrameBuffer(frameBuffer);
 
   try {
-    // printf("write tile %d %d\n", partx/data->tilex, party/data->tiley);
-    out.writeTile(partx / data->tilex, party / data->tiley, level);
+    /* Write all file tiles covered by the tile at once, they are compressed in parallel. */
+    const int dx1 = partx / data->file_tilex;
+    const int dy1 = party / data->file_tiley;
+    const int dx2 = std::min((partx + data->tilex - 1) / data->file_tilex,
+                             out.numXTiles(level) - 1);
+    const int dy2 = std::min((party + data->tiley - 1) / data->file_tiley,
+                             out.numYTiles(level) - 1);
+    out.writeTiles(dx1, dx2, dy1, dy2, level);
   }
   catch (const std::exception &exc) {
     std::cerr << "OpenEXR-writeTile: ERROR: " << exc.what() << std::endl;
   }
 }
 
-void IMB_exr_read_channels(void *handle)
+static bool imb_exr_pass_has_channel(const ExrPass *pass, const ExrChannel *echan)
+{
+  for (int a = 0; a < pass->totchan; a++) {
+    if (pass->chan[a] == echan) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Read the channels which have a buffer assigned. When only_pass is given, channels of other
+ * passes are skipped, parts without any requested channel are not decoded at all.
+ * Rows are in Blender convention (bottom to top) and clamped to the data window. */
+static void imb_exr_read_channels_ex(ExrHandle *data,
+                                     const ExrPass *only_pass,
+                                     int row_min,
+                                     int row_max)
 {
-  ExrHandle *data = (ExrHandle *)handle;
   int numparts = data->ifile->parts();
 
   /* Check if EXR was saved with previous versions of blender which flipped images. */
@@ -1239,11 +1300,15 @@ void IMB_exr_read_channels(void *handle)
     /* Insert all matching channel into framebuffer. */
     FrameBuffer frameBuffer;
     ExrChannel *echan;
+    int num_inserted = 0;
 
     for (echan = (ExrChannel *)data->channels.first; echan; echan = echan->next) {
       if (echan->m->part_number != i) {
         continue;
       }
+      if (only_pass && !imb_exr_pass_has_channel(only_pass, echan)) {
+        continue;
+      }
 
       exr_printf("%d %-6s %-22s \"%s\"\n",
                  echan->m->part_number,
@@ -1270,17 +1335,39 @@ void IMB_exr_read_channels(void *handle)
 
         frameBuffer.insert(echan->m->internal_name,
                            Slice(Imf::FLOAT, (char *)rect, xstride, ystride));
+        num_inserted++;
       }
       else {
         printf("warning, channel with no rect set %s\n", echan->m->internal_name.c_str());
       }
     }
 
-    /* Read pixels. */
+    if (num_inserted == 0 && only_pass) {
+      continue;
+    }
+
+    /* Convert the requested rows to scanlines of this part. */
+    int ymin, ymax;
+    if (!flip) {
+      ymin = dw.min.y + (data->height - 1) - row_max;
+      ymax = dw.min.y + (data->height - 1) - row_min;
+    }
+    else {
+      ymin = dw.min.y + row_min;
+      ymax = dw.min.y + row_max;
+    }
+    CLAMP_MIN(ymin, dw.min.y);
+    CLAMP_MAX(ymax, dw.max.y);
+    if (ymin > ymax) {
+      continue;
+    }
+
+    /* Read pixels. Decompression of the scanline blocks or tiles runs on the OpenEXR global
+     * thread pool, see #imb_initopenexr. */
     try {
       in.setFrameBuffer(frameBuffer);
-      exr_printf("readPixels:readPixels[%d]: min.y: %d, max.y: %d\n", i, dw.min.y, dw.max.y);
-      in.readPixels(dw.min.y, dw.max.y);
+      exr_printf("readPixels:readPixels[%d]: min.y: %d, max.y: %d\n", i, ymin, ymax);
+      in.readPixels(ymin, ymax);
     }
     catch (const std::exception &exc) {
       std::cerr << "OpenEXR-readPixels: ERROR: " << exc.what() << std::endl;
@@ -1289,6 +1376,72 @@ void IMB_exr_read_channels(void *handle)
   }
 }
 
+void IMB_exr_read_channels(void *handle)
+{
+  ExrHandle *data = (ExrHandle *)handle;
+  imb_exr_read_channels_ex(data, nullptr, 0, data->height - 1);
+}
+
+/* Open a multi-layer file for reading individual passes on demand, returns 0 for single layer
+ * files. Unlike #IMB_exr_begin_read no pixel
+ * buffers exist until a pass is requested with #IMB_exr_read_pass, so the cost of a read only
+ * depends on the requested passes and rows, not on the total amount of passes in the file. */
+int IMB_exr_begin_read_multilayer(void *handle, const char *filename, int *width, int *height)
+{
+  ExrHandle *data = (ExrHandle *)handle;
+
+  if (!IMB_exr_begin_read(handle, filename, width, height)) {
+    return 0;
+  }
+  if (!imb_exr_is_multi(*data->ifile)) {
+    return 0;
+  }
+
+  return imb_exr_build_layers(data) ? 1 : 0;
+}
+
+/* Decode rows row_min..row_max (inclusive, bottom to top) of a single pass.
+ * A NULL layname or viewname matches the first layer or view containing the pass.
+ * The returned buffer is owned by the handle and covers the full image, rows outside the
+ * requested range stay zero unless read before. */
+float *IMB_exr_read_pass(void *handle,
+                         const char *layname,
+                         const char *passname,
+                         const char *viewname,
+                         int row_min,
+                         int row_max,
+                         int *r_totchan)
+{
+  ExrHandle *data = (ExrHandle *)handle;
+
+  LISTBASE_FOREACH (ExrLayer *, lay, &data->layers) {
+    if (layname && !STREQ(lay->name, layname)) {
+      continue;
+    }
+    LISTBASE_FOREACH (ExrPass *, pass, &lay->passes) {
+      if (!STREQ(pass->internal_name, passname)) {
+        continue;
+      }
+      if (viewname && !STREQ(pass->view, viewname)) {
+        continue;
+      }
+
+      if (pass->rect == nullptr) {
+        imb_exr_pass_alloc_rect(data, pass);
+      }
+      imb_exr_read_channels_ex(
+          data, pass, std::max(row_min, 0), std::min(row_max, data->height - 1));
+
+      if (r_totchan) {
+        *r_totchan = pass->totchan;
+      }
+      return pass->rect;
+    }
+  }
+
+  return nullptr;
+}
+
 void IMB_exr_multilayer_convert(void *handle,
                                 void *base,
                                 void *(*addview)(void *base, const char *str),
@@ -1531,42 +1684,12 @@ static ExrPass *imb_exr_get_pass(ListBase *lb, char *passname)
 }
 
 /* creates channels, makes a hierarchy and assigns memory to channels */
-static ExrHandle *imb_exr_begin_read_mem(IStream &file_stream,
-                                         MultiPartInputFile &file,
-                                         int width,
-                                         int height)
+/* Build the hierarchical layer list from the flattened channels, without allocating buffers. */
+static bool imb_exr_build_layers(ExrHandle *data)
 {
-  ExrLayer *lay;
-  ExrPass *pass;
   ExrChannel *echan;
-  ExrHandle *data = (ExrHandle *)IMB_exr_get_handle();
-  int a;
   char layname[EXR_TOT_MAXNAME], passname[EXR_TOT_MAXNAME];
 
-  data->ifile_stream = &file_stream;
-  data->ifile = &file;
-
-  data->width = width;
-  data->height = height;
-
-  std::vector<MultiViewChannelName> channels;
-  GetChannelsInMultiPartFile(*data->ifile, channels);
-
-  imb_exr_get_views(*data->ifile, *data->multiView);
-
-  for (size_t i = 0; i < channels.size(); i++) {
-    IMB_exr_add_channel(
-        data, nullptr, channels[i].name.c_str(), channels[i].view.c_str(), 0, 0, nullptr, false);
-
-    echan = (ExrChannel *)data->channels.last;
-    echan->m->name = channels[i].name;
-    echan->m->view = channels[i].view;
-    echan->m->part_number = channels[i].part_number;
-    echan->m->internal_name = channels[i].internal_name;
-  }
-
-  /* now try to sort out how to assign memory to the channels */
-  /* first build hierarchical layer list */
   for (echan = (ExrChannel *)data->channels.first; echan; echan = echan->next) {
     if (imb_exr_split_channel_name(echan, layname, passname)) {
 
@@ -1597,68 +1720,119 @@ static ExrHandle *imb_exr_begin_read_mem(IStream &file_stream,
   }
   if (echan) {
     printf("error, too many channels in one pass: %s\n", echan->m->name.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+/* Allocate the buffer of a pass and point its channels into it. */
+static void imb_exr_pass_alloc_rect(ExrHandle *data, ExrPass *pass)
+{
+  ExrChannel *echan;
+  const int width = data->width;
+  const int height = data->height;
+  int a;
+
+  if (pass->totchan == 0) {
+    return;
+  }
+
+  pass->rect = (float *)MEM_callocN(width * height * pass->totchan * sizeof(float), "pass rect");
+  if (pass->totchan == 1) {
+    echan = pass->chan[0];
+    echan->rect = pass->rect;
+    echan->xstride = 1;
+    echan->ystride = width;
+    pass->chan_id[0] = echan->chan_id;
+  }
+  else {
+    char lookup[256];
+
+    memset(lookup, 0, sizeof(lookup));
+
+    /* we can have RGB(A), XYZ(W), UVA */
+    if (ELEM(pass->totchan, 3, 4)) {
+      if (pass->chan[0]->chan_id == 'B' || pass->chan[1]->chan_id == 'B' ||
+          pass->chan[2]->chan_id == 'B') {
+        lookup[(unsigned int)'R'] = 0;
+        lookup[(unsigned int)'G'] = 1;
+        lookup[(unsigned int)'B'] = 2;
+        lookup[(unsigned int)'A'] = 3;
+      }
+      else if (pass->chan[0]->chan_id == 'Y' || pass->chan[1]->chan_id == 'Y' ||
+               pass->chan[2]->chan_id == 'Y') {
+        lookup[(unsigned int)'X'] = 0;
+        lookup[(unsigned int)'Y'] = 1;
+        lookup[(unsigned int)'Z'] = 2;
+        lookup[(unsigned int)'W'] = 3;
+      }
+      else {
+        lookup[(unsigned int)'U'] = 0;
+        lookup[(unsigned int)'V'] = 1;
+        lookup[(unsigned int)'A'] = 2;
+      }
+      for (a = 0; a < pass->totchan; a++) {
+        echan = pass->chan[a];
+        echan->rect = pass->rect + lookup[(unsigned int)echan->chan_id];
+        echan->xstride = pass->totchan;
+        echan->ystride = width * pass->totchan;
+        pass->chan_id[(unsigned int)lookup[(unsigned int)echan->chan_id]] = echan->chan_id;
+      }
+    }
+    else { /* unknown */
+      for (a = 0; a < pass->totchan; a++) {
+        echan = pass->chan[a];
+        echan->rect = pass->rect + a;
+        echan->xstride = pass->totchan;
+        echan->ystride = width * pass->totchan;
+        pass->chan_id[a] = echan->chan_id;
+      }
+    }
+  }
+}
+
+static ExrHandle *imb_exr_begin_read_mem(IStream &file_stream,
+                                         MultiPartInputFile &file,
+                                         int width,
+                                         int height)
+{
+  ExrChannel *echan;
+  ExrHandle *data = (ExrHandle *)IMB_exr_get_handle();
+
+  data->ifile_stream = &file_stream;
+  data->ifile = &file;
+
+  data->width = width;
+  data->height = height;
+
+  std::vector<MultiViewChannelName> channels;
+  GetChannelsInMultiPartFile(*data->ifile, channels);
+
+  imb_exr_get_views(*data->ifile, *data->multiView);
+
+  for (size_t i = 0; i < channels.size(); i++) {
+    IMB_exr_add_channel(
+        data, nullptr, channels[i].name.c_str(), channels[i].view.c_str(), 0, 0, nullptr, false);
+
+    echan = (ExrChannel *)data->channels.last;
+    echan->m->name = channels[i].name;
+    echan->m->view = channels[i].view;
+    echan->m->part_number = channels[i].part_number;
+    echan->m->internal_name = channels[i].internal_name;
+  }
+
+  /* now try to sort out how to assign memory to the channels */
+  /* first build hierarchical layer list */
+  if (!imb_exr_build_layers(data)) {
     IMB_exr_close(data);
     return nullptr;
   }
 
   /* with some heuristics, try to merge the channels in buffers */
-  for (lay = (ExrLayer *)data->layers.first; lay; lay = lay->next) {
-    for (pass = (ExrPass *)lay->passes.first; pass; pass = pass->next) {
-      if (pass->totchan) {
-        pass->rect = (float *)MEM_callocN(width * height * pass->totchan * sizeof(float),
-                                          "pass rect");
-        if (pass->totchan == 1) {
-          echan = pass->chan[0];
-          echan->rect = pass->rect;
-          echan->xstride = 1;
-          echan->ystride = width;
-          pass->chan_id[0] = echan->chan_id;
-        }
-        else {
-          char lookup[256];
-
-          memset(lookup, 0, sizeof(lookup));
-
-          /* we can have RGB(A), XYZ(W), UVA */
-          if (ELEM(pass->totchan, 3, 4)) {
-            if (pass->chan[0]->chan_id == 'B' || pass->chan[1]->chan_id == 'B' ||
-                pass->chan[2]->chan_id == 'B') {
-              lookup[(unsigned int)'R'] = 0;
-              lookup[(unsigned int)'G'] = 1;
-              lookup[(unsigned int)'B'] = 2;
-              lookup[(unsigned int)'A'] = 3;
-            }
-            else if (pass->chan[0]->chan_id == 'Y' || pass->chan[1]->chan_id == 'Y' ||
-                     pass->chan[2]->chan_id == 'Y') {
-              lookup[(unsigned int)'X'] = 0;
-              lookup[(unsigned int)'Y'] = 1;
-              lookup[(unsigned int)'Z'] = 2;
-              lookup[(unsigned int)'W'] = 3;
-            }
-            else {
-              lookup[(unsigned int)'U'] = 0;
-              lookup[(unsigned int)'V'] = 1;
-              lookup[(unsigned int)'A'] = 2;
-            }
-            for (a = 0; a < pass->totchan; a++) {
-              echan = pass->chan[a];
-              echan->rect = pass->rect + lookup[(unsigned int)echan->chan_id];
-              echan->xstride = pass->totchan;
-              echan->ystride = width * pass->totchan;
-              pass->chan_id[(unsigned int)lookup[(unsigned int)echan->chan_id]] = echan->chan_id;
-            }
-          }
-          else { /* unknown */
-            for (a = 0; a < pass->totchan; a++) {
-              echan = pass->chan[a];
-              echan->rect = pass->rect + a;
-              echan->xstride = pass->totchan;
-              echan->ystride = width * pass->totchan;
-              pass->chan_id[a] = echan->chan_id;
-            }
-          }
-        }
-      }
+  LISTBASE_FOREACH (ExrLayer *, lay, &data->layers) {
+    LISTBASE_FOREACH (ExrPass *, pass, &lay->passes) {
+      imb_exr_pass_alloc_rect(data, pass);
     }
   }
 
@@ -2098,6 +2272,183 @@ struct ImBuf *imb_load_openexr(const unsigned char *mem,
   }
 }
 
+/* Scanline files decode this many rows of every strip of rows a thumbnail row covers, the rows
+ * in between are skipped. */
+#define EXR_THUMBNAIL_STRIP_ROWS 2
+
+/**
+ * Box filter the source image into the thumbnail. `get_row` returns a row of the source, only up
+ * to `strip_rows_max` evenly spaced rows are requested for every row of the thumbnail.
+ */
+template<typename GetRowFn>
+static void exr_thumbnail_box_filter(ImBuf *ibuf,
+                                     const int source_w,
+                                     const int source_h,
+                                     const int strip_rows_max,
+                                     const GetRowFn &get_row)
+{
+  const int dest_w = ibuf->x;
+  const int dest_h = ibuf->y;
+  Array<float> sums((size_t)dest_w * 4);
+
+  for (int h = 0; h < dest_h; h++) {
+    const int y_begin = (int)(((int64_t)h * source_h) / dest_h);
+    const int y_end = MAX2((int)(((int64_t)(h + 1) * source_h) / dest_h), y_begin + 1);
+    const int strip_h = y_end - y_begin;
+    const int rows_num = MIN2(strip_h, strip_rows_max);
+
+    memset(&sums[0], 0, sizeof(float) * dest_w * 4);
+    for (int row = 0; row < rows_num; row++) {
+      /* Center of each of the parts the strip is divided into. */
+      const Rgba *source_row = get_row(y_begin + ((2 * row + 1) * strip_h) / (2 * rows_num));
+
+      for (int w = 0; w < dest_w; w++) {
+        const int x_begin = (int)(((int64_t)w * source_w) / dest_w);
+        const int x_end = MAX2((int)(((int64_t)(w + 1) * source_w) / dest_w), x_begin + 1);
+        float *sum = &sums[(size_t)w * 4];
+
+        for (const Rgba *source_px = source_row + x_begin; source_px < source_row + x_end;
+             source_px++) {
+          sum[0] += source_px->r;
+          sum[1] += source_px->g;
+          sum[2] += source_px->b;
+          sum[3] += source_px->a;
+        }
+      }
+    }
+
+    /* EXR rows are stored top to bottom. */
+    float *dest_px = ibuf->rect_float + (size_t)(dest_h - 1 - h) * dest_w * 4;
+    for (int w = 0; w < dest_w; w++, dest_px += 4) {
+      const int x_begin = (int)(((int64_t)w * source_w) / dest_w);
+      const int x_end = MAX2((int)(((int64_t)(w + 1) * source_w) / dest_w), x_begin + 1);
+      mul_v4_v4fl(dest_px, &sums[(size_t)w * 4], 1.0f / (float)(rows_num * (x_end - x_begin)));
+    }
+  }
+}
+
+/* Tiled files with mip or rip maps store smaller versions of the image. Fill the thumbnail from
+ * the smallest level that is at least as large, returns false when the file has no levels. */
+static bool exr_thumbnail_from_levels(const char *filepath, ImBuf *ibuf)
+{
+  IFileStream stream(filepath);
+  TiledRgbaInputFile file(stream, 1);
+
+  const LevelMode level_mode = file.levelMode();
+  if (level_mode == ONE_LEVEL) {
+    return false;
+  }
+
+  int lx = 0, ly = 0;
+  while (lx + 1 < file.numXLevels() && file.levelWidth(lx + 1) >= ibuf->x) {
+    lx++;
+  }
+  while (ly + 1 < file.numYLevels() && file.levelHeight(ly + 1) >= ibuf->y) {
+    ly++;
+  }
+  if (level_mode == MIPMAP_LEVELS) {
+    lx = ly = MIN2(lx, ly);
+  }
+
+  const Box2i dw = file.dataWindowForLevel(lx, ly);
+  const int level_w = dw.max.x - dw.min.x + 1;
+  const int level_h = dw.max.y - dw.min.y + 1;
+  Array<Rgba> pixels((size_t)level_w * level_h);
+
+  file.setFrameBuffer(&pixels[0] - dw.min.x - (size_t)dw.min.y * level_w, 1, level_w);
+  file.readTiles(0, file.numXTiles(lx) - 1, 0, file.numYTiles(ly) - 1, lx, ly);
+
+  exr_thumbnail_box_filter(ibuf, level_w, level_h, level_h, [&](const int y) {
+    return &pixels[(size_t)y * level_w];
+  });
+  return true;
+}
+
+struct ImBuf *imb_load_filepath_thumbnail_openexr(const char *filepath,
+                                                  const int UNUSED(flags),
+                                                  const size_t max_thumb_size,
+                                                  char colorspace[],
+                                                  size_t *r_width,
+                                                  size_t *r_height)
+{
+  IStream *stream = nullptr;
+  RgbaInputFile *file = nullptr;
+  struct ImBuf *ibuf = nullptr;
+
+  /* OpenExr uses exceptions for error-handling. */
+  try {
+    stream = new IFileStream(filepath);
+    file = new RgbaInputFile(*stream, 1);
+
+    /* Multi-layer files without a plain RGB or luminance layer are left to the regular
+     * loader. */
+    if (!file->isComplete() || (file->channels() & (WRITE_RGB | WRITE_Y)) == 0) {
+      delete file;
+      delete stream;
+      return nullptr;
+    }
+
+    const Box2i dw = file->dataWindow();
+    const int source_w = dw.max.x - dw.min.x + 1;
+    const int source_h = dw.max.y - dw.min.y + 1;
+    *r_width = source_w;
+    *r_height = source_h;
+
+    /* Use the embedded preview when it is large enough, it is stored as 8 bit sRGB. */
+    if (file->header().hasPreviewImage()) {
+      const PreviewImage &preview = file->header().previewImage();
+      if (MAX2(preview.width(), preview.height()) >= max_thumb_size) {
+        colorspace_set_default_role(colorspace, IM_MAX_SPACE, COLOR_ROLE_DEFAULT_BYTE);
+        ibuf = IMB_allocFromBuffer(
+            (unsigned int *)preview.pixels(), nullptr, preview.width(), preview.height(), 4);
+        IMB_flipy(ibuf);
+        delete file;
+        delete stream;
+        return ibuf;
+      }
+    }
+
+    /* Same as the regular loader. */
+    colorspace_set_default_role(colorspace, IM_MAX_SPACE, COLOR_ROLE_DEFAULT_FLOAT);
+
+    const float scale_factor = MIN3(1.0f,
+                                    (float)max_thumb_size / (float)source_w,
+                                    (float)max_thumb_size / (float)source_h);
+    const int dest_w = MAX2((int)(source_w * scale_factor), 1);
+    const int dest_h = MAX2((int)(source_h * scale_factor), 1);
+
+    ibuf = IMB_allocImBuf(dest_w, dest_h, 32, IB_rectfloat);
+
+    if (!(file->header().hasTileDescription() && exr_thumbnail_from_levels(filepath, ibuf))) {
+      /* Scanline files are decoded in blocks of rows, blocks without a requested row are
+       * skipped. */
+      Array<Rgba> row(source_w);
+      exr_thumbnail_box_filter(
+          ibuf, source_w, source_h, EXR_THUMBNAIL_STRIP_ROWS, [&](const int y) {
+            const int file_y = y + dw.min.y;
+            file->setFrameBuffer(&row[0] - dw.min.x - (size_t)file_y * source_w, 1, source_w);
+            file->readPixels(file_y);
+            return (const Rgba *)&row[0];
+          });
+    }
+
+    ibuf->ftype = IMB_FTYPE_OPENEXR;
+
+    delete file;
+    delete stream;
+    return ibuf;
+  }
+  catch (const std::exception &exc) {
+    std::cerr << exc.what() << std::endl;
+    if (ibuf) {
+      IMB_freeImBuf(ibuf);
+    }
+    delete file;
+    delete stream;
+    return nullptr;
+  }
+}
+
 void imb_initopenexr(void)
 {
   int num_threads = BLI_system_thread_count();
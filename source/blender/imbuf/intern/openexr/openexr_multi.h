@@ -51,6 +51,7 @@ void IMB_exr_add_channel(void *handle,
                          bool use_half_float);
 
 int IMB_exr_begin_read(void *handle, const char *filename, int *width, int *height);
+int IMB_exr_begin_read_multilayer(void *handle, const char *filename, int *width, int *height);
 int IMB_exr_begin_write(void *handle,
                         const char *filename,
                         int width,
@@ -72,6 +73,13 @@ float *IMB_exr_channel_rect(void *handle,
                             const char *view);
 
 void IMB_exr_read_channels(void *handle);
+float *IMB_exr_read_pass(void *handle,
+                         const char *layname,
+                         const char *passname,
+                         const char *viewname,
+                         int row_min,
+                         int row_max,
+                         int *r_totchan);
 void IMB_exr_write_channels(void *handle);
 void IMB_exrtile_write_channels(
     void *handle, int partx, int party, int level, const char *viewname, bool empty);
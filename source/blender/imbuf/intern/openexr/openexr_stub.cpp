@@ -50,6 +50,13 @@ int IMB_exr_begin_read(void * /*handle*/,
 {
   return 0;
 }
+int IMB_exr_begin_read_multilayer(void * /*handle*/,
+                                  const char * /*filename*/,
+                                  int * /*width*/,
+                                  int * /*height*/)
+{
+  return 0;
+}
 int IMB_exr_begin_write(void * /*handle*/,
                         const char * /*filename*/,
                         int /*width*/,
@@ -88,6 +95,16 @@ float *IMB_exr_channel_rect(void * /*handle*/,
 void IMB_exr_read_channels(void * /*handle*/)
 {
 }
+float *IMB_exr_read_pass(void * /*handle*/,
+                         const char * /*layname*/,
+                         const char * /*passname*/,
+                         const char * /*viewname*/,
+                         int /*row_min*/,
+                         int /*row_max*/,
+                         int * /*r_totchan*/)
+{
+  return nullptr;
+}
 void IMB_exr_write_channels(void * /*handle*/)
 {
 }
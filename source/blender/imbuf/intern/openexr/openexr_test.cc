@@ -0,0 +1,237 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include <cstring>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_scene_types.h"
+
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#include "BKE_appdir.h"
+
+#include "IMB_imbuf.h"
+
+#include "openexr_multi.h"
+
+namespace blender::imbuf::tests {
+
+/* Taller than a block of ZIP compressed scanlines, so row ranges span several blocks. */
+static const int WIDTH = 19;
+static const int HEIGHT = 37;
+
+struct TestPass {
+  const char *layname;
+  const char *passname;
+  const char *chan_id;
+};
+
+static const TestPass PASSES[] = {
+    {"RenderLayer", "Combined", "RGBA"},
+    {"RenderLayer", "Depth", "Z"},
+    {"RenderLayer", "Normal", "XYZ"},
+    {"Other", "Diffuse", "RGB"},
+};
+static const int PASSES_NUM = ARRAY_SIZE(PASSES);
+
+/* Unique per pass, channel and pixel, and exactly representable as float. */
+static float pass_value(int pass_index, int channel, int x, int y)
+{
+  return pass_index * 1000.0f + channel * 100.0f + y + x / 64.0f;
+}
+
+class imbuf_openexr_multilayer : public testing::Test {
+ protected:
+  char filepath[FILE_MAX];
+
+  static void SetUpTestCase()
+  {
+    testing::Test::SetUpTestCase();
+    IMB_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    IMB_exit();
+    testing::Test::TearDownTestCase();
+  }
+
+  void SetUp() override
+  {
+    BKE_tempdir_init(nullptr);
+    BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), "multilayer_test.exr");
+    write_multilayer();
+  }
+
+  void TearDown() override
+  {
+    BKE_tempdir_session_purge();
+  }
+
+  void write_multilayer()
+  {
+    void *handle = IMB_exr_get_handle();
+    float *rects[PASSES_NUM];
+
+    for (int p = 0; p < PASSES_NUM; p++) {
+      const int totchan = strlen(PASSES[p].chan_id);
+      rects[p] = (float *)MEM_malloc_arrayN(
+          (size_t)WIDTH * HEIGHT * totchan, sizeof(float), __func__);
+      for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+          for (int c = 0; c < totchan; c++) {
+            rects[p][((size_t)y * WIDTH + x) * totchan + c] = pass_value(p, c, x, y);
+          }
+        }
+      }
+
+      for (int c = 0; c < totchan; c++) {
+        char passname[EXR_PASS_MAXNAME];
+        BLI_snprintf(
+            passname, sizeof(passname), "%s.%c", PASSES[p].passname, PASSES[p].chan_id[c]);
+        IMB_exr_add_channel(handle,
+                            PASSES[p].layname,
+                            passname,
+                            "",
+                            totchan,
+                            totchan * WIDTH,
+                            rects[p] + c,
+                            false);
+      }
+    }
+
+    ASSERT_TRUE(
+        IMB_exr_begin_write(handle, filepath, WIDTH, HEIGHT, R_IMF_EXR_CODEC_ZIP, nullptr));
+    IMB_exr_write_channels(handle);
+    IMB_exr_close(handle);
+
+    for (int p = 0; p < PASSES_NUM; p++) {
+      MEM_freeN(rects[p]);
+    }
+  }
+
+  /* Rows row_min..row_max of the buffer must match the written pass, all others are zero. */
+  static void expect_pass_rows(
+      const float *rect, int pass_index, int totchan, int row_min, int row_max)
+  {
+    for (int y = 0; y < HEIGHT; y++) {
+      const bool is_read = (y >= row_min && y <= row_max);
+      for (int x = 0; x < WIDTH; x++) {
+        for (int c = 0; c < totchan; c++) {
+          const float expect = is_read ? pass_value(pass_index, c, x, y) : 0.0f;
+          EXPECT_EQ(rect[((size_t)y * WIDTH + x) * totchan + c], expect)
+              << "pass " << pass_index << ", channel " << c << ", pixel " << x << ", " << y;
+        }
+      }
+    }
+  }
+};
+
+TEST_F(imbuf_openexr_multilayer, ReadSinglePass)
+{
+  void *handle = IMB_exr_get_handle();
+  int width, height;
+  ASSERT_TRUE(IMB_exr_begin_read_multilayer(handle, filepath, &width, &height));
+  EXPECT_EQ(width, WIDTH);
+  EXPECT_EQ(height, HEIGHT);
+
+  int totchan = 0;
+  const float *rect = IMB_exr_read_pass(
+      handle, "Other", "Diffuse", nullptr, 0, HEIGHT - 1, &totchan);
+  ASSERT_NE(rect, nullptr);
+  EXPECT_EQ(totchan, 3);
+  expect_pass_rows(rect, 3, 3, 0, HEIGHT - 1);
+
+  /* Only the requested pass has a buffer. */
+  EXPECT_NE(IMB_exr_channel_rect(handle, "Other", "Diffuse.G", nullptr), nullptr);
+  EXPECT_EQ(IMB_exr_channel_rect(handle, "RenderLayer", "Combined.R", nullptr), nullptr);
+  EXPECT_EQ(IMB_exr_channel_rect(handle, "RenderLayer", "Normal.X", nullptr), nullptr);
+  EXPECT_EQ(IMB_exr_channel_rect(handle, "RenderLayer", "Depth.Z", nullptr), nullptr);
+
+  /* Without a layer name, the first layer containing the pass is used. */
+  rect = IMB_exr_read_pass(handle, nullptr, "Combined", nullptr, 0, HEIGHT - 1, &totchan);
+  ASSERT_NE(rect, nullptr);
+  EXPECT_EQ(totchan, 4);
+  expect_pass_rows(rect, 0, 4, 0, HEIGHT - 1);
+
+  EXPECT_EQ(IMB_exr_read_pass(handle, "Other", "Combined", nullptr, 0, HEIGHT - 1, &totchan),
+            nullptr);
+  EXPECT_EQ(IMB_exr_read_pass(handle, nullptr, "Emission", nullptr, 0, HEIGHT - 1, &totchan),
+            nullptr);
+
+  IMB_exr_close(handle);
+}
+
+TEST_F(imbuf_openexr_multilayer, ReadRows)
+{
+  void *handle = IMB_exr_get_handle();
+  int width, height;
+  ASSERT_TRUE(IMB_exr_begin_read_multilayer(handle, filepath, &width, &height));
+
+  /* Rows are bottom to top, the range crosses a block of scanlines. */
+  int totchan = 0;
+  const float *rect = IMB_exr_read_pass(
+      handle, "RenderLayer", "Normal", nullptr, 3, 20, &totchan);
+  ASSERT_NE(rect, nullptr);
+  EXPECT_EQ(totchan, 3);
+  expect_pass_rows(rect, 2, 3, 3, 20);
+
+  /* Reading more rows fills in the same buffer. */
+  const float *rect_more = IMB_exr_read_pass(
+      handle, "RenderLayer", "Normal", nullptr, 21, 30, &totchan);
+  EXPECT_EQ(rect_more, rect);
+  expect_pass_rows(rect, 2, 3, 3, 30);
+
+  /* Ranges are clamped to the image. */
+  rect = IMB_exr_read_pass(
+      handle, "RenderLayer", "Depth", nullptr, HEIGHT - 3, HEIGHT + 10, &totchan);
+  ASSERT_NE(rect, nullptr);
+  EXPECT_EQ(totchan, 1);
+  expect_pass_rows(rect, 1, 1, HEIGHT - 3, HEIGHT - 1);
+
+  rect = IMB_exr_read_pass(handle, "RenderLayer", "Combined", nullptr, -10, 0, &totchan);
+  ASSERT_NE(rect, nullptr);
+  expect_pass_rows(rect, 0, 4, 0, 0);
+
+  IMB_exr_close(handle);
+}
+
+TEST_F(imbuf_openexr_multilayer, ReadAllChannels)
+{
+  /* Reading all channels into buffers set by the caller still works with the partial reading. */
+  void *handle = IMB_exr_get_handle();
+  int width, height;
+  ASSERT_TRUE(IMB_exr_begin_read(handle, filepath, &width, &height));
+
+  float *rect = (float *)MEM_callocN(sizeof(float[3]) * WIDTH * HEIGHT, __func__);
+  for (int c = 0; c < 3; c++) {
+    char passname[EXR_PASS_MAXNAME];
+    BLI_snprintf(passname, sizeof(passname), "Diffuse.%c", "RGB"[c]);
+    IMB_exr_set_channel(handle, "Other", passname, 3, 3 * WIDTH, rect + c);
+  }
+  IMB_exr_read_channels(handle);
+  expect_pass_rows(rect, 3, 3, 0, HEIGHT - 1);
+
+  MEM_freeN(rect);
+  IMB_exr_close(handle);
+}
+
+}  // namespace blender::imbuf::tests
@@ -252,6 +252,52 @@ ImBuf *IMB_loadiffname(const char *filepath, int flags, char colorspace[IM_MAX_S
   return ibuf;
 }
 
+/**
+ * Load an image for generating a thumbnail. File types which can decode at reduced resolution
+ * return an image which is only at least \a max_thumb_size in its largest dimension, other
+ * types are loaded at full resolution. The full resolution of the image is returned in
+ * \a r_width and \a r_height.
+ */
+ImBuf *IMB_thumb_load_image(const char *filepath,
+                            const size_t max_thumb_size,
+                            char colorspace[IM_MAX_SPACE],
+                            size_t *r_width,
+                            size_t *r_height)
+{
+  const int flags = IB_rect | IB_metadata;
+  const int filetype = IMB_ispic_type(filepath);
+  ImBuf *ibuf = NULL;
+
+  if (filetype == 0) {
+    return NULL;
+  }
+
+  for (const ImFileType *type = IMB_FILE_TYPES; type < IMB_FILE_TYPES_LAST; type++) {
+    if (type->filetype == filetype && type->load_filepath_thumbnail) {
+      char effective_colorspace[IM_MAX_SPACE] = "";
+      if (colorspace) {
+        BLI_strncpy(effective_colorspace, colorspace, sizeof(effective_colorspace));
+      }
+
+      ibuf = type->load_filepath_thumbnail(
+          filepath, flags, max_thumb_size, effective_colorspace, r_width, r_height);
+      if (ibuf) {
+        imb_handle_alpha(ibuf, flags, colorspace, effective_colorspace);
+        return ibuf;
+      }
+      break;
+    }
+  }
+
+  ibuf = IMB_loadiffname(filepath, flags, colorspace);
+  if (ibuf) {
+    *r_width = ibuf->x;
+    *r_height = ibuf->y;
+  }
+
+  return ibuf;
+}
+
 ImBuf *IMB_testiffname(const char *filepath, int flags)
 {
   ImBuf *ibuf;
@@ -23,9 +23,16 @@
  */
 
 #include <math.h>
+#include <string.h>
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#include "BLI_math_base.h"
 #include "BLI_math_color.h"
 #include "BLI_math_interp.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "MEM_guardedalloc.h"
 
@@ -1876,3 +1883,345 @@ void IMB_scaleImBuf_threaded(ImBuf *ibuf, unsigned int newx, unsigned int newy)
     ibuf->rect_float = init_data.float_buffer;
   }
 }
+
+/* ******** filtered scaling ******** */
+
+/* Separable resampling: the image is first filtered horizontally into a float buffer of
+ * `newx * ibuf->y` pixels which is then filtered vertically. Both passes are threaded over rows.
+ *
+ * Byte buffers are converted to premultiplied float per row, so filtering does not bleed color
+ * of transparent pixels, float buffers are expected to be premultiplied already. */
+
+typedef struct ScaleFilterAxis {
+  /* First source pixel contributing to each destination pixel. */
+  int *first;
+  /* Number of contributing source pixels for each destination pixel. */
+  int *num;
+  /* Normalized weights, `taps` for each destination pixel. */
+  float *weights;
+  int taps;
+} ScaleFilterAxis;
+
+static float scale_filter_support(eIMBScaleFilter filter)
+{
+  switch (filter) {
+    case IMB_SCALE_FILTER_BOX:
+      return 0.5f;
+    case IMB_SCALE_FILTER_BILINEAR:
+      return 1.0f;
+    case IMB_SCALE_FILTER_MITCHELL:
+      return 2.0f;
+    case IMB_SCALE_FILTER_LANCZOS3:
+      return 3.0f;
+  }
+  BLI_assert(0);
+  return 1.0f;
+}
+
+static float scale_filter_sinc(float x)
+{
+  if (x == 0.0f) {
+    return 1.0f;
+  }
+  x *= (float)M_PI;
+  return sinf(x) / x;
+}
+
+static float scale_filter_eval(eIMBScaleFilter filter, float x)
+{
+  x = fabsf(x);
+
+  switch (filter) {
+    case IMB_SCALE_FILTER_BOX:
+      return (x < 0.5f) ? 1.0f : 0.0f;
+    case IMB_SCALE_FILTER_BILINEAR:
+      return (x < 1.0f) ? 1.0f - x : 0.0f;
+    case IMB_SCALE_FILTER_MITCHELL:
+      /* Mitchell-Netravali with B = C = 1/3. */
+      if (x < 1.0f) {
+        return (7.0f * x * x * x - 12.0f * x * x + 16.0f / 3.0f) / 6.0f;
+      }
+      if (x < 2.0f) {
+        return (-7.0f / 3.0f * x * x * x + 12.0f * x * x - 20.0f * x + 32.0f / 3.0f) / 6.0f;
+      }
+      return 0.0f;
+    case IMB_SCALE_FILTER_LANCZOS3:
+      return (x < 3.0f) ? scale_filter_sinc(x) * scale_filter_sinc(x / 3.0f) : 0.0f;
+  }
+  return 0.0f;
+}
+
+static void scale_filter_axis_init(ScaleFilterAxis *axis,
+                                   int src_size,
+                                   int dst_size,
+                                   eIMBScaleFilter filter)
+{
+  const float scale = (float)src_size / (float)dst_size;
+  /* When scaling down the filter is stretched to cover all source pixels. */
+  const float filter_scale = max_ff(scale, 1.0f);
+  const float support = scale_filter_support(filter) * filter_scale;
+
+  axis->taps = (int)ceilf(support * 2.0f) + 1;
+  axis->first = MEM_mallocN(sizeof(int) * dst_size, "scale filter first");
+  axis->num = MEM_mallocN(sizeof(int) * dst_size, "scale filter num");
+  axis->weights = MEM_callocN(sizeof(float) * dst_size * axis->taps, "scale filter weights");
+
+  for (int i = 0; i < dst_size; i++) {
+    const float center = ((float)i + 0.5f) * scale;
+    const int start = max_ii((int)floorf(center - support), 0);
+    const int end = min_ii(min_ii((int)ceilf(center + support), src_size), start + axis->taps);
+    float *weights = axis->weights + (size_t)i * axis->taps;
+    float total = 0.0f;
+
+    for (int j = start; j < end; j++) {
+      weights[j - start] = scale_filter_eval(filter, ((float)j + 0.5f - center) / filter_scale);
+      total += weights[j - start];
+    }
+
+    axis->first[i] = start;
+    axis->num[i] = end - start;
+
+    if (total != 0.0f) {
+      const float total_inv = 1.0f / total;
+      for (int j = 0; j < end - start; j++) {
+        weights[j] *= total_inv;
+      }
+    }
+    else {
+      /* Can only happen with a box filter hitting pixels exactly at its edge. */
+      axis->first[i] = clamp_i((int)center, 0, src_size - 1);
+      axis->num[i] = 1;
+      weights[0] = 1.0f;
+    }
+  }
+}
+
+static void scale_filter_axis_free(ScaleFilterAxis *axis)
+{
+  MEM_freeN(axis->first);
+  MEM_freeN(axis->num);
+  MEM_freeN(axis->weights);
+}
+
+/* dst = sum(weights[i] * src[i * stride]) for `channels` floats, src stride in floats. */
+BLI_INLINE void scale_filter_accumulate_pixel(float *dst,
+                                              const float *src,
+                                              const float *weights,
+                                              int num,
+                                              int channels)
+{
+#ifdef __SSE2__
+  if (channels == 4) {
+    __m128 sum = _mm_setzero_ps();
+    for (int i = 0; i < num; i++) {
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[i]), _mm_loadu_ps(src + i * 4)));
+    }
+    _mm_storeu_ps(dst, sum);
+    return;
+  }
+#endif
+
+  for (int c = 0; c < channels; c++) {
+    float sum = 0.0f;
+    for (int i = 0; i < num; i++) {
+      sum += weights[i] * src[i * channels + c];
+    }
+    dst[c] = sum;
+  }
+}
+
+/* dst[i] += weight * src[i] for a whole row of `len` floats. */
+BLI_INLINE void scale_filter_accumulate_row(float *dst, const float *src, float weight, size_t len)
+{
+  size_t i = 0;
+#ifdef __SSE2__
+  const __m128 weight4 = _mm_set1_ps(weight);
+  for (; i + 4 <= len; i += 4) {
+    __m128 sum = _mm_loadu_ps(dst + i);
+    sum = _mm_add_ps(sum, _mm_mul_ps(weight4, _mm_loadu_ps(src + i)));
+    _mm_storeu_ps(dst + i, sum);
+  }
+#endif
+  for (; i < len; i++) {
+    dst[i] += weight * src[i];
+  }
+}
+
+typedef struct ScaleFilterData {
+  const ImBuf *ibuf;
+  int newx, newy;
+  int channels;
+
+  ScaleFilterAxis axis_x, axis_y;
+
+  /* Result of the horizontal pass, `newx * ibuf->y` pixels. */
+  float *temp;
+
+  unsigned char *byte_buffer;
+  float *float_buffer;
+} ScaleFilterData;
+
+typedef struct ScaleFilterTLS {
+  /* Row of converted byte pixels, lazily allocated. */
+  float *row;
+} ScaleFilterTLS;
+
+static float *scale_filter_tls_row(ScaleFilterTLS *tls, int width)
+{
+  if (tls->row == NULL) {
+    tls->row = MEM_mallocN(sizeof(float[4]) * width, __func__);
+  }
+  return tls->row;
+}
+
+static void scale_filter_tls_free(const void *__restrict UNUSED(userdata), void *__restrict tls_v)
+{
+  ScaleFilterTLS *tls = tls_v;
+  MEM_SAFE_FREE(tls->row);
+}
+
+static void scale_filter_x_task(void *__restrict userdata,
+                                const int y,
+                                const TaskParallelTLS *__restrict tls)
+{
+  ScaleFilterData *data = userdata;
+  const ImBuf *ibuf = data->ibuf;
+  const ScaleFilterAxis *axis = &data->axis_x;
+  const int channels = data->channels;
+  const float *src;
+
+  if (data->byte_buffer) {
+    const unsigned char *src_byte = (unsigned char *)ibuf->rect + (size_t)y * ibuf->x * 4;
+    float *row = scale_filter_tls_row(tls->userdata_chunk, ibuf->x);
+    for (int x = 0; x < ibuf->x; x++) {
+      straight_uchar_to_premul_float(row + x * 4, src_byte + x * 4);
+    }
+    src = row;
+  }
+  else {
+    src = ibuf->rect_float + (size_t)y * ibuf->x * channels;
+  }
+
+  float *dst = data->temp + (size_t)y * data->newx * channels;
+  for (int x = 0; x < data->newx; x++, dst += channels) {
+    scale_filter_accumulate_pixel(dst,
+                                  src + axis->first[x] * channels,
+                                  axis->weights + (size_t)x * axis->taps,
+                                  axis->num[x],
+                                  channels);
+  }
+}
+
+static void scale_filter_y_task(void *__restrict userdata,
+                                const int y,
+                                const TaskParallelTLS *__restrict tls)
+{
+  ScaleFilterData *data = userdata;
+  const ScaleFilterAxis *axis = &data->axis_y;
+  const int channels = data->channels;
+  const size_t row_len = (size_t)data->newx * channels;
+  const float *weights = axis->weights + (size_t)y * axis->taps;
+  float *dst;
+
+  if (data->byte_buffer) {
+    dst = scale_filter_tls_row(tls->userdata_chunk, data->newx);
+  }
+  else {
+    dst = data->float_buffer + (size_t)y * row_len;
+  }
+
+  memset(dst, 0, sizeof(float) * row_len);
+  for (int i = 0; i < axis->num[y]; i++) {
+    scale_filter_accumulate_row(
+        dst, data->temp + (size_t)(axis->first[y] + i) * row_len, weights[i], row_len);
+  }
+
+  if (data->byte_buffer) {
+    unsigned char *dst_byte = data->byte_buffer + (size_t)y * data->newx * 4;
+    for (int x = 0; x < data->newx; x++) {
+      premul_float_to_straight_uchar(dst_byte + x * 4, dst + x * 4);
+    }
+  }
+}
+
+static void scale_filter_buffer(ImBuf *ibuf,
+                                ScaleFilterData *data,
+                                unsigned char *byte_buffer,
+                                float *float_buffer)
+{
+  ScaleFilterTLS tls = {NULL};
+  TaskParallelSettings settings;
+
+  data->byte_buffer = byte_buffer;
+  data->float_buffer = float_buffer;
+  data->channels = byte_buffer ? 4 : ibuf->channels;
+  data->temp = MEM_mallocN(sizeof(float) * data->channels * data->newx * ibuf->y, __func__);
+
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 8;
+  settings.userdata_chunk = &tls;
+  settings.userdata_chunk_size = sizeof(tls);
+  settings.func_free = scale_filter_tls_free;
+
+  BLI_task_parallel_range(0, ibuf->y, data, scale_filter_x_task, &settings);
+  BLI_task_parallel_range(0, data->newy, data, scale_filter_y_task, &settings);
+
+  MEM_freeN(data->temp);
+}
+
+/**
+ * Scale \a ibuf using \a filter, multi-threaded.
+ * Return true if \a ibuf is modified.
+ */
+bool IMB_scaleImBuf_filtered(struct ImBuf *ibuf,
+                             unsigned int newx,
+                             unsigned int newy,
+                             eIMBScaleFilter filter)
+{
+  ScaleFilterData data = {NULL};
+
+  if (ibuf == NULL) {
+    return false;
+  }
+  if (ibuf->rect == NULL && ibuf->rect_float == NULL) {
+    return false;
+  }
+  if (newx == 0 || newy == 0) {
+    return false;
+  }
+  if (newx == ibuf->x && newy == ibuf->y) {
+    return false;
+  }
+
+  /* Scale the Z-buffer while ibuf->x and ibuf->y are still the source size. */
+  scalefast_Z_ImBuf(ibuf, newx, newy);
+
+  data.ibuf = ibuf;
+  data.newx = newx;
+  data.newy = newy;
+  scale_filter_axis_init(&data.axis_x, ibuf->x, newx, filter);
+  scale_filter_axis_init(&data.axis_y, ibuf->y, newy, filter);
+
+  if (ibuf->rect) {
+    unsigned char *byte_buffer = MEM_mallocN(sizeof(char[4]) * newx * newy, __func__);
+    scale_filter_buffer(ibuf, &data, byte_buffer, NULL);
+    imb_freerectImBuf(ibuf);
+    ibuf->mall |= IB_rect;
+    ibuf->rect = (unsigned int *)byte_buffer;
+  }
+
+  if (ibuf->rect_float) {
+    float *float_buffer = MEM_mallocN(sizeof(float) * ibuf->channels * newx * newy, __func__);
+    scale_filter_buffer(ibuf, &data, NULL, float_buffer);
+    imb_freerectfloatImBuf(ibuf);
+    ibuf->mall |= IB_rectfloat;
+    ibuf->rect_float = float_buffer;
+  }
+
+  scale_filter_axis_free(&data.axis_x);
+  scale_filter_axis_free(&data.axis_y);
+
+  ibuf->x = newx;
+  ibuf->y = newy;
+  return true;
+}
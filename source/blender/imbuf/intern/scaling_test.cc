@@ -0,0 +1,254 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include "BLI_math.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+namespace blender::imbuf::tests {
+
+static const eIMBScaleFilter FILTERS[] = {IMB_SCALE_FILTER_BOX,
+                                          IMB_SCALE_FILTER_BILINEAR,
+                                          IMB_SCALE_FILTER_MITCHELL,
+                                          IMB_SCALE_FILTER_LANCZOS3};
+
+class imbuf_scale_filtered : public testing::Test {
+ public:
+  static void SetUpTestCase()
+  {
+    testing::Test::SetUpTestCase();
+    IMB_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    IMB_exit();
+    testing::Test::TearDownTestCase();
+  }
+};
+
+static ImBuf *float_image_new(int width, int height, const float color[4])
+{
+  ImBuf *ibuf = IMB_allocImBuf(width, height, 32, IB_rectfloat);
+  for (int i = 0; i < width * height; i++) {
+    copy_v4_v4(ibuf->rect_float + i * 4, color);
+  }
+  return ibuf;
+}
+
+static const float *float_pixel(const ImBuf *ibuf, int x, int y)
+{
+  return ibuf->rect_float + ((size_t)y * ibuf->x + x) * 4;
+}
+
+/* Image of the given size with a single white pixel. */
+static ImBuf *impulse_image_new(int width, int height, int x, int y)
+{
+  const float black[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  ImBuf *ibuf = float_image_new(width, height, black);
+  copy_v4_fl(ibuf->rect_float + ((size_t)y * width + x) * 4, 1.0f);
+  return ibuf;
+}
+
+/* Image with the red channel increasing from left to right, the value of each pixel is the
+ * position of its center. */
+static ImBuf *gradient_image_new(int width, int height)
+{
+  const float black[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+  ImBuf *ibuf = float_image_new(width, height, black);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      ibuf->rect_float[((size_t)y * width + x) * 4] = (float)x + 0.5f;
+    }
+  }
+  return ibuf;
+}
+
+TEST_F(imbuf_scale_filtered, ConstantFloat)
+{
+  const float color[4] = {0.2f, 0.4f, 0.6f, 0.8f};
+  const int sizes[][4] = {{13, 7, 5, 3}, {5, 3, 17, 11}, {8, 8, 3, 12}};
+
+  for (const eIMBScaleFilter filter : FILTERS) {
+    for (const auto &size : sizes) {
+      ImBuf *ibuf = float_image_new(size[0], size[1], color);
+      EXPECT_TRUE(IMB_scaleImBuf_filtered(ibuf, size[2], size[3], filter));
+      EXPECT_EQ(ibuf->x, size[2]);
+      EXPECT_EQ(ibuf->y, size[3]);
+
+      for (int y = 0; y < ibuf->y; y++) {
+        for (int x = 0; x < ibuf->x; x++) {
+          EXPECT_V4_NEAR(float_pixel(ibuf, x, y), color, 1e-6f);
+        }
+      }
+      IMB_freeImBuf(ibuf);
+    }
+  }
+}
+
+TEST_F(imbuf_scale_filtered, ConstantByte)
+{
+  const unsigned char color[4] = {51, 102, 153, 255};
+
+  for (const eIMBScaleFilter filter : FILTERS) {
+    ImBuf *ibuf = IMB_allocImBuf(11, 6, 32, IB_rect);
+    for (int i = 0; i < 11 * 6; i++) {
+      copy_v4_v4_uchar((unsigned char *)(ibuf->rect + i), color);
+    }
+
+    EXPECT_TRUE(IMB_scaleImBuf_filtered(ibuf, 4, 15, filter));
+    for (int i = 0; i < ibuf->x * ibuf->y; i++) {
+      const unsigned char *pixel = (unsigned char *)(ibuf->rect + i);
+      EXPECT_EQ(pixel[0], color[0]);
+      EXPECT_EQ(pixel[1], color[1]);
+      EXPECT_EQ(pixel[2], color[2]);
+      EXPECT_EQ(pixel[3], color[3]);
+    }
+    IMB_freeImBuf(ibuf);
+  }
+}
+
+TEST_F(imbuf_scale_filtered, ImpulseBoxDown)
+{
+  /* Every destination pixel averages 2 x 2 source pixels. */
+  ImBuf *ibuf = impulse_image_new(8, 8, 2, 5);
+  EXPECT_TRUE(IMB_scaleImBuf_filtered(ibuf, 4, 4, IMB_SCALE_FILTER_BOX));
+
+  for (int y = 0; y < 4; y++) {
+    for (int x = 0; x < 4; x++) {
+      const float expect = (x == 1 && y == 2) ? 0.25f : 0.0f;
+      EXPECT_NEAR(float_pixel(ibuf, x, y)[0], expect, 1e-6f) << x << ", " << y;
+      EXPECT_NEAR(float_pixel(ibuf, x, y)[3], expect, 1e-6f) << x << ", " << y;
+    }
+  }
+  IMB_freeImBuf(ibuf);
+}
+
+TEST_F(imbuf_scale_filtered, ImpulseBilinearUp)
+{
+  /* Destination pixel centers are a quarter pixel away from source pixel centers, so the impulse
+   * spreads to four pixels per axis with weights 1/4 and 3/4. */
+  ImBuf *ibuf = impulse_image_new(5, 5, 2, 2);
+  EXPECT_TRUE(IMB_scaleImBuf_filtered(ibuf, 10, 10, IMB_SCALE_FILTER_BILINEAR));
+
+  const float weights[10] = {0.0f, 0.0f, 0.0f, 0.25f, 0.75f, 0.75f, 0.25f, 0.0f, 0.0f, 0.0f};
+  for (int y = 0; y < 10; y++) {
+    for (int x = 0; x < 10; x++) {
+      EXPECT_NEAR(float_pixel(ibuf, x, y)[0], weights[x] * weights[y], 1e-6f) << x << ", " << y;
+    }
+  }
+  IMB_freeImBuf(ibuf);
+}
+
+TEST_F(imbuf_scale_filtered, ImpulseCubicUp)
+{
+  for (const eIMBScaleFilter filter : {IMB_SCALE_FILTER_MITCHELL, IMB_SCALE_FILTER_LANCZOS3}) {
+    ImBuf *ibuf = impulse_image_new(9, 9, 4, 4);
+    EXPECT_TRUE(IMB_scaleImBuf_filtered(ibuf, 18, 18, filter));
+
+    /* The response is symmetric around the impulse, peaks at it and both filters have negative
+     * lobes. */
+    float sum = 0.0f, min = 0.0f;
+    for (int y = 0; y < 18; y++) {
+      for (int x = 0; x < 18; x++) {
+        const float value = float_pixel(ibuf, x, y)[0];
+        EXPECT_NEAR(value, float_pixel(ibuf, 17 - x, y)[0], 1e-6f);
+        EXPECT_NEAR(value, float_pixel(ibuf, x, 17 - y)[0], 1e-6f);
+        EXPECT_NEAR(value, float_pixel(ibuf, y, x)[0], 1e-6f);
+        EXPECT_LE(value, float_pixel(ibuf, 8, 8)[0]);
+        sum += value;
+        min = min_ff(min, value);
+      }
+    }
+    EXPECT_LT(min, 0.0f);
+    /* Each source pixel covers four destination pixels. */
+    EXPECT_NEAR(sum, 4.0f, 0.05f);
+    IMB_freeImBuf(ibuf);
+  }
+}
+
+TEST_F(imbuf_scale_filtered, GradientDown)
+{
+  /* Symmetric filters keep a linear gradient, away from the borders where the filter is cut
+   * off. */
+  for (const eIMBScaleFilter filter : FILTERS) {
+    ImBuf *ibuf = gradient_image_new(32, 4);
+    EXPECT_TRUE(IMB_scaleImBuf_filtered(ibuf, 16, 2, filter));
+
+    for (int y = 0; y < 2; y++) {
+      for (int x = 3; x < 13; x++) {
+        EXPECT_NEAR(float_pixel(ibuf, x, y)[0], (x + 0.5f) * 2.0f, 1e-4f) << filter << ": " << x;
+        EXPECT_NEAR(float_pixel(ibuf, x, y)[3], 1.0f, 1e-6f);
+      }
+    }
+    IMB_freeImBuf(ibuf);
+  }
+}
+
+TEST_F(imbuf_scale_filtered, GradientUp)
+{
+  for (const eIMBScaleFilter filter : FILTERS) {
+    ImBuf *ibuf = gradient_image_new(16, 2);
+    EXPECT_TRUE(IMB_scaleImBuf_filtered(ibuf, 32, 4, filter));
+
+    for (int y = 0; y < 4; y++) {
+      for (int x = 6; x < 26; x++) {
+        /* The box filter picks the nearest pixel when scaling up. */
+        const float expect = (filter == IMB_SCALE_FILTER_BOX) ? floorf(x * 0.5f) + 0.5f :
+                                                                (x + 0.5f) * 0.5f;
+        /* Lanczos only approximately reproduces linear functions, the error is about 0.04 of
+         * the slope at quarter pixel offsets. */
+        const float threshold = (filter == IMB_SCALE_FILTER_LANCZOS3) ? 0.025f : 1e-4f;
+        EXPECT_NEAR(float_pixel(ibuf, x, y)[0], expect, threshold) << filter << ": " << x;
+      }
+    }
+    IMB_freeImBuf(ibuf);
+  }
+}
+
+TEST_F(imbuf_scale_filtered, ByteTransparentNoBleed)
+{
+  /* Opaque red next to transparent green: filtering premultiplied colors must not let the
+   * green of the transparent pixels leak into the result. */
+  for (const eIMBScaleFilter filter : FILTERS) {
+    ImBuf *ibuf = IMB_allocImBuf(8, 2, 32, IB_rect);
+    for (int y = 0; y < 2; y++) {
+      for (int x = 0; x < 8; x++) {
+        unsigned char *pixel = (unsigned char *)(ibuf->rect + y * 8 + x);
+        if (x < 4) {
+          ARRAY_SET_ITEMS(pixel, 255, 0, 0, 255);
+        }
+        else {
+          ARRAY_SET_ITEMS(pixel, 0, 255, 0, 0);
+        }
+      }
+    }
+
+    EXPECT_TRUE(IMB_scaleImBuf_filtered(ibuf, 13, 3, filter));
+    for (int i = 0; i < ibuf->x * ibuf->y; i++) {
+      const unsigned char *pixel = (unsigned char *)(ibuf->rect + i);
+      if (pixel[3] != 0) {
+        EXPECT_GE(pixel[0], 254) << filter << ": " << i;
+        EXPECT_EQ(pixel[1], 0) << filter << ": " << i;
+      }
+    }
+    IMB_freeImBuf(ibuf);
+  }
+}
+
+}  // namespace blender::imbuf::tests
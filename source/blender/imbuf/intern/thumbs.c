@@ -341,6 +341,8 @@ static ImBuf *thumb_create_ex(const char *file_path,
   short ex, ey;
   float scaledx, scaledy;
   BLI_stat_t info;
+  /* Full resolution of the source, the loaded image may be smaller. */
+  size_t source_width = 0, source_height = 0;
 
   switch (size) {
     case THB_NORMAL:
@@ -384,7 +386,7 @@ static ImBuf *thumb_create_ex(const char *file_path,
         if (img == NULL) {
           switch (source) {
             case THB_SOURCE_IMAGE:
-              img = IMB_loadiffname(file_path, IB_rect | IB_metadata, NULL);
+              img = IMB_thumb_load_image(file_path, tsize, NULL, &source_width, &source_height);
               break;
             case THB_SOURCE_BLEND:
               img = IMB_thumb_load_blend(file_path, blen_group, blen_id);
@@ -401,8 +403,12 @@ static ImBuf *thumb_create_ex(const char *file_path,
           if (BLI_stat(file_path, &info) != -1) {
             BLI_snprintf(mtime, sizeof(mtime), "%ld", (long int)info.st_mtime);
           }
-          BLI_snprintf(cwidth, sizeof(cwidth), "%d", img->x);
-          BLI_snprintf(cheight, sizeof(cheight), "%d", img->y);
+          if (source_width == 0) {
+            source_width = img->x;
+            source_height = img->y;
+          }
+          BLI_snprintf(cwidth, sizeof(cwidth), "%zu", source_width);
+          BLI_snprintf(cheight, sizeof(cheight), "%zu", source_height);
         }
       }
       else if (THB_SOURCE_MOVIE == source) {
@@ -447,7 +453,7 @@ static ImBuf *thumb_create_ex(const char *file_path,
         imb_freerectfloatImBuf(img);
       }
 
-      IMB_scaleImBuf(img, ex, ey);
+      IMB_scaleImBuf_filtered(img, ex, ey, IMB_SCALE_FILTER_BOX);
     }
     BLI_snprintf(desc, sizeof(desc), "Thumbnail for %s", uri);
     IMB_metadata_ensure(&img->metadata);
@@ -0,0 +1,153 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_rand.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+
+#include "PIL_time.h"
+
+namespace blender::imbuf::tests {
+
+/* Downscaling a 4K frame to a thumbnail sized image, the way the file browser and sequencer
+ * proxies use the scaling functions, and upscaling a preview. */
+
+#define SOURCE_WIDTH 4096
+#define SOURCE_HEIGHT 2160
+#define RUNS_NUM 5
+
+class IMB_scaling_performance : public testing::Test {
+ public:
+  static void SetUpTestCase()
+  {
+    testing::Test::SetUpTestCase();
+    IMB_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    IMB_exit();
+    testing::Test::TearDownTestCase();
+  }
+};
+
+static ImBuf *random_image_new(int width, int height, bool use_float)
+{
+  ImBuf *ibuf = IMB_allocImBuf(width, height, 32, use_float ? IB_rectfloat : IB_rect);
+  RNG *rng = BLI_rng_new(0);
+  const size_t channels_num = (size_t)width * height * 4;
+
+  if (use_float) {
+    for (size_t i = 0; i < channels_num; i++) {
+      ibuf->rect_float[i] = BLI_rng_get_float(rng);
+    }
+  }
+  else {
+    unsigned char *rect = (unsigned char *)ibuf->rect;
+    for (size_t i = 0; i < channels_num; i++) {
+      rect[i] = (unsigned char)(BLI_rng_get_uint(rng) & 0xff);
+    }
+  }
+
+  BLI_rng_free(rng);
+  return ibuf;
+}
+
+template<typename ScaleFn>
+static void scale_benchmark(const char *name,
+                            int width,
+                            int height,
+                            int new_width,
+                            int new_height,
+                            bool use_float,
+                            const ScaleFn &scale)
+{
+  ImBuf *ibuf_orig = random_image_new(width, height, use_float);
+  double time = 0.0;
+
+  for (int i = 0; i < RUNS_NUM; i++) {
+    ImBuf *ibuf = IMB_dupImBuf(ibuf_orig);
+
+    const double time_start = PIL_check_seconds_timer();
+    scale(ibuf, new_width, new_height);
+    time += PIL_check_seconds_timer() - time_start;
+
+    EXPECT_EQ(ibuf->x, new_width);
+    EXPECT_EQ(ibuf->y, new_height);
+    IMB_freeImBuf(ibuf);
+  }
+
+  printf("%s %s %dx%d -> %dx%d: %.4fs\n",
+         name,
+         use_float ? "float" : "byte",
+         width,
+         height,
+         new_width,
+         new_height,
+         time / RUNS_NUM);
+
+  IMB_freeImBuf(ibuf_orig);
+}
+
+static void scale_benchmark_all(
+    int width, int height, int new_width, int new_height, bool use_float)
+{
+  scale_benchmark(
+      "IMB_scaleImBuf", width, height, new_width, new_height, use_float, IMB_scaleImBuf);
+  scale_benchmark(
+      "IMB_scalefastImBuf", width, height, new_width, new_height, use_float, IMB_scalefastImBuf);
+  scale_benchmark("IMB_scaleImBuf_threaded",
+                  width,
+                  height,
+                  new_width,
+                  new_height,
+                  use_float,
+                  IMB_scaleImBuf_threaded);
+
+  const struct {
+    const char *name;
+    eIMBScaleFilter filter;
+  } filters[] = {
+      {"IMB_scaleImBuf_filtered box", IMB_SCALE_FILTER_BOX},
+      {"IMB_scaleImBuf_filtered bilinear", IMB_SCALE_FILTER_BILINEAR},
+      {"IMB_scaleImBuf_filtered mitchell", IMB_SCALE_FILTER_MITCHELL},
+      {"IMB_scaleImBuf_filtered lanczos3", IMB_SCALE_FILTER_LANCZOS3},
+  };
+  for (const auto &filter : filters) {
+    scale_benchmark(filter.name,
+                    width,
+                    height,
+                    new_width,
+                    new_height,
+                    use_float,
+                    [&](ImBuf *ibuf, int x, int y) {
+                      IMB_scaleImBuf_filtered(ibuf, x, y, filter.filter);
+                    });
+  }
+}
+
+TEST_F(IMB_scaling_performance, DownscaleByte)
+{
+  scale_benchmark_all(SOURCE_WIDTH, SOURCE_HEIGHT, SOURCE_WIDTH / 4, SOURCE_HEIGHT / 4, false);
+}
+
+TEST_F(IMB_scaling_performance, DownscaleFloat)
+{
+  scale_benchmark_all(SOURCE_WIDTH, SOURCE_HEIGHT, SOURCE_WIDTH / 4, SOURCE_HEIGHT / 4, true);
+}
+
+TEST_F(IMB_scaling_performance, UpscaleByte)
+{
+  scale_benchmark_all(SOURCE_WIDTH / 4, SOURCE_HEIGHT / 4, SOURCE_WIDTH, SOURCE_HEIGHT, false);
+}
+
+TEST_F(IMB_scaling_performance, UpscaleFloat)
+{
+  scale_benchmark_all(SOURCE_WIDTH / 4, SOURCE_HEIGHT / 4, SOURCE_WIDTH, SOURCE_HEIGHT, true);
+}
+
+}  // namespace blender::imbuf::tests
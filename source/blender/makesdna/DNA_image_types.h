@@ -221,6 +221,8 @@ enum {
   IMA_GPU_REFRESH = (1 << 0),
   /** All mipmap levels in OpenGL texture set? */
   IMA_GPU_MIPMAP_COMPLETE = (1 << 1),
+  /** Modified regions of image buffers need to be uploaded, see #IMB_dirty_tiles_tag. */
+  IMA_GPU_PARTIAL_REFRESH = (1 << 2),
 };
 
 /* Image.source, where the image comes from */
@@ -155,6 +155,8 @@ typedef struct PointCache {
 #define PTCACHE_IGNORE_CLEAR (1 << 13)
 
 #define PTCACHE_FLAG_INFO_DIRTY (1 << 14)
+/* Store all frames of a disk cache in a single file. */
+#define PTCACHE_DISK_CONTAINER (1 << 15)
 
 /* PTCACHE_OUTDATED + PTCACHE_FRAMES_SKIPPED */
 #define PTCACHE_REDO_NEEDED 258
@@ -87,7 +87,8 @@ PyDoc_STRVAR(py_imbuf_resize_doc,
              "\n"
              "   :arg size: New size.\n"
              "   :type size: pair of ints\n"
-             "   :arg method: Method of resizing ('FAST', 'BILINEAR')\n"
+             "   :arg method: Method of resizing ('FAST', 'BILINEAR', 'BOX', 'MITCHELL', "
+             "'LANCZOS')\n"
              "   :type method: str\n");
 static PyObject *py_imbuf_resize(Py_ImBuf *self, PyObject *args, PyObject *kw)
 {
@@ -95,10 +96,13 @@ static PyObject *py_imbuf_resize(Py_ImBuf *self, PyObject *args, PyObject *kw)
 
   uint size[2];
 
-  enum { FAST, BILINEAR };
+  enum { FAST, BILINEAR, BOX, MITCHELL, LANCZOS };
   const struct PyC_StringEnumItems method_items[] = {
       {FAST, "FAST"},
       {BILINEAR, "BILINEAR"},
+      {BOX, "BOX"},
+      {MITCHELL, "MITCHELL"},
+      {LANCZOS, "LANCZOS"},
       {0, NULL},
   };
   struct PyC_StringEnum method = {method_items, FAST};
@@ -115,6 +119,15 @@ static PyObject *py_imbuf_resize(Py_ImBuf *self, PyObject *args, PyObject *kw)
   else if (method.value_found == BILINEAR) {
     IMB_scaleImBuf(self->ibuf, UNPACK2(size));
   }
+  else if (method.value_found == BOX) {
+    IMB_scaleImBuf_filtered(self->ibuf, UNPACK2(size), IMB_SCALE_FILTER_BOX);
+  }
+  else if (method.value_found == MITCHELL) {
+    IMB_scaleImBuf_filtered(self->ibuf, UNPACK2(size), IMB_SCALE_FILTER_MITCHELL);
+  }
+  else if (method.value_found == LANCZOS) {
+    IMB_scaleImBuf_filtered(self->ibuf, UNPACK2(size), IMB_SCALE_FILTER_LANCZOS3);
+  }
   else {
     BLI_assert(0);
   }
@@ -45,13 +45,21 @@
 #include "bpy_app_icons.h"
 #include "bpy_app_timers.h"
 
+#include "BLI_listbase.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_appdir.h"
 #include "BKE_blender_version.h"
 #include "BKE_global.h"
+#include "BKE_main.h"
 
 #include "DNA_ID.h"
+#include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
+
+#include "IMB_moviecache.h"
+
+#include "SEQ_sequencer.h"
 
 #include "UI_interface_icons.h"
 
@@ -356,6 +364,65 @@ static PyObject *bpy_app_preview_render_size_get(PyObject *UNUSED(self), void *c
   return PyLong_FromLong((long)UI_icon_preview_to_render_size(POINTER_AS_INT(closure)));
 }
 
+static PyObject *bpy_app_cache_statistics_as_dict(const MovieCacheStatistics *stats)
+{
+  PyObject *dict = PyDict_New();
+  PyObject *item;
+
+#define DICT_ADD(key, value) \
+  PyDict_SetItemString(dict, key, item = (value)); \
+  Py_DECREF(item)
+
+  DICT_ADD("memory_in_use", PyLong_FromSize_t(stats->memory_in_use));
+  DICT_ADD("items", PyLong_FromLong(stats->totitem));
+  DICT_ADD("hits", PyLong_FromUnsignedLongLong(stats->hits));
+  DICT_ADD("misses", PyLong_FromUnsignedLongLong(stats->misses));
+  DICT_ADD("evictions", PyLong_FromUnsignedLongLong(stats->evictions));
+
+#undef DICT_ADD
+
+  return dict;
+}
+
+PyDoc_STRVAR(bpy_app_cache_statistics_doc,
+             "Dictionary with statistics of the in-memory image caches sharing the memory cache "
+             "limit: ``memory_limit`` in bytes, ``movie_cache`` for images, movie clips and "
+             "display buffers and ``sequencer`` for the sequencer caches of all scenes. "
+             "Each cache reports ``memory_in_use``, ``items``, ``hits``, ``misses`` and "
+             "``evictions`` (read-only)");
+static PyObject *bpy_app_cache_statistics_get(PyObject *UNUSED(self), void *UNUSED(closure))
+{
+  MovieCacheStatistics movie_stats, seq_stats = {0};
+  PyObject *ret = PyDict_New();
+  PyObject *item;
+
+  IMB_moviecache_get_statistics(&movie_stats);
+
+  if (G_MAIN) {
+    LISTBASE_FOREACH (Scene *, scene, &G_MAIN->scenes) {
+      if (scene->ed) {
+        MovieCacheStatistics stats;
+        BKE_sequencer_cache_get_statistics(scene, &stats);
+        seq_stats.memory_in_use += stats.memory_in_use;
+        seq_stats.totitem += stats.totitem;
+        seq_stats.hits += stats.hits;
+        seq_stats.misses += stats.misses;
+        seq_stats.evictions += stats.evictions;
+      }
+    }
+  }
+
+  PyDict_SetItemString(
+      ret, "memory_limit", item = PyLong_FromSize_t(((size_t)U.memcachelimit) * 1024 * 1024));
+  Py_DECREF(item);
+  PyDict_SetItemString(ret, "movie_cache", item = bpy_app_cache_statistics_as_dict(&movie_stats));
+  Py_DECREF(item);
+  PyDict_SetItemString(ret, "sequencer", item = bpy_app_cache_statistics_as_dict(&seq_stats));
+  Py_DECREF(item);
+
+  return ret;
+}
+
 static PyObject *bpy_app_autoexec_fail_message_get(PyObject *UNUSED(self), void *UNUSED(closure))
 {
   return PyC_UnicodeFromByte(G.autoexec_fail);
@@ -456,6 +523,11 @@ static PyGetSetDef bpy_app_getsets[] = {
      NULL},
     {"tempdir", bpy_app_tempdir_get, NULL, bpy_app_tempdir_doc, NULL},
     {"driver_namespace", bpy_app_driver_dict_get, NULL, bpy_app_driver_dict_doc, NULL},
+    {"cache_statistics",
+     bpy_app_cache_statistics_get,
+     NULL,
+     bpy_app_cache_statistics_doc,
+     NULL},
 
     {"render_icon_size",
      bpy_app_preview_render_size_get,
@@ -45,6 +45,7 @@
 #include "BLI_listbase.h"
 #include "BLI_math.h"
 #include "BLI_path_util.h"
+#include "BLI_profile.h"
 #include "BLI_rect.h"
 #include "BLI_string.h"
 #include "BLI_threads.h"
@@ -1588,6 +1589,8 @@ static void do_render_all_options(Render *re)
 {
   bool render_seq = false;
 
+  BLI_PROFILE_ZONE_BEGIN(zone, "Render Frame");
+
   re->current_scene_update(re->suh, re->scene);
 
   BKE_scene_camera_switch_update(re->scene);
@@ -1598,6 +1601,7 @@ static void do_render_all_options(Render *re)
   BKE_image_all_free_anim_ibufs(re->main, re->r.cfra);
   BKE_sequencer_all_free_anim_ibufs(re->scene, re->r.cfra);
 
+  BLI_PROFILE_ZONE_BEGIN(render_zone, "Render");
   if (RE_engine_render(re, 1)) {
     /* in this case external render overrides all */
   }
@@ -1614,6 +1618,7 @@ static void do_render_all_options(Render *re)
   else {
     do_render_composite(re);
   }
+  BLI_PROFILE_ZONE_END(render_zone);
 
   re->i.lastframetime = PIL_check_seconds_timer() - re->i.starttime;
 
@@ -1633,6 +1638,8 @@ static void do_render_all_options(Render *re)
       re->display_update(re->duh, re->result, NULL);
     }
   }
+
+  BLI_PROFILE_ZONE_END(zone);
 }
 
 static bool check_valid_compositing_camera(Scene *scene, Object *camera_override)
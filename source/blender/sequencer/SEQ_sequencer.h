@@ -34,6 +34,7 @@ struct GSet;
 struct ImBuf;
 struct Main;
 struct Mask;
+struct MovieCacheStatistics;
 struct ReportList;
 struct Scene;
 struct SeqIndexBuildContext;
@@ -265,6 +266,7 @@ void BKE_sequencer_cache_iterate(struct Scene *scene,
                                                     int timeline_frame,
                                                     int cache_type,
                                                     float cost));
+void BKE_sequencer_cache_get_statistics(struct Scene *scene, struct MovieCacheStatistics *r_stats);
 
 /* **********************************************************************
  * prefetch.c
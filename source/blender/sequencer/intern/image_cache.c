@@ -33,6 +33,7 @@
 #include "IMB_colormanagement.h"
 #include "IMB_imbuf.h"
 #include "IMB_imbuf_types.h"
+#include "IMB_moviecache.h"
 
 #include "BLI_blenlib.h"
 #include "BLI_endian_switch.h"
@@ -145,6 +146,8 @@ typedef struct SeqCache {
   struct SeqCacheKey *last_key;
   size_t memory_used;
   SeqDiskCache *disk_cache;
+  /* Counted since the cache was created, protected by `iterator_mutex`. */
+  uint64_t hits, misses, evictions;
 } SeqCache;
 
 typedef struct SeqCacheItem {
@@ -778,9 +781,18 @@ static void seq_cache_unlock(Scene *scene)
   }
 }
 
+/* The memory limit is shared with the movie cache (images, movie clips, display buffers).
+ * Memory used there is not available to the sequencer, but at least half of the limit is
+ * always left to the sequencer so playback does not degrade to rendering every frame. */
 static size_t seq_cache_get_mem_total(void)
 {
-  return ((size_t)U.memcachelimit) * 1024 * 1024;
+  const size_t memory_limit = ((size_t)U.memcachelimit) * 1024 * 1024;
+  const size_t memory_shared = IMB_moviecache_get_memory_in_use();
+
+  if (memory_shared > memory_limit / 2) {
+    return memory_limit - memory_limit / 2;
+  }
+  return memory_limit - memory_shared;
 }
 
 static void seq_cache_keyfree(void *val)
@@ -822,10 +834,12 @@ static ImBuf *seq_cache_get(SeqCache *cache, SeqCacheKey *key)
 
   if (item && item->ibuf) {
     IMB_refImBuf(item->ibuf);
+    cache->hits++;
 
     return item->ibuf;
   }
 
+  cache->misses++;
   return NULL;
 }
 
@@ -915,6 +929,7 @@ static void seq_cache_recycle_linked(Scene *scene, SeqCacheKey *base)
   while (base) {
     SeqCacheKey *prev = base->link_prev;
     BLI_ghash_remove(cache->hash, base, seq_cache_keyfree, seq_cache_valfree);
+    cache->evictions++;
     base = prev;
   }
 
@@ -922,6 +937,7 @@ static void seq_cache_recycle_linked(Scene *scene, SeqCacheKey *base)
   while (base) {
     next = base->link_next;
     BLI_ghash_remove(cache->hash, base, seq_cache_keyfree, seq_cache_valfree);
+    cache->evictions++;
     base = next;
   }
 }
@@ -1463,6 +1479,24 @@ void BKE_sequencer_cache_iterate(struct Scene *scene,
   seq_cache_unlock(scene);
 }
 
+void BKE_sequencer_cache_get_statistics(Scene *scene, MovieCacheStatistics *r_stats)
+{
+  SeqCache *cache = seq_cache_get_from_scene(scene);
+
+  memset(r_stats, 0, sizeof(*r_stats));
+  if (!cache) {
+    return;
+  }
+
+  seq_cache_lock(scene);
+  r_stats->memory_in_use = cache->memory_used;
+  r_stats->totitem = BLI_ghash_len(cache->hash);
+  r_stats->hits = cache->hits;
+  r_stats->misses = cache->misses;
+  r_stats->evictions = cache->evictions;
+  seq_cache_unlock(scene);
+}
+
 bool BKE_sequencer_cache_is_full(Scene *scene)
 {
   size_t memory_total = seq_cache_get_mem_total();
@@ -719,20 +719,29 @@ static void cloth_calc_force(
                                                  "effector forces");
     float(*forcevec)[3] = is_not_hair ? winvec + mvert_num : winvec;
 
+    /* Evaluate the effectors for all vertices at once. */
+    float(*motion)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * mvert_num * 2,
+                                                 "effector motion state");
+    EffectedPoint *epoints = (EffectedPoint *)MEM_mallocN(sizeof(EffectedPoint) * mvert_num,
+                                                          "effector points");
     for (i = 0; i < cloth->mvert_num; i++) {
-      float x[3], v[3];
-      EffectedPoint epoint;
+      float *x = motion[i * 2], *v = motion[i * 2 + 1];
 
       SIM_mass_spring_get_motion_state(data, i, x, v);
-      pd_point_from_loc(scene, x, v, i, &epoint);
-      BKE_effectors_apply(effectors,
-                          nullptr,
-                          clmd->sim_parms->effector_weights,
-                          &epoint,
-                          forcevec[i],
-                          winvec[i],
-                          nullptr);
+      pd_point_from_loc(scene, x, v, i, &epoints[i]);
+    }
+    BKE_effectors_apply_array(effectors,
+                              nullptr,
+                              clmd->sim_parms->effector_weights,
+                              epoints,
+                              (int)mvert_num,
+                              forcevec,
+                              winvec,
+                              nullptr);
+    MEM_freeN(epoints);
+    MEM_freeN(motion);
 
+    for (i = 0; i < cloth->mvert_num; i++) {
       has_wind = has_wind || !is_zero_v3(winvec[i]);
       has_force = has_force || !is_zero_v3(forcevec[i]);
     }
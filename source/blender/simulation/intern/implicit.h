@@ -103,6 +103,14 @@ void SIM_mass_spring_add_constraint_ndof2(struct Implicit_Data *data,
 bool SIM_mass_spring_solve_velocities(struct Implicit_Data *data,
                                       float dt,
                                       struct ImplicitSolverResult *result);
+#ifdef IMPLICIT_SOLVER_BLENDER
+/* Same as #SIM_mass_spring_solve_velocities, which uses block CSR matrices for large meshes
+ * only. Both solvers should give the same result within the solver tolerance. */
+bool SIM_mass_spring_solve_velocities_ex(struct Implicit_Data *data,
+                                         float dt,
+                                         struct ImplicitSolverResult *result,
+                                         bool use_block_csr);
+#endif
 bool SIM_mass_spring_solve_positions(struct Implicit_Data *data, float dt);
 void SIM_mass_spring_apply_result(struct Implicit_Data *data);
 
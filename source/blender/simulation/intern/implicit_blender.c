@@ -34,6 +34,7 @@
 #  include "DNA_texture_types.h"
 
 #  include "BLI_math.h"
+#  include "BLI_task.h"
 #  include "BLI_utildefines.h"
 
 #  include "BKE_cloth.h"
@@ -50,6 +51,10 @@
 #    define CLOTH_OPENMP_LIMIT 512
 #  endif
 
+#  ifdef __SSE2__
+#    include <emmintrin.h>
+#  endif
+
 //#define DEBUG_TIME
 
 #  ifdef DEBUG_TIME
@@ -658,6 +663,171 @@ DO_INLINE void subadd_bfmatrixS_bfmatrixS(
   }
 }
 
+/* ==== Block CSR matrices ==== */
+
+/* Large meshes are solved with the big matrices converted to block compressed sparse rows.
+ * Both triangles of the symmetric matrix are stored, so each row of a product only reads its own
+ * blocks and rows can be computed in parallel without locking. Vectors are processed in chunks of
+ * fixed size, dot products add up the chunk sums in order afterwards. This keeps results the same
+ * for any number of threads. */
+
+/* Solve with block CSR matrices from this many vertices, smaller meshes use cg_filtered(). */
+#  define CLOTH_CSR_MIN_VERTS 4096
+/* Vertices per task, also the granularity of dot product sums. */
+#  define CLOTH_CSR_CHUNK_SIZE 512
+
+typedef struct BlockCSR {
+  int num_rows;
+  int num_entries, entries_alloc;
+  /* First entry of every row, num_rows + 1 items. */
+  int *row_offsets;
+  /* Per entry: column, source block in the big matrix and whether it is used transposed. */
+  int *columns;
+  int *blocks;
+  bool *transposed;
+  /* Block values of A and dF/dX per entry, as columns padded to 4 floats. */
+  float (*A)[3][4];
+  float (*dFdX)[3][4];
+  /* Sums of the current chunks, for dot products. */
+  int num_chunks;
+  float *chunk_sums_a, *chunk_sums_b;
+} BlockCSR;
+
+static void block_csr_free(BlockCSR *csr)
+{
+  MEM_SAFE_FREE(csr->row_offsets);
+  MEM_SAFE_FREE(csr->columns);
+  MEM_SAFE_FREE(csr->blocks);
+  MEM_SAFE_FREE(csr->transposed);
+  MEM_SAFE_FREE(csr->A);
+  MEM_SAFE_FREE(csr->dFdX);
+  MEM_SAFE_FREE(csr->chunk_sums_a);
+  MEM_SAFE_FREE(csr->chunk_sums_b);
+  memset(csr, 0, sizeof(*csr));
+}
+
+/* Build the sparsity pattern from the diagonal blocks and the first num_blocks spring blocks.
+ * Entries of a row are ordered by their block index. */
+static void block_csr_build(BlockCSR *csr, const fmatrix3x3 *matrix, int num_blocks)
+{
+  const int numverts = matrix[0].vcount;
+  const int num_entries = numverts + 2 * num_blocks;
+  int i;
+
+  if (csr->num_rows != numverts) {
+    MEM_SAFE_FREE(csr->row_offsets);
+    MEM_SAFE_FREE(csr->chunk_sums_a);
+    MEM_SAFE_FREE(csr->chunk_sums_b);
+    csr->num_rows = numverts;
+    csr->num_chunks = (numverts + CLOTH_CSR_CHUNK_SIZE - 1) / CLOTH_CSR_CHUNK_SIZE;
+    csr->row_offsets = MEM_mallocN(sizeof(int) * (numverts + 1), "cloth csr rows");
+    csr->chunk_sums_a = MEM_mallocN(sizeof(float) * csr->num_chunks, "cloth csr sums");
+    csr->chunk_sums_b = MEM_mallocN(sizeof(float) * csr->num_chunks, "cloth csr sums");
+  }
+  if (num_entries > csr->entries_alloc) {
+    MEM_SAFE_FREE(csr->columns);
+    MEM_SAFE_FREE(csr->blocks);
+    MEM_SAFE_FREE(csr->transposed);
+    MEM_SAFE_FREE(csr->A);
+    MEM_SAFE_FREE(csr->dFdX);
+    csr->entries_alloc = num_entries;
+    csr->columns = MEM_mallocN(sizeof(int) * num_entries, "cloth csr columns");
+    csr->blocks = MEM_mallocN(sizeof(int) * num_entries, "cloth csr blocks");
+    csr->transposed = MEM_mallocN(sizeof(bool) * num_entries, "cloth csr transposed");
+    csr->A = MEM_mallocN_aligned(sizeof(*csr->A) * num_entries, 16, "cloth csr A");
+    csr->dFdX = MEM_mallocN_aligned(sizeof(*csr->dFdX) * num_entries, 16, "cloth csr dFdX");
+  }
+  csr->num_entries = num_entries;
+
+  /* Count entries per row, then turn the counts into offsets. */
+  int *row_offsets = csr->row_offsets;
+  for (i = 0; i < numverts; i++) {
+    row_offsets[i] = 1;
+  }
+  row_offsets[numverts] = 0;
+  for (i = numverts; i < numverts + num_blocks; i++) {
+    row_offsets[matrix[i].r]++;
+    row_offsets[matrix[i].c]++;
+  }
+  int offset = 0;
+  for (i = 0; i <= numverts; i++) {
+    const int count = row_offsets[i];
+    row_offsets[i] = offset;
+    offset += count;
+  }
+
+  int *fill = MEM_dupallocN(row_offsets);
+  for (i = 0; i < numverts; i++) {
+    const int e = fill[i]++;
+    csr->columns[e] = i;
+    csr->blocks[e] = i;
+    csr->transposed[e] = false;
+  }
+  for (i = numverts; i < numverts + num_blocks; i++) {
+    const int r = matrix[i].r, c = matrix[i].c;
+    int e = fill[r]++;
+    csr->columns[e] = c;
+    csr->blocks[e] = i;
+    csr->transposed[e] = false;
+    /* The lower triangle is the transposed block. */
+    e = fill[c]++;
+    csr->columns[e] = r;
+    csr->blocks[e] = i;
+    csr->transposed[e] = true;
+  }
+  MEM_freeN(fill);
+}
+
+BLI_INLINE void block_csr_set_value(float r_value[3][4], const float m[3][3], bool transposed)
+{
+  for (int j = 0; j < 3; j++) {
+    for (int i = 0; i < 3; i++) {
+      r_value[j][i] = transposed ? m[j][i] : m[i][j];
+    }
+    r_value[j][3] = 0.0f;
+  }
+}
+
+/* r = row of the matrix times x. */
+BLI_INLINE void block_csr_mul_row(float r[3],
+                                  const BlockCSR *csr,
+                                  const float (*values)[3][4],
+                                  const lfVector *x,
+                                  int row)
+{
+  const int end = csr->row_offsets[row + 1];
+#  ifdef __SSE2__
+  __m128 acc = _mm_setzero_ps();
+  for (int e = csr->row_offsets[row]; e < end; e++) {
+    const float *xc = x[csr->columns[e]];
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(values[e][0]), _mm_set1_ps(xc[0])));
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(values[e][1]), _mm_set1_ps(xc[1])));
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_load_ps(values[e][2]), _mm_set1_ps(xc[2])));
+  }
+  float result[4];
+  _mm_storeu_ps(result, acc);
+  copy_v3_v3(r, result);
+#  else
+  zero_v3(r);
+  for (int e = csr->row_offsets[row]; e < end; e++) {
+    const float *xc = x[csr->columns[e]];
+    madd_v3_v3fl(r, values[e][0], xc[0]);
+    madd_v3_v3fl(r, values[e][1], xc[1]);
+    madd_v3_v3fl(r, values[e][2], xc[2]);
+  }
+#  endif
+}
+
+/* Sum of the chunk sums in chunk order, independent of the number of threads. */
+static float block_csr_sum_chunks(const float *chunk_sums, int num_chunks)
+{
+  float sum = 0.0f;
+  for (int i = 0; i < num_chunks; i++) {
+    sum += chunk_sums[i];
+  }
+  return sum;
+}
+
 ///////////////////////////////////////////////////////////////////
 /* simulator start */
 ///////////////////////////////////////////////////////////////////
@@ -683,6 +853,8 @@ typedef struct Implicit_Data {
   lfVector *z;          /* target velocity in constrained directions */
   fmatrix3x3 *S;        /* filtering matrix for constraints */
   fmatrix3x3 *P, *Pinv; /* pre-conditioning matrix */
+
+  BlockCSR csr; /* A and dFdX as block CSR, for large meshes */
 } Implicit_Data;
 
 Implicit_Data *SIM_mass_spring_solver_create(int numverts, int numsprings)
@@ -734,6 +906,8 @@ void SIM_mass_spring_solver_free(Implicit_Data *id)
   del_lfvector(id->dV);
   del_lfvector(id->z);
 
+  block_csr_free(&id->csr);
+
   MEM_freeN(id);
 }
 
@@ -1151,10 +1325,227 @@ static int cg_filtered_pre(lfVector *dv,
 }
 #  endif
 
+/* ==== Block CSR solver ==== */
+
+typedef struct BlockCSRSolveData {
+  Implicit_Data *data;
+  BlockCSR *csr;
+  float dt;
+  /* Residual, search direction and A times the search direction. */
+  lfVector *r, *c, *q;
+  float alpha, beta;
+} BlockCSRSolveData;
+
+BLI_INLINE void block_csr_chunk_range(const BlockCSR *csr, int chunk, int *r_start, int *r_end)
+{
+  *r_start = chunk * CLOTH_CSR_CHUNK_SIZE;
+  *r_end = min_ii(*r_start + CLOTH_CSR_CHUNK_SIZE, csr->num_rows);
+}
+
+/* Assemble A = M - dt * dF/dV - dt^2 * dF/dX, compute B and initialize the CG vectors. Rows only
+ * depend on their own blocks, so all of this is done in one pass. */
+static void block_csr_solve_init_cb(void *__restrict userdata,
+                                    const int chunk,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BlockCSRSolveData *solve = userdata;
+  Implicit_Data *data = solve->data;
+  BlockCSR *csr = solve->csr;
+  const float dt = solve->dt;
+  float bnorm2 = 0.0f, delta = 0.0f;
+  int start, end;
+
+  block_csr_chunk_range(csr, chunk, &start, &end);
+  for (int i = start; i < end; i++) {
+    for (int e = csr->row_offsets[i]; e < csr->row_offsets[i + 1]; e++) {
+      const int b = csr->blocks[e];
+      float a[3][3];
+      cp_fmatrix(a, data->M[b].m);
+      subadd_fmatrixS_fmatrixS(a, data->dFdV[b].m, dt, data->dFdX[b].m, (dt * dt));
+      block_csr_set_value(csr->A[e], a, csr->transposed[e]);
+      block_csr_set_value(csr->dFdX[e], data->dFdX[b].m, csr->transposed[e]);
+    }
+
+    /* B = F * dt + dF/dX * V * dt^2 */
+    float dFdXmV[3];
+    block_csr_mul_row(dFdXmV, csr, (const float(*)[3][4])csr->dFdX, data->V, i);
+    VECADDSS(data->B[i], data->F[i], dt, dFdXmV, (dt * dt));
+
+    copy_v3_v3(data->dV[i], data->z[i]);
+
+    /* bnorm2 = filter(B)^T * filter(B) */
+    float fB[3];
+    copy_v3_v3(fB, data->B[i]);
+    mul_m3_v3(data->S[i].m, fB);
+    bnorm2 += dot_v3v3(fB, fB);
+
+    /* r = filter(B - A * dV) */
+    float AdV[3];
+    block_csr_mul_row(AdV, csr, (const float(*)[3][4])csr->A, data->z, i);
+    sub_v3_v3v3(solve->r[i], data->B[i], AdV);
+    mul_m3_v3(data->S[i].m, solve->r[i]);
+
+    /* c = filter(P^-1 * r) */
+    copy_v3_v3(solve->c[i], solve->r[i]);
+    mul_m3_v3(data->S[i].m, solve->c[i]);
+
+    delta += dot_v3v3(solve->r[i], solve->c[i]);
+  }
+  csr->chunk_sums_a[chunk] = bnorm2;
+  csr->chunk_sums_b[chunk] = delta;
+}
+
+/* q = filter(A * c), sum c^T * q */
+static void block_csr_solve_mul_cb(void *__restrict userdata,
+                                   const int chunk,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BlockCSRSolveData *solve = userdata;
+  const fmatrix3x3 *S = solve->data->S;
+  BlockCSR *csr = solve->csr;
+  float sum = 0.0f;
+  int start, end;
+
+  block_csr_chunk_range(csr, chunk, &start, &end);
+  for (int i = start; i < end; i++) {
+    block_csr_mul_row(solve->q[i], csr, (const float(*)[3][4])csr->A, solve->c, i);
+    mul_m3_v3(S[i].m, solve->q[i]);
+    sum += dot_v3v3(solve->c[i], solve->q[i]);
+  }
+  csr->chunk_sums_a[chunk] = sum;
+}
+
+/* dV += c * alpha, r -= q * alpha, sum r^T * r */
+static void block_csr_solve_step_cb(void *__restrict userdata,
+                                    const int chunk,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BlockCSRSolveData *solve = userdata;
+  lfVector *dV = solve->data->dV;
+  BlockCSR *csr = solve->csr;
+  const float alpha = solve->alpha;
+  float sum = 0.0f;
+  int start, end;
+
+  block_csr_chunk_range(csr, chunk, &start, &end);
+  for (int i = start; i < end; i++) {
+    VECADDS(dV[i], dV[i], solve->c[i], alpha);
+    VECADDS(solve->r[i], solve->r[i], solve->q[i], -alpha);
+    /* s = P^-1 * r, with P = I */
+    sum += dot_v3v3(solve->r[i], solve->r[i]);
+  }
+  csr->chunk_sums_b[chunk] = sum;
+}
+
+/* c = filter(s + c * beta) */
+static void block_csr_solve_direction_cb(void *__restrict userdata,
+                                         const int chunk,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BlockCSRSolveData *solve = userdata;
+  const fmatrix3x3 *S = solve->data->S;
+  const float beta = solve->beta;
+  int start, end;
+
+  block_csr_chunk_range(solve->csr, chunk, &start, &end);
+  for (int i = start; i < end; i++) {
+    VECADDS(solve->c[i], solve->r[i], solve->c[i], beta);
+    mul_m3_v3(S[i].m, solve->c[i]);
+  }
+}
+
+/* Vnew = V + dV */
+static void block_csr_solve_finish_cb(void *__restrict userdata,
+                                      const int chunk,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BlockCSRSolveData *solve = userdata;
+  Implicit_Data *data = solve->data;
+  int start, end;
+
+  block_csr_chunk_range(solve->csr, chunk, &start, &end);
+  for (int i = start; i < end; i++) {
+    add_v3_v3v3(data->Vnew[i], data->V[i], data->dV[i]);
+  }
+}
+
+/* Same algorithm as cg_filtered(), with the products and vector operations fused into a few
+ * parallel passes over the rows. */
+static bool solve_velocities_block_csr(Implicit_Data *data, float dt, ImplicitSolverResult *result)
+{
+  unsigned int conjgrad_loopcount = 0, conjgrad_looplimit = 100;
+  float conjgrad_epsilon = 0.01f;
+
+  unsigned int numverts = data->dFdV[0].vcount;
+  BlockCSR *csr = &data->csr;
+  float bnorm2, delta_new, delta_old, delta_target;
+
+  block_csr_build(csr, data->A, data->num_blocks);
+
+  BlockCSRSolveData solve = {
+      .data = data,
+      .csr = csr,
+      .dt = dt,
+      .r = create_lfvector(numverts),
+      .c = create_lfvector(numverts),
+      .q = create_lfvector(numverts),
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+
+  BLI_task_parallel_range(0, csr->num_chunks, &solve, block_csr_solve_init_cb, &settings);
+  bnorm2 = block_csr_sum_chunks(csr->chunk_sums_a, csr->num_chunks);
+  delta_new = block_csr_sum_chunks(csr->chunk_sums_b, csr->num_chunks);
+  delta_target = conjgrad_epsilon * conjgrad_epsilon * bnorm2;
+
+  while (delta_new > delta_target && conjgrad_loopcount < conjgrad_looplimit) {
+    BLI_task_parallel_range(0, csr->num_chunks, &solve, block_csr_solve_mul_cb, &settings);
+    solve.alpha = delta_new / block_csr_sum_chunks(csr->chunk_sums_a, csr->num_chunks);
+
+    BLI_task_parallel_range(0, csr->num_chunks, &solve, block_csr_solve_step_cb, &settings);
+    delta_old = delta_new;
+    delta_new = block_csr_sum_chunks(csr->chunk_sums_b, csr->num_chunks);
+
+    solve.beta = delta_new / delta_old;
+    BLI_task_parallel_range(0, csr->num_chunks, &solve, block_csr_solve_direction_cb, &settings);
+
+    conjgrad_loopcount++;
+  }
+
+  /* advance velocities */
+  BLI_task_parallel_range(0, csr->num_chunks, &solve, block_csr_solve_finish_cb, &settings);
+
+  del_lfvector(solve.r);
+  del_lfvector(solve.c);
+  del_lfvector(solve.q);
+
+  result->status = conjgrad_loopcount < conjgrad_looplimit ? SIM_SOLVER_SUCCESS :
+                                                             SIM_SOLVER_NO_CONVERGENCE;
+  result->iterations = conjgrad_loopcount;
+  result->error = bnorm2 > 0.0f ? sqrtf(delta_new / bnorm2) : 0.0f;
+
+  return result->status == SIM_SOLVER_SUCCESS;
+}
+
 bool SIM_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSolverResult *result)
+{
+  const bool use_block_csr = data->dFdV[0].vcount >= CLOTH_CSR_MIN_VERTS;
+  return SIM_mass_spring_solve_velocities_ex(data, dt, result, use_block_csr);
+}
+
+bool SIM_mass_spring_solve_velocities_ex(Implicit_Data *data,
+                                         float dt,
+                                         ImplicitSolverResult *result,
+                                         bool use_block_csr)
 {
   unsigned int numverts = data->dFdV[0].vcount;
 
+  if (use_block_csr) {
+    return solve_velocities_block_csr(data, dt, result);
+  }
+
   lfVector *dFdXmV = create_lfvector(numverts);
   zero_lfvector(data->dV, numverts);
 
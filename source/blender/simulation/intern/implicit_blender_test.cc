@@ -0,0 +1,148 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include <cmath>
+
+#include "BLI_math.h"
+
+#include "SIM_mass_spring.h"
+
+#include "implicit.h"
+
+#ifdef IMPLICIT_SOLVER_BLENDER
+
+namespace blender::sim::tests {
+
+/* A grid of 72 x 72 vertices, above the size from which block CSR matrices are used. */
+static const int GRID_SIZE = 72;
+static const float GRID_SPACING = 0.1f;
+
+static int grid_index(int x, int y)
+{
+  return y * GRID_SIZE + x;
+}
+
+/* Hanging cloth: the top row is pinned, the rest is bumpy and moving, so stretched structural
+ * and shear springs give the matrices off-diagonal blocks. */
+static Implicit_Data *cloth_grid_create()
+{
+  const int verts_num = GRID_SIZE * GRID_SIZE;
+  const int springs_num = 4 * verts_num;
+  Implicit_Data *data = SIM_mass_spring_solver_create(verts_num, springs_num);
+
+  float I3[3][3];
+  unit_m3(I3);
+
+  for (int y = 0; y < GRID_SIZE; y++) {
+    for (int x = 0; x < GRID_SIZE; x++) {
+      const int i = grid_index(x, y);
+      const float co[3] = {
+          x * GRID_SPACING, y * GRID_SPACING, 0.02f * sinf(x * 0.7f) * cosf(y * 1.3f)};
+      const float vel[3] = {0.1f * cosf(x * 0.3f + y), 0.0f, -0.2f * sinf(y * 0.5f)};
+
+      SIM_mass_spring_set_vertex_mass(data, i, 0.3f);
+      SIM_mass_spring_set_rest_transform(data, i, I3);
+      SIM_mass_spring_set_motion_state(data, i, co, vel);
+    }
+  }
+
+  const float zero[3] = {0.0f, 0.0f, 0.0f};
+  SIM_mass_spring_clear_constraints(data);
+  for (int x = 0; x < GRID_SIZE; x++) {
+    SIM_mass_spring_add_constraint_ndof0(data, grid_index(x, GRID_SIZE - 1), zero);
+  }
+
+  const float gravity[3] = {0.0f, 0.0f, -9.81f};
+  SIM_mass_spring_clear_forces(data);
+  for (int i = 0; i < verts_num; i++) {
+    SIM_mass_spring_force_gravity(data, i, 0.3f, gravity);
+  }
+  SIM_mass_spring_force_drag(data, 1.0f);
+
+  const float restlen = 0.9f * GRID_SPACING;
+  const float restlen_shear = restlen * (float)M_SQRT2;
+  for (int y = 0; y < GRID_SIZE; y++) {
+    for (int x = 0; x < GRID_SIZE; x++) {
+      const int i = grid_index(x, y);
+      if (x + 1 < GRID_SIZE) {
+        SIM_mass_spring_force_spring_linear(
+            data, i, grid_index(x + 1, y), restlen, 15.0f, 5.0f, 15.0f, 5.0f, true, false, 0.0f);
+      }
+      if (y + 1 < GRID_SIZE) {
+        SIM_mass_spring_force_spring_linear(
+            data, i, grid_index(x, y + 1), restlen, 15.0f, 5.0f, 15.0f, 5.0f, true, false, 0.0f);
+      }
+      if (x + 1 < GRID_SIZE && y + 1 < GRID_SIZE) {
+        SIM_mass_spring_force_spring_linear(data,
+                                            i,
+                                            grid_index(x + 1, y + 1),
+                                            restlen_shear,
+                                            5.0f,
+                                            5.0f,
+                                            5.0f,
+                                            5.0f,
+                                            true,
+                                            false,
+                                            0.0f);
+      }
+    }
+  }
+
+  return data;
+}
+
+TEST(implicit_blender, BlockCSRMatchesConjugateGradient)
+{
+  const float dt = 1.0f / 25.0f;
+  Implicit_Data *data_cg = cloth_grid_create();
+  Implicit_Data *data_csr = cloth_grid_create();
+
+  ImplicitSolverResult result_cg, result_csr;
+  EXPECT_TRUE(SIM_mass_spring_solve_velocities_ex(data_cg, dt, &result_cg, false));
+  EXPECT_TRUE(SIM_mass_spring_solve_velocities_ex(data_csr, dt, &result_csr, true));
+  EXPECT_EQ(result_cg.status, SIM_SOLVER_SUCCESS);
+  EXPECT_EQ(result_csr.status, SIM_SOLVER_SUCCESS);
+  EXPECT_GT(result_cg.iterations, 1);
+  EXPECT_NEAR(result_cg.iterations, result_csr.iterations, 1);
+
+  /* Both solve the system until the residual is below the solver tolerance, the remaining
+   * difference comes from the order of floating point operations. */
+  float max_velocity = 0.0f, max_difference = 0.0f;
+  for (int i = 0; i < GRID_SIZE * GRID_SIZE; i++) {
+    float v_cg[3], v_csr[3];
+    SIM_mass_spring_get_new_velocity(data_cg, i, v_cg);
+    SIM_mass_spring_get_new_velocity(data_csr, i, v_csr);
+    max_velocity = max_ff(max_velocity, len_v3(v_cg));
+    max_difference = max_ff(max_difference, len_v3v3(v_cg, v_csr));
+  }
+  EXPECT_GT(max_velocity, 0.1f);
+  EXPECT_LT(max_difference, 1e-3f * max_velocity);
+
+  /* Pinned vertices keep their velocity. */
+  float v_pinned[3];
+  SIM_mass_spring_get_new_velocity(data_csr, grid_index(GRID_SIZE / 2, GRID_SIZE - 1), v_pinned);
+  float v_initial[3];
+  SIM_mass_spring_get_velocity(data_csr, grid_index(GRID_SIZE / 2, GRID_SIZE - 1), v_initial);
+  EXPECT_V3_NEAR(v_pinned, v_initial, 1e-6f);
+
+  SIM_mass_spring_solver_free(data_cg);
+  SIM_mass_spring_solver_free(data_csr);
+}
+
+}  // namespace blender::sim::tests
+
+#endif /* IMPLICIT_SOLVER_BLENDER */
@@ -43,6 +43,7 @@
 
 #include "BLI_listbase.h"
 #include "BLI_path_util.h"
+#include "BLI_profile.h"
 #include "BLI_string.h"
 #include "BLI_task.h"
 #include "BLI_threads.h"
@@ -65,6 +66,7 @@
 #include "BKE_main.h"
 #include "BKE_mball_tessellate.h"
 #include "BKE_node.h"
+#include "BKE_pointcache.h"
 #include "BKE_report.h"
 #include "BKE_scene.h"
 #include "BKE_screen.h"
@@ -476,6 +478,14 @@ void WM_exit_ex(bContext *C, const bool do_python)
 {
   wmWindowManager *wm = C ? CTX_wm_manager(C) : NULL;
 
+  /* Print before data is freed, when enabled with `--debug-memory-sampling`. */
+  MEM_print_sampling_stats();
+
+  /* Write the capture started with `--profile`. */
+  if (BLI_profile_is_capturing() && !BLI_profile_capture_end()) {
+    printf("Error: failed to write the profiling capture\n");
+  }
+
   /* first wrap up running stuff, we assume only the active WM is running */
   /* modal handlers are on window level freed, others too? */
   /* note; same code copied in wm_files.c */
@@ -578,6 +588,7 @@ void WM_exit_ex(bContext *C, const bool do_python)
 #endif
 
   BKE_subdiv_exit();
+  BKE_ptcache_containers_exit();
 
   if (opengl_is_init) {
     BKE_image_free_unused_gpu_textures();
@@ -37,6 +37,7 @@
 #  include "BLI_listbase.h"
 #  include "BLI_mempool.h"
 #  include "BLI_path_util.h"
+#  include "BLI_profile.h"
 #  include "BLI_string.h"
 #  include "BLI_string_utf8.h"
 #  include "BLI_system.h"
@@ -577,6 +578,10 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_args_print_arg_doc(ba, "--debug-cycles");
 #  endif
   BLI_args_print_arg_doc(ba, "--debug-memory");
+  BLI_args_print_arg_doc(ba, "--debug-memory-sampling");
+#  ifdef WITH_PROFILE_ZONES
+  BLI_args_print_arg_doc(ba, "--profile");
+#  endif
   BLI_args_print_arg_doc(ba, "--debug-jobs");
   BLI_args_print_arg_doc(ba, "--debug-python");
   BLI_args_print_arg_doc(ba, "--debug-depsgraph");
@@ -1058,6 +1063,51 @@ static int arg_handle_debug_mode_memory_set(int UNUSED(argc),
   return 0;
 }
 
+static const char arg_handle_debug_mode_memory_sampling_set_doc[] =
+    "<bytes>\n"
+    "\tSample one allocation per <bytes> allocated, to estimate the memory used per allocation\n"
+    "\tname with little overhead. Statistics are printed on exit, by the memory statistics\n"
+    "\toperator and when receiving the SIGUSR1 signal.\n"
+    "\tNot used with the fully guarded memory allocator.";
+static int arg_handle_debug_mode_memory_sampling_set(int argc,
+                                                     const char **argv,
+                                                     void *UNUSED(data))
+{
+  const char *arg_id = "--debug-memory-sampling";
+  if (argc > 1) {
+    const char *err_msg = NULL;
+    int value;
+    if (!parse_int_clamp(argv[1], NULL, 1, INT_MAX, &value, &err_msg)) {
+      printf("\nError: %s '%s %s'.\n", err_msg, arg_id, argv[1]);
+      return 1;
+    }
+
+    MEM_enable_sampling((size_t)value);
+    app_state.signal.use_memory_sampling_handler = true;
+
+    return 1;
+  }
+  printf("\nError: you must specify the number of bytes per sample.\n");
+  return 0;
+}
+
+#  ifdef WITH_PROFILE_ZONES
+static const char arg_handle_profile_set_doc[] =
+    "<filepath>\n"
+    "\tRecord the time spent in profiling zones of all threads, until Blender exits.\n"
+    "\tThe capture is written to <filepath> in the Chrome trace format, which can be opened in\n"
+    "\t'chrome://tracing' or 'https://ui.perfetto.dev'.";
+static int arg_handle_profile_set(int argc, const char **argv, void *UNUSED(data))
+{
+  if (argc > 1) {
+    BLI_profile_capture_begin(argv[1]);
+    return 1;
+  }
+  printf("\nError: you must specify a filepath after '--profile'.\n");
+  return 0;
+}
+#  endif
+
 static const char arg_handle_debug_value_set_doc[] =
     "<value>\n"
     "\tSet debug value of <value> on startup.";
@@ -2110,6 +2160,11 @@ void main_args_setup(bContext *C, bArgs *ba)
   BLI_args_add(ba, NULL, "--debug-cycles", CB(arg_handle_debug_mode_cycles), NULL);
 #  endif
   BLI_args_add(ba, NULL, "--debug-memory", CB(arg_handle_debug_mode_memory_set), NULL);
+  BLI_args_add(
+      ba, NULL, "--debug-memory-sampling", CB(arg_handle_debug_mode_memory_sampling_set), NULL);
+#  ifdef WITH_PROFILE_ZONES
+  BLI_args_add(ba, NULL, "--profile", CB(arg_handle_profile_set), NULL);
+#  endif
 
   BLI_args_add(ba, NULL, "--debug-value", CB(arg_handle_debug_value_set), NULL);
   BLI_args_add(ba,
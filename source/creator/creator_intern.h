@@ -43,6 +43,7 @@ struct ApplicationState {
   struct {
     bool use_crash_handler;
     bool use_abort_handler;
+    bool use_memory_sampling_handler;
   } signal;
 
   /* we may want to set different exit codes for other kinds of errors */
@@ -39,6 +39,8 @@
 #  include <stdlib.h>
 #  include <string.h>
 
+#  include "MEM_guardedalloc.h"
+
 #  include "BLI_sys_types.h"
 
 #  ifdef WIN32
@@ -230,6 +232,14 @@ static void sig_handle_abort(int UNUSED(signum))
   BKE_tempdir_session_purge();
 }
 
+#  ifndef WIN32
+static void sig_handle_memory_sampling(int UNUSED(signum))
+{
+  /* Printing isn't safe here, the statistics are printed by the next sampled allocation. */
+  MEM_request_print_sampling_stats();
+}
+#  endif
+
 void main_signal_setup(void)
 {
   if (app_state.signal.use_crash_handler) {
@@ -250,6 +260,14 @@ void main_signal_setup(void)
   if (app_state.signal.use_abort_handler) {
     signal(SIGABRT, sig_handle_abort);
   }
+
+#  ifndef WIN32
+  /* Print memory statistics of the sampling heap profiler, see `--debug-memory-sampling`.
+   * Without it, keep the default action of the signal. */
+  if (app_state.signal.use_memory_sampling_handler) {
+    signal(SIGUSR1, sig_handle_memory_sampling);
+  }
+#  endif
 }
 
 void main_signal_setup_background(void)
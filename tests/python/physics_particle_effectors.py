@@ -0,0 +1,138 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# ./blender.bin --background --factory-startup --python tests/python/physics_particle_effectors.py -- --verbose
+
+import math
+import unittest
+
+import bpy
+
+
+def scene_reset():
+    scene = bpy.context.scene
+    for ob in list(scene.objects):
+        bpy.data.objects.remove(ob)
+
+
+def field_add(type, location, rotation=(0.0, 0.0, 0.0)):
+    bpy.ops.object.effector_add(type=type, location=location, rotation=rotation)
+    return bpy.context.object
+
+
+def simulate(emitter, frames):
+    scene = bpy.context.scene
+    # Setting a particle option resets the cache, so the particles are simulated again.
+    settings = emitter.particle_systems[0].settings
+    settings.frame_end = settings.frame_end
+
+    for frame in range(scene.frame_start, scene.frame_start + frames):
+        scene.frame_set(frame)
+
+    depsgraph = bpy.context.evaluated_depsgraph_get()
+    particles = emitter.evaluated_get(depsgraph).particle_systems[0].particles
+    return [(p.alive_state, p.location.copy(), p.velocity.copy()) for p in particles]
+
+
+class TestParticleEffectors(unittest.TestCase):
+    frames = 20
+
+    @classmethod
+    def setUpClass(cls):
+        scene_reset()
+
+        bpy.ops.mesh.primitive_plane_add(size=4.0)
+        cls.emitter = bpy.context.object
+        bpy.ops.object.particle_system_add()
+        settings = cls.emitter.particle_systems[0].settings
+        settings.count = 400
+        settings.frame_start = 1
+        settings.frame_end = 10
+        settings.lifetime = 100
+        settings.normal_factor = 2.0
+        settings.physics_type = 'NEWTON'
+        # The particles do not collide, so the effectors gather the colliders for the absorption
+        # themselves.
+        settings.collision_collection = bpy.data.collections.new("NoColliders")
+
+        # Covers part of the particles, absorbing some of the force of the fields above it.
+        bpy.ops.mesh.primitive_plane_add(size=3.0, location=(1.0, 0.0, 3.0))
+        bpy.ops.object.modifier_add(type='COLLISION')
+        bpy.context.object.collision.absorption = 0.6
+
+        cls.fields = [
+            field_add('FORCE', (0.0, 0.0, 6.0)),
+            field_add('WIND', (-3.0, 0.0, 2.0), (0.0, math.pi / 2.0, 0.0)),
+            field_add('VORTEX', (0.0, 0.0, 0.0)),
+        ]
+        cls.fields[0].field.strength = 8.0
+        cls.fields[1].field.strength = 4.0
+        cls.fields[2].field.strength = 2.0
+        for ob in cls.fields:
+            ob.field.use_absorption = True
+
+    def simulate(self):
+        return simulate(self.emitter, self.frames)
+
+    def assertParticlesEqual(self, result, expected):
+        self.assertEqual(len(result), len(expected))
+        for (state, location, velocity), (state_ex, location_ex, velocity_ex) in zip(result, expected):
+            self.assertEqual(state, state_ex)
+            self.assertAlmostEqual((location - location_ex).length, 0.0, delta=1e-5)
+            self.assertAlmostEqual((velocity - velocity_ex).length, 0.0, delta=1e-5)
+
+    def test_precalc_matches_per_particle(self):
+        # The effectors of the first integration step are evaluated for all particles at once.
+        expected = self.simulate()
+
+        # A noisy field makes the particle system evaluate the effectors per particle. It is out
+        # of reach of all particles, so the forces are the same.
+        dummy = field_add('FORCE', (100.0, 0.0, 0.0))
+        dummy.field.noise = 1.0
+        dummy.field.use_max_distance = True
+        dummy.field.distance_max = 1.0
+        try:
+            result = self.simulate()
+        finally:
+            bpy.data.objects.remove(dummy)
+
+        self.assertParticlesEqual(result, expected)
+
+    def test_absorption(self):
+        # Make sure the fields and the absorption of the collider did something at all.
+        expected = self.simulate()
+        for ob in self.fields:
+            ob.field.use_absorption = False
+        try:
+            result = self.simulate()
+        finally:
+            for ob in self.fields:
+                ob.field.use_absorption = True
+
+        self.assertEqual(len(result), len(expected))
+        difference = max((location - location_ex).length
+                         for (_, location, _), (_, location_ex, _) in zip(result, expected))
+        self.assertGreater(difference, 1e-3)
+
+
+if __name__ == "__main__":
+    import sys
+    sys.argv = [__file__] + (sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else [])
+    unittest.main()
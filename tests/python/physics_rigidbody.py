@@ -0,0 +1,152 @@
+# ##### BEGIN GPL LICENSE BLOCK #####
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version 2
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program; if not, write to the Free Software Foundation,
+#  Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# ##### END GPL LICENSE BLOCK #####
+
+# <pep8 compliant>
+
+# ./blender.bin --background --factory-startup --python tests/python/physics_rigidbody.py -- --verbose
+
+import unittest
+
+import bpy
+
+
+def scene_reset_with_ground():
+    scene = bpy.context.scene
+    for ob in list(scene.objects):
+        bpy.data.objects.remove(ob)
+
+    if scene.rigidbody_world is not None:
+        bpy.ops.rigidbody.world_remove()
+    bpy.ops.rigidbody.world_add()
+
+    bpy.ops.mesh.primitive_plane_add(size=50.0)
+    bpy.ops.rigidbody.object_add(type='PASSIVE')
+
+
+def simulate(frames, use_multithreading):
+    scene = bpy.context.scene
+    # Setting the option resets the cache, so the world is rebuilt and simulated again.
+    scene.rigidbody_world.use_multithreading = use_multithreading
+
+    for frame in range(scene.frame_start, scene.frame_start + frames):
+        scene.frame_set(frame)
+
+    return [ob.matrix_world.copy() for ob in scene.objects if ob.rigid_body.type == 'ACTIVE']
+
+
+class TestRigidBodyMultithreading(unittest.TestCase):
+    frames = 60
+
+    @classmethod
+    def setUpClass(cls):
+        scene = bpy.context.scene
+        scene_reset_with_ground()
+
+        # Several piles of cubes, so there are many contacts and separate islands to solve.
+        for x in range(4):
+            for y in range(4):
+                for z in range(5):
+                    bpy.ops.mesh.primitive_cube_add(
+                        size=1.0,
+                        location=(x * 3.0 + z * 0.1, y * 3.0, z * 1.05 + 0.5),
+                        rotation=(0.0, 0.0, z * 0.2),
+                    )
+                    bpy.ops.rigidbody.object_add(type='ACTIVE')
+
+        scene.rigidbody_world.point_cache.frame_end = cls.frames
+
+    def simulate(self, use_multithreading):
+        return simulate(self.frames, use_multithreading)
+
+    def test_deterministic(self):
+        expected = self.simulate(True)
+        for _ in range(2):
+            self.assertEqual(self.simulate(True), expected)
+
+    def test_collisions(self):
+        result = self.simulate(True)
+        self.assertEqual(len(result), 4 * 4 * 5)
+
+        # Cubes start 0.05 apart, so every pile has to settle lower than it started, without
+        # falling through the ground or each other.
+        top_start = 4 * 1.05 + 0.5
+        top = max(matrix.translation.z for matrix in result)
+        self.assertLess(top, top_start - 0.1)
+        self.assertGreater(top, 2.0)
+        for matrix in result:
+            self.assertGreater(matrix.translation.z, 0.45)
+
+        # Islands are solved in a different order than in the single threaded world, so the
+        # individual cubes differ, but the piles settle the same way.
+        expected = self.simulate(False)
+        height = sum(matrix.translation.z for matrix in result) / len(result)
+        expected_height = sum(matrix.translation.z for matrix in expected) / len(expected)
+        self.assertAlmostEqual(height, expected_height, delta=0.1)
+
+
+class TestRigidBodyCompoundMultithreading(unittest.TestCase):
+    frames = 60
+
+    @classmethod
+    def setUpClass(cls):
+        scene = bpy.context.scene
+        scene_reset_with_ground()
+
+        # Piles of compound shapes, made of three cubes each. Every child has its own contact
+        # manifold with the bodies it touches, so there are several manifolds per pair of bodies.
+        for x in range(3):
+            for y in range(3):
+                for z in range(3):
+                    location = (x * 4.0 + z * 0.3, y * 4.0, z * 1.6 + 0.6)
+                    bpy.ops.mesh.primitive_cube_add(
+                        size=1.0,
+                        location=location,
+                        rotation=(0.0, 0.0, z * 0.7 + x * 0.2),
+                    )
+                    parent = bpy.context.object
+                    bpy.ops.rigidbody.object_add(type='ACTIVE')
+                    parent.rigid_body.collision_shape = 'COMPOUND'
+
+                    for offset in ((1.0, 0.0, 0.0), (0.0, 1.0, 0.0), (-1.0, 0.0, 0.5)):
+                        bpy.ops.mesh.primitive_cube_add(size=0.9)
+                        child = bpy.context.object
+                        bpy.ops.rigidbody.object_add(type='ACTIVE')
+                        child.parent = parent
+                        child.location = offset
+
+        scene.rigidbody_world.point_cache.frame_end = cls.frames
+
+    def test_deterministic(self):
+        scene = bpy.context.scene
+        scene.frame_set(scene.frame_start)
+        start = [ob.matrix_world.copy() for ob in scene.objects if ob.rigid_body.type == 'ACTIVE']
+        expected = simulate(self.frames, True)
+
+        # The compound shapes start apart, so they have to fall and settle on each other.
+        height_start = sum(matrix.translation.z for matrix in start) / len(start)
+        height = sum(matrix.translation.z for matrix in expected) / len(expected)
+        self.assertLess(height, height_start - 0.1)
+
+        for _ in range(3):
+            self.assertEqual(simulate(self.frames, True), expected)
+
+
+if __name__ == "__main__":
+    import sys
+    sys.argv = [__file__] + (sys.argv[sys.argv.index("--") + 1:] if "--" in sys.argv else [])
+    unittest.main()